@@ -76,6 +76,8 @@ public:
     bool authenticatedByConf{false};
     bool autoFilenameIncrementBool = true;
     bool savePlyAsBinary{true};
+    bool saveMeshesCompressed{false};
+    bool saveSkeletonAsColumns{false};
     bool unsavedChanges = false;
 
     QFlags<AnnotationMode> annotationMode;
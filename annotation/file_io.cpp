@@ -24,6 +24,7 @@
 
 #include "annotation/annotation.h"
 #include "loader.h"
+#include "mesh/mesharrays.h"
 #include "widgets/mainwindow.h"
 #include "scriptengine/scripting.h"
 #include "segmentation/segmentation.h"
@@ -49,7 +50,13 @@
 #include <QTemporaryFile>
 
 
+#include <algorithm>
+#include <cstdint>
 #include <ctime>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
 
 QString annotationFileDefaultName() {// Generate a default file name based on date and time.
     // ISO 8601 combined date and time in basic format (extended format cannot be used because Windows doesn’t allow ›:‹)
@@ -194,36 +201,47 @@ void annotationFileLoad(const QString & filename, bool mergeSkeleton, const QStr
             Segmentation::singleton().jobLoad(file);
         });
         //load skeleton after mergelist as it may depend on a loaded segmentation
+        boost::optional<SkeletonColumns> columns;
+        getSpecificFile("skeleton.kcs", [&columns](auto & file){
+            columns = SkeletonColumns::read(file);
+        });
         std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> treeMap;
-        getSpecificFile("annotation.xml", [&treeMap, mergeSkeleton, treeCmtOnMultiLoad](auto & file){
-            treeMap = Skeletonizer::singleton().loadXmlSkeleton(file, mergeSkeleton, treeCmtOnMultiLoad);
+        getSpecificFile("annotation.xml", [&treeMap, &columns, mergeSkeleton, treeCmtOnMultiLoad](auto & file){
+            treeMap = Skeletonizer::singleton().loadXmlSkeleton(file, mergeSkeleton, treeCmtOnMultiLoad, columns ? &columns.get() : nullptr);
         });
+        const auto meshTreeId = [&treeMap, &mergeSkeleton](const QString & fileName) -> boost::optional<std::uint64_t> {
+            bool validId = false;
+            const auto treeId = QFileInfo{fileName}.completeBaseName().toULongLong(&validId);
+            if (!validId) {
+                qDebug() << "Filename not of the form <tree id>.ply, so loading as new tree:" << fileName;
+                return boost::none;
+            } else if (mergeSkeleton) {
+                const auto iter = treeMap.find(treeId);
+                if (iter != std::end(treeMap)) {
+                    return iter->second.get().treeID;
+                } else if (!Skeletonizer::singleton().findTreeByTreeID(treeId)) {
+                    qDebug() << "Tree not found for this mesh, loading as new tree:" << fileName;
+                    return boost::none;
+                }
+            }
+            return treeId;
+        };
+        std::vector<std::tuple<QString, boost::optional<std::uint64_t>, QByteArray>> encodedMeshes;
         for (auto valid = archive.goToFirstFile(); valid; valid = archive.goToNextFile()) { // after annotation.xml, because loading .xml clears skeleton
             const QRegularExpression meshRegEx(R"regex([0-9]*\.ply)regex");
+            const QRegularExpression encodedMeshRegEx(R"regex([0-9]*\.kmesh)regex");
             const QRegularExpression nmlRegEx(R"regex(.*\.nml)regex");
             auto fileName = archive.getCurrentFileName();
             if (meshRegEx.match(fileName).hasMatch()) {
                 nonExtraFiles.insert(fileName);
                 QuaZipFile file(&archive);
-                auto nameWithoutExtension = fileName;
-                nameWithoutExtension.chop(4);
-                bool validId = false;
-                auto treeId = boost::make_optional<std::uint64_t>(nameWithoutExtension.toULongLong(&validId));
-                if (!validId) {
-                    qDebug() << "Filename not of the form <tree id>.ply, so loading as new tree:" << fileName;
-                    treeId = boost::none;
-                } else if (mergeSkeleton) {
-                    const auto iter = treeMap.find(treeId.get());
-                    if (iter != std::end(treeMap)) {
-                        treeId = iter->second.get().treeID;
-                    } else {
-                        if (!Skeletonizer::singleton().findTreeByTreeID(treeId.get())) {
-                            qDebug() << "Tree not found for this mesh, loading as new tree:" << fileName;
-                            treeId = boost::none;
-                        }
-                    }
-                }
-                Skeletonizer::singleton().loadMesh(file, treeId, fileName);
+                Skeletonizer::singleton().loadMesh(file, meshTreeId(fileName), fileName);
+            }
+            if (encodedMeshRegEx.match(fileName).hasMatch()) {// decoded together below
+                nonExtraFiles.insert(fileName);
+                QuaZipFile file(&archive);
+                file.open(QIODevice::ReadOnly);
+                encodedMeshes.emplace_back(fileName, meshTreeId(fileName), file.readAll());
             }
             if (nmlRegEx.match(fileName).hasMatch()) {// PyK *.nml inside an *.nmx
                 nonExtraFiles.insert(fileName);
@@ -232,6 +250,31 @@ void annotationFileLoad(const QString & filename, bool mergeSkeleton, const QStr
                 mergeSkeleton = true;// support loading multiple files
             }
         }
+        std::vector<std::size_t> meshIds(encodedMeshes.size());
+        std::iota(std::begin(meshIds), std::end(meshIds), 0);
+        std::vector<MeshArrays> meshes(encodedMeshes.size());
+        std::vector<std::string> meshErrors(encodedMeshes.size());
+        QtConcurrent::blockingMap(meshIds, [&encodedMeshes, &meshes, &meshErrors](const std::size_t id){
+            QBuffer buffer(&std::get<2>(encodedMeshes[id]));
+            try {
+                meshes[id] = MeshArrays::read(buffer);
+            } catch (const std::runtime_error & e) {
+                meshErrors[id] = e.what();
+            }
+        });
+        for (const auto id : meshIds) {
+            const auto & [fileName, treeId, data] = encodedMeshes[id];
+            if (!meshErrors[id].empty()) {
+                throw std::runtime_error((fileName + ": " + QString::fromStdString(meshErrors[id])).toStdString());
+            }
+            auto & mesh = meshes[id];
+            auto meshTree = treeId;
+            if (!meshTree) {
+                meshTree = Skeletonizer::singleton().addTree(boost::none, boost::none, {{"comment", fileName}}).treeID;
+            }
+            Skeletonizer::singleton().addMeshToTree(meshTree, mesh.vertices, mesh.normals, mesh.indices, mesh.colors);
+            mesh = {};
+        }
         state->viewer->loader_notify();
         for (auto valid = archive.goToFirstFile(); valid; valid = archive.goToNextFile()) {
             if (!nonExtraFiles.contains(archive.getCurrentFileName())) {
@@ -268,6 +311,49 @@ void annotationFileSave(const QString & filename, const bool onlySelectedTrees,
                 compressed_data.remove(0, 6);// remove 4 byte Qt header and 2 byte zlib header
                 compressed_data.remove(compressed_data.size() - 4, 4);// remove 4 byte zlib trailer
             }
+            void deflateChunked(const QByteArray & data) {// chunks are deflated in parallel and joined by sync flushes
+                const int chunkSize = 1 << 20;
+                const int window = 1 << 15;
+                std::vector<int> ids(std::max(1, (data.size() + chunkSize - 1) / chunkSize));
+                std::iota(std::begin(ids), std::end(ids), 0);
+                std::vector<QByteArray> chunks(ids.size());
+                std::vector<uLong> crcs(ids.size());
+                std::vector<std::uint8_t> failed(ids.size(), false);
+                QtConcurrent::blockingMap(ids, [&data, &chunks, &crcs, &failed, chunkSize, window, last = ids.size() - 1](const int id){
+                    const auto * begin = reinterpret_cast<const Bytef *>(data.data()) + id * chunkSize;
+                    const auto length = static_cast<uInt>(std::min(chunkSize, data.size() - id * chunkSize));
+                    crcs[id] = crc32(crc32(0L, Z_NULL, 0), begin, length);
+                    z_stream stream{};
+                    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                        failed[id] = true;
+                        return;
+                    }
+                    if (id != 0) {// the preceding input as dictionary keeps the ratio close to a single stream
+                        deflateSetDictionary(&stream, begin - window, window);
+                    }
+                    auto & chunk = chunks[id];
+                    chunk.resize(static_cast<int>(deflateBound(&stream, length) + 16));// a sync flush appends an empty stored block
+                    stream.next_in = const_cast<Bytef *>(begin);
+                    stream.avail_in = length;
+                    stream.next_out = reinterpret_cast<Bytef *>(chunk.data());
+                    stream.avail_out = static_cast<uInt>(chunk.size());
+                    const auto finish = static_cast<std::size_t>(id) == last;
+                    const auto result = ::deflate(&stream, finish ? Z_FINISH : Z_SYNC_FLUSH);
+                    failed[id] = stream.avail_in != 0 || result != (finish ? Z_STREAM_END : Z_OK);
+                    chunk.resize(static_cast<int>(stream.total_out));
+                    deflateEnd(&stream);
+                });
+                if (std::find(std::begin(failed), std::end(failed), true) != std::end(failed)) {
+                    throw std::runtime_error("deflate failed");
+                }
+                size = data.size();
+                crc = crcs.front();
+                compressed_data = chunks.front();
+                for (std::size_t id = 1; id < chunks.size(); ++id) {
+                    crc = crc32_combine(crc, crcs[id], std::min(chunkSize, data.size() - static_cast<int>(id) * chunkSize));
+                    compressed_data += chunks[id];
+                }
+            }
         };
         auto zipCreateFile = [](QuaZipFile & file_write, const QString & name, const int level = Z_BEST_SPEED, const uLong size = 0, const quint32 crc = 0){
             auto fileinfo = QuaZipNewInfo(name);
@@ -284,9 +370,27 @@ void annotationFileSave(const QString & filename, const bool onlySelectedTrees,
                 throw std::runtime_error((filename + ": saving extra file %1 failed").arg(it.key()).toStdString());
             }
         }
+        const auto skeletonAsColumns = Annotation::singleton().saveSkeletonAsColumns && !onlySelectedTrees;
+        if (skeletonAsColumns) {// the trees go to skeleton.kcs, annotation.xml keeps the rest
+            QBuffer columns;
+            columns.open(QIODevice::WriteOnly);
+            Skeletonizer::singleton().saveColumnarSkeleton(columns);
+            QuaZipFile file_write(&archive_write);
+            if (zipCreateFile(file_write, "skeleton.kcs", Z_NO_COMPRESSION)) {// chunks are compressed already
+                file_write.write(columns.data());
+            } else {
+                throw std::runtime_error((filename + ": saving skeleton columns failed").toStdString());
+            }
+        }
+        QBuffer skeleton;
+        skeleton.open(QIODevice::WriteOnly);
+        Skeletonizer::singleton().saveXmlSkeleton(skeleton, onlySelectedTrees, saveTime, saveDatasetPath, !skeletonAsColumns);
+        skeleton.close();
+        zip_data annotation;
+        annotation.deflateChunked(skeleton.data());
         QuaZipFile file_write(&archive_write);
-        if (zipCreateFile(file_write, "annotation.xml")) {
-            Skeletonizer::singleton().saveXmlSkeleton(file_write, onlySelectedTrees, saveTime, saveDatasetPath);
+        if (zipCreateFile(file_write, "annotation.xml", Z_BEST_SPEED, annotation.size, annotation.crc)) {
+            file_write.write(annotation.compressed_data);
         } else {
             throw std::runtime_error((filename + ": saving skeleton failed").toStdString());
         }
@@ -310,10 +414,15 @@ void annotationFileSave(const QString & filename, const bool onlySelectedTrees,
         time.start();
         std::vector<std::reference_wrapper<const treeListElement>> trees;
         std::vector<decltype(Skeletonizer::singleton().getMesh(std::declval<treeListElement>()))> mesh_parts;
+        std::vector<QVector<GLfloat>> mesh_normals;
+        const auto encodeMeshes = Annotation::singleton().saveMeshesCompressed;
         for (const auto & tree : state->skeletonState->trees) {
             if ((!onlySelectedTrees || tree.selected) && tree.mesh != nullptr) {
                 trees.emplace_back(tree);
                 mesh_parts.emplace_back(Skeletonizer::singleton().getMesh(tree));
+                if (encodeMeshes) {// spares recomputing them on load
+                    mesh_normals.emplace_back(Skeletonizer::singleton().getMeshNormals(tree));
+                }
             }
         }
         qDebug() << "retrieving meshes" << time.nsecsElapsed() / 1e9;
@@ -322,13 +431,19 @@ void annotationFileSave(const QString & filename, const bool onlySelectedTrees,
         std::vector<zip_data> compressed_meshes(mesh_parts.size());
         std::iota(std::begin(ids), std::end(ids), 0);
         try {
-            QtConcurrent::blockingMap(ids, [&trees, &mesh_parts, &compressed_meshes](const auto id){
+            QtConcurrent::blockingMap(ids, [&trees, &mesh_parts, &mesh_normals, &compressed_meshes, encodeMeshes](const auto id){
                 QBuffer buffer;
                 buffer.open(QIODevice::WriteOnly);
                 const auto & [vertex_components, colors, indices] = mesh_parts[id];
-                Skeletonizer::singleton().saveMesh(buffer, trees[id], vertex_components, colors, indices);
-                buffer.close();
-                compressed_meshes[id].deflate(buffer.data());
+                if (encodeMeshes) {
+                    const auto treeColors = trees[id].get().mesh->useTreeColor;
+                    MeshArrays{vertex_components, mesh_normals[id], treeColors ? QVector<std::uint8_t>{} : colors, indices}.write(buffer);
+                    compressed_meshes[id].compressed_data = buffer.data();
+                } else {
+                    Skeletonizer::singleton().saveMesh(buffer, trees[id], vertex_components, colors, indices);
+                    buffer.close();
+                    compressed_meshes[id].deflate(buffer.data());
+                }
             });
         } catch (QException & e) {// any exception gets rethrown as Q(Unhandled)Exception but we only handle std::exception upwards
             throw std::runtime_error("couldn’t generate ply");
@@ -337,8 +452,10 @@ void annotationFileSave(const QString & filename, const bool onlySelectedTrees,
         time.restart();
         for (const auto & id : ids) {
             QuaZipFile file_write(&archive_write);
-            const auto filename = QString::number(trees[id].get().treeID) + ".ply";
-            if (zipCreateFile(file_write, filename, Z_BEST_SPEED, compressed_meshes[id].size, compressed_meshes[id].crc)) {
+            const auto filename = QString::number(trees[id].get().treeID) + (encodeMeshes ? ".kmesh" : ".ply");
+            const auto created = encodeMeshes ? zipCreateFile(file_write, filename, Z_NO_COMPRESSION)// streams are compressed already
+                                              : zipCreateFile(file_write, filename, Z_BEST_SPEED, compressed_meshes[id].size, compressed_meshes[id].crc);
+            if (created) {
                 file_write.write(compressed_meshes[id].compressed_data);
             } else {
                 throw std::runtime_error((filename + ": saving mesh failed").toStdString());
@@ -348,6 +465,7 @@ void annotationFileSave(const QString & filename, const bool onlySelectedTrees,
         if (!onlySelectedTrees && Segmentation::singleton().enabled) {
             QElapsedTimer cubeTime;
             cubeTime.start();
+            Segmentation::singleton().downsampler.waitForFinished();// coarser mags of the latest strokes
             const auto guard = Loader::Controller::singleton().getAllModifiedCubes(Segmentation::singleton().layerId);
             const auto & cubes = guard.cubes;
             for (std::size_t i = 0; i < cubes.size(); ++i) {
@@ -587,3 +587,14 @@ bool Dataset::isOverlay() const {
             || type == CubeType::SEGMENTATION_SZ_ZIP
             || type == CubeType::SNAPPY;
 }
+
+Dataset Dataset::atMagIndex(const std::size_t index) const {
+    auto dataset = *this;
+    dataset.magIndex = index;
+    dataset.magnification = 1 << index;
+    if (scales.size() > index) {
+        dataset.scale = scales[index];
+        dataset.scaleFactor = dataset.scale / scales[0];
+    }
+    return dataset;
+}
@@ -66,6 +66,7 @@ struct Dataset {
     QUrl openConnectomeCubeUrl(CoordOfCube coord) const;
 
     bool isOverlay() const;
+    Dataset atMagIndex(const std::size_t index) const;
 
     CoordOfCube global2cube(const Coordinate & globalCoord) const {
         return globalCoord.cube(cubeShape, scaleFactor);
@@ -25,6 +25,7 @@
 #include "brainmaps.h"
 #include "functions.h"
 #include "network.h"
+#include "segmentation/palettecube.h"
 #include "segmentation/segmentation.h"
 #include "skeleton/skeletonizer.h"
 #include "stateInfo.h"
@@ -50,6 +51,7 @@
 
 #include <cmath>
 #include <fstream>
+#include <numeric>
 #include <stdexcept>
 #include <type_traits>
 
@@ -65,6 +67,29 @@ auto insideCurrentSupercubeWrap = [](const Coordinate & center, const Dataset &
     };
 };
 
+// overlay cubes are only edited at the current mag, so only raw layers keep coarser mags as preview
+static bool hasFallback(const Dataset & dataset) {
+    return !dataset.isOverlay();
+}
+
+// upper bound of fallback cubes covering the supercube for any current mag
+static std::size_t fallbackCubeCount(const Dataset & dataset) {
+    const auto magCount = static_cast<std::size_t>(std::log2(dataset.highestAvailableMag) + 1);
+    std::size_t maxCount{0};
+    for (std::size_t mag{0}; mag < magCount; ++mag) {
+        std::size_t count{0};
+        for (auto coarse = mag + 1; coarse < std::min(magCount, mag + 1 + Loader::fallbackMagCount); ++coarse) {
+            const auto ratio = dataset.atMagIndex(coarse).scaleFactor / dataset.atMagIndex(mag).scaleFactor;
+            const auto edge = [](const float r){// supercube extent in coarse cubes plus one for misalignment
+                return static_cast<std::size_t>(std::ceil((state->M - 1) / std::max(1.f, std::round(r)))) + 1;
+            };
+            count += edge(ratio.x) * edge(ratio.y) * edge(ratio.z);
+        }
+        maxCount = std::max(maxCount, count);
+    }
+    return maxCount;
+}
+
 void Loader::Controller::suspendLoader() {
     ++loadingNr;
     workerThread.quit();
@@ -82,8 +107,21 @@ Loader::Controller::Controller() {
     QObject::connect(worker.get(), &Loader::Worker::progress, this, &Loader::Controller::refCountChange);
     QObject::connect(this, &Loader::Controller::loadSignal, worker.get(), &Loader::Worker::downloadAndLoadCubes, Qt::QueuedConnection);// avoid deadlock via snappyCacheClear
     QObject::connect(this, &Loader::Controller::unloadCurrentMagnificationSignal, worker.get(), static_cast<void(Loader::Worker::*)()>(&Loader::Worker::unloadCurrentMagnification), Qt::BlockingQueuedConnection);
+    QObject::connect(this, &Loader::Controller::demoteCurrentMagnificationSignal, worker.get(), &Loader::Worker::demoteCurrentMagnification, Qt::BlockingQueuedConnection);
     QObject::connect(this, &Loader::Controller::markCubeAsModifiedSignal, worker.get(), &Loader::Worker::markCubeAsModified, Qt::BlockingQueuedConnection);
     QObject::connect(this, &Loader::Controller::snappyCacheSupplySnappySignal, worker.get(), &Loader::Worker::snappyCacheSupplySnappy, Qt::BlockingQueuedConnection);
+    QObject::connect(this, &Loader::Controller::expandCubeSignal, worker.get(), &Loader::Worker::expandCube, Qt::BlockingQueuedConnection);
+    QObject::connect(this, &Loader::Controller::repackCubesSignal, worker.get(), &Loader::Worker::repackCubes, Qt::BlockingQueuedConnection);
+    repackTimer.setSingleShot(true);
+    repackTimer.setInterval(2000);
+    // blocks the gui thread, so no brush writes into the cubes while they are packed
+    QObject::connect(&repackTimer, &QTimer::timeout, this, [this](){
+        if (workerThread.isRunning()) {
+            emit repackCubesSignal();
+        } else if (worker) {
+            worker->repackCubes();
+        }
+    });
     workerThread.start();
 }
 
@@ -102,9 +140,27 @@ void Loader::Controller::unloadCurrentMagnification() {
     }
 }
 
+void Loader::Controller::demoteCurrentMagnification() {
+    ++loadingNr;
+    if (workerThread.isRunning()) {
+        emit demoteCurrentMagnificationSignal();
+    } else if (worker) {
+        worker->demoteCurrentMagnification();
+    }
+}
+
 void Loader::Controller::markCubeAsModified(const std::size_t layerId, const CoordOfCube &cubeCoord, const int magnification) {
     emit markCubeAsModifiedSignal(layerId, cubeCoord, magnification);
     state->viewer->reslice_notify_all(layerId, cubeCoord);
+    repackTimer.start();// edited cubes stay expanded until the strokes pause
+}
+
+void Loader::Controller::expandCube(const std::size_t layerId, const std::size_t magIndex, const CoordOfCube & cubeCoord) {
+    if (workerThread.isRunning()) {
+        emit expandCubeSignal(layerId, magIndex, cubeCoord);
+    } else if (worker) {
+        worker->expandCube(layerId, magIndex, cubeCoord);
+    }
 }
 
 bool Loader::Controller::isFinished() {
@@ -246,6 +302,11 @@ Loader::Worker::~Worker() {
             elem.clear();
         }
     }
+    for (auto & layer : state->cube2Palette) {
+        for (auto & elem : layer) {
+            elem.clear();
+        }
+    }
 }
 
 template<typename CubeHash, typename Slots, typename Keep>
@@ -266,8 +327,26 @@ void unloadCubes(CubeHash & loadedCubes, Slots & freeSlots, Keep keep, UnloadHoo
     }
 }
 
+// packed cubes own their memory, readers may still hold them
+template<typename PaletteHash, typename Keep, typename UnloadHook>
+void unloadPalettes(PaletteHash & loadedCubes, Keep keep, UnloadHook todo) {
+    for (auto it = std::begin(loadedCubes); it != std::end(loadedCubes);) {
+        if (!keep(it->first)) {
+            todo(it->first);
+            it = loadedCubes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+template<typename PaletteHash, typename Keep>
+void unloadPalettes(PaletteHash & loadedCubes, Keep keep) {
+    unloadPalettes(loadedCubes, keep, [](const CoordOfCube &){});
+}
+
 void Loader::Worker::unloadCurrentMagnification(const std::size_t layerId) {
-    abortDownloadsFinishDecompression(layerId, [](const CoordOfCube &){return false;});
+    abortDownloadsFinishDecompression(layerId, [](std::size_t, const CoordOfCube &){return false;});
     QMutexLocker locker(&state->protectCube2Pointer);
     if (loaderMagnification >= state->cube2Pointer[layerId].size()) {
         return;
@@ -284,14 +363,80 @@ void Loader::Worker::unloadCurrentMagnification(const std::size_t layerId) {
         state->viewer->reslice_notify_all(layerId, cubeCoord);
     }
     state->cube2Pointer[layerId][loaderMagnification].clear();
+    unloadPalettes(state->cube2Palette[layerId][loaderMagnification], [](const CoordOfCube &){ return false; }, [layerId](const CoordOfCube & cubeCoord){
+        state->viewer->reslice_notify_all(layerId, cubeCoord);
+    });
 }
 
 void Loader::Worker::unloadCurrentMagnification() {
     for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
         unloadCurrentMagnification(layerId);
+        unloadFallbackMagnifications(layerId);
     }
 }
 
+void Loader::Worker::demoteCurrentMagnification() {
+    for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
+        if (hasFallback(datasets[layerId])) {// keep loaded cubes until the new mag replaces them
+            abortDownloadsFinishDecompression(layerId, [](std::size_t, const CoordOfCube &){return false;});
+        } else {
+            unloadCurrentMagnification(layerId);
+        }
+    }
+}
+
+std::vector<std::pair<std::size_t, CoordOfCube>> Loader::Worker::fallbackCubes(const std::size_t layerId, const Coordinate & center) const {
+    std::vector<std::pair<std::size_t, CoordOfCube>> cubes;
+    const auto & dataset = datasets[layerId];
+    if (!hasFallback(dataset)) {
+        return cubes;
+    }
+    const auto magCount = static_cast<std::size_t>(std::log2(dataset.highestAvailableMag) + 1);
+    const auto halfFOV = dataset.atMagIndex(loaderMagnification).cube2global({1,1,1}) * (state->M - 1) / 2;
+    // coarsest first, it is the quickest to cover the viewports
+    for (auto mag = std::min(magCount, loaderMagnification + 1 + fallbackMagCount); mag-- > loaderMagnification + 1;) {
+        const auto coarse = dataset.atMagIndex(mag);
+        const auto tlCube = coarse.global2cube(center - halfFOV);
+        const auto brCube = coarse.global2cube(center + halfFOV);
+        for (int z = tlCube.z; z <= brCube.z; ++z)
+        for (int y = tlCube.y; y <= brCube.y; ++y)
+        for (int x = tlCube.x; x <= brCube.x; ++x) {
+            cubes.emplace_back(mag, CoordOfCube{x, y, z});
+        }
+    }
+    return cubes;
+}
+
+void Loader::Worker::unloadFallbackMagnifications(const std::size_t layerId, const Coordinate & center) {
+    const auto wanted = fallbackCubes(layerId, center);
+    bool unloaded{false};
+    QMutexLocker locker(&state->protectCube2Pointer);
+    for (std::size_t mag{0}; mag < state->cube2Pointer[layerId].size(); ++mag) {
+        if (mag != loaderMagnification) {
+            const auto keep = [&wanted, mag](const CoordOfCube & cubeCoord){
+                return std::find(std::begin(wanted), std::end(wanted), std::pair{mag, cubeCoord}) != std::end(wanted);
+            };
+            unloadCubes(state->cube2Pointer[layerId][mag], freeSlots[layerId], keep, [&unloaded](const CoordOfCube &, void *){ unloaded = true; });
+            unloadPalettes(state->cube2Palette[layerId][mag], keep, [&unloaded](const CoordOfCube &){ unloaded = true; });
+        }
+    }
+    if (unloaded) {
+        state->viewer->reslice_notify_all(layerId);
+    }
+}
+
+void Loader::Worker::unloadFallbackMagnifications(const std::size_t layerId) {
+    abortDownloadsFinishDecompression(layerId, [this](std::size_t mag, const CoordOfCube &){ return mag == loaderMagnification; });
+    QMutexLocker locker(&state->protectCube2Pointer);
+    for (std::size_t mag{0}; mag < state->cube2Pointer[layerId].size(); ++mag) {
+        if (mag != loaderMagnification) {
+            unloadCubes(state->cube2Pointer[layerId][mag], freeSlots[layerId], [](const CoordOfCube &){ return false; });
+            unloadPalettes(state->cube2Palette[layerId][mag], [](const CoordOfCube &){ return false; });
+        }
+    }
+    state->viewer->reslice_notify_all(layerId);
+}
+
 void Loader::Worker::markCubeAsModified(const std::size_t layerId, const CoordOfCube &cubeCoord, const int magnification) {
     modifiedCacheQueue[layerId][static_cast<std::size_t>(std::log2(magnification))].emplace(cubeCoord);
 }
@@ -303,26 +448,91 @@ void Loader::Worker::snappyCacheSupplySnappy(const std::size_t layerId, const Co
                       .arg(cubeCoord.x).arg(cubeCoord.y).arg(cubeCoord.z).arg(cubeMagnification).arg(snappyCache[layerId].size());
         return;
     }
-    snappyCache[layerId][cubeMagnification].emplace(std::piecewise_construct, std::forward_as_tuple(cubeCoord), std::forward_as_tuple(cube));
+    snappyCache[layerId][cubeMagnification].insert_or_assign(cubeCoord, cube);// downsampled cubes replace older versions
 
-    if (cubeMagnification == loaderMagnification) {//unload if currently loaded
-        auto openIt = slotOpen[layerId].find(cubeCoord);
-        if (openIt != std::end(slotOpen[layerId])) {
+    {//unload if currently loaded, coarser mags may be loaded as fallback
+        auto & opens = slotOpen[layerId][cubeMagnification];
+        auto openIt = opens.find(cubeCoord);
+        if (openIt != std::end(opens)) {
             openIt->second->cancel();
         }
-        auto downloadIt = slotDownload[layerId].find(cubeCoord);
-        if (downloadIt != std::end(slotDownload[layerId])) {
+        auto & downloads = slotDownload[layerId][cubeMagnification];
+        auto downloadIt = downloads.find(cubeCoord);
+        if (downloadIt != std::end(downloads)) {
             downloadIt->second->abort();
         }
-        auto decompressionIt = slotDecompression[layerId].find(cubeCoord);
-        if (decompressionIt != std::end(slotDecompression[layerId])) {
+        auto & decompressions = slotDecompression[layerId][cubeMagnification];
+        auto decompressionIt = decompressions.find(cubeCoord);
+        if (decompressionIt != std::end(decompressions)) {
             decompressionIt->second->waitForFinished();
         }
         QMutexLocker locker(&state->protectCube2Pointer);
-        auto cubePtr = cubeQuery(state->cube2Pointer, layerId, loaderMagnification, cubeCoord);
+        auto cubePtr = cubeQuery(state->cube2Pointer, layerId, cubeMagnification, cubeCoord);
         if (cubePtr != nullptr) {
             freeSlots[layerId].emplace_back(cubePtr);
-            state->cube2Pointer[layerId][loaderMagnification].erase(cubeCoord);
+            state->cube2Pointer[layerId][cubeMagnification].erase(cubeCoord);
+        }
+        if (cubeMagnification < state->cube2Palette[layerId].size()) {
+            state->cube2Palette[layerId][cubeMagnification].erase(cubeCoord);
+        }
+    }
+}
+
+void Loader::Worker::reserveSlot(const std::size_t layerId) {
+    if (freeSlots[layerId].empty() && datasets[layerId].isOverlay()) {
+        slotChunk[layerId].emplace_back(datasets[layerId].cubeShape.prod() * OBJID_BYTES, 0);
+        freeSlots[layerId].emplace_back(slotChunk[layerId].back().data());
+    }
+}
+
+void Loader::Worker::expandCube(const std::size_t layerId, const std::size_t magIndex, const CoordOfCube & cubeCoord) {
+    std::shared_ptr<const PaletteCube> cube;
+    {
+        QMutexLocker locker(&state->protectCube2Pointer);
+        if (cubeQuery(state->cube2Pointer, layerId, magIndex, cubeCoord) != nullptr) {
+            return;
+        }
+        cube = paletteQuery(state->cube2Palette, layerId, magIndex, cubeCoord);
+    }
+    if (cube == nullptr) {
+        return;
+    }
+    reserveSlot(layerId);
+    auto * slot = freeSlots[layerId].front();
+    freeSlots[layerId].pop_front();
+    cube->decode(reinterpret_cast<std::uint64_t *>(slot));// only this thread modifies the cube tables
+    QMutexLocker locker(&state->protectCube2Pointer);
+    state->cube2Pointer[layerId][magIndex][cubeCoord] = slot;
+    state->cube2Palette[layerId][magIndex].erase(cubeCoord);
+}
+
+void Loader::Worker::repackCubes() {
+    for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
+        if (!datasets[layerId].isOverlay() || loaderMagnification >= modifiedCacheQueue[layerId].size()) {
+            continue;
+        }
+        std::vector<std::pair<CoordOfCube, void *>> expanded;
+        {
+            QMutexLocker locker(&state->protectCube2Pointer);
+            expanded.assign(std::begin(state->cube2Pointer[layerId][loaderMagnification]), std::end(state->cube2Pointer[layerId][loaderMagnification]));
+        }
+        for (const auto & [cubeCoord, slot] : expanded) {// keep the edits before the slot is recycled
+            if (modifiedCacheQueue[layerId][loaderMagnification].erase(cubeCoord) > 0) {
+                snappyCacheBackupRaw(layerId, cubeCoord, slot);
+            }
+        }
+        const auto cubeShape = datasets[layerId].cubeShape;
+        std::vector<std::shared_ptr<const PaletteCube>> cubes(expanded.size());
+        std::vector<std::size_t> indices(expanded.size());
+        std::iota(std::begin(indices), std::end(indices), 0);
+        QtConcurrent::blockingMap(indices, [&expanded, &cubes, cubeShape](const std::size_t i){
+            cubes[i] = std::make_shared<const PaletteCube>(reinterpret_cast<const std::uint64_t *>(expanded[i].second), cubeShape);
+        });
+        QMutexLocker locker(&state->protectCube2Pointer);
+        for (std::size_t i = 0; i < expanded.size(); ++i) {
+            state->cube2Pointer[layerId][loaderMagnification].erase(expanded[i].first);
+            state->cube2Palette[layerId][loaderMagnification][expanded[i].first] = cubes[i];
+            freeSlots[layerId].emplace_back(expanded[i].second);
         }
     }
 }
@@ -340,11 +550,14 @@ void Loader::Worker::snappyCacheClear() {
     //unload all modified cubes
     for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
         for (std::size_t mag = 0; mag < state->cube2Pointer[layerId].size(); ++mag) {
-            unloadCubes(state->cube2Pointer[layerId][mag], freeSlots[layerId], [this, layerId, mag](const CoordOfCube & cubeCoord){
+            const auto keep = [this, layerId, mag](const CoordOfCube & cubeCoord){
                 const bool unflushed = modifiedCacheQueue[layerId][mag].find(cubeCoord) != std::end(modifiedCacheQueue[layerId][mag]);
                 const bool flushed = snappyCache[layerId][mag].find(cubeCoord) != std::end(snappyCache[layerId][mag]);
                 return !unflushed && !flushed;//only keep cubes which are neither in snappy cache nor in modified queue
-            });
+            };
+            QMutexLocker locker(&state->protectCube2Pointer);
+            unloadCubes(state->cube2Pointer[layerId][mag], freeSlots[layerId], keep);
+            unloadPalettes(state->cube2Palette[layerId][mag], keep);
             modifiedCacheQueue[layerId][mag].clear();
             snappyCache[layerId][mag].clear();
         }
@@ -359,9 +572,14 @@ void Loader::Worker::flushIntoSnappyCache() {
             for (const auto & cubeCoord : modifiedCacheQueue[layerId][mag]) {
                 state->protectCube2Pointer.lock();
                 auto cube = cubeQuery(state->cube2Pointer, layerId, mag, {cubeCoord.x, cubeCoord.y, cubeCoord.z});
+                const auto packedCube = paletteQuery(state->cube2Palette, layerId, mag, cubeCoord);
                 state->protectCube2Pointer.unlock();
                 if (cube != nullptr) {
                     snappyCacheBackupRaw(layerId, cubeCoord, cube);
+                } else if (packedCube != nullptr) {// marked without being written
+                    std::vector<std::uint64_t> decoded(datasets[layerId].cubeShape.prod());
+                    packedCube->decode(decoded.data());
+                    snappyCacheBackupRaw(layerId, cubeCoord, decoded.data());
                 }
             }
             //clear work queue
@@ -392,14 +610,14 @@ void abortDownloads(Downloads & downloads, Func keep) {
 
 void Loader::Worker::abortDownloadsFinishDecompression() {
     for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
-        abortDownloadsFinishDecompression(layerId, [](const CoordOfCube &){return false;});
+        abortDownloadsFinishDecompression(layerId, [](std::size_t, const CoordOfCube &){return false;});
     }
 }
 
-decltype(Loader::Worker::slotDecompression)::value_type::iterator Loader::Worker::finalizeDecompression(QFutureWatcher<DecompressionResult> & watcher, decltype(freeSlots)::value_type & freeSlots, decltype(slotDecompression)::value_type & decompressions, const CoordOfCube & cubeCoord) {
-    auto [success, currentSlot, io] = watcher.result();
-    if (!success) {//decompression unsuccessful
-        freeSlots.emplace_back(currentSlot);
+Loader::Worker::Decompressions::iterator Loader::Worker::finalizeDecompression(QFutureWatcher<DecompressionResult> & watcher, decltype(freeSlots)::value_type & freeSlots, Decompressions & decompressions, const CoordOfCube & cubeCoord) {
+    auto [success, releasedSlot, io] = watcher.result();
+    if (releasedSlot != nullptr) {//decompression unsuccessful or cube packed
+        freeSlots.emplace_back(releasedSlot);
     }
     io->deleteLater();
     auto it = decompressions.erase(decompressions.find(cubeCoord));
@@ -409,64 +627,79 @@ decltype(Loader::Worker::slotDecompression)::value_type::iterator Loader::Worker
 
 template<typename Func>
 void Loader::Worker::abortDownloadsFinishDecompression(std::size_t layerId, Func keep) {
-    for (auto & elem : slotOpen[layerId]) {
-        elem.second->blockSignals(true);
-        elem.second->cancel();
-    }
-    for (auto & elem : slotOpen[layerId]) {
-        solitaryConfinement.emplace_back(std::move(elem.second));
+    for (std::size_t mag{0}; mag < slotOpen[layerId].size(); ++mag) {
+        for (auto & elem : slotOpen[layerId][mag]) {
+            elem.second->blockSignals(true);
+            elem.second->cancel();
+        }
+        for (auto & elem : slotOpen[layerId][mag]) {
+            solitaryConfinement.emplace_back(std::move(elem.second));
+        }
+        slotOpen[layerId][mag].clear();
     }
     solitaryConfinement.erase(std::remove_if(std::begin(solitaryConfinement), std::end(solitaryConfinement),
         [](const auto & val){ return val->isFinished(); }), std::end(solitaryConfinement));
-    slotOpen[layerId].clear();
     broadcastProgress();
-    abortDownloads(slotDownload[layerId], keep);
-    for (auto it = std::begin(slotDecompression[layerId]); it != std::end(slotDecompression[layerId]);) {
-        if (!keep(it->first)) {
-            it->second->waitForFinished();
-            it = finalizeDecompression(*it->second, freeSlots[layerId], slotDecompression[layerId], it->first);
-        } else {
-            ++it;
+    for (std::size_t mag{0}; mag < slotDownload[layerId].size(); ++mag) {
+        const auto keepMag = [&keep, mag](const CoordOfCube & cubeCoord){ return keep(mag, cubeCoord); };
+        abortDownloads(slotDownload[layerId][mag], keepMag);
+        auto & decompressions = slotDecompression[layerId][mag];
+        for (auto it = std::begin(decompressions); it != std::end(decompressions);) {
+            if (!keepMag(it->first)) {
+                it->second->waitForFinished();
+                it = finalizeDecompression(*it->second, freeSlots[layerId], decompressions, it->first);
+            } else {
+                ++it;
+            }
         }
     }
 }
 
-Loader::DecompressionResult decompressCube(void * currentSlot, QIODevice & reply, const std::size_t layerId, const Dataset dataset, decltype(state->cube2Pointer)::value_type::value_type & cubeHash, const CoordOfCube cubeCoord) {
-    if (!reply.isOpen()) {// sanity check, finished replies with no error should be ready for reading (https://bugreports.qt.io/browse/QTBUG-45944)
-        qCritical() << layerId << cubeCoord << static_cast<int>(dataset.type) << "decompression failed → no fill";
-        return {false, currentSlot, &reply};
+std::pair<QNetworkRequest, QByteArray> Loader::cubeRequest(const Dataset & dataset, const CoordOfCube & cubeCoord) {
+    auto request = dataset.apiSwitch(cubeCoord);
+    QByteArray payload;
+    if (dataset.api == Dataset::API::GoogleBrainmaps) {
+        const auto inmagCoord = cubeCoord.componentMul(dataset.cubeShape);
+        request.setRawHeader("Content-Type", "application/octet-stream");
+        const QString json(R"json({"geometry":{"corner":"%1,%2,%3", "size":"%4,%5,%6", "scale":%7}, "subvolume_format":"SINGLE_IMAGE", "image_format_options":{"image_format":"JPEG", "jpeg_quality":70}})json");
+        payload = json.arg(inmagCoord.x).arg(inmagCoord.y).arg(inmagCoord.z).arg(dataset.cubeShape.x).arg(dataset.cubeShape.y).arg(dataset.cubeShape.z).arg(dataset.magIndex).toUtf8();
+    } else if (dataset.api == Dataset::API::WebKnossos) {
+        const auto globalCoord = dataset.cube2global(cubeCoord);
+        request.setRawHeader("Content-Type", "application/json");
+        payload = QString{R"json([{"position":[%1,%2,%3],"zoomStep":%4,"cubeSize":%5,"fourBit":false}])json"}.arg(globalCoord.x).arg(globalCoord.y).arg(globalCoord.z).arg(static_cast<std::size_t>(std::log2(dataset.magnification))).arg(dataset.cubeShape.x).toUtf8();
     }
-    QThread::currentThread()->setPriority(QThread::IdlePriority);
-    bool success = false;
+    return {request, payload};
+}
 
-    auto data = reply.read(reply.bytesAvailable());//readAll can be very slow – https://bugreports.qt.io/browse/QTBUG-45926
+bool Loader::decodeCube(QByteArray & data, const Dataset & dataset, void * cube) {
+    bool success = false;
     const auto cubeVxCount = dataset.cubeShape.prod();
     const std::size_t availableSize = data.size();
     if (dataset.type == Dataset::CubeType::RAW_UNCOMPRESSED) {
         const std::size_t expectedSize = cubeVxCount;
         if (availableSize == expectedSize) {
-            std::copy(std::begin(data), std::end(data), reinterpret_cast<std::uint8_t *>(currentSlot));
+            std::copy(std::begin(data), std::end(data), reinterpret_cast<std::uint8_t *>(cube));
             success = true;
         }
     } else if (dataset.type == Dataset::CubeType::RAW_JPG || dataset.type == Dataset::CubeType::RAW_J2K || dataset.type == Dataset::CubeType::RAW_JP2_6 || dataset.type == Dataset::CubeType::RAW_PNG) {
         const auto image = QImage::fromData(data).convertToFormat(QImage::Format_Grayscale8);
         const qint64 expectedSize = cubeVxCount;
         if (image.sizeInBytes() == expectedSize) {
-            std::copy(image.bits(), image.bits() + image.sizeInBytes(), reinterpret_cast<std::uint8_t *>(currentSlot));
+            std::copy(image.bits(), image.bits() + image.sizeInBytes(), reinterpret_cast<std::uint8_t *>(cube));
             success = true;
         }
     } else if (dataset.type == Dataset::CubeType::SEGMENTATION_UNCOMPRESSED_16) {
         const std::size_t expectedSize = cubeVxCount * OBJID_BYTES / 4;
         if (availableSize == expectedSize) {
             boost::multi_array_ref<uint16_t, 1> dataRef(reinterpret_cast<uint16_t *>(data.data()), boost::extents[cubeVxCount]);
-            boost::multi_array_ref<uint64_t, 1> slotRef(reinterpret_cast<uint64_t *>(currentSlot), boost::extents[cubeVxCount]);
+            boost::multi_array_ref<uint64_t, 1> slotRef(reinterpret_cast<uint64_t *>(cube), boost::extents[cubeVxCount]);
             std::copy(std::begin(dataRef), std::end(dataRef), std::begin(slotRef));
             success = true;
         }
     } else if (dataset.type == Dataset::CubeType::SEGMENTATION_UNCOMPRESSED_64) {
         const std::size_t expectedSize = cubeVxCount * OBJID_BYTES;
         if (availableSize == expectedSize) {
-            std::copy(std::begin(data), std::end(data), reinterpret_cast<std::uint64_t *>(currentSlot));
+            std::copy(std::begin(data), std::end(data), reinterpret_cast<std::uint64_t *>(cube));
             success = true;
         }
     } else if (dataset.type == Dataset::CubeType::SEGMENTATION_SZ_ZIP) {
@@ -481,7 +714,7 @@ Loader::DecompressionResult decompressCube(void * currentSlot, QIODevice & reply
                 snappy::GetUncompressedLength(data.data(), data.size(), &uncompressedSize);
                 const std::size_t expectedSize = cubeVxCount * OBJID_BYTES;
                 if (uncompressedSize == expectedSize) {
-                    success = snappy::RawUncompress(data.data(), data.size(), reinterpret_cast<char*>(currentSlot));
+                    success = snappy::RawUncompress(data.data(), data.size(), reinterpret_cast<char*>(cube));
                 }
             }
             archive.close();
@@ -489,12 +722,32 @@ Loader::DecompressionResult decompressCube(void * currentSlot, QIODevice & reply
     } else {
         qDebug() << "unsupported format";
     }
+    return success;
+}
+
+Loader::DecompressionResult decompressCube(void * currentSlot, QIODevice & reply, const std::size_t layerId, const Dataset dataset, decltype(state->cube2Pointer)::value_type::value_type & cubeHash
+        , decltype(state->cube2Palette)::value_type::value_type & paletteHash, const CoordOfCube cubeCoord, const bool fallback) {
+    if (!reply.isOpen()) {// sanity check, finished replies with no error should be ready for reading (https://bugreports.qt.io/browse/QTBUG-45944)
+        qCritical() << layerId << cubeCoord << static_cast<int>(dataset.type) << "decompression failed → no fill";
+        return {false, currentSlot, &reply};
+    }
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+    auto data = reply.read(reply.bytesAvailable());//readAll can be very slow – https://bugreports.qt.io/browse/QTBUG-45926
+    const bool success = Loader::decodeCube(data, dataset, currentSlot);
 
-    if (success) {
+    if (success && dataset.isOverlay()) {// the slot was only needed for decompression
+        auto cube = std::make_shared<const PaletteCube>(reinterpret_cast<const std::uint64_t *>(currentSlot), dataset.cubeShape);
+        state->protectCube2Pointer.lock();
+        paletteHash[cubeCoord] = std::move(cube);
+        state->protectCube2Pointer.unlock();
+        state->viewer->reslice_notify_all(layerId, fallback ? boost::none : boost::make_optional(cubeCoord));
+        return {success, currentSlot, &reply};
+    } else if (success) {
         state->protectCube2Pointer.lock();
         cubeHash[cubeCoord] = currentSlot;
         state->protectCube2Pointer.unlock();
-        state->viewer->reslice_notify_all(layerId, cubeCoord);
+        state->viewer->reslice_notify_all(layerId, fallback ? boost::none : boost::make_optional(cubeCoord));// fallback cubes span several current cubes
+        return {success, nullptr, &reply};
     }
 
     return {success, currentSlot, &reply};
@@ -502,7 +755,14 @@ Loader::DecompressionResult decompressCube(void * currentSlot, QIODevice & reply
 
 void Loader::Worker::cleanup(const Coordinate center) {
     for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
-        abortDownloadsFinishDecompression(layerId, currentlyVisibleWrap(center, datasets[layerId]));
+        const auto visible = currentlyVisibleWrap(center, datasets[layerId]);
+        const auto wanted = fallbackCubes(layerId, center);
+        abortDownloadsFinishDecompression(layerId, [this, &visible, &wanted](const std::size_t mag, const CoordOfCube & cubeCoord){
+            if (mag == loaderMagnification) {
+                return visible(cubeCoord);
+            }
+            return std::find(std::begin(wanted), std::end(wanted), std::pair{mag, cubeCoord}) != std::end(wanted);
+        });
         if (loaderMagnification >= state->cube2Pointer[layerId].size()) {
             continue;
         }
@@ -518,6 +778,9 @@ void Loader::Worker::cleanup(const Coordinate center) {
             }
             state->viewer->reslice_notify_all(layerId, cubeCoord);
         });
+        unloadPalettes(state->cube2Palette[layerId][loaderMagnification], insideCurrentSupercubeWrap(center, datasets[layerId]), [layerId](const CoordOfCube & cubeCoord){
+            state->viewer->reslice_notify_all(layerId, cubeCoord);
+        });
     }
 }
 
@@ -531,8 +794,10 @@ void Loader::Controller::startLoading(const Coordinate & center, const UserMoveT
 
 void Loader::Worker::broadcastProgress(bool startup) {
     std::size_t count{0};
-    for (const auto & tup : boost::combine(slotOpen, slotDownload, slotDecompression)) {
-        count += tup.get<0>().size() + tup.get<1>().size() + tup.get<2>().size();
+    for (const auto & layer : boost::combine(slotOpen, slotDownload, slotDecompression)) {
+        for (const auto & tup : boost::combine(layer.get<0>(), layer.get<1>(), layer.get<2>())) {
+            count += tup.get<0>().size() + tup.get<1>().size() + tup.get<2>().size();
+        }
     }
     isFinished = count == 0;
     emit progress(startup, count);
@@ -557,6 +822,7 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
         {
             QMutexLocker locker(&state->protectCube2Pointer);
             state->cube2Pointer.resize(changedDatasets.size());
+            state->cube2Palette.resize(changedDatasets.size());
         }
         {
             QMutexLocker lock{&snappyCacheMutex};
@@ -566,9 +832,18 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
     }
     for (std::size_t layerId{0}; layerId < changedDatasets.size(); ++layerId) {
         const auto magCount = static_cast<std::size_t>(std::log2(changedDatasets[layerId].highestAvailableMag) + 1);
+        if (slotOpen[layerId].size() != magCount) {// pending loads reference the per mag maps
+            if (layerId < datasets.size()) {
+                abortDownloadsFinishDecompression(layerId, [](std::size_t, const CoordOfCube &){return false;});
+            }
+            slotOpen[layerId].resize(magCount);
+            slotDownload[layerId].resize(magCount);
+            slotDecompression[layerId].resize(magCount);
+        }
         {
             QMutexLocker locker(&state->protectCube2Pointer);
             state->cube2Pointer[layerId].resize(magCount);
+            state->cube2Palette[layerId].resize(magCount);
         }
         {
             QMutexLocker lock{&snappyCacheMutex};
@@ -583,6 +858,7 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
                 continue;// loader-relevant layer properties didn’t change
             }
             unloadCurrentMagnification(layerId);
+            unloadFallbackMagnifications(layerId);
             slotChunk[layerId].clear();
             freeSlots[layerId].clear();
         }
@@ -592,7 +868,9 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
         const auto overlayFactor = changedDatasets[layerId].isOverlay() ? OBJID_BYTES : 1;
 
         const auto cubeBytes = changedDatasets[layerId].cubeShape.prod() * overlayFactor;
-        const auto cubeSetElements = std::pow(state->M, 3);
+        // overlay cubes are resident packed, their slots only hold cubes during decompression and editing and grow on demand
+        const auto cubeSetElements = changedDatasets[layerId].isOverlay() ? QThread::idealThreadCount()
+                : std::pow(state->M, 3) + (hasFallback(changedDatasets[layerId]) ? fallbackCubeCount(changedDatasets[layerId]) : 0);
         const auto cubeSetBytes = cubeSetElements * cubeBytes;
         qDebug() << layerId << "Allocating" << cubeSetBytes / 1024. / 1024. << "MiB for cubes.";
         QElapsedTimer time;
@@ -607,8 +885,24 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
     loaderCacheSize = cacheSize;
 
     if (loaderMagnification != datasets[0].magIndex) {
-        unloadCurrentMagnification();
-        loaderMagnification = datasets[0].magIndex;
+        for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
+            if (!hasFallback(datasets[layerId])) {
+                unloadCurrentMagnification(layerId);
+            }
+        }
+        loaderMagnification = datasets[0].magIndex;// cubes of the previous mag now serve as fallback
+    }
+    std::vector<std::tuple<std::size_t, std::size_t, CoordOfCube>> fallbackQueue;
+    for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
+        if (hasFallback(datasets[layerId]) && layerId < state->cube2Pointer.size()) {
+            unloadFallbackMagnifications(layerId, center);
+            QMutexLocker locker(&state->protectCube2Pointer);
+            for (const auto & [mag, cubeCoord] : fallbackCubes(layerId, center)) {
+                if (cubeQuery(state->cube2Pointer, layerId, mag, cubeCoord) == nullptr && paletteQuery(state->cube2Palette, layerId, mag, cubeCoord) == nullptr) {
+                    fallbackQueue.emplace_back(layerId, mag, cubeCoord);
+                }
+            }
+        }
     }
     const auto Dcoi = DcoiFromPos(center, userMoveType, direction);//datacubes of interest prioritized around the current position
     //split dcoi into slice planes and rest
@@ -617,15 +911,18 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
         QMutexLocker locker(&state->protectCube2Pointer);
         for (std::size_t layerId{0}; layerId < datasets.size(); ++layerId) {
             // only queue downloads which are necessary
-            if (cubeQuery(state->cube2Pointer, layerId, loaderMagnification, todo) == nullptr) {
+            if (cubeQuery(state->cube2Pointer, layerId, loaderMagnification, todo) == nullptr && paletteQuery(state->cube2Palette, layerId, loaderMagnification, todo) == nullptr) {
                 allCubes.emplace_back(layerId, todo);
             }
         }
     }
 
-    auto startDownload = [this, center, loadingNr](const std::size_t layerId, const Dataset dataset, const CoordOfCube cubeCoord, decltype(slotDownload)::value_type & downloads
-            , decltype(slotDecompression)::value_type & decompressions, decltype(freeSlots)::value_type & freeSlots, decltype(state->cube2Pointer)::value_type::value_type & cubeHash){
-        auto & opens = slotOpen[layerId];
+    auto startDownload = [this, center, loadingNr](const std::size_t layerId, const Dataset dataset, const CoordOfCube cubeCoord, Downloads & downloads
+            , Decompressions & decompressions, decltype(freeSlots)::value_type & freeSlots, decltype(state->cube2Pointer)::value_type::value_type & cubeHash
+            , decltype(state->cube2Palette)::value_type::value_type & paletteHash){
+        const auto magIndex = dataset.magIndex;
+        const bool fallback = magIndex != loaderMagnification;
+        auto & opens = slotOpen[layerId][magIndex];
         const auto c = dataset.cube2global(cubeCoord);
         const auto b = dataset.boundary;
         if (c.x < 0 || c.y < 0 || c.z < 0 || c.x >= b.x || c.y >= b.y || c.z >= b.z) {
@@ -633,8 +930,9 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
         }
         if (dataset.isOverlay()) {
             QMutexLocker lock{&snappyCacheMutex};
-            auto snappyIt = snappyCache[layerId][loaderMagnification].find(cubeCoord);
-            if (snappyIt != std::end(snappyCache[layerId][loaderMagnification])) {
+            auto snappyIt = snappyCache[layerId][magIndex].find(cubeCoord);
+            if (snappyIt != std::end(snappyCache[layerId][magIndex])) {
+                reserveSlot(layerId);
                 if (!freeSlots.empty()) {
                     auto downloadIt = downloads.find(cubeCoord);
                     if (downloadIt != std::end(downloads)) {
@@ -648,15 +946,18 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
                     const auto currentSlotIt = cubeHash.find(cubeCoord);
                     auto * currentSlot = currentSlotIt != std::end(cubeHash) ? currentSlotIt->second : freeSlots.front();
                     cubeHash.erase(cubeCoord);
+                    paletteHash.erase(cubeCoord);
                     state->protectCube2Pointer.unlock();
                     if (currentSlot == freeSlots.front()) {
                         freeSlots.pop_front();
                     }
                     //directly uncompress snappy cube into the OC slot
                     const auto success = snappy::RawUncompress(snappyIt->second.c_str(), snappyIt->second.size(), reinterpret_cast<char*>(currentSlot));
-                    if (success) {
+                    if (success) {// edited cubes are packed as well until they are edited again
+                        auto cube = std::make_shared<const PaletteCube>(reinterpret_cast<const std::uint64_t *>(currentSlot), dataset.cubeShape);
+                        freeSlots.emplace_back(currentSlot);
                         state->protectCube2Pointer.lock();
-                        cubeHash[cubeCoord] = currentSlot;
+                        paletteHash[cubeCoord] = std::move(cube);
                         state->protectCube2Pointer.unlock();
 
                         state->viewer->reslice_notify_all(layerId, cubeCoord);
@@ -671,14 +972,20 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
             }
         }
         state->protectCube2Pointer.lock();
-        const bool cubeNotAlreadyLoaded = cubeHash.count(cubeCoord) == 0;
+        const bool cubeNotAlreadyLoaded = cubeHash.count(cubeCoord) == 0 && paletteHash.count(cubeCoord) == 0;
         state->protectCube2Pointer.unlock();
         const bool cubeNotDownloading = downloads.count(cubeCoord) == 0 && opens.count(cubeCoord) == 0;
         const bool cubeNotDecompressing = decompressions.count(cubeCoord) == 0;
 
         if (cubeNotAlreadyLoaded && cubeNotDownloading && cubeNotDecompressing) {
             if (dataset.type == Dataset::CubeType::SNAPPY) {
-                if (!freeSlots.empty()) {
+                if (dataset.isOverlay()) {
+                    auto cube = std::make_shared<const PaletteCube>(std::uint64_t{0}, dataset.cubeShape);
+                    state->protectCube2Pointer.lock();
+                    paletteHash[cubeCoord] = std::move(cube);
+                    state->protectCube2Pointer.unlock();
+                    state->viewer->reslice_notify_all(layerId, cubeCoord);
+                } else if (!freeSlots.empty()) {
                     auto * currentSlot = freeSlots.front();
                     freeSlots.pop_front();
                     const std::size_t cubeBytes = dataset.cubeShape.prod() * (dataset.isOverlay() ? OBJID_BYTES : 1);
@@ -693,27 +1000,18 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
                 return;
             }
 
-            auto request = dataset.apiSwitch(cubeCoord);
+            QNetworkRequest request;
+            QByteArray payload;
+            std::tie(request, payload) = Loader::cubeRequest(dataset, cubeCoord);
 //            request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
 //            request.setAttribute(QNetworkRequest::SpdyAllowedAttribute, true);
 //            request.setAttribute(QNetworkRequest::BackgroundRequestAttribute, true);
 
-            QByteArray payload;
             if (cubeCoord == dataset.global2cube(center)) {
                 //the first download usually finishes last (which is a bug) so we put it alone in the high priority bucket
                 request.setPriority(QNetworkRequest::HighPriority);
             }
             auto & io = [&]() -> QIODevice & {
-                if (dataset.api == Dataset::API::GoogleBrainmaps) {
-                    const auto inmagCoord = cubeCoord.componentMul(dataset.cubeShape);
-                    request.setRawHeader("Content-Type", "application/octet-stream");
-                    const QString json(R"json({"geometry":{"corner":"%1,%2,%3", "size":"%4,%5,%6", "scale":%7}, "subvolume_format":"SINGLE_IMAGE", "image_format_options":{"image_format":"JPEG", "jpeg_quality":70}})json");
-                    payload = json.arg(inmagCoord.x).arg(inmagCoord.y).arg(inmagCoord.z).arg(dataset.cubeShape.x).arg(dataset.cubeShape.y).arg(dataset.cubeShape.z).arg(loaderMagnification).toUtf8();
-                } else if (dataset.api == Dataset::API::WebKnossos) {
-                    const auto globalCoord = dataset.cube2global(cubeCoord);
-                    request.setRawHeader("Content-Type", "application/json");
-                    payload = QString{R"json([{"position":[%1,%2,%3],"zoomStep":%4,"cubeSize":%5,"fourBit":false}])json"}.arg(globalCoord.x).arg(globalCoord.y).arg(globalCoord.z).arg(static_cast<std::size_t>(std::log2(dataset.magnification))).arg(dataset.cubeShape.x).toUtf8();
-                }
                 if (dataset.url.scheme() == "file") {
                     return *new QBuffer{};
                 }
@@ -723,7 +1021,8 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
                     return *qnam.get(request);
                 }
             }();
-            auto processDownload = [this, layerId, dataset, &io, cubeCoord, &downloads, &decompressions, &freeSlots, &cubeHash](bool exists = false){
+            auto processDownload = [this, layerId, dataset, fallback, &io, cubeCoord, &downloads, &decompressions, &freeSlots, &cubeHash, &paletteHash](bool exists = false){
+                reserveSlot(layerId);
                 if (freeSlots.empty()) {
                     qCritical() << layerId << cubeCoord << static_cast<int>(dataset.type) << "no slots for decompression" << cubeHash.size() << freeSlots.size();
                     io.deleteLater();
@@ -742,9 +1041,15 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
                     io.setParent(nullptr);// reparent, so it doesn’t get destroyed with qnam
                     decompressions[cubeCoord].reset(watcher);
                     downloads.erase(cubeCoord);
-                    watcher->setFuture(QtConcurrent::run(&decompressionPool, std::bind(&decompressCube, currentSlot, std::ref(io), layerId, dataset, std::ref(cubeHash), cubeCoord)));
+                    watcher->setFuture(QtConcurrent::run(&decompressionPool, std::bind(&decompressCube, currentSlot, std::ref(io), layerId, dataset, std::ref(cubeHash), std::ref(paletteHash), cubeCoord, fallback)));
                 } else {
-                    if ((maybeReply != nullptr && maybeReply->error() == QNetworkReply::ContentNotFoundError) || (maybeReply == nullptr && !exists)) {//404 → fill
+                    if (((maybeReply != nullptr && maybeReply->error() == QNetworkReply::ContentNotFoundError) || (maybeReply == nullptr && !exists)) && dataset.isOverlay()) {//404 → fill
+                        auto cube = std::make_shared<const PaletteCube>(std::uint64_t{0}, dataset.cubeShape);
+                        state->protectCube2Pointer.lock();
+                        paletteHash[cubeCoord] = std::move(cube);
+                        state->protectCube2Pointer.unlock();
+                        state->viewer->reslice_notify_all(layerId, fallback ? boost::none : boost::make_optional(cubeCoord));
+                    } else if ((maybeReply != nullptr && maybeReply->error() == QNetworkReply::ContentNotFoundError) || (maybeReply == nullptr && !exists)) {
                         auto * currentSlot = freeSlots.front();
                         freeSlots.pop_front();
                         const std::size_t cubeBytes = dataset.cubeShape.prod() * (dataset.isOverlay() ? OBJID_BYTES : 1);
@@ -752,7 +1057,7 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
                         state->protectCube2Pointer.lock();
                         cubeHash[cubeCoord] = currentSlot;
                         state->protectCube2Pointer.unlock();
-                        state->viewer->reslice_notify_all(layerId, cubeCoord);
+                        state->viewer->reslice_notify_all(layerId, fallback ? boost::none : boost::make_optional(cubeCoord));
                     } else {
                         if(maybeReply != nullptr && maybeReply->error() != QNetworkReply::OperationCanceledError) {
                             qCritical() << layerId << cubeCoord << static_cast<int>(dataset.type) << maybeReply->request().url() << maybeReply->errorString() << maybeReply->readAll();
@@ -840,11 +1145,22 @@ void Loader::Worker::downloadAndLoadCubes(const unsigned int loadingNr, const Co
         }
     };
 
+    for (auto [layerId, magIndex, cubeCoord] : fallbackQueue) {
+        if (loadingNr == Loader::Controller::singleton().loadingNr) {
+            if (datasets[layerId].loadingEnabled) {
+                try {
+                    startDownload(layerId, datasets[layerId].atMagIndex(magIndex), cubeCoord, slotDownload[layerId].at(magIndex), slotDecompression[layerId].at(magIndex), freeSlots[layerId]
+                                  , state->cube2Pointer.at(layerId).at(magIndex), state->cube2Palette.at(layerId).at(magIndex));
+                } catch (const std::out_of_range &) {}
+            }
+        }
+    }
     for (auto [layerId, cubeCoord] : allCubes) {
         if (loadingNr == Loader::Controller::singleton().loadingNr) {
             if (datasets[layerId].loadingEnabled) {
                 try {
-                    startDownload(layerId, datasets[layerId], cubeCoord, slotDownload[layerId], slotDecompression[layerId], freeSlots[layerId], state->cube2Pointer.at(layerId).at(loaderMagnification));
+                    startDownload(layerId, datasets[layerId], cubeCoord, slotDownload[layerId].at(loaderMagnification), slotDecompression[layerId].at(loaderMagnification), freeSlots[layerId]
+                                  , state->cube2Pointer.at(layerId).at(loaderMagnification), state->cube2Palette.at(layerId).at(loaderMagnification));
                 } catch (const std::out_of_range &) {}
             }
         }
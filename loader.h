@@ -48,8 +48,10 @@
 #include <list>
 #include <memory>
 #include <mutex>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 /* Calculate movement trajectory for loading based on how many last single movements */
@@ -66,7 +68,13 @@ class Worker;
 }
 
 namespace Loader {
-using DecompressionResult = std::tuple<bool, void*, QIODevice*>;
+// number of coarser mags kept resident around the current position as preview while the current mag loads
+constexpr std::size_t fallbackMagCount{2};
+using DecompressionResult = std::tuple<bool, void*, QIODevice*>;// success, slot to release, io
+/// request and payload that fetch one cube of the dataset at its mag
+std::pair<QNetworkRequest, QByteArray> cubeRequest(const Dataset & dataset, const CoordOfCube & cubeCoord);
+/// decodes the downloaded bytes of one cube into 8 bit raw or 64 bit overlay voxels
+bool decodeCube(QByteArray & data, const Dataset & dataset, void * cube);
 class Worker : public QObject {
     Q_OBJECT
     friend class Loader::Controller;
@@ -82,12 +90,16 @@ private:
     using ptr = std::unique_ptr<T>;
     using DecompressionOperationPtr = ptr<QFutureWatcher<DecompressionResult>>;
     using OpenWatcher = QFutureWatcher<boost::optional<bool>>;
-    std::vector<std::unordered_map<CoordOfCube, ptr<OpenWatcher>>> slotOpen;
+    using Opens = std::unordered_map<CoordOfCube, ptr<OpenWatcher>>;
+    using Downloads = std::unordered_map<CoordOfCube, QNetworkReply*>;
+    using Decompressions = std::unordered_map<CoordOfCube, DecompressionOperationPtr>;
+    // per layer and mag
+    std::vector<std::vector<Opens>> slotOpen;
     std::vector<ptr<OpenWatcher>> solitaryConfinement;// disconnected worker threads that wait for IO
-    std::vector<std::unordered_map<CoordOfCube, QNetworkReply*>> slotDownload;
-    std::vector<std::unordered_map<CoordOfCube, DecompressionOperationPtr>> slotDecompression;
+    std::vector<std::vector<Downloads>> slotDownload;
+    std::vector<std::vector<Decompressions>> slotDecompression;
     std::vector<std::list<std::vector<std::uint8_t>>> slotChunk;// slot ownership
-    std::vector<std::list<void *>> freeSlots;
+    std::vector<std::list<void *>> freeSlots;// shared by the current mag and the fallback mags
     int currentMaxMetric;
 
     std::atomic_bool isFinished{false};
@@ -97,10 +109,14 @@ private:
     floatCoordinate find_close_xyz(floatCoordinate direction);
     std::vector<CoordOfCube> DcoiFromPos(const Coordinate &currentOrigin, const UserMoveType userMoveType, const floatCoordinate & direction);
     uint loadCubes();
+    std::vector<std::pair<std::size_t, CoordOfCube>> fallbackCubes(const std::size_t layerId, const Coordinate & center) const;
+    void unloadFallbackMagnifications(const std::size_t layerId, const Coordinate & center);
+    void unloadFallbackMagnifications(const std::size_t layerId);
+    void reserveSlot(const std::size_t layerId);
     void snappyCacheBackupRaw(const std::size_t layerId, const CoordOfCube &, const void * cube);
     void snappyCacheClear();
 
-    decltype(slotDecompression)::value_type::iterator finalizeDecompression(QFutureWatcher<DecompressionResult> & watcher, decltype(freeSlots)::value_type & freeSlots, decltype(slotDecompression)::value_type & decompressions, const CoordOfCube & cubeCoord);
+    Decompressions::iterator finalizeDecompression(QFutureWatcher<DecompressionResult> & watcher, decltype(freeSlots)::value_type & freeSlots, Decompressions & decompressions, const CoordOfCube & cubeCoord);
     void abortDownloadsFinishDecompression();
     template<typename Func>
     void abortDownloadsFinishDecompression(std::size_t, Func);
@@ -119,8 +135,11 @@ public://matsch
 
     void unloadCurrentMagnification(const std::size_t);
     void unloadCurrentMagnification();
+    void demoteCurrentMagnification();
     void markCubeAsModified(const std::size_t layerId, const CoordOfCube &cubeCoord, const int magnification);
     void snappyCacheSupplySnappy(const std::size_t layerId, const CoordOfCube, const quint64 cubeMagnification, const std::string cube);
+    void expandCube(const std::size_t layerId, const std::size_t magIndex, const CoordOfCube & cubeCoord);
+    void repackCubes();
     void flushIntoSnappyCache();
     void broadcastProgress(bool startup = false);
     Worker();
@@ -136,6 +155,7 @@ class Controller : public QObject {
     Q_OBJECT
     friend class Loader::Worker;
     QThread workerThread;
+    QTimer repackTimer;
 public:
     std::unique_ptr<Loader::Worker> worker;
     std::atomic_uint loadingNr{0};
@@ -147,6 +167,7 @@ public:
     Controller();
     virtual ~Controller() override;
     void unloadCurrentMagnification();
+    void demoteCurrentMagnification();
 
     void startLoading(const Coordinate & center, const UserMoveType userMoveType, const floatCoordinate &direction);
     template<typename... Args>
@@ -154,6 +175,8 @@ public:
         emit snappyCacheSupplySnappySignal(std::forward<Args>(args)...);
     }
     void markCubeAsModified(const std::size_t layerId, const CoordOfCube &cubeCoord, const int magnification);
+    /// unpacks a resident overlay cube into a slot before it is written
+    void expandCube(const std::size_t layerId, const std::size_t magIndex, const CoordOfCube & cubeCoord);
 
     struct LockedSnappy {
         std::unique_lock<QMutex> locker;
@@ -174,8 +197,11 @@ signals:
     void progress(int count);
     void refCountChange(bool isIncrement, int refCount);
     void unloadCurrentMagnificationSignal();
+    void demoteCurrentMagnificationSignal();
     void loadSignal(const unsigned int loadingNr, const Coordinate center, const UserMoveType userMoveType, const floatCoordinate & direction, const Dataset::list_t & changedDatasets, const quint64 cacheSize);
     void markCubeAsModifiedSignal(const std::size_t layerId, const CoordOfCube &cubeCoord, const int magnification);
     void snappyCacheSupplySnappySignal(const std::size_t layerId, const CoordOfCube, const quint64 cubeMagnification, const std::string cube);
+    void expandCubeSignal(const std::size_t layerId, const std::size_t magIndex, const CoordOfCube & cubeCoord);
+    void repackCubesSignal();
 };
 }//namespace Loader
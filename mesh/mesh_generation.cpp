@@ -3,24 +3,33 @@
 #include "coordinate.h"
 #include "dataset.h"
 #include "loader.h"
+#include "regionio.h"
 #include "segmentation/segmentation.h"
 #include "skeleton/skeletonizer.h"
+#include "stateInfo.h"
 
 #include "vtkMarchingCubesTriangleCases.h"
 
 #include <QApplication>
-#include <QFuture>
-#include <QFutureWatcher>
+#include <QMessageBox>
+#include <QMutexLocker>
 #include <QProgressDialog>
 #include <QObject>
+#include <QSignalBlocker>
+#include <QThread>
 #include <QtConcurrentMap>
 
-#include <snappy.h>
-
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <list>
+#include <numeric>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 
-template<typename T, typename U>
-void marchingCubes(std::unordered_map<U, std::unordered_map<floatCoordinate, int>> & obj2points, std::unordered_map<U, std::vector<unsigned int>> & obj2faces, std::unordered_map<std::uint64_t, std::size_t> & obj2idCounter, const std::vector<T> & data, const std::unordered_map<T, U> & soid2oid, const std::array<double, 3> & origin, const std::array<double, 3> & dims, const std::array<double, 3> & spacing, const std::array<double, 6> & extent) {
+template<typename T, typename U, typename CellFilter>
+void marchingCubes(std::unordered_map<U, std::unordered_map<floatCoordinate, int>> & obj2points, std::unordered_map<U, std::vector<unsigned int>> & obj2faces, std::unordered_map<std::uint64_t, std::size_t> & obj2idCounter, const std::vector<T> & data, const std::unordered_map<T, U> & soid2oid, const std::array<double, 3> & origin, const std::array<double, 3> & dims, const std::array<double, 3> & spacing, const std::array<double, 6> & extent, const CellFilter & ownsCell) {
     const auto triCases = vtkMarchingCubesTriangleCases::GetCases();
 
     static const std::array<int, 8> CASE_MASK{1,2,4,8,16,32,64,128};
@@ -39,6 +48,9 @@ void marchingCubes(std::unordered_map<U, std::unordered_map<floatCoordinate, int
             pts[0][1] = origin[1] + (y + extent[2]) * spacing[1];
             const auto ynext = pts[0][1] + spacing[1];
             for (std::size_t x = 0; x < (dims[0] - 1); ++x) {
+                if (!ownsCell(x, y, z)) {
+                    continue;
+                }
                 // get scalar values
                 const auto idx = x + yOffset + zOffset;
                 std::array<T, 8> cubeVals{};
@@ -90,9 +102,9 @@ void marchingCubes(std::unordered_map<U, std::unordered_map<floatCoordinate, int
                     // for discrete marching cubes, we are looking for an
                     // exact match of a scalar at a vertex to a value
                     if (auto it = soid2oid.find(cubeVals[pi]); it != std::end(soid2oid)) {// subobject and object already existed so we can do a non-mutating lookup without synchronization
-                        for (auto & oindex : Segmentation::singleton().subobjectFromId(it->first, {}).oidxs()) {
+                        Segmentation::singleton().subobjectFromId(it->first, {}).forEachObjectIndex([&](const std::uint64_t oindex){
                             obj2index[oindex] |= CASE_MASK[pi];
-                        }
+                        });
                     } else if (soid2oid.empty() && cubeVals[pi] != Segmentation::singleton().getBackgroundId()) {// mesh soids when no objects were selected
                         obj2index[cubeVals[pi]] |= CASE_MASK[pi];
                     }
@@ -137,187 +149,302 @@ void marchingCubes(std::unordered_map<U, std::unordered_map<floatCoordinate, int
     }
 }
 
-auto generateMeshForSubobjectID(const std::unordered_map<std::uint64_t, std::uint64_t> & soid2oid, const std::vector<std::uint64_t> & objects, const Loader::Worker::SnappySet & cubes, QProgressDialog & progress) {
-    std::vector<std::unordered_map<std::uint64_t, std::unordered_map<floatCoordinate, int>>> obj2totalpoints(cubes.size());
-    std::vector<std::unordered_map<std::uint64_t, std::vector<unsigned int>>> obj2totalfaces(cubes.size());
-    const auto processCube = [&](const auto & val){
-        const auto id = val.first;
-        const auto & pair = *val.second;
-        auto & obj2points = obj2totalpoints[id];
-        auto & obj2faces = obj2totalfaces[id];
-        std::unordered_map<std::uint64_t, std::size_t> obj2idCounter;
-        const auto cubeShape = Dataset::datasets[Segmentation::singleton().layerId].cubeShape;
-        const std::size_t size = cubeShape.prod();
+namespace {
+int floorDiv(const int value, const int divisor) {
+    return value / divisor - (value % divisor < 0);
+}
 
-        std::unordered_map<CoordOfCube, std::vector<std::uint64_t>> extractedCubes;// local lookup
-        auto extractedCubeForCoord = [&cubes, &extractedCubes, size](const auto & coord) -> auto & {
-            auto & cube = extractedCubes[coord];
-            if (cube.empty()) {
-                cube.resize(size);
-                auto findIt = cubes.find(coord);
-                if (findIt != std::end(cubes)) {
-                    if (!snappy::RawUncompress(findIt->second.c_str(), findIt->second.size(), reinterpret_cast<char *>(cube.data()))) {
-                        std::runtime_error("failed to extract snappy cube in generateMeshForSubobjectID");
-                    }
-                } else {
-                    std::fill(std::begin(cube), std::end(cube), 0);// dummy data for missing or broken cubes in snappy cache
+struct CubeMesh {
+    std::unordered_map<std::uint64_t, std::unordered_map<floatCoordinate, int>> obj2points;
+    std::unordered_map<std::uint64_t, std::vector<unsigned int>> obj2faces;
+    std::unordered_set<CoordOfCube> neighbors;// cubes whose cells touch the meshed voxels
+};
+
+struct ObjectMesh {
+    std::unordered_map<floatCoordinate, unsigned int> ids;// welds the vertices shared with adjacent cubes
+    QVector<float> verts;
+    QVector<unsigned int> faces;
+};
+
+// a cube owns the marching cells whose lower corner lies inside, so every seam is meshed exactly once
+// with seamOf only the owned cells that reach into one of those cubes are meshed
+CubeMesh meshCube(const CoordOfCube & cubeCoord, const std::unordered_map<CoordOfCube, std::vector<char>> & cubes, const std::unordered_map<std::uint64_t, std::uint64_t> & soid2oid, const Dataset & dataset, const bool explore, const std::unordered_set<CoordOfCube> * seamOf) {
+    const auto cubeShape = dataset.cubeShape;
+    const Coordinate cubeFirst{cubeCoord.x * cubeShape.x, cubeCoord.y * cubeShape.y, cubeCoord.z * cubeShape.z};
+    std::array<const std::uint64_t *, 8> blocks{};// the cube and its upper neighbors
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        const auto it = cubes.find(cubeCoord + CoordOfCube(i & 1, (i >> 1) & 1, i >> 2));
+        if (it != std::end(cubes) && !it->second.empty()) {
+            blocks[i] = reinterpret_cast<const std::uint64_t *>(it->second.data());
+        }
+    }
+    const auto background = Segmentation::singleton().getBackgroundId();
+    const auto isMeshed = [&soid2oid, background](const std::uint64_t value){
+        return soid2oid.empty() ? value != background : soid2oid.count(value) != 0;
+    };
+    std::uint64_t lastValue{0};
+    bool lastMeshed{isMeshed(lastValue)};
+
+    CubeMesh mesh;
+    std::unordered_map<std::uint64_t, std::size_t> obj2idCounter;
+    const std::array<double, 3> spacing{{dataset.scale.x, dataset.scale.y, dataset.scale.z}};
+    const int slabCells{16};// bounds the copied block per thread
+    for (int z0 = 0; z0 < cubeShape.z; z0 += slabCells) {
+        const auto cells = std::min(slabCells, cubeShape.z - z0);
+        const std::array<double, 3> dims{{cubeShape.x + 1.0, cubeShape.y + 1.0, cells + 1.0}};
+        std::vector<std::uint64_t> data(static_cast<std::size_t>(dims[0] * dims[1] * dims[2]));
+        bool any{false};
+        std::size_t i{0};
+        for (int z = z0; z <= z0 + cells; ++z)
+        for (int y = 0; y <= cubeShape.y; ++y)
+        for (int x = 0; x <= cubeShape.x; ++x, ++i) {
+            const auto * block = blocks[(x == cubeShape.x) | (y == cubeShape.y) << 1 | (z == cubeShape.z) << 2];
+            if (block == nullptr) {
+                continue;
+            }
+            const auto value = block[(static_cast<std::size_t>(z % cubeShape.z) * cubeShape.y + y % cubeShape.y) * cubeShape.x + x % cubeShape.x];
+            data[i] = value;
+            if (value != lastValue) {
+                lastValue = value;
+                lastMeshed = isMeshed(value);
+            }
+            if (!lastMeshed) {
+                continue;
+            }
+            any = true;
+            if (explore && (x == 0 || y == 0 || z == 0 || x == cubeShape.x || y == cubeShape.y || z == cubeShape.z)) {
+                for (int d = 0; d < 8; ++d) {// owners of the cells around this voxel
+                    mesh.neighbors.emplace(floorDiv(cubeFirst.x + x - (d & 1), cubeShape.x), floorDiv(cubeFirst.y + y - ((d >> 1) & 1), cubeShape.y), floorDiv(cubeFirst.z + z - (d >> 2), cubeShape.z));
                 }
             }
-            return cube;
-        };
-
-        const auto scale = Dataset::current().scale;
-        const auto inMagCoord = Coordinate{pair.first.x, pair.first.y, pair.first.z}.componentMul(cubeShape);
-        const auto cubeCoord = scale.componentMul(inMagCoord);
-
-        const std::array<double, 3> dims{{cubeShape.x * 1.0, cubeShape.y * 1.0, cubeShape.z * 1.0}};
-        const std::array<double, 3> origin{{cubeCoord.x, cubeCoord.y, cubeCoord.z}};
-        const std::array<double, 3> spacing{{scale.x, scale.y, scale.z}};
-        const std::array<double, 6> extent{{0, dims[0], 0, dims[1], 0, dims[2]}};
-
-        if (Dataset::current().boundary.z != 1) {
-            marchingCubes(obj2points, obj2faces, obj2idCounter, extractedCubeForCoord(pair.first), soid2oid, origin, dims, spacing, extent);
         }
-        for (std::size_t i = 0; i < 6; ++i) {
-            const std::array<double, 3> dims{{i < 2 ? 2.0 : cubeShape.x + 2, i % 4 < 2 ? cubeShape.y + 2 : 2.0, i < 4 ? cubeShape.z + 2 : 2.0}};
-            const floatCoordinate unscaledOrigin(inMagCoord + floatCoordinate(i == 1 ? cubeShape.x - 1 : -1, i == 3 ? cubeShape.y - 1 : -1, i == 5 ? cubeShape.z - 1 : -1));
-            const std::array<double, 6> extent{{0, dims[0], 0, dims[1], 0, dims[2]}};
-
-            std::vector<std::uint64_t> data(std::reduce(std::begin(dims), std::end(dims), 1.0, std::multiplies<>{}));
-
-            const auto rowSize = dims[0];
-            const auto sliceSize = rowSize * dims[1];
-            for (std::size_t z = 0; z < dims[2]; ++z) {
-                for (std::size_t y = 0; y < dims[1]; ++y) {
-                    for (std::size_t x = 0; x < dims[0]; ++x) {
-                        const Coordinate globalPos = unscaledOrigin + Coordinate(x, y, z);
-                        if (globalPos.x < 0 || globalPos.y < 0 || globalPos.z < 0) {
-                            continue;
-                        }
-                        const CoordOfCube coord(globalPos.x / cubeShape.x, globalPos.y / cubeShape.y, globalPos.z / cubeShape.z);
-                        const CoordInCube inCube(globalPos.x % cubeShape.x, globalPos.y % cubeShape.y, globalPos.z % cubeShape.z);
-                        auto & cube = extractedCubeForCoord(coord);
-                        data[z * sliceSize + y * rowSize + x] = boost::multi_array_ref<uint64_t, 3>(reinterpret_cast<std::uint64_t *>(cube.data()), boost::extents[cubeShape.z][cubeShape.y][cubeShape.x])[inCube.z][inCube.y][inCube.x];
+        if (any) {// global voxel offsets keep the vertices of neighboring cubes identical
+            const std::array<double, 6> extent{{1.0 * cubeFirst.x, dims[0], 1.0 * cubeFirst.y, dims[1], 1.0 * (cubeFirst.z + z0), dims[2]}};
+            const auto ownsCell = [seamOf, &cubeCoord, &cubeShape, z0](const int x, const int y, const int z){
+                if (seamOf == nullptr) {
+                    return true;
+                }
+                const std::array<bool, 3> upper{{x + 1 == cubeShape.x, y + 1 == cubeShape.y, z0 + z + 1 == cubeShape.z}};// the cell reaches into the upper neighbor
+                for (int d = 1; d < 8; ++d) {
+                    if ((!(d & 1) || upper[0]) && (!(d & 2) || upper[1]) && (!(d & 4) || upper[2])
+                            && seamOf->count(cubeCoord + CoordOfCube(d & 1, (d >> 1) & 1, d >> 2)) != 0) {
+                        return true;
                     }
                 }
-            }
-            const auto scaledOrigin = scale.componentMul(unscaledOrigin);
-            marchingCubes(obj2points, obj2faces, obj2idCounter, data, soid2oid, {{scaledOrigin.x, scaledOrigin.y, scaledOrigin.z}}, dims, spacing, extent);
+                return false;
+            };
+            marchingCubes(mesh.obj2points, mesh.obj2faces, obj2idCounter, data, soid2oid, {{0, 0, 0}}, dims, spacing, extent, ownsCell);
         }
-    };
-    std::string s;
-    std::vector<std::pair<std::size_t, decltype(std::cbegin(cubes))>> threadids;
-    std::size_t i = 0;
-    for (auto it = std::begin(cubes); it != std::end(cubes); ++it) {
-        threadids.emplace_back(i, it);
-        ++i;
     }
+    mesh.neighbors.erase(cubeCoord);
+    return mesh;
+}
 
-    QEventLoop pause;
-    QFutureWatcher<void> watcher;
-    QObject::connect(&watcher, &decltype(watcher)::progressRangeChanged, &progress, &QProgressDialog::setRange);
-    QObject::connect(&watcher, &decltype(watcher)::progressValueChanged, &progress, &QProgressDialog::setValue);
-    QObject::connect(&watcher, &decltype(watcher)::finished, [&pause](){ pause.exit();} );
-    QObject::connect(&progress, &QProgressDialog::canceled, &watcher, &decltype(watcher)::cancel);
-    watcher.setFuture(QtConcurrent::map(threadids, processCube));
-    pause.exec();
-
-    progress.setLabelText(progress.labelText() + QObject::tr("\nFinalizing …"));
-    progress.setRange(0, 1000);
-    double value{0};
-
-    std::unordered_map<std::uint64_t, QVector<float>> obj2verts;
-    std::unordered_map<std::uint64_t, std::vector<std::size_t>> obj2offsets;
-    std::unordered_map<std::uint64_t, std::size_t> obj2offseti;
-    std::unordered_map<std::uint64_t, QVector<unsigned int>> obj2faces;
+// decoded cubes are kept across waves, neighboring cubes of consecutive waves share their upper neighbors
+class CubeCache {
+    std::unordered_map<CoordOfCube, std::vector<char>> cubes;
+    std::list<CoordOfCube> recent;// most recently used first
+    std::unordered_map<CoordOfCube, std::list<CoordOfCube>::iterator> positions;
+    const std::size_t capacity;
 
-    value = 0;
-    for (auto & elempoints : obj2totalpoints) {
-        if (progress.wasCanceled()) {
-            break;
+    void touch(const CoordOfCube & cubeCoord) {
+        recent.splice(std::begin(recent), recent, positions.at(cubeCoord));
+    }
+    void add(const CoordOfCube & cubeCoord, std::vector<char> && cube) {
+        cubes.emplace(cubeCoord, std::move(cube));
+        recent.emplace_front(cubeCoord);
+        positions.emplace(cubeCoord, std::begin(recent));
+    }
+public:
+    explicit CubeCache(const std::size_t capacity) : capacity{capacity} {}
+    /** the returned cubes contain all needed ones */
+    const std::unordered_map<CoordOfCube, std::vector<char>> & fetch(const std::size_t layerId, const std::size_t magIndex, const std::unordered_set<CoordOfCube> & needed) {
+        std::vector<CoordOfCube> missing;
+        for (const auto & cubeCoord : needed) {
+            if (cubes.find(cubeCoord) != std::end(cubes)) {
+                touch(cubeCoord);
+            } else {
+                missing.emplace_back(cubeCoord);
+            }
+        }
+        const auto keep = std::max(needed.size() - missing.size(), capacity - std::min(capacity, missing.size()));
+        while (cubes.size() > keep) {// the needed cubes are at the front
+            cubes.erase(recent.back());
+            positions.erase(recent.back());
+            recent.pop_back();
         }
-        for (const auto & pair : elempoints) {
-            const auto oid = pair.first;
-            auto & verts = obj2verts[oid];
-            const auto offset = verts.size();
-            obj2offsets[oid].emplace_back(offset / 3);
-            verts.resize(offset + 3 * pair.second.size());
-            for (const auto & pair : pair.second) {
-                verts[offset + 3 * pair.second    ] = pair.first.x;
-                verts[offset + 3 * pair.second + 1] = pair.first.y;
-                verts[offset + 3 * pair.second + 2] = pair.first.z;
+        for (auto & pair : readLayerCubes(layerId, magIndex, missing)) {
+            add(pair.first, std::move(pair.second));
+        }
+        return cubes;
+    }
+};
+
+void weld(std::unordered_map<std::uint64_t, ObjectMesh> & meshes, CubeMesh & cubeMesh) {
+    for (auto & pair : cubeMesh.obj2points) {
+        auto & mesh = meshes[pair.first];
+        std::vector<unsigned int> remap(pair.second.size());
+        for (const auto & point : pair.second) {
+            const auto [it, inserted] = mesh.ids.emplace(point.first, static_cast<unsigned int>(mesh.ids.size()));
+            if (inserted) {
+                mesh.verts << point.first.x << point.first.y << point.first.z;
             }
+            remap[point.second] = it->second;
+        }
+        for (const auto id : cubeMesh.obj2faces[pair.first]) {
+            mesh.faces.push_back(remap[id]);
         }
-        elempoints.clear();// deallocate bit by bit
-        progress.setValue(++value / obj2totalpoints.size() * 333);
     }
-    value = 0;
-    for (auto & elemfaces : obj2totalfaces) {
+    cubeMesh = {};
+}
+}
+
+/*
+ * Meshes are streamed cube by cube: starting from the seeds, every cube whose cells touch a meshed voxel is visited,
+ * so objects are followed beyond edited cubes and their meshes end up closed.
+ * Without selected objects only the seeds are meshed, including the seam cells that their lower neighbors own.
+ */
+void generateMeshForSubobjectID(const std::unordered_map<std::uint64_t, std::uint64_t> & soid2oid, const std::vector<std::uint64_t> & objects, const std::vector<CoordOfCube> & seeds, const std::size_t magIndex, QProgressDialog & progress) {
+    const auto layerId = Segmentation::singleton().layerId;
+    const auto dataset = Dataset::datasets[layerId].atMagIndex(magIndex);
+    const bool explore = !soid2oid.empty();
+    const std::unordered_set<CoordOfCube> seedSet(std::begin(seeds), std::end(seeds));
+    std::unordered_set<CoordOfCube> visited(seedSet);
+    std::unordered_set<CoordOfCube> seamCubes;// lower neighbors of the seeds, only their cells that reach into a seed are meshed
+    if (!explore) {
+        for (const auto & seed : seedSet) {
+            for (int d = 1; d < 8; ++d) {
+                const auto cubeCoord = seed - CoordOfCube(d & 1, (d >> 1) & 1, d >> 2);
+                if (seedSet.count(cubeCoord) == 0) {
+                    seamCubes.emplace(cubeCoord);
+                }
+            }
+        }
+        visited.insert(std::begin(seamCubes), std::end(seamCubes));
+    }
+    std::vector<CoordOfCube> initial(std::begin(visited), std::end(visited));
+    std::sort(std::begin(initial), std::end(initial), [](const auto & lhs, const auto & rhs){// neighbors end up in the same or adjacent waves
+        return std::tie(lhs.z, lhs.y, lhs.x) < std::tie(rhs.z, rhs.y, rhs.x);
+    });
+    std::deque<CoordOfCube> queue(std::begin(initial), std::end(initial));
+    const auto waveSize = static_cast<std::size_t>(std::max(1, QThread::idealThreadCount())) * 2;
+    CubeCache cubeCache{4 * waveSize};
+    std::unordered_map<std::uint64_t, ObjectMesh> meshes;
+    std::size_t done{0};
+    while (!queue.empty()) {
+        progress.setMaximum(visited.size());
+        progress.setValue(done);
         if (progress.wasCanceled()) {
             break;
         }
-        for (const auto & pair : elemfaces) {
-            const auto oid = pair.first;
-            auto & faces = obj2faces[oid];
-            auto & offseti = obj2offseti[oid];
-            auto & offsets = obj2offsets[oid];
-            for (const auto & elem : pair.second) {
-                faces.push_back(offsets[offseti] + elem);
+        std::vector<CoordOfCube> wave;
+        std::unordered_set<CoordOfCube> needed;
+        while (!queue.empty() && wave.size() < waveSize) {
+            wave.emplace_back(queue.front());
+            queue.pop_front();
+            for (int d = 0; d < 8; ++d) {
+                needed.emplace(wave.back() + CoordOfCube(d & 1, (d >> 1) & 1, d >> 2));
             }
-            ++offseti;
         }
-        elemfaces.clear();// deallocate bit by bit
-        progress.setValue(333 + ++value / obj2totalfaces.size() * 333);
-    }
-    value = 0;
-    const auto addMesh = [&](auto & iterable, const auto func){
-        QSignalBlocker blockautosave(Annotation::singleton().autoSaveTimer);
-        QSignalBlocker blockseg(Segmentation::singleton());
-        QSignalBlocker blockskel(Skeletonizer::singleton());
-        for (auto && elem : iterable) {
-            if (progress.wasCanceled()) {
-                break;
+        const auto & cubes = cubeCache.fetch(layerId, magIndex, needed);
+        std::vector<CubeMesh> cubeMeshes(wave.size());
+        std::vector<std::size_t> indices(wave.size());
+        std::iota(std::begin(indices), std::end(indices), 0);
+        QtConcurrent::blockingMap(indices, [&](const std::size_t i){
+            cubeMeshes[i] = meshCube(wave[i], cubes, soid2oid, dataset, explore, seamCubes.count(wave[i]) != 0 ? &seedSet : nullptr);
+        });
+        for (auto & cubeMesh : cubeMeshes) {
+            if (explore) {
+                for (const auto & neighbor : cubeMesh.neighbors) {
+                    if (visited.emplace(neighbor).second) {
+                        queue.emplace_back(neighbor);
+                    }
+                }
             }
-            func(elem, QVector<float>{}, QVector<std::uint8_t>{});
-            progress.setValue(666 + ++value / iterable.size() * 334);
+            weld(meshes, cubeMesh);
         }
-    };
-    if (!objects.empty()) {
-        addMesh(objects, [&](auto & oidx, auto normals, auto colors){
-            auto & nmcoords = obj2verts[oidx];
-            const auto coord = floatCoordinate{nmcoords[0], nmcoords[1], nmcoords[2]} / Dataset::current().scales[0];
+        done += wave.size();
+    }
+
+    progress.setLabelText(progress.labelText() + QObject::tr("\nFinalizing …"));
+    progress.setRange(0, meshes.size());
+    std::size_t value{0};
+    const std::unordered_set<std::uint64_t> selected(std::begin(objects), std::end(objects));
+    QSignalBlocker blockautosave(Annotation::singleton().autoSaveTimer);
+    QSignalBlocker blockseg(Segmentation::singleton());
+    QSignalBlocker blockskel(Skeletonizer::singleton());
+    for (auto & pair : meshes) {
+        if (progress.wasCanceled()) {
+            break;
+        }
+        progress.setValue(value++);
+        auto & mesh = pair.second;
+        mesh.ids = {};
+        if (mesh.verts.empty() || (!objects.empty() && selected.count(pair.first) == 0)) {
+            continue;// other objects sharing a subobject are not meshed completely
+        }
+        const auto coord = floatCoordinate{mesh.verts[0], mesh.verts[1], mesh.verts[2]} / Dataset::current().scales[0];
+        auto oidx = pair.first;
+        if (!objects.empty()) {
             Segmentation::singleton().setObjectLocation(oidx, coord);
-            Skeletonizer::singleton().addMeshToTree(Segmentation::singleton().oid(oidx), nmcoords, normals, obj2faces[oidx], colors, GL_TRIANGLES);
-        });
-    } else {
-        addMesh(obj2verts, [&](auto & oidverts, auto normals, auto colors){
-            auto & nmcoords = oidverts.second;
-            const auto coord = floatCoordinate{nmcoords[0], nmcoords[1], nmcoords[2]} / Dataset::current().scales[0];
-            const auto oidx = Segmentation::singleton().largestObjectContainingSubobjectId(oidverts.first, coord);
-            Skeletonizer::singleton().addMeshToTree(Segmentation::singleton().oid(oidx), nmcoords, normals, obj2faces[oidverts.first], colors, GL_TRIANGLES);
-        });
+        } else {
+            oidx = Segmentation::singleton().largestObjectContainingSubobjectId(pair.first, coord);
+        }
+        Skeletonizer::singleton().addMeshToTree(Segmentation::singleton().oid(oidx), mesh.verts, QVector<float>{}, mesh.faces, QVector<std::uint8_t>{}, GL_TRIANGLES);
+        mesh = {};
     }
     Segmentation::singleton().resetData();
     Skeletonizer::singleton().resetData();
 }
 
 void generateMeshesForSubobjectsOfSelectedObjects() {
-    const auto guard = Loader::Controller::singleton().getAllModifiedCubes(Segmentation::singleton().layerId);
-    const auto & cubes = guard.cubes;
-
-    const auto count = Segmentation::singleton().selectedObjectsCount();
-    const auto msg = QObject::tr("Generating meshes for %1 objects over %2 cubes").arg(count == 0 ? QObject::tr("all") : QString::number(count)).arg(cubes[Dataset::current().magIndex].size());
-    QProgressDialog progress(msg, "Cancel", 0, Segmentation::singleton().selectedObjectsCount() * cubes[0].size(), QApplication::activeWindow());
-    progress.setWindowModality(Qt::WindowModal);
-    qDebug() << msg.toUtf8().constData();
-
+    const auto layerId = Segmentation::singleton().layerId;
+    const auto magIndex = Dataset::current().magIndex;
+    std::vector<CoordOfCube> seeds;
+    {
+        const auto guard = Loader::Controller::singleton().getAllModifiedCubes(layerId);
+        for (const auto & pair : guard.cubes[magIndex]) {
+            seeds.emplace_back(pair.first);
+        }
+    }
     std::unordered_map<std::uint64_t, std::uint64_t> soids;
     std::vector<std::uint64_t> oids;
+    const auto dataset = Dataset::datasets[layerId].atMagIndex(magIndex);
     for (const auto objectIndex : Segmentation::singleton().selectedObjectIndices) {
-        for (const auto & elem : Segmentation::singleton().objects[objectIndex].subobjects) {
+        const auto & object = Segmentation::singleton().objects[objectIndex];
+        for (const auto & elem : object.subobjects) {
             soids.emplace(elem.get().id, objectIndex);
         }
         oids.emplace_back(objectIndex);
+        seeds.emplace_back(dataset.global2cube(object.location));
+    }
+    if (!oids.empty()) {// loaded cubes catch parts that are not connected to the location
+        QMutexLocker locker(&state->protectCube2Pointer);
+        if (state->cube2Pointer.size() > layerId && state->cube2Pointer[layerId].size() > magIndex) {
+            for (const auto & pair : state->cube2Pointer[layerId][magIndex]) {
+                seeds.emplace_back(pair.first);
+            }
+        }
+        if (state->cube2Palette.size() > layerId && state->cube2Palette[layerId].size() > magIndex) {
+            for (const auto & pair : state->cube2Palette[layerId][magIndex]) {
+                seeds.emplace_back(pair.first);
+            }
+        }
+    }
+
+    const auto count = oids.size();
+    const auto msg = QObject::tr("Generating meshes for %1 objects").arg(count == 0 ? QObject::tr("all") : QString::number(count));
+    QProgressDialog progress(msg, "Cancel", 0, seeds.size(), QApplication::activeWindow());
+    progress.setWindowModality(Qt::WindowModal);
+    qDebug() << msg.toUtf8().constData();
+
+    try {
+        generateMeshForSubobjectID(soids, oids, seeds, magIndex, progress);
+    } catch (const std::exception & e) {
+        QMessageBox box{QApplication::activeWindow()};
+        box.setIcon(QMessageBox::Warning);
+        box.setText(QObject::tr("Generating meshes failed"));
+        box.setInformativeText(e.what());
+        box.exec();
     }
-    generateMeshForSubobjectID(soids, oids, cubes[Dataset::current().magIndex], progress);
 }
@@ -0,0 +1,463 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+#include "mesh/mesharrays.h"
+
+#include "tinyply/tinyply.h"
+
+#include <QDataStream>
+#include <QIODevice>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+// file layout: magic, version, counts, per axis grid origin and step, then the compressed index, position, residual, normal and color streams.
+// the header is a big endian QDataStream (Qt_5_0, grid origins are written as doubles), normals are little endian octahedral int16 pairs
+const QByteArray meshMagic{"KNOSSOS mesh"};
+constexpr quint32 meshVersion{1};
+constexpr std::size_t vertexCacheSize{16};
+constexpr auto unusedVertex = std::numeric_limits<std::uint32_t>::max();
+
+std::uint64_t zigzag(const std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(const std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void putVarint(QByteArray & out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.append(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+class VarintReader {
+    const QByteArray & data;
+    int pos{0};
+public:
+    explicit VarintReader(const QByteArray & data) : data{data} {}
+    std::uint64_t next() {
+        std::uint64_t value{0};
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= data.size()) {
+                throw std::runtime_error("mesh: truncated stream");
+            }
+            const auto byte = static_cast<std::uint8_t>(data[pos++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("mesh: corrupt stream");
+    }
+    bool atEnd() const {
+        return pos == data.size();
+    }
+};
+
+std::uint32_t floatBits(const float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(const std::uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+struct Grid {
+    float origin{0};
+    double step{1};
+    float at(const std::int64_t q) const {// fma rounds once on every platform, encoder and decoder agree
+        return static_cast<float>(std::fma(static_cast<double>(q), step, static_cast<double>(origin)));
+    }
+};
+
+// marching cubes positions lie on a half voxel grid, its step is the smallest difference that is not float noise
+Grid estimateGrid(const QVector<float> & vertices, const int axis) {
+    std::vector<float> values;
+    values.reserve(vertices.size() / 3);
+    for (int i = axis; i < vertices.size(); i += 3) {
+        if (std::isfinite(vertices[i])) {
+            values.emplace_back(vertices[i]);
+        }
+    }
+    std::sort(std::begin(values), std::end(values));
+    values.erase(std::unique(std::begin(values), std::end(values)), std::end(values));
+    if (values.empty()) {
+        return {};
+    }
+    const double range = static_cast<double>(values.back()) - values.front();
+    const double noise = 1e-5 * std::max({std::abs(static_cast<double>(values.front())), std::abs(static_cast<double>(values.back())), range});
+    double step{0};
+    for (std::size_t i = 1; i < values.size(); ++i) {
+        const double diff = static_cast<double>(values[i]) - values[i - 1];
+        if (diff > noise && (step == 0 || diff < step)) {
+            step = diff;
+        }
+    }
+    if (step == 0 || !std::isfinite(range) || range / step > (1 << 30)) {// residuals keep arbitrary positions exact
+        step = range > 0 && std::isfinite(range) ? range / (1 << 20) : 1;
+    }
+    return {values.front(), step};
+}
+
+std::array<std::int16_t, 2> octahedralEncode(const float x, const float y, const float z) {
+    const auto l1 = std::abs(x) + std::abs(y) + std::abs(z);
+    if (!(l1 > 0)) {
+        return {};
+    }
+    auto u = x / l1;
+    auto v = y / l1;
+    if (z < 0) {// fold the lower hemisphere onto the corners
+        const auto foldedU = (1 - std::abs(v)) * (u < 0 ? -1 : 1);
+        v = (1 - std::abs(u)) * (v < 0 ? -1 : 1);
+        u = foldedU;
+    }
+    return {{static_cast<std::int16_t>(std::lround(std::clamp(u, -1.f, 1.f) * 32767)), static_cast<std::int16_t>(std::lround(std::clamp(v, -1.f, 1.f) * 32767))}};
+}
+
+std::array<float, 3> octahedralDecode(const std::int16_t encodedU, const std::int16_t encodedV) {
+    auto u = std::max(encodedU / 32767.f, -1.f);
+    auto v = std::max(encodedV / 32767.f, -1.f);
+    const auto z = 1 - std::abs(u) - std::abs(v);
+    if (z < 0) {
+        const auto unfoldedU = (1 - std::abs(v)) * (u < 0 ? -1 : 1);
+        v = (1 - std::abs(u)) * (v < 0 ? -1 : 1);
+        u = unfoldedU;
+    }
+    const auto length = std::sqrt(u * u + v * v + z * z);
+    return length > 0 ? std::array<float, 3>{{u / length, v / length, z / length}} : std::array<float, 3>{};
+}
+
+// triangle order for a small vertex cache, Tipsify from Sander et al. “Fast Triangle Reordering for Vertex Locality and Reduced Overdraw”
+std::vector<std::uint32_t> cacheOrder(const QVector<unsigned int> & indices, const std::size_t vertexCount) {
+    std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+    for (const auto index : indices) {
+        ++offsets[index + 1];
+    }
+    std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+    std::vector<std::uint32_t> adjacency(indices.size());
+    std::vector<std::uint32_t> fill(std::begin(offsets), std::end(offsets) - 1);
+    for (int i = 0; i < indices.size(); ++i) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+    std::vector<std::uint32_t> live(vertexCount);
+    for (std::size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        live[vertex] = offsets[vertex + 1] - offsets[vertex];
+    }
+    std::vector<std::size_t> cacheTime(vertexCount, 0);
+    std::vector<std::uint8_t> emitted(indices.size() / 3, false);
+    std::vector<std::uint32_t> order;
+    order.reserve(emitted.size());
+    std::vector<std::uint32_t> deadEnd;
+    std::vector<std::uint32_t> candidates;
+    std::size_t time{vertexCacheSize + 1};
+    std::size_t cursor{0};
+    const auto skipDeadEnd = [&]() -> std::int64_t {
+        while (!deadEnd.empty()) {
+            const auto vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[vertex] > 0) {
+                return vertex;
+            }
+        }
+        for (; cursor < vertexCount; ++cursor) {
+            if (live[cursor] > 0) {
+                return cursor;
+            }
+        }
+        return -1;
+    };
+    for (auto fan = skipDeadEnd(); fan >= 0;) {
+        candidates.clear();
+        for (auto i = offsets[fan]; i < offsets[fan + 1]; ++i) {
+            const auto triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            order.emplace_back(triangle);
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                const auto vertex = indices[3 * triangle + corner];
+                deadEnd.emplace_back(vertex);
+                candidates.emplace_back(vertex);
+                --live[vertex];
+                if (time - cacheTime[vertex] > vertexCacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+        fan = -1;
+        std::int64_t bestPriority{-1};
+        for (const auto vertex : candidates) {
+            if (live[vertex] > 0) {// prefer vertices that stay in the cache while their remaining triangles are emitted
+                const auto age = time - cacheTime[vertex];
+                const std::int64_t priority = age + 2 * live[vertex] <= vertexCacheSize ? age : 0;
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    fan = vertex;
+                }
+            }
+        }
+        if (fan < 0) {
+            fan = skipDeadEnd();
+        }
+    }
+    return order;
+}
+
+void checkSizes(const MeshArrays & mesh) {
+    const auto vertexCount = static_cast<std::size_t>(mesh.vertices.size() / 3);
+    if (mesh.vertices.size() % 3 != 0 || mesh.indices.size() % 3 != 0
+            || (!mesh.normals.empty() && mesh.normals.size() != mesh.vertices.size())
+            || (!mesh.colors.empty() && static_cast<std::size_t>(mesh.colors.size()) != 4 * vertexCount)) {
+        throw std::runtime_error("mesh: inconsistent array sizes");
+    }
+    if (std::any_of(std::begin(mesh.indices), std::end(mesh.indices), [vertexCount](const auto index){ return index >= vertexCount; })) {
+        throw std::runtime_error("mesh: index out of range");
+    }
+}
+}
+
+void MeshArrays::write(QIODevice & device) const {
+    checkSizes(*this);
+    const std::size_t vertexCount = vertices.size() / 3;
+    // vertices are renumbered in order of first use, so new ones are coded as 0 and reused ones as their distance
+    std::vector<std::uint32_t> renumbered(vertexCount, unusedVertex);
+    std::vector<std::uint32_t> byNumber;
+    byNumber.reserve(vertexCount);
+    QByteArray indexStream;
+    indexStream.reserve(indices.size());
+    for (const auto triangle : cacheOrder(indices, vertexCount)) {
+        for (std::size_t corner = 0; corner < 3; ++corner) {
+            const auto vertex = indices[3 * triangle + corner];
+            const auto next = static_cast<std::uint32_t>(byNumber.size());
+            if (renumbered[vertex] == unusedVertex) {
+                renumbered[vertex] = next;
+                byNumber.emplace_back(vertex);
+            }
+            putVarint(indexStream, next - renumbered[vertex]);
+        }
+    }
+    for (std::uint32_t vertex = 0; vertex < vertexCount; ++vertex) {
+        if (renumbered[vertex] == unusedVertex) {
+            renumbered[vertex] = byNumber.size();
+            byNumber.emplace_back(vertex);
+        }
+    }
+
+    const std::array<Grid, 3> grids{{estimateGrid(vertices, 0), estimateGrid(vertices, 1), estimateGrid(vertices, 2)}};
+    QByteArray positionStream;
+    QByteArray residualStream;
+    QByteArray normalStream(normals.empty() ? 0 : 4 * static_cast<int>(vertexCount), '\0');
+    QByteArray colorStream(colors.empty() ? 0 : 4 * static_cast<int>(vertexCount), '\0');
+    std::array<std::int64_t, 3> previous{};
+    for (std::size_t i = 0; i < vertexCount; ++i) {
+        const auto vertex = byNumber[i];
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            const auto value = vertices[3 * vertex + axis];
+            const auto & grid = grids[axis];
+            const std::int64_t q = std::isfinite(value) ? std::llround((static_cast<double>(value) - grid.origin) / grid.step) : 0;
+            putVarint(positionStream, zigzag(q - previous[axis]));
+            putVarint(residualStream, zigzag(static_cast<std::int32_t>(floatBits(value) - floatBits(grid.at(q)))));
+            previous[axis] = q;
+        }
+        if (!normalStream.isEmpty()) {
+            const auto encoded = octahedralEncode(normals[3 * vertex], normals[3 * vertex + 1], normals[3 * vertex + 2]);
+            qToLittleEndian<qint16>(encoded[0], normalStream.data() + 4 * i);
+            qToLittleEndian<qint16>(encoded[1], normalStream.data() + 4 * i + 2);
+        }
+        if (!colorStream.isEmpty()) {
+            std::memcpy(colorStream.data() + 4 * i, colors.data() + 4 * vertex, 4);
+        }
+    }
+
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.writeRawData(meshMagic.constData(), meshMagic.size());
+    stream << meshVersion << static_cast<quint32>(vertexCount) << static_cast<quint32>(indices.size()) << !normalStream.isEmpty() << !colorStream.isEmpty();
+    for (const auto & grid : grids) {
+        stream << grid.origin << grid.step;
+    }
+    for (const auto * data : {&indexStream, &positionStream, &residualStream, &normalStream, &colorStream}) {
+        stream << qCompress(*data);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        throw std::runtime_error("mesh: write failed");
+    }
+}
+
+MeshArrays MeshArrays::read(QIODevice & device) {
+    if (!device.isOpen() && !device.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("mesh: open failed");
+    }
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    QByteArray magic(meshMagic.size(), '\0');
+    stream.readRawData(magic.data(), magic.size());
+    quint32 version, vertexCount, indexCount;
+    bool hasNormals, hasColors;
+    stream >> version >> vertexCount >> indexCount >> hasNormals >> hasColors;
+    std::array<Grid, 3> grids;
+    for (auto & grid : grids) {
+        stream >> grid.origin >> grid.step;
+    }
+    std::array<QByteArray, 5> streams;
+    for (auto & data : streams) {
+        stream >> data;
+        data = qUncompress(data);
+    }
+    if (magic != meshMagic || version != meshVersion || stream.status() != QDataStream::Ok || indexCount % 3 != 0) {
+        throw std::runtime_error("mesh: unsupported or truncated file");
+    }
+    const auto & [indexStream, positionStream, residualStream, normalStream, colorStream] = streams;
+    if (normalStream.size() != (hasNormals ? 4 * static_cast<qint64>(vertexCount) : 0) || colorStream.size() != (hasColors ? 4 * static_cast<qint64>(vertexCount) : 0)) {
+        throw std::runtime_error("mesh: attribute size mismatch");
+    }
+
+    MeshArrays mesh;
+    mesh.indices.resize(indexCount);
+    VarintReader indexReader(indexStream);
+    std::uint32_t next{0};
+    for (auto & index : mesh.indices) {
+        const auto distance = indexReader.next();
+        if (distance > next || (distance == 0 && next == vertexCount)) {
+            throw std::runtime_error("mesh: index out of range");
+        }
+        index = next - distance;
+        next += distance == 0;
+    }
+    mesh.vertices.resize(3 * vertexCount);
+    VarintReader positionReader(positionStream);
+    VarintReader residualReader(residualStream);
+    std::array<std::int64_t, 3> q{};
+    for (std::size_t i = 0; i < 3 * vertexCount; ++i) {
+        const auto axis = i % 3;
+        q[axis] += unzigzag(positionReader.next());
+        const auto residual = static_cast<std::uint32_t>(static_cast<std::int32_t>(unzigzag(residualReader.next())));
+        mesh.vertices[i] = bitsFloat(floatBits(grids[axis].at(q[axis])) + residual);
+    }
+    if (!indexReader.atEnd() || !positionReader.atEnd() || !residualReader.atEnd()) {
+        throw std::runtime_error("mesh: stream size mismatch");
+    }
+    if (hasNormals) {
+        mesh.normals.resize(3 * vertexCount);
+        for (std::size_t i = 0; i < vertexCount; ++i) {
+            const auto * encoded = normalStream.constData() + 4 * i;
+            const auto normal = octahedralDecode(qFromLittleEndian<qint16>(encoded), qFromLittleEndian<qint16>(encoded + 2));
+            std::copy(std::begin(normal), std::end(normal), mesh.normals.begin() + 3 * i);
+        }
+    }
+    if (hasColors) {
+        mesh.colors.resize(4 * vertexCount);
+        std::memcpy(mesh.colors.data(), colorStream.constData(), colorStream.size());
+    }
+    return mesh;
+}
+
+void MeshArrays::writePly(QIODevice & device, const bool binary) const {
+    auto vertexComponents = vertices;// tinyply takes the arrays by mutable reference
+    auto normalComponents = normals;
+    auto rgba = colors;
+    auto triangles = indices;
+    tinyply::PlyFile ply;
+    ply.add_properties_to_element("vertex", {"x", "y", "z"}, vertexComponents);
+    if (!normalComponents.empty()) {
+        ply.add_properties_to_element("vertex", {"nx", "ny", "nz"}, normalComponents);
+    }
+    if (!rgba.empty()) {
+        ply.add_properties_to_element("vertex", {"red", "green", "blue", "alpha"}, rgba);
+    }
+    ply.add_properties_to_element("face", {"vertex_indices"}, triangles, 3, tinyply::PlyProperty::Type::UINT8);
+    if (!ply.write(device, binary)) {
+        throw std::runtime_error("mesh: ply write failed");
+    }
+}
+
+MeshArrays MeshArrays::readPly(QIODevice & device) {
+    if (!device.isOpen() && !device.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("mesh: open failed");
+    }
+    tinyply::PlyFile ply(device);
+    MeshArrays mesh;
+    int missingCoords = 0, missingNormals = 0, missingColors = 0, missingIndices = 0;
+    ply.request_properties_from_element("vertex", {"x", "y", "z"}, mesh.vertices, missingCoords);
+    const auto normalCount = ply.request_properties_from_element("vertex", {"nx", "ny", "nz"}, mesh.normals, missingNormals);
+    ply.request_properties_from_element("vertex", {"red", "green", "blue", "alpha"}, mesh.colors, missingColors);
+    ply.request_properties_from_element("face", {"vertex_indices"}, mesh.indices, missingIndices, 3);
+    if (missingCoords > 0 || (normalCount > 0 && missingNormals > 0) || (missingColors > 0 && missingColors != 4) || missingIndices > 0) {
+        throw std::runtime_error("mesh: malformed ply file");
+    }
+    try {
+        ply.read(device);
+    } catch (const std::invalid_argument & e) {
+        throw std::runtime_error(std::string{"mesh: "} + e.what());
+    }
+    return mesh;
+}
+
+bool MeshArrays::sameMesh(const MeshArrays & other) const {
+    using Corner = std::array<std::uint32_t, 4>;// position bits and rgba
+    const auto corner = [](const MeshArrays & mesh, const std::size_t vertex){
+        std::uint32_t rgba{0};
+        if (!mesh.colors.empty()) {
+            std::memcpy(&rgba, mesh.colors.data() + 4 * vertex, sizeof(rgba));
+        }
+        return Corner{{floatBits(mesh.vertices[3 * vertex]), floatBits(mesh.vertices[3 * vertex + 1]), floatBits(mesh.vertices[3 * vertex + 2]), rgba}};
+    };
+    const auto canonical = [&corner](const MeshArrays & mesh){
+        std::vector<Corner> vertexCorners(mesh.vertices.size() / 3);
+        for (std::size_t vertex = 0; vertex < vertexCorners.size(); ++vertex) {
+            vertexCorners[vertex] = corner(mesh, vertex);
+        }
+        std::vector<std::array<Corner, 3>> triangles(mesh.indices.size() / 3);
+        for (std::size_t triangle = 0; triangle < triangles.size(); ++triangle) {
+            auto & corners = triangles[triangle];
+            for (std::size_t i = 0; i < 3; ++i) {
+                corners[i] = vertexCorners[mesh.indices[3 * triangle + i]];
+            }
+            std::rotate(std::begin(corners), std::min_element(std::begin(corners), std::end(corners)), std::end(corners));// keeps the winding
+        }
+        std::sort(std::begin(vertexCorners), std::end(vertexCorners));
+        std::sort(std::begin(triangles), std::end(triangles));
+        return std::make_pair(std::move(vertexCorners), std::move(triangles));
+    };
+    checkSizes(*this);
+    checkSizes(other);
+    return vertices.size() == other.vertices.size() && indices.size() == other.indices.size() && colors.empty() == other.colors.empty() && canonical(*this) == canonical(other);
+}
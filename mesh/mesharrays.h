@@ -0,0 +1,48 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include <QVector>
+
+#include <cstdint>
+
+class QIODevice;
+
+/** @brief Plain arrays of a triangle mesh as uploaded to the Mesh buffers, with the *.ply and the compact *.kmesh encodings.
+ *  kmesh renumbers vertices and reorders triangles, positions, colors and triangles (including winding) are kept exactly. */
+class MeshArrays {
+public:
+    QVector<float> vertices;// xyz
+    QVector<float> normals;// xyz or empty
+    QVector<std::uint8_t> colors;// rgba or empty
+    QVector<unsigned int> indices;// triangles
+
+    /** positions on their grid plus exact residuals, octahedral normals, vertex cache ordered delta coded triangles, every stream deflated */
+    void write(QIODevice & device) const;
+    static MeshArrays read(QIODevice & device);
+    void writePly(QIODevice & device, const bool binary) const;
+    static MeshArrays readPly(QIODevice & device);
+    /** the same triangles over the same positions and colors, regardless of vertex and triangle order; normals are not compared */
+    bool sameMesh(const MeshArrays & other) const;
+};
@@ -0,0 +1,28 @@
+import time
+import knossos as k
+
+""" Times merging an object of a million supervoxels into a small one.
+	A mutable object is absorbed by linking its slot, an immutable one stays and each of its supervoxels
+	gets the result registered, which is what every merge used to cost.
+	Note: replaces the current mergelist
+"""
+
+subobject_count = 1000000
+
+def merge(immutable):
+    k.segmentation.mergelist_clear()
+    big = " ".join(str(i) for i in range(1, subobject_count + 1))
+    k.segmentation.mergelist_load("1 0 {} {}\n0 0 0\n\n\n2 0 0 {}\n0 0 0\n\n\n".format(int(immutable), big, subobject_count + 1))
+    k.segmentation.select_object(2)  # merge origin
+    k.segmentation.select_object(1)
+    start = time.time()
+    k.segmentation.merge_selected_objects()
+    duration = time.time() - start
+    return duration, len(k.segmentation.subobject_ids_of_object(2)) == subobject_count + 1
+
+absorb, absorb_ok = merge(False)
+register, register_ok = merge(True)
+k.segmentation.mergelist_clear()
+
+print("merging {} supervoxels: absorbing {:.3f} s, registering in every supervoxel {:.3f} s, speedup {:.1f}x, correct {}".format(
+    subobject_count, absorb, register, register / max(absorb, 1e-9), absorb_ok and register_ok))
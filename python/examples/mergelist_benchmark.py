@@ -0,0 +1,45 @@
+import os
+import random
+import tempfile
+import time
+import knossos as k
+
+""" Compares parsing a large generated mergelist with the former line by line parser and the parallel parser,
+	then times loading it into the segmentation
+	Note: loading replaces the current mergelist
+"""
+
+object_count = 1000000
+subobjects_per_object = 4
+
+random.seed(0)
+with tempfile.TemporaryDirectory() as tmp:
+    path = os.path.join(tmp, "mergelist.txt")
+    with open(path, "w") as f:
+        subobject_id = 1
+        for object_id in range(1, object_count + 1):
+            subobjects = " ".join(str(subobject_id + i) for i in range(random.randint(1, 2 * subobjects_per_object - 1)))
+            subobject_id += len(subobjects.split())
+            position = " ".join(str(random.randrange(10000)) for _ in range(3))
+            color = " ".join(str(random.randrange(256)) for _ in range(3)) if object_id % 2 else ""
+            f.write("{} 0 0 {}\n{} {}\n{}\n{}\n".format(object_id, subobjects, position, color, "axon" if object_id % 3 else "", ""))
+    size = os.path.getsize(path)
+
+    start = time.time()
+    line_by_line_count = k.segmentation.mergelist_parse(path, True)
+    line_by_line = time.time() - start
+
+    start = time.time()
+    parallel_count = k.segmentation.mergelist_parse(path, False)
+    parallel = time.time() - start
+
+    with open(path) as f:
+        text = f.read()
+    start = time.time()
+    k.segmentation.mergelist_load(text)
+    load = time.time() - start
+
+print("{} objects, {:.1f} MB".format(object_count, size / 1e6))
+print("parsing: line by line {:.3f} s, parallel {:.3f} s, speedup {:.1f}x, equal {}".format(
+    line_by_line, parallel, line_by_line / max(parallel, 1e-9), line_by_line_count == parallel_count == object_count))
+print("loading (parse and apply): {:.3f} s".format(load))
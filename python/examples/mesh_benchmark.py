@@ -0,0 +1,41 @@
+import glob
+import os
+import tempfile
+import time
+import zlib
+import knossos as k
+
+""" Compares the size and read speed of compressed *.kmesh files with deflated *.ply files as stored in k.zips
+	Positions, colors and triangles must survive the conversion exactly, normals are stored as 16 bit octahedral pairs and are not compared
+	Note: set ply_directory to a folder of meshes, e.g. the *.ply files of an unzipped annotation
+"""
+
+ply_directory = os.path.expanduser("~/meshes")
+
+ply_bytes = deflated_bytes = kmesh_bytes = 0
+ply_read = kmesh_read = 0.0
+geometry_exact = True
+with tempfile.TemporaryDirectory() as tmp:
+    for ply in glob.glob(os.path.join(ply_directory, "*.ply")):
+        kmesh = os.path.join(tmp, os.path.basename(ply)[:-4] + ".kmesh")
+        k.knossos.convert_mesh_file(ply, kmesh)
+        with open(ply, "rb") as f:
+            data = f.read()
+        ply_bytes += len(data)
+        deflated_bytes += len(zlib.compress(data, 1))
+        kmesh_bytes += os.path.getsize(kmesh)
+
+        start = time.time()
+        k.knossos.mesh_files_equal(ply, ply)
+        ply_read += time.time() - start
+        start = time.time()
+        k.knossos.mesh_files_equal(kmesh, kmesh)
+        kmesh_read += time.time() - start
+
+        back = os.path.join(tmp, os.path.basename(ply))
+        k.knossos.convert_mesh_file(kmesh, back)
+        geometry_exact = geometry_exact and k.knossos.mesh_files_equal(ply, kmesh) and k.knossos.mesh_files_equal(ply, back)
+
+print("ply {:.1f} MB, deflated {:.1f} MB, kmesh {:.1f} MB ({:.1f}x smaller)".format(
+    ply_bytes / 1e6, deflated_bytes / 1e6, kmesh_bytes / 1e6, deflated_bytes / max(kmesh_bytes, 1)))
+print("reading twice: ply {:.3f} s, kmesh {:.3f} s, positions, colors and triangles exact {} (normals are quantized)".format(ply_read, kmesh_read, geometry_exact))
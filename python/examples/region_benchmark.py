@@ -0,0 +1,27 @@
+import time
+import knossos as k
+
+""" Compares reading the segmentation around the current position voxel by voxel and as one region
+	Note: load a dataset with a segmentation layer, view it in mag 1 and wait for the loader to finish first
+"""
+
+layer = 0
+while k.knossos.get_layer_voxel_bytes(layer) != 8:
+    layer += 1
+edge = 32
+position = k.knossos.get_position()
+offset = [c - edge // 2 for c in position]
+
+start = time.time()
+voxels = [k.knossos.read_overlay_voxel([x, y, z])
+          for z in range(offset[2], offset[2] + edge)
+          for y in range(offset[1], offset[1] + edge)
+          for x in range(offset[0], offset[0] + edge)]
+per_voxel = time.time() - start
+
+start = time.time()
+region = k.read_region(layer, 1, offset, [edge] * 3)
+bulk = time.time() - start
+
+print("per voxel: {:.3f} s, region: {:.3f} s, speedup {:.0f}x, equal {}".format(
+    per_voxel, bulk, per_voxel / max(bulk, 1e-9), list(region.flatten(order='F')) == voxels))
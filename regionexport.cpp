@@ -0,0 +1,280 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#include "regionexport.h"
+
+#include "dataset.h"
+#include "regionio.h"
+#include "segmentation/segmentation.h"
+#include "stateInfo.h"
+
+#include <quazip.h>
+#include <quazipfile.h>
+
+#include <snappy.h>
+
+#include <QApplication>
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProgressDialog>
+#include <QTextStream>
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+void writeFile(const QString & path, const QByteArray & data) {
+    QDir{}.mkpath(QFileInfo{path}.path());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        throw std::runtime_error((QObject::tr("region export: writing %1 failed: %2").arg(path).arg(file.errorString())).toStdString());
+    }
+}
+
+void writeZip(const QString & path, const QString & name, const QByteArray & data) {
+    QDir{}.mkpath(QFileInfo{path}.path());
+    QuaZip archive(path);
+    bool success = archive.open(QuaZip::mdCreate);
+    if (success) {
+        QuaZipFile file(&archive);
+        success = file.open(QIODevice::WriteOnly, QuaZipNewInfo(name)) && file.write(data) == data.size();
+        file.close();
+        archive.close();
+        success &= archive.getZipError() == ZIP_OK;
+    }
+    if (!success) {
+        throw std::runtime_error((QObject::tr("region export: writing %1 failed").arg(path)).toStdString());
+    }
+}
+
+// dataset at the target directory, its cube urls name the files of the cube tree
+Dataset knossosTarget(const Dataset & dataset, const QString & layerDirectory) {
+    auto target = dataset;
+    target.api = Dataset::API::Heidelbrain;
+    target.type = dataset.isOverlay() ? Dataset::CubeType::SEGMENTATION_SZ_ZIP : Dataset::CubeType::RAW_PNG;
+    target.url = QUrl::fromLocalFile(layerDirectory);
+    target.token.clear();
+    return target;
+}
+
+// <name>.k.toml in the layer folder and, for cubic cubes, knossos.conf in the mag folder,
+// whose boundary and scale are given at that mag
+void writeKnossosConfig(const Dataset & dataset, const QString & layerDirectory) {
+    const auto name = dataset.experimentname.section("_mag", 0, 0);// as in the cube file names
+    const auto & cubeShape = dataset.cubeShape;
+    QString toml;
+    QTextStream tomlStream(&toml);
+    tomlStream << "[[Layer]]\n"
+               << "ServerFormat = \"knossos\"\n"
+               << "Name = \"" << name << "\"\n"
+               << "Description = \"region export\"\n"
+               << "Extent_px = [" << dataset.boundary.x << ", " << dataset.boundary.y << ", " << dataset.boundary.z << "]\n"
+               << "CubeShape_px = [" << cubeShape.x << ", " << cubeShape.y << ", " << cubeShape.z << "]\n"
+               << "VoxelSize_nm = [";
+    for (std::size_t magIndex = 0; magIndex <= dataset.magIndex; ++magIndex) {// only the exported mag folder exists
+        const auto scale = dataset.scales.size() > magIndex ? dataset.scales[magIndex] : dataset.scale * (1 << magIndex);
+        tomlStream << (magIndex != 0 ? ", " : "") << "[" << scale.x << ", " << scale.y << ", " << scale.z << "]";
+    }
+    tomlStream << "]\n"
+               << "FileExtension = [\"" << (dataset.isOverlay() ? ".seg.sz.zip" : ".png") << "\"]\n";
+    tomlStream.flush();
+    writeFile(QString{"%1/%2.k.toml"}.arg(layerDirectory).arg(name), toml.toUtf8());
+
+    if (cubeShape.x == cubeShape.y && cubeShape.y == cubeShape.z) {
+        const auto extent = [](const int boundary, const float scaleFactor){
+            return static_cast<int>(std::ceil(boundary / scaleFactor));
+        };
+        QString config;
+        QTextStream stream(&config);
+        stream << "experiment name \"" << name << "\";\n"
+               << "boundary x " << extent(dataset.boundary.x, dataset.scaleFactor.x) << ";\n"
+               << "boundary y " << extent(dataset.boundary.y, dataset.scaleFactor.y) << ";\n"
+               << "boundary z " << extent(dataset.boundary.z, dataset.scaleFactor.z) << ";\n"
+               << "scale x " << dataset.scale.x << ";\n"
+               << "scale y " << dataset.scale.y << ";\n"
+               << "scale z " << dataset.scale.z << ";\n"
+               << "magnification " << dataset.magnification << ";\n"
+               << "cube_edge_length " << cubeShape.x << ";\n"
+               << "png;\n";// the overlay layer of the conf loads the .seg.sz.zip cubes
+        stream.flush();
+        writeFile(QString{"%1/mag%2/knossos.conf"}.arg(layerDirectory).arg(dataset.magnification), config.toUtf8());
+    }
+}
+
+void writeZarrMetadata(const Dataset & dataset, const RegionExport & job, const QString & layerDirectory) {
+    const auto & cubeShape = dataset.cubeShape;
+    const auto extent = [](const int boundary, const float scaleFactor){
+        return static_cast<int>(std::ceil(boundary / scaleFactor));
+    };
+    const Coordinate shape{std::max(job.last.x + 1, extent(dataset.boundary.x, dataset.scaleFactor.x))
+                , std::max(job.last.y + 1, extent(dataset.boundary.y, dataset.scaleFactor.y))
+                , std::max(job.last.z + 1, extent(dataset.boundary.z, dataset.scaleFactor.z))};
+    const QJsonObject zarray{
+        {"zarr_format", 2},
+        {"shape", QJsonArray{shape.z, shape.y, shape.x}},
+        {"chunks", QJsonArray{cubeShape.z, cubeShape.y, cubeShape.x}},
+        {"dtype", dataset.isOverlay() ? "<u8" : "|u1"},
+        {"compressor", QJsonObject{{"id", "zlib"}, {"level", 6}}},
+        {"fill_value", 0},
+        {"order", "C"},
+        {"filters", QJsonValue::Null},
+    };
+    const QJsonObject zattrs{
+        {"axes", QJsonArray{"z", "y", "x"}},
+        {"offset", QJsonArray{job.first.z, job.first.y, job.first.x}},
+        {"size", QJsonArray{job.last.z - job.first.z + 1, job.last.y - job.first.y + 1, job.last.x - job.first.x + 1}},
+        {"mag", dataset.magnification},
+        {"scale", QJsonArray{dataset.scale.z, dataset.scale.y, dataset.scale.x}},
+        {"mergelist_applied", job.applyMergelist && dataset.isOverlay()},
+    };
+    writeFile(layerDirectory + "/.zarray", QJsonDocument{zarray}.toJson());
+    writeFile(layerDirectory + "/.zattrs", QJsonDocument{zattrs}.toJson());
+}
+
+// zeroes the voxels outside the region
+template<typename T>
+void clip(T * cube, const Coordinate & cubeShape, const Coordinate & cubeFirst, const RegionExport & job) {
+    for (int z = 0; z < cubeShape.z; ++z)
+    for (int y = 0; y < cubeShape.y; ++y)
+    for (int x = 0; x < cubeShape.x; ++x) {
+        const Coordinate pos{cubeFirst.x + x, cubeFirst.y + y, cubeFirst.z + z};
+        if (pos.x < job.first.x || pos.y < job.first.y || pos.z < job.first.z || pos.x > job.last.x || pos.y > job.last.y || pos.z > job.last.z) {
+            cube[(static_cast<std::size_t>(z) * cubeShape.y + y) * cubeShape.x + x] = 0;
+        }
+    }
+}
+
+void applyMergelist(std::uint64_t * cube, const std::size_t voxelCount, const std::unordered_map<std::uint64_t, std::uint64_t> & objectIds) {
+    std::uint64_t lastId{0}, lastObjectId{0};
+    bool cached{false};
+    for (std::size_t i = 0; i < voxelCount; ++i) {// runs of equal ids are common
+        if (!cached || cube[i] != lastId) {
+            lastId = cube[i];
+            const auto it = objectIds.find(lastId);
+            lastObjectId = it != std::end(objectIds) ? it->second : lastId;
+            cached = true;
+        }
+        cube[i] = lastObjectId;
+    }
+}
+}
+
+bool exportRegion(const RegionExport & job) {
+    QElapsedTimer time;
+    time.start();
+    std::unordered_map<std::uint64_t, std::uint64_t> objectIds;
+    if (job.applyMergelist) {
+        objectIds = Segmentation::singleton().objectIdsOfSubobjects();
+    }
+    const Coordinate size = job.last - job.first + 1;
+    QProgressDialog progress(QObject::tr("Exporting region"), QObject::tr("Cancel"), 0, 0, QApplication::activeWindow());
+    progress.setWindowModality(Qt::WindowModal);
+    for (std::size_t i = 0; i < job.layers.size(); ++i) {
+        const auto layerId = job.layers[i];
+        if (layerId >= Dataset::datasets.size()) {
+            throw std::runtime_error("region export: layer " + std::to_string(layerId) + " does not exist");
+        }
+        const auto dataset = Dataset::datasets[layerId].atMagIndex(job.magIndex);
+        const auto layerDirectory = QString{"%1/layer%2"}.arg(job.directory).arg(layerId);
+        const auto target = knossosTarget(dataset, layerDirectory);
+        if (job.format == RegionExport::Format::Zarr) {
+            writeZarrMetadata(dataset, job, layerDirectory);
+        } else {
+            writeKnossosConfig(target, layerDirectory);
+        }
+        progress.setLabelText(QObject::tr("Exporting layer %1 (%2 of %3)").arg(layerId).arg(i + 1).arg(job.layers.size()));
+        QMutex errorMutex;
+        QString error;
+        const auto encode = [&](const CoordOfCube & cubeCoord, std::vector<char> & cube){
+            try {
+                const auto & cubeShape = dataset.cubeShape;
+                const Coordinate cubeFirst{cubeCoord.x * cubeShape.x, cubeCoord.y * cubeShape.y, cubeCoord.z * cubeShape.z};
+                const auto voxelCount = static_cast<std::size_t>(cubeShape.prod());
+                if (dataset.isOverlay()) {
+                    auto * voxels = reinterpret_cast<std::uint64_t *>(cube.data());
+                    clip(voxels, cubeShape, cubeFirst, job);
+                    if (job.applyMergelist) {
+                        applyMergelist(voxels, voxelCount, objectIds);
+                    }
+                } else {
+                    clip(reinterpret_cast<std::uint8_t *>(cube.data()), cubeShape, cubeFirst, job);
+                }
+                if (job.format == RegionExport::Format::Zarr) {
+                    const auto chunk = qCompress(reinterpret_cast<const uchar *>(cube.data()), static_cast<int>(cube.size()), 6).mid(4);// zlib stream without the Qt size header
+                    writeFile(QString{"%1/%2.%3.%4"}.arg(layerDirectory).arg(cubeCoord.z).arg(cubeCoord.y).arg(cubeCoord.x), chunk);
+                } else if (dataset.isOverlay()) {
+                    std::string compressed;
+                    snappy::Compress(cube.data(), cube.size(), &compressed);
+                    const auto path = target.knossosCubeUrl(cubeCoord).toLocalFile();
+                    writeZip(path, QFileInfo{path}.fileName().chopped(4), QByteArray::fromStdString(compressed));// name.seg.sz inside name.seg.sz.zip
+                } else {
+                    const QImage image(reinterpret_cast<const uchar *>(cube.data()), cubeShape.x, cubeShape.y * cubeShape.z, cubeShape.x, QImage::Format_Grayscale8);
+                    QByteArray png;
+                    QBuffer buffer(&png);
+                    buffer.open(QIODevice::WriteOnly);
+                    if (!image.save(&buffer, "PNG")) {
+                        throw std::runtime_error("region export: png encoding failed");
+                    }
+                    writeFile(target.knossosCubeUrl(cubeCoord).toLocalFile(), png);
+                }
+            } catch (const std::exception & e) {// QtConcurrent only forwards QExceptions
+                QMutexLocker locker(&errorMutex);
+                if (error.isEmpty()) {
+                    error = e.what();
+                }
+            }
+            cube = {};
+        };
+        const auto proceed = [&](const std::size_t done, const std::size_t total){
+            {
+                QMutexLocker locker(&errorMutex);
+                if (!error.isEmpty()) {
+                    throw std::runtime_error(error.toStdString());
+                }
+            }
+            progress.setMaximum(static_cast<int>(total));
+            progress.setValue(static_cast<int>(done));
+            return !progress.wasCanceled();
+        };
+        if (!forEachRegionCube(layerId, job.magIndex, job.first, size, encode, proceed)) {
+            qDebug() << "region export canceled after" << time.nsecsElapsed() / 1e9 << "s";
+            return false;
+        }
+    }
+    qDebug() << "region export took" << time.nsecsElapsed() / 1e9 << "s";
+    return true;
+}
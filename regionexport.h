@@ -0,0 +1,53 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <QString>
+
+#include <cstddef>
+#include <vector>
+
+struct RegionExport {
+    enum class Format {
+        KnossosCubes,// cube tree of .png or .seg.sz.zip files with a .k.toml and knossos.conf, loadable as dataset
+        Zarr// zlib compressed Zarr v2 array per layer, chunked by cube
+    };
+    std::vector<std::size_t> layers;
+    std::size_t magIndex{0};
+    Coordinate first;// in voxels of the mag, inclusive
+    Coordinate last;
+    QString directory;// layers go to directory/layer<id>
+    Format format{Format::KnossosCubes};
+    bool applyMergelist{false};// overlay voxels get the id of their largest object
+};
+
+/**
+ * Streams the region of each layer through the loader pipeline batch by batch,
+ * so the region doesn’t need to fit into memory, and encodes and writes the cubes in parallel.
+ * Edited cubes are taken from memory or the snappy cache. Shows progress and returns false if canceled.
+ */
+bool exportRegion(const RegionExport & job);
@@ -0,0 +1,346 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#include "regionio.h"
+
+#include "annotation/annotation.h"
+#include "dataset.h"
+#include "loader.h"
+#include "segmentation/palettecube.h"
+#include "stateInfo.h"
+#include "viewer.h"
+
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <snappy.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+struct CubeSource {
+    enum class Origin {
+        Empty, Resident, Packed, Snappy, Encoded, File
+    };
+    CoordOfCube cubeCoord;
+    Origin origin{Origin::Empty};
+    std::vector<char> cube;// decoded voxels
+    std::shared_ptr<const PaletteCube> packedCube;
+    std::string snappy;
+    QByteArray encoded;
+    QString path;
+    bool failed{false};
+};
+
+// cubes per batch, bounds the memory of large regions
+std::size_t batchSize() {
+    return static_cast<std::size_t>(std::max(1, QThread::idealThreadCount())) * 4;
+}
+
+Dataset layerDataset(const std::size_t layerId, const std::size_t magIndex) {
+    if (layerId >= Dataset::datasets.size()) {
+        throw std::runtime_error("region access: layer " + std::to_string(layerId) + " does not exist");
+    }
+    const auto dataset = Dataset::datasets[layerId].atMagIndex(magIndex);
+    if (dataset.magnification < dataset.lowestAvailableMag || dataset.magnification > dataset.highestAvailableMag) {
+        throw std::runtime_error("region access: mag " + std::to_string(dataset.magnification) + " is not available");
+    }
+    return dataset;
+}
+
+Dataset regionDataset(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape) {
+    const auto dataset = layerDataset(layerId, magIndex);
+    if (first.x < 0 || first.y < 0 || first.z < 0 || shape.x <= 0 || shape.y <= 0 || shape.z <= 0) {
+        throw std::runtime_error("region access: invalid region");
+    }
+    return dataset;
+}
+
+std::vector<CoordOfCube> regionCubes(const Dataset & dataset, const Coordinate & first, const Coordinate & shape) {
+    const auto cubeBegin = first / dataset.cubeShape;
+    const auto cubeEnd = (first + shape - 1) / dataset.cubeShape + 1;
+    std::vector<CoordOfCube> cubeCoords;
+    for (int z = cubeBegin.z; z < cubeEnd.z; ++z)
+    for (int y = cubeBegin.y; y < cubeEnd.y; ++y)
+    for (int x = cubeBegin.x; x < cubeEnd.x; ++x) {
+        cubeCoords.emplace_back(x, y, z);
+    }
+    return cubeCoords;
+}
+
+// resident and cached cubes are looked up in order of recency, the rest is downloaded concurrently
+std::vector<CubeSource> fetchCubes(const std::size_t layerId, const Dataset & dataset, std::vector<CoordOfCube>::const_iterator begin, std::vector<CoordOfCube>::const_iterator end) {
+    const std::size_t cubeBytes = dataset.cubeShape.prod() * regionVoxelBytes(layerId);
+    std::vector<CubeSource> sources;
+    std::vector<std::size_t> downloads;
+    for (auto it = begin; it != end; ++it) {
+        sources.emplace_back();
+        auto & source = sources.back();
+        source.cubeCoord = *it;
+        const auto globalCoord = dataset.cube2global(source.cubeCoord);
+        if (globalCoord.x < 0 || globalCoord.y < 0 || globalCoord.z < 0
+                || globalCoord.x >= dataset.boundary.x || globalCoord.y >= dataset.boundary.y || globalCoord.z >= dataset.boundary.z) {
+            continue;
+        }
+        {
+            QMutexLocker locker(&state->protectCube2Pointer);
+            if (const auto * cube = static_cast<const char *>(cubeQuery(state->cube2Pointer, layerId, dataset.magIndex, source.cubeCoord))) {
+                source.origin = CubeSource::Origin::Resident;
+                source.cube.assign(cube, cube + cubeBytes);
+                continue;
+            }
+            source.packedCube = paletteQuery(state->cube2Palette, layerId, dataset.magIndex, source.cubeCoord);
+        }
+        if (source.packedCube != nullptr) {
+            source.origin = CubeSource::Origin::Packed;
+            continue;
+        }
+        if (dataset.isOverlay()) {
+            auto & worker = *Loader::Controller::singleton().worker;
+            QMutexLocker locker(&worker.snappyCacheMutex);
+            if (layerId < worker.snappyCache.size() && dataset.magIndex < worker.snappyCache[layerId].size()) {
+                const auto & cubes = worker.snappyCache[layerId][dataset.magIndex];
+                if (const auto snappyIt = cubes.find(source.cubeCoord); snappyIt != std::end(cubes)) {
+                    source.origin = CubeSource::Origin::Snappy;
+                    source.snappy = snappyIt->second;
+                    continue;
+                }
+            }
+        }
+        if (dataset.type == Dataset::CubeType::SNAPPY || !dataset.loadingEnabled) {
+            continue;
+        }
+        if (dataset.url.scheme() == "file") {
+            const auto path = Loader::cubeRequest(dataset, source.cubeCoord).first.url().toLocalFile();
+            if (Annotation::singleton().embeddedDataset) {
+                const auto embeddedPath = QFileInfo{*Annotation::singleton().embeddedDataset}.dir().path() + path;
+                if (Annotation::singleton().extraFiles.contains(embeddedPath)) {
+                    source.origin = CubeSource::Origin::Encoded;
+                    source.encoded = Annotation::singleton().extraFiles[embeddedPath];
+                }
+            } else {
+                source.origin = CubeSource::Origin::File;
+                source.path = path;
+            }
+            continue;
+        }
+        downloads.emplace_back(sources.size() - 1);
+    }
+
+    if (!downloads.empty()) {
+        QNetworkAccessManager qnam;
+        QEventLoop pause;
+        std::vector<std::unique_ptr<QNetworkReply>> replies;
+        std::size_t pending{downloads.size()};
+        for (const auto index : downloads) {
+            const auto [request, payload] = Loader::cubeRequest(dataset, sources[index].cubeCoord);
+            const bool post = dataset.api == Dataset::API::WebKnossos || dataset.api == Dataset::API::GoogleBrainmaps;
+            replies.emplace_back(post ? qnam.post(request, payload) : qnam.get(request));
+            QObject::connect(replies.back().get(), &QNetworkReply::finished, &pause, [&pending, &pause](){
+                if (--pending == 0) {
+                    pause.quit();
+                }
+            });
+        }
+        if (pending != 0) {
+            state->viewer->suspend([&pause]() { return pause.exec(); });
+        }
+        for (std::size_t i = 0; i < downloads.size(); ++i) {
+            auto & source = sources[downloads[i]];
+            auto & reply = *replies[i];
+            if (reply.error() == QNetworkReply::NoError) {
+                source.origin = CubeSource::Origin::Encoded;
+                source.encoded = reply.readAll();
+            } else if (reply.error() != QNetworkReply::ContentNotFoundError) {// 404 → empty cube
+                throw std::runtime_error("region access: download of " + reply.request().url().toString().toStdString() + " failed: " + reply.errorString().toStdString());
+            }
+        }
+    }
+    return sources;
+}
+
+void decodeSource(const Dataset & dataset, const std::size_t cubeBytes, CubeSource & source) {
+    if (source.origin == CubeSource::Origin::Resident) {
+        return;
+    }
+    source.cube.resize(cubeBytes);
+    if (source.origin == CubeSource::Origin::Empty) {
+        std::fill(std::begin(source.cube), std::end(source.cube), 0);
+    } else if (source.origin == CubeSource::Origin::Packed) {
+        source.packedCube->decode(reinterpret_cast<std::uint64_t *>(source.cube.data()));
+        source.packedCube.reset();
+    } else if (source.origin == CubeSource::Origin::Snappy) {
+        std::size_t size{0};
+        source.failed = !snappy::GetUncompressedLength(source.snappy.data(), source.snappy.size(), &size) || size != cubeBytes
+                || !snappy::RawUncompress(source.snappy.data(), source.snappy.size(), source.cube.data());
+        source.snappy.clear();
+    } else {
+        if (source.origin == CubeSource::Origin::File) {
+            QFile file(source.path);
+            if (!file.open(QIODevice::ReadOnly)) {// missing files are empty cubes like 404s
+                std::fill(std::begin(source.cube), std::end(source.cube), 0);
+                return;
+            }
+            source.encoded = file.readAll();
+        }
+        source.failed = !Loader::decodeCube(source.encoded, dataset, source.cube.data());
+        source.encoded.clear();
+    }
+}
+
+void throwIfFailed(const CubeSource & source) {
+    if (source.failed) {
+        const auto & c = source.cubeCoord;
+        throw std::runtime_error("region access: decoding cube (" + std::to_string(c.x) + ", " + std::to_string(c.y) + ", " + std::to_string(c.z) + ") failed");
+    }
+}
+
+// calls func(cube voxel, buffer voxel, bytes) for each x-run of the region inside the cube
+template<typename Func>
+void forEachRun(const Dataset & dataset, const std::size_t voxelBytes, const CoordOfCube & cubeCoord, const Coordinate & first, const Coordinate & shape, const Coordinate & strides, Func func) {
+    const auto cubeShape = dataset.cubeShape;
+    const Coordinate cubeFirst{cubeCoord.x * cubeShape.x, cubeCoord.y * cubeShape.y, cubeCoord.z * cubeShape.z};
+    const auto begin = first.capped(cubeFirst, cubeFirst + cubeShape);
+    const auto end = (first + shape - 1).capped(cubeFirst, cubeFirst + cubeShape) + 1;
+    const bool contiguous = strides.x == static_cast<int>(voxelBytes);
+    for (int z = begin.z; z < end.z; ++z)
+    for (int y = begin.y; y < end.y; ++y) {
+        const std::ptrdiff_t cubeOffset = ((static_cast<std::ptrdiff_t>(z - cubeFirst.z) * cubeShape.y + (y - cubeFirst.y)) * cubeShape.x + (begin.x - cubeFirst.x)) * voxelBytes;
+        const std::ptrdiff_t dataOffset = static_cast<std::ptrdiff_t>(z - first.z) * strides.z + static_cast<std::ptrdiff_t>(y - first.y) * strides.y + static_cast<std::ptrdiff_t>(begin.x - first.x) * strides.x;
+        if (contiguous) {
+            func(cubeOffset, dataOffset, (end.x - begin.x) * voxelBytes);
+        } else {
+            for (int x = 0; x < end.x - begin.x; ++x) {
+                func(cubeOffset + x * static_cast<std::ptrdiff_t>(voxelBytes), dataOffset + x * static_cast<std::ptrdiff_t>(strides.x), voxelBytes);
+            }
+        }
+    }
+}
+
+// proceed(done, total) is asked before each batch and cancels with false
+template<typename Func, typename Proceed>
+bool forEachBatch(const std::size_t layerId, const Dataset & dataset, const Coordinate & first, const Coordinate & shape, Func func, Proceed proceed) {
+    const auto cubeCoords = regionCubes(dataset, first, shape);
+    const std::size_t cubeBytes = dataset.cubeShape.prod() * regionVoxelBytes(layerId);
+    for (std::size_t offset{0}; offset < cubeCoords.size(); offset += batchSize()) {
+        if (!proceed(offset, cubeCoords.size())) {
+            return false;
+        }
+        const auto batchEnd = std::begin(cubeCoords) + std::min(cubeCoords.size(), offset + batchSize());
+        auto sources = fetchCubes(layerId, dataset, std::begin(cubeCoords) + offset, batchEnd);
+        QtConcurrent::blockingMap(sources, [&dataset, cubeBytes](CubeSource & source){
+            decodeSource(dataset, cubeBytes, source);
+        });
+        for (const auto & source : sources) {
+            throwIfFailed(source);
+        }
+        func(sources);
+    }
+    return proceed(cubeCoords.size(), cubeCoords.size());
+}
+
+auto always = [](std::size_t, std::size_t){ return true; };
+}
+
+std::size_t regionVoxelBytes(const std::size_t layerId) {
+    return Dataset::datasets[layerId].isOverlay() ? OBJID_BYTES : 1;
+}
+
+void readLayerRegion(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape, char * data, const Coordinate & strides) {
+    const auto dataset = regionDataset(layerId, magIndex, first, shape);
+    const auto voxelBytes = regionVoxelBytes(layerId);
+    forEachBatch(layerId, dataset, first, shape, [&](std::vector<CubeSource> & sources){
+        QtConcurrent::blockingMap(sources, [&](const CubeSource & source){// cubes cover disjoint parts of the buffer
+            forEachRun(dataset, voxelBytes, source.cubeCoord, first, shape, strides, [&source, data](const std::ptrdiff_t cubeOffset, const std::ptrdiff_t dataOffset, const std::size_t bytes){
+                std::memcpy(data + dataOffset, source.cube.data() + cubeOffset, bytes);
+            });
+        });
+    }, always);
+}
+
+bool forEachRegionCube(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape
+        , const std::function<void(const CoordOfCube &, std::vector<char> &)> & func, const std::function<bool(std::size_t, std::size_t)> & proceed) {
+    const auto dataset = regionDataset(layerId, magIndex, first, shape);
+    return forEachBatch(layerId, dataset, first, shape, [&func](std::vector<CubeSource> & sources){
+        QtConcurrent::blockingMap(sources, [&func](CubeSource & source){
+            func(source.cubeCoord, source.cube);
+        });
+    }, proceed);
+}
+
+std::unordered_map<CoordOfCube, std::vector<char>> readLayerCubes(const std::size_t layerId, const std::size_t magIndex, const std::vector<CoordOfCube> & cubeCoords) {
+    const auto dataset = layerDataset(layerId, magIndex);
+    const std::size_t cubeBytes = dataset.cubeShape.prod() * regionVoxelBytes(layerId);
+    auto sources = fetchCubes(layerId, dataset, std::begin(cubeCoords), std::end(cubeCoords));
+    QtConcurrent::blockingMap(sources, [&dataset, cubeBytes](CubeSource & source){
+        decodeSource(dataset, cubeBytes, source);
+    });
+    std::unordered_map<CoordOfCube, std::vector<char>> cubes;
+    for (auto & source : sources) {
+        throwIfFailed(source);
+        cubes.emplace(source.cubeCoord, std::move(source.cube));
+    }
+    return cubes;
+}
+
+CubeCoordSet writeLayerRegion(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape, const char * data, const Coordinate & strides, const bool markChanged) {
+    const auto dataset = regionDataset(layerId, magIndex, first, shape);
+    if (!dataset.isOverlay()) {
+        throw std::runtime_error("region access: only overlay layers can be written");
+    }
+    const auto voxelBytes = regionVoxelBytes(layerId);
+    CubeCoordSet cubeChangeSet;
+    forEachBatch(layerId, dataset, first, shape, [&](std::vector<CubeSource> & sources){
+        QtConcurrent::blockingMap(sources, [&](CubeSource & source){
+            forEachRun(dataset, voxelBytes, source.cubeCoord, first, shape, strides, [&source, data](const std::ptrdiff_t cubeOffset, const std::ptrdiff_t dataOffset, const std::size_t bytes){
+                std::memcpy(source.cube.data() + cubeOffset, data + dataOffset, bytes);
+            });
+            snappy::Compress(source.cube.data(), source.cube.size(), &source.snappy);
+            source.cube = {};
+        });
+        for (const auto & source : sources) {// replaces resident cubes, they are reloaded from the snappy cache
+            Loader::Controller::singleton().snappyCacheSupplySnappy(layerId, source.cubeCoord, static_cast<quint64>(magIndex), source.snappy);
+            if (markChanged) {
+                Loader::Controller::singleton().markCubeAsModified(layerId, source.cubeCoord, dataset.magnification);
+            }
+            cubeChangeSet.emplace(source.cubeCoord);
+        }
+    }, always);
+    state->viewer->loader_notify();
+    return cubeChangeSet;
+}
@@ -0,0 +1,48 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#pragma once
+
+#include "coordinate.h"
+#include "segmentation/cubeloader.h"
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Bulk voxel access to any layer at any mag, independent of the cubes the loader keeps resident.
+ * Regions are given in voxels of the mag, buffers are addressed with byte strides like NumPy arrays
+ * and hold 1 byte per voxel for raw layers and OBJID_BYTES for overlay layers.
+ * Missing cubes come from the snappy cache or are fetched on demand, cubes are copied in parallel.
+ */
+std::size_t regionVoxelBytes(const std::size_t layerId);
+void readLayerRegion(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape, char * data, const Coordinate & strides);
+/// whole cubes at any coordinate, empty outside of the dataset
+std::unordered_map<CoordOfCube, std::vector<char>> readLayerCubes(const std::size_t layerId, const std::size_t magIndex, const std::vector<CoordOfCube> & cubeCoords);
+/// func runs in parallel on the whole voxels of each cube overlapping the region, proceed(done, total) can cancel between batches
+bool forEachRegionCube(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape
+        , const std::function<void(const CoordOfCube &, std::vector<char> &)> & func, const std::function<bool(std::size_t, std::size_t)> & proceed);
+CubeCoordSet writeLayerRegion(const std::size_t layerId, const std::size_t magIndex, const Coordinate & first, const Coordinate & shape, const char * data, const Coordinate & strides, const bool markChanged = true);
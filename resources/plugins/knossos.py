@@ -17,3 +17,20 @@ class SlotBlocker(object):
        if exc_type is not None:
            traceback.print_exception(exc_type, exc_value, tb)
        self.block_state.block = self.prev_block
+
+def _region_dtype(layer):
+   import numpy
+   return numpy.uint64 if knossos.get_layer_voxel_bytes(layer) == 8 else numpy.uint8
+
+def read_region(layer, mag, offset, size):
+   """Returns the voxels of layer at mag as array indexed [x, y, z], offset and size are in voxels of that mag."""
+   import numpy
+   data = numpy.empty(tuple(size), dtype=_region_dtype(layer), order='F')
+   knossos.read_region_into_buffer(layer, mag, list(offset), list(size), data.__array_interface__['data'][0], list(data.strides))
+   return data
+
+def write_region(layer, mag, offset, data, mark_changed=True):
+   """Writes an array indexed [x, y, z] (or any buffer) into the overlay layer at mag, returns the changed cube coordinates."""
+   import numpy
+   data = numpy.asarray(data, dtype=_region_dtype(layer))
+   return knossos.write_region_from_buffer(layer, mag, list(offset), list(data.shape), data.__array_interface__['data'][0], list(data.strides), mark_changed)
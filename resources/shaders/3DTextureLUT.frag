@@ -1,18 +1,20 @@
 #version 110
 
-uniform sampler3D indexTexture;
-uniform float factor;//expand float to uint8 range
+uniform sampler3D indexTexture;// R16 or RG16 (low, high)
+uniform float factor;//expand normalized float to uint16 range
 
-uniform sampler1D textureLUT;
-uniform float lutSize;//float(textureSize1D(textureLUT, 0));
+uniform sampler2D textureLUT;
+uniform vec2 lutSize;//vec2(textureSize2D(textureLUT, 0));
 
 uniform float textureOpacity;
 
 varying vec3 texCoordFrag;
 
 void main() {
-    float index = texture3D(indexTexture, texCoordFrag).r;
-    index *= factor;
-    gl_FragColor = texture1D(textureLUT, (index + 0.5) / lutSize);
+    vec2 halves = floor(texture3D(indexTexture, texCoordFrag).rg * factor + 0.5);
+    float index = halves.r + halves.g * 65536.0;
+    float row = floor(index / lutSize.x);
+    float column = index - row * lutSize.x;
+    gl_FragColor = texture2D(textureLUT, (vec2(column, row) + 0.5) / lutSize);
     gl_FragColor.a *= textureOpacity;
 }
@@ -0,0 +1,12 @@
+#version 110
+
+uniform bool lighting;
+
+varying vec3 frag_normal;
+varying vec4 frag_color;
+
+vec4 diffuse(vec3, vec4);
+
+void main() {
+    gl_FragColor = lighting ? diffuse(frag_normal, frag_color) : frag_color;
+}
@@ -0,0 +1,27 @@
+#version 110
+
+attribute vec3 vertex;// unit cylinder along z from 0 to 1
+attribute vec4 instance_base;// base and its radius
+attribute vec4 instance_top;// top and its radius
+attribute vec4 color;
+
+uniform mat4 modelview_matrix;
+uniform mat4 projection_matrix;
+
+varying vec3 frag_normal;
+varying vec4 frag_color;
+
+void main() {
+    vec3 axis = instance_top.xyz - instance_base.xyz;
+    vec3 direction = length(axis) > 0.0 ? normalize(axis) : vec3(0.0, 0.0, 1.0);
+    vec3 helper = abs(direction.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 u = normalize(cross(helper, direction));
+    vec3 v = cross(direction, u);
+    vec3 radial = u * vertex.x + v * vertex.y;
+    float radius = mix(instance_base.w, instance_top.w, vertex.z);
+
+    mat4 mvp_matrix = projection_matrix * modelview_matrix;
+    gl_Position = mvp_matrix * vec4(instance_base.xyz + radial * radius + axis * vertex.z, 1.0);
+    frag_normal = radial;
+    frag_color = color;
+}
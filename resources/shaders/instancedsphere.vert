@@ -0,0 +1,18 @@
+#version 110
+
+attribute vec3 vertex;// unit sphere
+attribute vec4 instance_base;// center and radius
+attribute vec4 color;
+
+uniform mat4 modelview_matrix;
+uniform mat4 projection_matrix;
+
+varying vec3 frag_normal;
+varying vec4 frag_color;
+
+void main() {
+    mat4 mvp_matrix = projection_matrix * modelview_matrix;
+    gl_Position = mvp_matrix * vec4(instance_base.xyz + vertex * instance_base.w, 1.0);
+    frag_normal = vertex;
+    frag_color = color;
+}
@@ -0,0 +1,46 @@
+#version 110
+
+uniform sampler3D volume;
+uniform sampler3D occupancy;
+uniform mat4 texMatrix;
+uniform float opacity;
+uniform int steps;
+uniform float rFront;
+uniform float rStep;
+uniform float bricks;
+
+varying vec2 frag_tex;
+
+void main() {
+    // r runs front (near 1) to back (0) like the slices that were stacked before
+    vec2 st = vec2(0.5*(frag_tex.x+1.0), 0.5*(1.0-frag_tex.y));
+    vec3 dir = (texMatrix * vec4(0.0, 0.0, -rStep, 0.0)).xyz;
+    vec3 safeDir = mix(vec3(1e-6), dir, step(1e-6, abs(dir)));
+    vec4 acc = vec4(0.0);
+    float k = 0.0;
+    for (int i = 0; i < steps; ++i) {
+        if (k >= float(steps)) {
+            break;
+        }
+        float r = rFront - k*rStep;
+        vec3 pos = (texMatrix * vec4(st, r, 1.0)).xyz;
+        if (texture3D(occupancy, pos).r == 0.0) {// jump to the exit of the empty brick
+            vec3 exitPlane = (floor(pos * bricks) + step(0.0, safeDir)) / bricks;
+            vec3 t = (exitPlane - pos) / safeDir;
+            k += max(1.0, floor(min(t.x, min(t.y, t.z))));
+        } else {
+            vec4 texel = texture3D(volume, pos);
+            float alpha = texel.a * opacity;
+            acc.rgb += (1.0 - acc.a) * alpha * texel.rgb * r;// depth shading
+            acc.a += (1.0 - acc.a) * alpha;
+            if (acc.a > 0.99) {// early ray termination
+                break;
+            }
+            k += 1.0;
+        }
+    }
+    if (acc.a == 0.0) {
+        discard;
+    }
+    gl_FragColor = vec4(acc.rgb / acc.a, acc.a);
+}
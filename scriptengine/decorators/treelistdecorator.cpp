@@ -24,6 +24,7 @@
 #include "treelistdecorator.h"
 
 #include "scriptengine/proxies/skeletonproxy.h"
+#include "skeleton/skeletonizer.h"
 
 TreeListDecorator::TreeListDecorator(QObject *parent) :
     QObject(parent)
@@ -43,10 +44,12 @@ QColor TreeListDecorator::color(treeListElement *self) {
 }
 
 QList<nodeListElement *> *TreeListDecorator::nodes(treeListElement *self) {
+    Skeletonizer::singleton().pageInTree(*self);
     return self->getNodes();
 }
 
 nodeListElement *TreeListDecorator::first_node(treeListElement *self) {
+    Skeletonizer::singleton().pageInTree(*self);
     return self->nodes.empty() ? nullptr : &self->nodes.front();
 }
 
@@ -26,6 +26,9 @@
 #include "buildinfo.h"
 #include "functions.h"
 #include "loader.h"
+#include "mesh/mesharrays.h"
+#include "regionexport.h"
+#include "regionio.h"
 #include "segmentation/cubeloader.h"
 #include "skeleton/node.h"
 #include "skeleton/skeletonizer.h"
@@ -37,6 +40,10 @@
 #include <QApplication>
 #include <QFile>
 
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
 void PythonProxy::annotation_load(const QString & filename, const bool merge) {
     state->mainWindow->openFileDispatch({filename}, merge, true);
 }
@@ -105,6 +112,76 @@ void PythonProxy::coord_cubes_mark_changed_proxy(QVector<int> cubeChangeSetList)
     coordCubesMarkChanged(cubeChangeSet);
 }
 
+int PythonProxy::get_layer_voxel_bytes(int layer) {
+    if (layer < 0 || static_cast<std::size_t>(layer) >= Dataset::datasets.size()) {
+        throw std::runtime_error("get_layer_voxel_bytes: layer " + std::to_string(layer) + " does not exist");
+    }
+    return static_cast<int>(regionVoxelBytes(layer));
+}
+
+// mag is the magnification (1, 2, 4, …), offset and size are in voxels of that mag
+static std::size_t regionMagIndex(const int mag) {
+    if (mag < 1 || (mag & (mag - 1)) != 0) {
+        throw std::runtime_error("region access: mag " + std::to_string(mag) + " is no power of 2");
+    }
+    return static_cast<std::size_t>(std::log2(mag));
+}
+
+void PythonProxy::read_region_into_buffer(int layer, int mag, QList<int> offset, QList<int> size, quint64 dataPtr, QList<int> strides) {
+    readLayerRegion(layer, regionMagIndex(mag), Coordinate(offset), Coordinate(size), reinterpret_cast<char *>(dataPtr), Coordinate(strides));
+}
+
+QVector<int> PythonProxy::write_region_from_buffer(int layer, int mag, QList<int> offset, QList<int> size, quint64 dataPtr, QList<int> strides, bool isMarkChanged) {
+    const auto cubeChangeSet = writeLayerRegion(layer, regionMagIndex(mag), Coordinate(offset), Coordinate(size), reinterpret_cast<const char *>(dataPtr), Coordinate(strides), isMarkChanged);
+    QVector<int> cubeChangeSetVector;
+    for (const auto & elem : cubeChangeSet) {
+        cubeChangeSetVector += elem.vector();
+    }
+    return cubeChangeSetVector;
+}
+
+bool PythonProxy::export_region(QList<int> layers, int mag, QList<int> offset, QList<int> size, const QString & directory, const QString & format, bool applyMergelist) {
+    if (format != "knossos" && format != "zarr") {
+        throw std::runtime_error("export_region: unknown format " + format.toStdString() + ", use knossos or zarr");
+    }
+    RegionExport job;
+    for (const auto layer : layers) {
+        job.layers.emplace_back(layer);
+    }
+    job.magIndex = regionMagIndex(mag);
+    job.first = Coordinate(offset);
+    job.last = job.first + Coordinate(size) - 1;
+    job.directory = directory;
+    job.format = format == "zarr" ? RegionExport::Format::Zarr : RegionExport::Format::KnossosCubes;
+    job.applyMergelist = applyMergelist;
+    return exportRegion(job);
+}
+
+static MeshArrays readMeshFile(const QString & path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("opening " + path.toStdString() + " failed");
+    }
+    return path.endsWith(".kmesh") ? MeshArrays::read(file) : MeshArrays::readPly(file);
+}
+
+void PythonProxy::convert_mesh_file(const QString & source, const QString & target) {
+    const auto mesh = readMeshFile(source);
+    QFile file(target);
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw std::runtime_error("opening " + target.toStdString() + " failed");
+    }
+    if (target.endsWith(".kmesh")) {
+        mesh.write(file);
+    } else {
+        mesh.writePly(file, Annotation::singleton().savePlyAsBinary);
+    }
+}
+
+bool PythonProxy::mesh_files_equal(const QString & path, const QString & otherPath) {
+    return readMeshFile(path).sameMesh(readMeshFile(otherPath));
+}
+
 quint64 PythonProxy::read_overlay_voxel(QList<int> coord) {
     return readVoxel(coord);
 }
@@ -71,6 +71,12 @@ public slots:
     QVector<int> process_region_by_strided_buf_proxy(QList<int> globalFirst, QList<int> size, quint64 dataPtr,
                                         QList<int> strides, bool isWrite, bool isMarkedChanged);
     void coord_cubes_mark_changed_proxy(QVector<int> cubeChangeSetList);
+    int get_layer_voxel_bytes(int layer);
+    void read_region_into_buffer(int layer, int mag, QList<int> offset, QList<int> size, quint64 dataPtr, QList<int> strides);
+    QVector<int> write_region_from_buffer(int layer, int mag, QList<int> offset, QList<int> size, quint64 dataPtr, QList<int> strides, bool isMarkChanged = true);
+    bool export_region(QList<int> layers, int mag, QList<int> offset, QList<int> size, const QString & directory, const QString & format = "knossos", bool applyMergelist = false);
+    void convert_mesh_file(const QString & source, const QString & target);// .ply ↔ .kmesh, positions, colors and triangles are exact, .kmesh normals are 16 bit octahedral
+    bool mesh_files_equal(const QString & path, const QString & otherPath);// compares positions, colors and triangles, not normals
     void set_movement_area(QList<int> minCoord, QList<int> maxCoord);
     void set_work_mode(const int mode);
     void refocus_viewport3d(const int x = 0, const int y = 0, const int z = 0);
@@ -25,6 +25,8 @@
 #include "segmentation/cubeloader.h"
 #include "segmentation/segmentation.h"
 
+#include <QFile>
+
 auto & objectFromId(const quint64 objId) {
     const auto it = Segmentation::singleton().objectIdToIndex.find(objId);
     if (it == std::end(Segmentation::singleton().objectIdToIndex)) {
@@ -49,6 +51,23 @@ QString SegmentationProxy::mergelist_save() {
     return mergelist;
 }
 
+quint64 SegmentationProxy::mergelist_parse(const QString & path, const bool lineByLine) {// parses without loading, returns the object count
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error(QObject::tr("could not open %1").arg(path).toStdString());
+    }
+    if (lineByLine) {
+        QTextStream stream(&file);
+        return Mergelist::parseLineByLine(stream).objects.size();
+    }
+    const auto * begin = reinterpret_cast<const char *>(file.map(0, file.size()));
+    if (begin == nullptr) {
+        const auto data = file.readAll();
+        return Mergelist::parse(data.constData(), data.constData() + data.size()).objects.size();
+    }
+    return Mergelist::parse(begin, begin + file.size()).objects.size();
+}
+
 void SegmentationProxy::subobject_from_id(const quint64 subObjId, const QList<int> & coord) {
     Segmentation::singleton().subobjectFromId(subObjId, Coordinate(coord));
 }
@@ -143,3 +162,33 @@ void SegmentationProxy::jump_to_object(const quint64 objId) {
 QList<int> SegmentationProxy::object_location(const quint64 objId) {
     return objectFromId(objId).location.list();
 }
+
+void SegmentationProxy::build_region_graph() {
+    Segmentation::singleton().regionGraph.build();
+    Segmentation::singleton().regionGraph.waitForFinished();
+}
+
+quint64 SegmentationProxy::region_graph_contact_area(const quint64 subobjectId, const quint64 otherSubobjectId) {
+    Segmentation::singleton().regionGraph.waitForFinished();
+    return Segmentation::singleton().regionGraph.contactArea(subobjectId, otherSubobjectId);
+}
+
+QVariantList SegmentationProxy::region_graph_neighbors(const quint64 subobjectId) {
+    Segmentation::singleton().regionGraph.waitForFinished();
+    QVariantList neighbors;
+    for (const auto & [neighbor, area] : Segmentation::singleton().regionGraph.neighbors(subobjectId)) {
+        neighbors.append(QVariant(QVariantList{static_cast<quint64>(neighbor), static_cast<quint64>(area)}));
+    }
+    return neighbors;
+}
+
+QVariantHash SegmentationProxy::region_graph_contacts() {
+    Segmentation::singleton().regionGraph.waitForFinished();
+    QVariantList lhs, rhs, areas;
+    for (const auto & contact : Segmentation::singleton().regionGraph.contacts()) {
+        lhs.append(static_cast<quint64>(contact.lhs));
+        rhs.append(static_cast<quint64>(contact.rhs));
+        areas.append(static_cast<quint64>(contact.area));
+    }
+    return {{"subobject_id", lhs}, {"other_subobject_id", rhs}, {"area", areas}};
+}
@@ -26,6 +26,7 @@
 
 #include <QList>
 #include <QObject>
+#include <QVariant>
 
 class SegmentationProxy : public QObject {
     Q_OBJECT
@@ -33,6 +34,7 @@ public slots:
     void mergelist_clear();
     void mergelist_load(QString &mergelist);
     QString mergelist_save();
+    quint64 mergelist_parse(const QString & path, const bool lineByLine = false);
 
     void subobject_from_id(const quint64 subObjId, const QList<int> & coord);
     void set_render_only_selected_objs(const bool b);
@@ -57,4 +59,9 @@ public slots:
     void unselect_object(const quint64 objId);
     void jump_to_object(const quint64 objId);
     QList<int> object_location(const quint64 objId);
+
+    void build_region_graph();
+    quint64 region_graph_contact_area(const quint64 subobjectId, const quint64 otherSubobjectId);
+    QVariantList region_graph_neighbors(const quint64 subobjectId);
+    QVariantHash region_graph_contacts();
 };
@@ -22,15 +22,18 @@
 
 #include "skeletonproxy.h"
 
+#include "dataset.h"
 #include "functions.h"
 #include "stateInfo.h"
 #include "skeleton/node.h"
+#include "skeleton/skeletonanalytics.h"
 #include "skeleton/skeletonizer.h"
 #include "skeleton/tree.h"
 #include "viewer.h"
 #include "widgets/mainwindow.h"
 
 #include <QApplication>
+#include <QBuffer>
 #include <QDir>
 #include <QFile>
 #include <QMessageBox>
@@ -63,6 +66,7 @@ void SkeletonProxy::move_to_previous_tree() {
 }
 
 bool SkeletonProxy::extract_connected_component(quint64 node_id) {
+    Skeletonizer::singleton().pageInNode(node_id);
     return Skeletonizer::singleton().extractConnectedComponent(node_id);
 }
 
@@ -123,37 +127,61 @@ void SkeletonProxy::delete_tree_mesh(quint64 tree_id) {
 }
 
 nodeListElement *SkeletonProxy::find_node_by_id(quint64 node_id) {
-    return Skeletonizer::singleton().findNodeByNodeID(node_id);
+    return Skeletonizer::singleton().pageInNode(node_id);
 }
 
 QList<nodeListElement *> SkeletonProxy::find_nodes_in_tree(treeListElement & tree, const QString & comment) {
+    Skeletonizer::singleton().pageInTree(tree);
     return Skeletonizer::findNodesInTree(tree, comment);
 }
 
 void SkeletonProxy::move_node_to_tree(quint64 node_id, quint64 tree_id) {
-    nodeListElement *node = Skeletonizer::singleton().findNodeByNodeID(node_id);
+    nodeListElement *node = Skeletonizer::singleton().pageInNode(node_id);
     Skeletonizer::singleton().select(QSet{node});
     Skeletonizer::singleton().moveSelectedNodesToTree(tree_id);
 }
 
 nodeListElement *SkeletonProxy::find_nearby_node_from_tree(quint64 tree_id, int x, int y, int z) {
     treeListElement *tree = Skeletonizer::singleton().findTreeByTreeID(tree_id);
+    if (tree != nullptr) {
+        Skeletonizer::singleton().pageInTree(*tree);
+    }
     Coordinate coord(x, y, z);
     return Skeletonizer::singleton().findNearbyNode(tree, coord);
 }
 
+QList<nodeListElement *> toQList(const std::vector<nodeListElement *> & nodes) {
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+    return {std::cbegin(nodes), std::cend(nodes)};
+#else
+    return QVector<nodeListElement *>::fromStdVector(nodes).toList();
+#endif
+}
+
+QList<nodeListElement *> SkeletonProxy::find_nearest_nodes(int x, int y, int z, int count) {
+    return toQList(state->skeletonState->nodeIndex.nearest({x, y, z}, std::max(0, count)));
+}
+
+QList<nodeListElement *> SkeletonProxy::find_nodes_in_radius(int x, int y, int z, float radius) {
+    return toQList(state->skeletonState->nodeIndex.withinRadius({x, y, z}, radius));
+}
+
+QList<nodeListElement *> SkeletonProxy::find_nodes_in_box(const QVector3D & min, const QVector3D & max) {
+    return toQList(state->skeletonState->nodeIndex.inBox(Coordinate(min.x(), min.y(), min.z()), Coordinate(max.x(), max.y(), max.z())));
+}
+
 nodeListElement *SkeletonProxy::node_with_prev_id(quint64 node_id, bool same_tree) {
-    nodeListElement *node = Skeletonizer::singleton().findNodeByNodeID(node_id);
+    nodeListElement *node = Skeletonizer::singleton().pageInNode(node_id);
     return Skeletonizer::singleton().getNodeWithPrevID(node, same_tree);
 }
 
 nodeListElement *SkeletonProxy::node_with_next_id(quint64 node_id, bool same_tree) {
-    nodeListElement *node = Skeletonizer::singleton().findNodeByNodeID(node_id);
+    nodeListElement *node = Skeletonizer::singleton().pageInNode(node_id);
     return Skeletonizer::singleton().getNodeWithNextID(node, same_tree);
 }
 
 bool SkeletonProxy::set_radius(const quint64 node_id, const float radius) {
-    auto * node = Skeletonizer::singleton().findNodeByNodeID(node_id);
+    auto * node = Skeletonizer::singleton().pageInNode(node_id);
     if (node != nullptr) {
         Skeletonizer::singleton().setRadius(*node, radius);
         return true;
@@ -162,7 +190,7 @@ bool SkeletonProxy::set_radius(const quint64 node_id, const float radius) {
 }
 
 bool SkeletonProxy::set_position(const quint64 node_id, const QVector3D & position) {
-    auto * node = Skeletonizer::singleton().findNodeByNodeID(node_id);
+    auto * node = Skeletonizer::singleton().pageInNode(node_id);
     if (node != nullptr) {
         Skeletonizer::singleton().setPosition(*node, Coordinate(position.x(), position.y(), position.z()));
         return true;
@@ -182,10 +210,10 @@ void SkeletonProxy::clear_skeleton() {
 }
 
 QString SkeletonProxy::save_skeleton() {
-    QString save_string;
-    QXmlStreamWriter xml(&save_string);
-    Skeletonizer::singleton().saveXmlSkeleton(xml);
-    return save_string;
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    Skeletonizer::singleton().saveXmlSkeleton(buffer);
+    return QString::fromUtf8(buffer.data());
 }
 
 void SkeletonProxy::load_skeleton(QString & xml_string, const bool merge, const QString & treeCmtOnMultiLoad) {
@@ -193,6 +221,81 @@ void SkeletonProxy::load_skeleton(QString & xml_string, const bool merge, const
     Skeletonizer::singleton().loadXmlSkeleton(xml, merge, treeCmtOnMultiLoad);
 }
 
+void SkeletonProxy::save_skeleton_columns(const QString & path) {
+    QFile file(path);
+    Skeletonizer::singleton().saveColumnarSkeleton(file);
+}
+
+void SkeletonProxy::load_skeleton_columns(const QString & path, const bool merge) {
+    QFile file(path);
+    Skeletonizer::singleton().loadColumnarSkeleton(file, merge);
+}
+
+void SkeletonProxy::set_tree_paging(const bool enabled) {
+    Skeletonizer::singleton().treePaging = enabled;
+    if (enabled) {
+        Skeletonizer::singleton().pageByPosition(state->viewerState->currentPosition);
+    } else {
+        Skeletonizer::singleton().pageInAll();
+    }
+}
+
+void SkeletonProxy::page_in_tree(quint64 tree_id) {
+    Skeletonizer::singleton().pageInTree(treeFromId(tree_id));
+}
+
+bool SkeletonProxy::page_out_tree(quint64 tree_id) {
+    return Skeletonizer::singleton().pageOutTree(treeFromId(tree_id));
+}
+
+quint64 SkeletonProxy::tree_node_count(quint64 tree_id) {
+    return Skeletonizer::singleton().nodeCount(treeFromId(tree_id));
+}
+
+auto analyzeSkeleton() {
+    auto columns = Skeletonizer::singleton().columnSnapshot();// includes the paged out trees
+    auto report = SkeletonAnalytics::analyze(columns, Dataset::current().scales[0]);
+    return std::make_pair(std::move(columns), std::move(report));
+}
+
+template<typename T, typename Func>
+QVariantList column(const std::vector<T> & elems, Func func) {
+    QVariantList list;
+    list.reserve(static_cast<int>(elems.size()));
+    for (const auto & elem : elems) {
+        list.append(func(elem));
+    }
+    return list;
+}
+
+QVariantHash SkeletonProxy::tree_statistics() {
+    const auto trees = analyzeSkeleton().second.trees;
+    return {{"tree_id", column(trees, [](const auto & tree){ return static_cast<quint64>(tree.treeID); })}
+        , {"node_count", column(trees, [](const auto & tree){ return tree.nodeCount; })}
+        , {"segment_count", column(trees, [](const auto & tree){ return tree.segmentCount; })}
+        , {"component_count", column(trees, [](const auto & tree){ return tree.componentCount; })}
+        , {"cycle_count", column(trees, [](const auto & tree){ return tree.cycleCount; })}
+        , {"branch_point_count", column(trees, [](const auto & tree){ return tree.branchPointCount; })}
+        , {"end_point_count", column(trees, [](const auto & tree){ return tree.endPointCount; })}
+        , {"max_branch_order", column(trees, [](const auto & tree){ return tree.maxBranchOrder; })}
+        , {"strahler_order", column(trees, [](const auto & tree){ return tree.strahlerOrder; })}
+        , {"cable_length", column(trees, [](const auto & tree){ return tree.cableLength; })}
+        , {"max_path_length", column(trees, [](const auto & tree){ return tree.maxPathLength; })}};
+}
+
+QVariantHash SkeletonProxy::node_statistics() {
+    const auto analysis = analyzeSkeleton();
+    const auto & columns = analysis.first;
+    const auto & nodes = analysis.second.nodes;
+    const auto identity = [](const auto value){ return value; };
+    return {{"node_id", column(columns.nodeIDs, [](const auto nodeID){ return static_cast<quint64>(nodeID); })}
+        , {"tree_id", column(columns.treeIndices, [&columns](const auto index){ return static_cast<quint64>(columns.trees[index].treeID); })}
+        , {"parent_id", column(nodes.parents, [&columns](const auto index){ return static_cast<quint64>(columns.nodeIDs[index]); })}
+        , {"branch_order", column(nodes.branchOrders, identity)}
+        , {"strahler_order", column(nodes.strahlerOrders, identity)}
+        , {"path_length", column(nodes.pathLengths, identity)}};
+}
+
 // TEST LATER
 void SkeletonProxy::export_converter(const QString &path) {
     QDir dir(path);
@@ -239,8 +342,8 @@ void SkeletonProxy::delete_skeleton() {
 }
 
 bool SkeletonProxy::delete_segment(quint64 source_id, quint64 target_id) {
-    auto * sourceNode = Skeletonizer::singleton().findNodeByNodeID(source_id);
-    auto * targetNode = Skeletonizer::singleton().findNodeByNodeID(target_id);
+    auto * sourceNode = Skeletonizer::singleton().pageInNode(source_id);
+    auto * targetNode = Skeletonizer::singleton().pageInNode(target_id);
     if (sourceNode && targetNode) {
         auto segmentIt = Skeletonizer::findSegmentBetween(*sourceNode, *targetNode);
         if (segmentIt != std::end(sourceNode->segments)) {
@@ -252,7 +355,7 @@ bool SkeletonProxy::delete_segment(quint64 source_id, quint64 target_id) {
 }
 
 bool SkeletonProxy::delete_node(quint64 node_id) {
-    if (!Skeletonizer::singleton().delNode(node_id, nullptr)) {
+    if (!Skeletonizer::singleton().delNode(node_id, Skeletonizer::singleton().pageInNode(node_id))) {
         emit echo(QString("could not delete the node with id %1").arg(node_id));
         return false;
     }
@@ -329,7 +432,7 @@ bool SkeletonProxy::set_active_tree(quint64 tree_id) {
 }
 
 bool SkeletonProxy::set_comment(quint64 node_id, char *comment) {
-    auto node = state->skeletonState->nodesByNodeID[node_id];
+    auto * node = Skeletonizer::singleton().pageInNode(node_id);
     if (node) {
         Skeletonizer::singleton().setComment(*node, QString(comment));
         return true;
@@ -338,7 +441,7 @@ bool SkeletonProxy::set_comment(quint64 node_id, char *comment) {
 }
 
 bool SkeletonProxy::delete_comment(quint64 node_id) {
-    auto node = state->skeletonState->nodesByNodeID[node_id];
+    auto * node = Skeletonizer::singleton().pageInNode(node_id);
     if (node) {
         Skeletonizer::singleton().setComment(*node, "");
         return true;
@@ -347,8 +450,8 @@ bool SkeletonProxy::delete_comment(quint64 node_id) {
 }
 
 bool SkeletonProxy::add_segment(quint64 source_id, quint64 target_id) {
-    auto * sourceNode = Skeletonizer::singleton().findNodeByNodeID(source_id);
-    auto * targetNode = Skeletonizer::singleton().findNodeByNodeID(target_id);
+    auto * sourceNode = Skeletonizer::singleton().pageInNode(source_id);
+    auto * targetNode = Skeletonizer::singleton().pageInNode(target_id);
     if(sourceNode != nullptr && targetNode != nullptr) {
         if (!Skeletonizer::singleton().addSegment(*sourceNode, *targetNode)) {
             emit echo(QString("could not add a segment with source id %1 and target id %2").arg(source_id).arg(target_id));
@@ -360,7 +463,7 @@ bool SkeletonProxy::add_segment(quint64 source_id, quint64 target_id) {
 }
 
 bool SkeletonProxy::set_branch_node(quint64 node_id) {
-    nodeListElement *currentNode = Skeletonizer::singleton().findNodeByNodeID(node_id);
+    nodeListElement *currentNode = Skeletonizer::singleton().pageInNode(node_id);
     if(nullptr == currentNode) {
         emit echo(QString("no node with id %1 found").arg(node_id));
         return false;
@@ -407,6 +510,15 @@ QString SkeletonProxy::help() {
                    "\n move_to_next_tree() : moves the viewer to the next tree" \
                    "\n move_to_prev_tree() : moves the viewer to the previosu tree" \
                    "\n export_converter(path) : creates a python class in the path which can be used to convert between the NewSkeleton class and KNOSSOS." \
+                   "\n save_skeleton_columns(path) : saves all trees as binary skeleton columns (.kcs)" \
+                   "\n load_skeleton_columns(path, merge) : loads the trees of a binary skeleton columns file (.kcs)" \
+                   "\n set_tree_paging(enabled) : keeps only the nodes of selected trees and trees near the current position in memory" \
+                   "\n page_in_tree(tree_id) : loads the paged out nodes of a tree" \
+                   "\n page_out_tree(tree_id) : compresses the nodes of an unselected tree, returns False if it has to stay in memory" \
+                   "\n tree_node_count(tree_id) : returns the node count of a tree, including paged out nodes" \
+                   "\n tree_statistics() : returns a dict of per tree lists: tree_id, node_count, segment_count, component_count, cycle_count," \
+                   "\n\t branch_point_count, end_point_count, max_branch_order, strahler_order, cable_length, max_path_length (physical units)" \
+                   "\n node_statistics() : returns a dict of per node lists: node_id, tree_id, parent_id (own id for roots), branch_order, strahler_order, path_length" \
                    "\n set_branch_node(node_id) : sets the node with node_id to branch_node" \
                    "\n add_segment(source_id, target_id) : adds a segment for the nodes. Both nodes must be added before" \
                    "\n delete_active_node() : deletes the active node or informs about that no active node could be deleted" \
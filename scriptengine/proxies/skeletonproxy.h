@@ -42,6 +42,14 @@ public slots:
     void clear_skeleton();
     QString save_skeleton();
     void load_skeleton(QString & xml_string, const bool merge, const QString & treeCmtOnMultiLoad = "");
+    void save_skeleton_columns(const QString & path);
+    void load_skeleton_columns(const QString & path, const bool merge = false);
+    void set_tree_paging(const bool enabled);
+    void page_in_tree(quint64 tree_id);
+    bool page_out_tree(quint64 tree_id);
+    quint64 tree_node_count(quint64 tree_id);
+    QVariantHash tree_statistics();
+    QVariantHash node_statistics();
 
     void delete_skeleton();
     bool extract_connected_component(quint64 node_id);
@@ -70,6 +78,9 @@ public slots:
     QList<nodeListElement *> find_nodes_in_tree(treeListElement & tree, const QString & comment);
     void move_node_to_tree(quint64 node_id, quint64 tree_id);
     nodeListElement *find_nearby_node_from_tree(quint64 tree_id, int x, int y, int z);
+    QList<nodeListElement *> find_nearest_nodes(int x, int y, int z, int count = 1);
+    QList<nodeListElement *> find_nodes_in_radius(int x, int y, int z, float radius);
+    QList<nodeListElement *> find_nodes_in_box(const QVector3D & min, const QVector3D & max);
     nodeListElement *node_with_prev_id(quint64 node_id, bool same_tree);
     nodeListElement *node_with_next_id(quint64 node_id, bool same_tree);
     bool set_radius(const quint64 node_id, const float radius);
@@ -24,6 +24,7 @@
 
 #include "annotation/annotation.h"
 #include "loader.h"
+#include "palettecube.h"
 #include "segmentation.h"
 #include "segmentationsplit.h"
 #include "stateInfo.h"
@@ -33,13 +34,28 @@
 #include <boost/multi_array.hpp>
 
 #include <cstdint>
+#include <memory>
 
-std::pair<bool, void *> getRawCube(const Coordinate & pos, const std::size_t layerIdx = Segmentation::singleton().layerId) {
+// packed cubes are expanded for writing
+std::pair<bool, void *> getRawCube(const Coordinate & pos, const std::size_t layerIdx = Segmentation::singleton().layerId, const bool expand = true) {
+    const auto magIndex = Dataset::datasets[layerIdx].magIndex;
+    const auto cubeCoord = Dataset::datasets[layerIdx].global2cube(pos);
     QMutexLocker locker(&state->protectCube2Pointer);
-    auto * rawcube = cubeQuery(state->cube2Pointer, layerIdx, Dataset::datasets[layerIdx].magIndex, Dataset::datasets[layerIdx].global2cube(pos));
+    auto * rawcube = cubeQuery(state->cube2Pointer, layerIdx, magIndex, cubeCoord);
+    if (rawcube == nullptr && expand && paletteQuery(state->cube2Palette, layerIdx, magIndex, cubeCoord) != nullptr) {
+        locker.unlock();
+        Loader::Controller::singleton().expandCube(layerIdx, magIndex, cubeCoord);
+        locker.relock();
+        rawcube = cubeQuery(state->cube2Pointer, layerIdx, magIndex, cubeCoord);
+    }
     return std::make_pair(rawcube != nullptr, rawcube);
 }
 
+std::shared_ptr<const PaletteCube> getPaletteCube(const Coordinate & pos, const std::size_t layerIdx = Segmentation::singleton().layerId) {
+    QMutexLocker locker(&state->protectCube2Pointer);
+    return paletteQuery(state->cube2Palette, layerIdx, Dataset::datasets[layerIdx].magIndex, Dataset::datasets[layerIdx].global2cube(pos));
+}
+
 template<typename T = std::uint64_t>
 boost::multi_array_ref<T, 3> getCubeRef(void * const rawcube, const std::size_t layerIdx = Segmentation::singleton().layerId) {
     const auto cubeShape = Dataset::datasets[layerIdx].cubeShape;
@@ -49,11 +65,17 @@ boost::multi_array_ref<T, 3> getCubeRef(void * const rawcube, const std::size_t
 
 // can hold ids as well as raw data
 std::optional<std::uint64_t> readLayerVoxel(const Coordinate & pos, const std::size_t layerIdx) {
-    auto cubeIt = getRawCube(pos, layerIdx);
-    if (!cubeIt.first || (Dataset::datasets[layerIdx].isOverlay() && Annotation::singleton().outsideMovementArea(pos))) {
+    if (Dataset::datasets[layerIdx].isOverlay() && Annotation::singleton().outsideMovementArea(pos)) {
         return std::nullopt;
     }
+    auto cubeIt = getRawCube(pos, layerIdx, false);
     const auto inCube = pos.insideCube(Dataset::datasets[layerIdx].cubeShape, Dataset::datasets[layerIdx].scaleFactor);
+    if (!cubeIt.first) {
+        if (const auto packedCube = getPaletteCube(pos, layerIdx)) {
+            return packedCube->at(inCube.x, inCube.y, inCube.z);
+        }
+        return std::nullopt;
+    }
     const auto access = [&](auto arg){
         return getCubeRef<decltype(arg)>(cubeIt.second, layerIdx)[inCube.z][inCube.y][inCube.x];
     };
@@ -142,8 +164,9 @@ auto wholeCubes = [](const Coordinate & globalFirst, const Coordinate & globalLa
     };
 };
 
+// func gets copies of the voxels in packed cubes unless write expands them
 template<typename Func, typename Skip>
-CubeCoordSet processRegion(const Coordinate & globalFirst, const Coordinate &  globalLast, Func func, Skip skip) {
+CubeCoordSet processRegion(const Coordinate & globalFirst, const Coordinate &  globalLast, Func func, Skip skip, const bool write = true) {
     const auto & cubeShape = Dataset::current().cubeShape;
     const auto cubeBegin = Dataset::current().global2cube(globalFirst);
     const auto cubeEnd = Dataset::current().global2cube(globalLast) + 1;
@@ -156,19 +179,31 @@ CubeCoordSet processRegion(const Coordinate & globalFirst, const Coordinate &  g
         skip(x, y, z);//skip cubes which got processed before
         const auto cubeCoord = CoordOfCube(x, y, z);
         const auto globalCubeBegin = Dataset::current().cube2global(cubeCoord);
-        auto rawcube = getRawCube(globalCubeBegin);
-        if (rawcube.first) {
-            auto cubeRef = getCubeRef(rawcube.second);
+        auto rawcube = getRawCube(globalCubeBegin, Segmentation::singleton().layerId, write);
+        const auto packedCube = rawcube.first ? nullptr : getPaletteCube(globalCubeBegin);
+        if (rawcube.first || packedCube != nullptr) {
             const auto globalCubeEnd = globalCubeBegin + Dataset::current().scaleFactor.componentMul(cubeShape);
             const auto localStart = globalFirst.capped(globalCubeBegin, globalCubeEnd).insideCube(cubeShape, Dataset::current().scaleFactor);
             const auto localEnd = globalLast.capped(globalCubeBegin, globalCubeEnd).insideCube(cubeShape, Dataset::current().scaleFactor);
-
-            for (int z = localStart.z; z <= localEnd.z; ++z)
-            for (int y = localStart.y; y <= localEnd.y; ++y)
-            for (int x = localStart.x; x <= localEnd.x; ++x) {
-                const Coordinate globalFromVoxelCoord{globalCubeBegin + Dataset::current().scaleFactor.componentMul(Coordinate{x, y, z})};
-                const auto adjustedGlobalCoord = globalFromVoxelCoord.capped(globalFirst, globalLast + 1);// fit to region boundaries that don’t exactly match mag2+ voxel coords
-                func(cubeRef[z][y][x], adjustedGlobalCoord);
+            const auto traverse = [&](auto access){
+                for (int z = localStart.z; z <= localEnd.z; ++z)
+                for (int y = localStart.y; y <= localEnd.y; ++y)
+                for (int x = localStart.x; x <= localEnd.x; ++x) {
+                    const Coordinate globalFromVoxelCoord{globalCubeBegin + Dataset::current().scaleFactor.componentMul(Coordinate{x, y, z})};
+                    const auto adjustedGlobalCoord = globalFromVoxelCoord.capped(globalFirst, globalLast + 1);// fit to region boundaries that don’t exactly match mag2+ voxel coords
+                    access(x, y, z, adjustedGlobalCoord);
+                }
+            };
+            if (rawcube.first) {
+                auto cubeRef = getCubeRef(rawcube.second);
+                traverse([&func, &cubeRef](const int x, const int y, const int z, const Coordinate & pos){
+                    func(cubeRef[z][y][x], pos);
+                });
+            } else {
+                traverse([&func, &packedCube](const int x, const int y, const int z, const Coordinate & pos){
+                    auto voxel = packedCube->at(x, y, z);
+                    func(voxel, pos);
+                });
             }
             cubeCoords.emplace(cubeCoord);
         }
@@ -181,11 +216,16 @@ CubeCoordSet processRegion(const Coordinate & globalFirst, const Coordinate &  g
     return processRegion(globalFirst, globalLast, func, [](int &, int, int){});
 }
 
+template<typename Func>//wrapper that doesn’t expand packed cubes
+CubeCoordSet readRegion(const Coordinate & globalFirst, const Coordinate &  globalLast, Func func) {
+    return processRegion(globalFirst, globalLast, func, [](int &, int, int){}, false);
+}
+
 void collectFromMovementArea() {
     QElapsedTimer t;
     t.start();
     std::unordered_map<std::uint64_t, Coordinate> ids;
-    const auto cubeChangeSet = processRegion(Annotation::singleton().movementAreaMin, Annotation::singleton().movementAreaMax, [&ids](uint64_t & voxel, const Coordinate & pos){
+    const auto cubeChangeSet = readRegion(Annotation::singleton().movementAreaMin, Annotation::singleton().movementAreaMax, [&ids](uint64_t & voxel, const Coordinate & pos){
         ids.try_emplace(voxel, pos);
     });
     ids.erase(Segmentation::singleton().getBackgroundId());
@@ -210,7 +250,7 @@ void assignNewIdInMovementArea(const std::uint64_t newId) {
 subobjectRetrievalMap readVoxels(const Coordinate & centerPos, const brush_t &brush) {
     subobjectRetrievalMap subobjects;
     const auto region = getRegion(centerPos, brush);
-    processRegion(region.first, region.second, [&subobjects](uint64_t & voxel, Coordinate position){
+    readRegion(region.first, region.second, [&subobjects](uint64_t & voxel, Coordinate position){
         if (voxel != 0) {//don’t select the unsegmented area as object
             subobjects.emplace(std::piecewise_construct, std::make_tuple(voxel), std::make_tuple(position));
         }
@@ -292,7 +332,7 @@ CubeCoordSet processRegionByStridedBuf(const Coordinate & globalFirst, const Coo
         }
     }
     else {
-        cubeChangeSet = processRegion(globalFirst, globalLast,
+        cubeChangeSet = readRegion(globalFirst, globalLast,
                 [globalFirst,data,strides](uint64_t & voxel, Coordinate globalPos){
                 reinterpret_cast<uint64_t &>(data[(globalPos - globalFirst).componentMul(strides).sum()]) = voxel;
             });
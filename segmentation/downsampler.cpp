@@ -0,0 +1,285 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#include "downsampler.h"
+
+#include "dataset.h"
+#include "loader.h"
+#include "palettecube.h"
+#include "segmentation.h"
+#include "stateInfo.h"
+#include "viewer.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+
+#include <snappy.h>
+
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace {
+struct Pyramid {// captured in the gui thread for the workers
+    std::size_t layerId;
+    std::array<int, 3> shape;
+    std::vector<std::array<int, 3>> ratios;// voxels per parent voxel along each axis, from the previous mag to this one
+    bool loadingEnabled;// otherwise cubes that are neither loaded nor modified are empty
+};
+
+using Cubes = std::unordered_map<CoordOfCube, std::string>;
+
+// the snappy compressed cubes of the finer mag computed in this run precede the loaded and cached ones
+std::vector<std::uint64_t> fetch(const Pyramid & pyramid, const std::size_t magIndex, const CoordOfCube & cubeCoord, const Cubes & computed) {
+    const auto voxelCount = static_cast<std::size_t>(pyramid.shape[0]) * pyramid.shape[1] * pyramid.shape[2];
+    std::string compressed;
+    if (const auto it = computed.find(cubeCoord); it != std::end(computed)) {
+        compressed = it->second;
+    } else {
+        std::shared_ptr<const PaletteCube> packedCube;
+        {
+            QMutexLocker locker(&state->protectCube2Pointer);
+            if (const auto * cube = static_cast<const std::uint64_t *>(cubeQuery(state->cube2Pointer, pyramid.layerId, magIndex, cubeCoord))) {
+                return {cube, cube + voxelCount};
+            }
+            packedCube = paletteQuery(state->cube2Palette, pyramid.layerId, magIndex, cubeCoord);
+        }
+        if (packedCube != nullptr) {
+            std::vector<std::uint64_t> cube(voxelCount);
+            packedCube->decode(cube.data());
+            return cube;
+        }
+        auto & worker = *Loader::Controller::singleton().worker;
+        QMutexLocker locker(&worker.snappyCacheMutex);
+        if (pyramid.layerId >= worker.snappyCache.size() || magIndex >= worker.snappyCache[pyramid.layerId].size()) {
+            return {};
+        }
+        const auto & cubes = worker.snappyCache[pyramid.layerId][magIndex];
+        const auto it = cubes.find(cubeCoord);
+        if (it == std::end(cubes)) {
+            return {};
+        }
+        compressed = it->second;
+    }
+    std::vector<std::uint64_t> cube(voxelCount);
+    if (!snappy::RawUncompress(compressed.data(), compressed.size(), reinterpret_cast<char *>(cube.data()))) {
+        qWarning() << QObject::tr("downsampling skipped broken snappy cube (%1, %2, %3)").arg(cubeCoord.x).arg(cubeCoord.y).arg(cubeCoord.z);
+        return {};
+    }
+    return cube;
+}
+
+std::uint64_t majority(const std::array<std::uint64_t, 8> & values, const std::size_t count) {
+    auto best = values[0];
+    std::size_t bestCount{0};
+    for (std::size_t i = 0; i < count && 2 * bestCount <= count; ++i) {// earlier occurrences win ties
+        std::size_t n{0};
+        for (std::size_t j = i; j < count; ++j) {
+            n += values[j] == values[i];
+        }
+        if (n > bestCount) {
+            best = values[i];
+            bestCount = n;
+        }
+    }
+    return best;
+}
+
+// empty if a child cube is unknown and there is no previous parent to keep its part from
+std::string downsample(const Pyramid & pyramid, const std::size_t magIndex, const CoordOfCube & cubeCoord, const Cubes & computed) {
+    const auto & shape = pyramid.shape;
+    const auto & ratio = pyramid.ratios[magIndex];
+    const auto voxelCount = static_cast<std::size_t>(shape[0]) * shape[1] * shape[2];
+    auto parent = fetch(pyramid, magIndex, cubeCoord, {});
+    if (parent.empty() && !pyramid.loadingEnabled) {
+        parent.resize(voxelCount);
+    }
+    const std::array<int, 3> span{shape[0] / ratio[0], shape[1] / ratio[1], shape[2] / ratio[2]};// parent voxels per child cube
+    std::array<std::uint64_t, 8> values;
+    const auto count = static_cast<std::size_t>(ratio[0] * ratio[1] * ratio[2]);
+    for (int cz = 0; cz < ratio[2]; ++cz)
+    for (int cy = 0; cy < ratio[1]; ++cy)
+    for (int cx = 0; cx < ratio[0]; ++cx) {
+        const CoordOfCube childCoord(cubeCoord.x * ratio[0] + cx, cubeCoord.y * ratio[1] + cy, cubeCoord.z * ratio[2] + cz);
+        const auto child = fetch(pyramid, magIndex - 1, childCoord, computed);
+        if (child.empty()) {
+            if (parent.empty()) {
+                return {};
+            }
+            continue;
+        }
+        if (parent.empty()) {// filled by the remaining children or abandoned
+            parent.resize(voxelCount);
+        }
+        for (int z = 0; z < span[2]; ++z)
+        for (int y = 0; y < span[1]; ++y)
+        for (int x = 0; x < span[0]; ++x) {
+            std::size_t i{0};
+            for (int dz = 0; dz < ratio[2]; ++dz)
+            for (int dy = 0; dy < ratio[1]; ++dy)
+            for (int dx = 0; dx < ratio[0]; ++dx) {
+                values[i++] = child[(static_cast<std::size_t>(z * ratio[2] + dz) * shape[1] + y * ratio[1] + dy) * shape[0] + x * ratio[0] + dx];
+            }
+            const auto px = cx * span[0] + x, py = cy * span[1] + y, pz = cz * span[2] + z;
+            parent[(static_cast<std::size_t>(pz) * shape[1] + py) * shape[0] + px] = majority(values, count);
+        }
+    }
+    std::string compressed;
+    snappy::Compress(reinterpret_cast<const char *>(parent.data()), parent.size() * sizeof(parent[0]), &compressed);
+    return compressed;
+}
+
+std::vector<Downsampler::Cube> downsamplePyramid(const Pyramid & pyramid, std::vector<std::unordered_set<CoordOfCube>> dirtyCubes) {
+    std::vector<Downsampler::Cube> results;
+    Cubes computed;// of the previous mag
+    auto modified = std::move(dirtyCubes[0]);
+    for (std::size_t magIndex = 1; magIndex < dirtyCubes.size(); ++magIndex) {
+        const auto & ratio = pyramid.ratios[magIndex];
+        std::unordered_set<CoordOfCube> parentCoords;
+        for (const auto & cubeCoord : modified) {
+            parentCoords.emplace(cubeCoord.x / ratio[0], cubeCoord.y / ratio[1], cubeCoord.z / ratio[2]);
+        }
+        std::vector<Downsampler::Cube> parents;
+        parents.reserve(parentCoords.size());
+        for (const auto & cubeCoord : parentCoords) {
+            parents.push_back({magIndex, cubeCoord, {}});
+        }
+        QtConcurrent::blockingMap(parents, [&pyramid, &computed](Downsampler::Cube & parent){
+            parent.snappy = downsample(pyramid, parent.magIndex, parent.cubeCoord, computed);
+        });
+        computed.clear();
+        modified = std::move(dirtyCubes[magIndex]);// edits at this mag propagate as well
+        for (auto & parent : parents) {
+            if (!parent.snappy.empty()) {
+                modified.emplace(parent.cubeCoord);
+                computed.emplace(parent.cubeCoord, parent.snappy);
+                results.emplace_back(std::move(parent));
+            }
+        }
+    }
+    return results;
+}
+}
+
+Downsampler::Downsampler() {
+    strokeTimer.setSingleShot(true);
+    strokeTimer.setInterval(250);
+    QObject::connect(&strokeTimer, &QTimer::timeout, this, &Downsampler::downsampleDirtyCubes);
+    QObject::connect(&watcher, &QFutureWatcher<std::vector<Cube>>::finished, this, &Downsampler::applyResults);
+    QObject::connect(&Loader::Controller::singleton(), &Loader::Controller::markCubeAsModifiedSignal, this, &Downsampler::markCubeAsModified);
+}
+
+void Downsampler::clear() {
+    strokeTimer.stop();
+    if (pending) {// discard
+        watcher.waitForFinished();
+        pending = false;
+    }
+    dirtyCubes.clear();
+}
+
+void Downsampler::waitForFinished() {
+    strokeTimer.stop();
+    downsampleDirtyCubes();
+    while (pending) {
+        watcher.waitForFinished();
+        applyResults();
+    }
+}
+
+void Downsampler::markCubeAsModified(const std::size_t layerId, const CoordOfCube & cubeCoord, const int magnification) {
+    if (!enabled || layerId != Segmentation::singleton().layerId) {
+        return;
+    }
+    if (!dirtyCubes.empty() && layerId != this->layerId) {// layer changed, start over
+        dirtyCubes.clear();
+    }
+    this->layerId = layerId;
+    dirtyCubes[static_cast<std::size_t>(std::log2(magnification))].emplace(cubeCoord);
+    strokeTimer.start();// restarted by every brush step, so a stroke is downsampled once
+}
+
+bool Downsampler::busy() const {
+    return pending || !dirtyCubes.empty();
+}
+
+void Downsampler::downsampleDirtyCubes() {
+    if (pending || dirtyCubes.empty()) {
+        return;
+    }
+    const auto & dataset = Dataset::datasets[layerId];
+    const auto magCount = static_cast<std::size_t>(std::log2(dataset.highestAvailableMag) + 1);
+    Pyramid pyramid{layerId, {dataset.cubeShape.x, dataset.cubeShape.y, dataset.cubeShape.z}, {{1, 1, 1}}, dataset.loadingEnabled};
+    for (std::size_t magIndex = 1; magIndex < magCount; ++magIndex) {
+        const auto scale = dataset.atMagIndex(magIndex).scaleFactor / dataset.atMagIndex(magIndex - 1).scaleFactor;
+        const std::array<int, 3> ratio{static_cast<int>(std::round(scale.x)), static_cast<int>(std::round(scale.y)), static_cast<int>(std::round(scale.z))};
+        bool pooling{true};
+        for (std::size_t axis = 0; axis < ratio.size(); ++axis) {
+            pooling &= (ratio[axis] == 1 || ratio[axis] == 2) && pyramid.shape[axis] % ratio[axis] == 0;
+        }
+        if (!pooling) {
+            qWarning() << tr("downsampling stops at mag index %1, only halving along each axis is supported").arg(magIndex);
+            break;
+        }
+        pyramid.ratios.emplace_back(ratio);
+    }
+    std::vector<std::unordered_set<CoordOfCube>> levels(pyramid.ratios.size());
+    for (auto & [magIndex, cubes] : dirtyCubes) {
+        if (magIndex < levels.size()) {
+            levels[magIndex] = std::move(cubes);
+        }
+    }
+    dirtyCubes.clear();
+    if (levels.size() < 2) {
+        return;
+    }
+    pending = true;
+    watcher.setFuture(QtConcurrent::run([pyramid, levels = std::move(levels)]() mutable {
+        return downsamplePyramid(pyramid, std::move(levels));
+    }));
+}
+
+void Downsampler::applyResults() {
+    if (!pending || !watcher.isFinished()) {
+        return;
+    }
+    pending = false;
+    const auto results = watcher.result();
+    bool loaded{false};
+    for (const auto & cube : results) {
+        {
+            QMutexLocker locker(&state->protectCube2Pointer);
+            loaded |= cubeQuery(state->cube2Pointer, layerId, cube.magIndex, cube.cubeCoord) != nullptr
+                    || paletteQuery(state->cube2Palette, layerId, cube.magIndex, cube.cubeCoord) != nullptr;
+        }
+        Loader::Controller::singleton().snappyCacheSupplySnappy(layerId, cube.cubeCoord, static_cast<quint64>(cube.magIndex), cube.snappy);
+    }
+    if (loaded) {// the loader evicted stale cubes, replace them from the snappy cache
+        state->viewer->loader_notify();
+    }
+    emit finished();
+    downsampleDirtyCubes();
+}
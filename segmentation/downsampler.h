@@ -0,0 +1,71 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QTimer>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Keeps the coarser magnifications of the segmentation layer in sync with edits.
+ *
+ * Once a stroke settles, the parents of the modified cubes are recomputed mag by mag with majority pooling
+ * in the background and handed to the snappy cache, which is what gets saved to the .k.zip.
+ */
+class Downsampler : public QObject {
+    Q_OBJECT
+public:
+    struct Cube {
+        std::size_t magIndex;
+        CoordOfCube cubeCoord;
+        std::string snappy;
+    };
+private:
+    std::size_t layerId{0};
+    std::unordered_map<std::size_t, std::unordered_set<CoordOfCube>> dirtyCubes;// per mag index
+    bool pending{false};
+    QTimer strokeTimer;
+    QFutureWatcher<std::vector<Cube>> watcher;
+
+    void applyResults();
+    void downsampleDirtyCubes();
+public:
+    bool enabled{true};
+
+    Downsampler();
+    void clear();
+    void waitForFinished();
+    void markCubeAsModified(const std::size_t layerId, const CoordOfCube & cubeCoord, const int magnification);
+    bool busy() const;
+signals:
+    void finished();
+};
@@ -0,0 +1,263 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#include "segmentation/mergelist.h"
+
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr std::size_t parseBlockSize{4 << 20};
+constexpr std::size_t formatBlockObjects{1 << 14};
+
+const char * lineEnd(const char * it, const char * end) {
+    const auto * newline = static_cast<const char *>(std::memchr(it, '\n', end - it));
+    return newline != nullptr ? newline : end;
+}
+
+const char * nextLine(const char * it, const char * end) {
+    const auto * eol = lineEnd(it, end);
+    return eol != end ? eol + 1 : end;
+}
+
+QString lineText(const char * it, const char * eol) {
+    if (eol != it && *(eol - 1) == '\r') {
+        --eol;
+    }
+    return QString::fromUtf8(it, static_cast<int>(eol - it));
+}
+
+template<typename T>
+bool number(const char *& it, const char * end, T & value) {// whitespace separated, like istream >>
+    while (it != end && (*it == ' ' || *it == '\t' || *it == '\r')) {
+        ++it;
+    }
+    if (it != end && *it == '+') {
+        ++it;
+    }
+    const auto result = std::from_chars(it, end, value);
+    if (result.ec != std::errc{}) {
+        return false;
+    }
+    it = result.ptr;
+    return true;
+}
+
+bool flag(const char *& it, const char * end, bool & value) {
+    int integer;
+    if (!number(it, end, integer) || (integer != 0 && integer != 1)) {
+        return false;
+    }
+    value = integer;
+    return true;
+}
+
+struct Block {
+    Mergelist mergelist;
+    boost::optional<std::size_t> errorLine;
+};
+
+/** parses the objects that start in [it, blockEnd), the last one may reach until end */
+void parseBlock(Block & block, const char * it, const char * blockEnd, const char * end, std::size_t line) {
+    auto & mergelist = block.mergelist;
+    while (it < blockEnd) {
+        if (std::all_of(it, end, [](const char c){ return c == ' ' || c == '\t' || c == '\r' || c == '\n'; })) {
+            return;// trailing blank lines
+        }
+        Mergelist::Object object;
+        object.firstSubobject = mergelist.subobjectIds.size();
+        const auto * eol = lineEnd(it, end);
+        std::uint64_t subobjectId;
+        auto valid = number(it, eol, object.id) && flag(it, eol, object.todo) && flag(it, eol, object.immutable) && number(it, eol, subobjectId);
+        if (valid) {
+            do {
+                mergelist.subobjectIds.emplace_back(subobjectId);
+            } while (number(it, eol, subobjectId));
+            object.subobjectCount = mergelist.subobjectIds.size() - object.firstSubobject;
+        }
+        it = nextLine(eol, end);
+        valid = valid && it < end;
+        if (valid) {
+            eol = lineEnd(it, end);
+            valid = number(it, eol, object.location.x) && number(it, eol, object.location.y) && number(it, eol, object.location.z);
+            std::array<std::uint32_t, 3> color;
+            if (number(it, eol, color[0]) && number(it, eol, color[1]) && number(it, eol, color[2])) {
+                object.color = std::make_tuple(static_cast<std::uint8_t>(color[0]), static_cast<std::uint8_t>(color[1]), static_cast<std::uint8_t>(color[2]));
+            }
+            it = nextLine(eol, end);
+        }
+        for (auto * text : {&object.category, &object.comment}) {
+            valid = valid && it < end;
+            if (valid) {
+                eol = lineEnd(it, end);
+                *text = lineText(it, eol);
+                it = nextLine(eol, end);
+            }
+        }
+        if (!valid) {
+            block.errorLine = line;
+            return;
+        }
+        mergelist.objects.emplace_back(std::move(object));
+        line += 4;
+    }
+}
+
+template<typename T>
+void append(QByteArray & out, const T value) {
+    std::array<char, 24> buffer;
+    const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    out.append(buffer.data(), static_cast<int>(result.ptr - buffer.data()));
+}
+}
+
+Mergelist Mergelist::parse(const char * begin, const char * end) {
+    const auto size = static_cast<std::size_t>(end - begin);
+    const auto blockCount = std::max<std::size_t>(1, (size + parseBlockSize - 1) / parseBlockSize);
+    std::vector<std::size_t> blockIndices(blockCount);
+    std::iota(std::begin(blockIndices), std::end(blockIndices), 0);
+    const auto blockBegin = [begin, end](const std::size_t i){ return std::min(begin + i * parseBlockSize, end); };
+    std::vector<std::size_t> newlines(blockCount);
+    QtConcurrent::blockingMap(blockIndices, [&](const std::size_t i){
+        newlines[i] = std::count(blockBegin(i), blockBegin(i + 1), '\n');
+    });
+    std::exclusive_scan(std::begin(newlines), std::end(newlines), std::begin(newlines), std::size_t{0});// lines before each block
+    std::vector<Block> blocks(blockCount);
+    QtConcurrent::blockingMap(blockIndices, [&](const std::size_t i){
+        // objects start at every 4th line, find the first one in this block
+        auto * it = blockBegin(i);
+        auto line = newlines[i];
+        if (it != begin && *(it - 1) != '\n') {
+            it = nextLine(it, end);
+            ++line;
+        }
+        for (; line % 4 != 0 && it < end; ++line) {
+            it = nextLine(it, end);
+        }
+        parseBlock(blocks[i], it, blockBegin(i + 1), end, line);
+    });
+    Mergelist mergelist;
+    std::size_t objectCount{0}, subobjectCount{0};
+    for (const auto & block : blocks) {
+        if (block.errorLine) {
+            throw std::runtime_error("mergelistLoad parsing failed @" + std::to_string(block.errorLine.get() + 1));
+        }
+        objectCount += block.mergelist.objects.size();
+        subobjectCount += block.mergelist.subobjectIds.size();
+    }
+    mergelist.objects.reserve(objectCount);
+    mergelist.subobjectIds.reserve(subobjectCount);
+    for (auto & block : blocks) {
+        const auto offset = mergelist.subobjectIds.size();
+        for (auto & object : block.mergelist.objects) {
+            object.firstSubobject += offset;
+            mergelist.objects.emplace_back(std::move(object));
+        }
+        mergelist.subobjectIds.insert(std::end(mergelist.subobjectIds), std::begin(block.mergelist.subobjectIds), std::end(block.mergelist.subobjectIds));
+    }
+    return mergelist;
+}
+
+Mergelist Mergelist::parseLineByLine(QTextStream & stream) {
+    Mergelist mergelist;
+    QString line;
+    std::size_t line_i{0};
+    while (!(line = stream.readLine()).isNull()) {
+        std::istringstream lineStream(line.toStdString());
+        std::istringstream coordColorLineStream(stream.readLine().toStdString());
+        Object object;
+        object.firstSubobject = mergelist.subobjectIds.size();
+        std::uint64_t subobjectId;
+        uint r, g, b;
+        const bool valid0 = (lineStream >> object.id) && (lineStream >> object.todo) && (lineStream >> object.immutable) && (lineStream >> subobjectId);
+        const bool valid1 = (coordColorLineStream >> object.location.x) && (coordColorLineStream >> object.location.y) && (coordColorLineStream >> object.location.z);
+        if ((coordColorLineStream >> r) && (coordColorLineStream >> g) && (coordColorLineStream >> b)) {
+            object.color = std::make_tuple(static_cast<std::uint8_t>(r), static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(b));
+        }
+        const bool valid2 = !(object.category = stream.readLine()).isNull();
+        const bool valid3 = !(object.comment = stream.readLine()).isNull();
+        if (!(valid0 && valid1 && valid2 && valid3)) {
+            throw std::runtime_error("mergelistLoad parsing failed @" + std::to_string(line_i + 1));
+        }
+        do {
+            mergelist.subobjectIds.emplace_back(subobjectId);
+        } while (lineStream >> subobjectId);
+        object.subobjectCount = mergelist.subobjectIds.size() - object.firstSubobject;
+        mergelist.objects.emplace_back(std::move(object));
+        line_i += 4;
+    }
+    return mergelist;
+}
+
+QByteArray Mergelist::format() const {
+    const auto blockCount = (objects.size() + formatBlockObjects - 1) / formatBlockObjects;
+    std::vector<std::size_t> blockIndices(blockCount);
+    std::iota(std::begin(blockIndices), std::end(blockIndices), 0);
+    std::vector<QByteArray> blocks(blockCount);
+    QtConcurrent::blockingMap(blockIndices, [this, &blocks](const std::size_t i){
+        auto & out = blocks[i];
+        for (auto objectIndex = i * formatBlockObjects; objectIndex < std::min(objects.size(), (i + 1) * formatBlockObjects); ++objectIndex) {
+            const auto & object = objects[objectIndex];
+            append(out, object.id);
+            out.append(object.todo ? " 1" : " 0");
+            out.append(object.immutable ? " 1" : " 0");
+            for (auto s = object.firstSubobject; s < object.firstSubobject + object.subobjectCount; ++s) {
+                out.append(' ');
+                append(out, subobjectIds[s]);
+            }
+            out.append('\n');
+            append(out, object.location.x);
+            out.append(' ');
+            append(out, object.location.y);
+            out.append(' ');
+            append(out, object.location.z);
+            out.append(' ');
+            if (object.color) {
+                append(out, std::get<0>(object.color.get()));
+                out.append(' ');
+                append(out, std::get<1>(object.color.get()));
+                out.append(' ');
+                append(out, std::get<2>(object.color.get()));
+            }
+            out.append('\n');
+            out.append(object.category.toUtf8());
+            out.append('\n');
+            out.append(object.comment.toUtf8());
+            out.append('\n');
+        }
+    });
+    QByteArray out;
+    out.reserve(std::accumulate(std::begin(blocks), std::end(blocks), 0, [](const int sum, const QByteArray & block){ return sum + block.size(); }));
+    for (const auto & block : blocks) {
+        out.append(block);
+    }
+    return out;
+}
@@ -0,0 +1,62 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QTextStream>
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+/** @brief Plain representation of the mergelist text format, 4 lines per object:
+ *  "id todo immutable subobject…", "x y z [r g b]", category and comment.
+ *  Parsing and formatting run in parallel over blocks and keep the object order. */
+class Mergelist {
+public:
+    struct Object {
+        std::uint64_t id;
+        bool todo;
+        bool immutable;
+        std::size_t firstSubobject;// into subobjectIds
+        std::size_t subobjectCount;
+        Coordinate location;
+        boost::optional<std::tuple<std::uint8_t, std::uint8_t, std::uint8_t>> color;
+        QString category;
+        QString comment;
+    };
+    std::vector<Object> objects;
+    std::vector<std::uint64_t> subobjectIds;// of all objects, consecutively
+
+    /** throws std::runtime_error with the line of the first malformed object */
+    static Mergelist parse(const char * begin, const char * end);
+    /** the former sequential QTextStream parser, kept as reference for benchmarks */
+    static Mergelist parseLineByLine(QTextStream & stream);
+    QByteArray format() const;
+};
@@ -0,0 +1,87 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Disjoint set forest over object slots.
+ *
+ * Subobjects reference the slot of their objects instead of the object index.
+ * Absorbing a mutable object links its slot to the survivor, so its subobjects need no rewrite,
+ * and moving an object to another index only updates the index of its root slot.
+ * Lookups don’t compress paths so they stay safe for concurrent readers, union by size keeps the trees shallow.
+ */
+class ObjectSlots {
+    std::vector<std::uint64_t> parents;
+    std::vector<std::uint64_t> sizes;
+    std::vector<std::uint64_t> indices;// object index of each root
+public:
+    std::uint64_t add(const std::uint64_t index) {
+        parents.emplace_back(parents.size());
+        sizes.emplace_back(1);
+        indices.emplace_back(index);
+        return parents.back();
+    }
+    std::uint64_t find(std::uint64_t slot) const {
+        while (parents[slot] != slot) {
+            slot = parents[slot];
+        }
+        return slot;
+    }
+    std::uint64_t index(const std::uint64_t slot) const {
+        return indices[find(slot)];
+    }
+    void setIndex(const std::uint64_t slot, const std::uint64_t index) {
+        indices[find(slot)] = index;
+    }
+    /// links both sets, the result keeps the object index of survivor and its root is returned
+    std::uint64_t unite(const std::uint64_t survivor, const std::uint64_t other) {
+        auto root = find(survivor);
+        auto otherRoot = find(other);
+        if (root == otherRoot) {
+            return root;
+        }
+        const auto index = indices[root];
+        if (sizes[root] < sizes[otherRoot]) {
+            std::swap(root, otherRoot);
+        }
+        parents[otherRoot] = root;
+        sizes[root] += sizes[otherRoot];
+        indices[root] = index;
+        return root;
+    }
+    void reserveAdditional(const std::size_t count) {
+        parents.reserve(parents.size() + count);
+        sizes.reserve(sizes.size() + count);
+        indices.reserve(indices.size() + count);
+    }
+    void clear() {
+        parents.clear();
+        sizes.clear();
+        indices.clear();
+    }
+};
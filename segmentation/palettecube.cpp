@@ -0,0 +1,147 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#include "palettecube.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+PaletteCube::PaletteCube(const std::uint64_t * cube, const Coordinate & shape)
+        : shape{shape}, blockShape{(shape.x + blockEdge - 1) / blockEdge, (shape.y + blockEdge - 1) / blockEdge, (shape.z + blockEdge - 1) / blockEdge} {
+    std::unordered_map<std::uint64_t, std::uint32_t> paletteIndices;
+    std::unordered_multimap<std::size_t, std::uint32_t> tableOffsets;// table hash → offset into tables
+    std::vector<std::uint32_t> table;
+    std::array<std::uint64_t, blockVoxels> values;
+    std::vector<std::uint64_t> ids;
+    blocks.reserve(static_cast<std::size_t>(blockShape.x) * blockShape.y * blockShape.z);
+    for (int bz = 0; bz < blockShape.z; ++bz)
+    for (int by = 0; by < blockShape.y; ++by)
+    for (int bx = 0; bx < blockShape.x; ++bx) {
+        const Coordinate first{bx * blockEdge, by * blockEdge, bz * blockEdge};
+        values.fill(cube[(static_cast<std::size_t>(first.z) * shape.y + first.y) * shape.x + first.x]);// voxels beyond partial blocks add no id
+        bool uniform{true};
+        for (int z = 0; z < std::min(blockEdge, shape.z - first.z); ++z)
+        for (int y = 0; y < std::min(blockEdge, shape.y - first.y); ++y)
+        for (int x = 0; x < std::min(blockEdge, shape.x - first.x); ++x) {
+            auto & value = values[(z * blockEdge + y) * blockEdge + x];
+            value = cube[(static_cast<std::size_t>(first.z + z) * shape.y + first.y + y) * shape.x + first.x + x];
+            uniform &= value == values[0];
+        }
+        if (uniform) {
+            ids.assign(1, values[0]);
+        } else {
+            ids.assign(std::begin(values), std::end(values));
+            std::sort(std::begin(ids), std::end(ids));
+            ids.erase(std::unique(std::begin(ids), std::end(ids)), std::end(ids));
+        }
+        std::uint8_t bits{0};
+        while ((std::size_t{1} << bits) < ids.size()) {
+            bits = bits == 0 ? 1 : 2 * bits;
+        }
+        table.clear();
+        for (const auto id : ids) {
+            const auto [it, inserted] = paletteIndices.try_emplace(id, static_cast<std::uint32_t>(palette.size()));
+            if (inserted) {
+                palette.emplace_back(id);
+            }
+            table.emplace_back(it->second);
+        }
+        const auto hash = boost::hash_range(std::begin(table), std::end(table));
+        const auto [candidate, candidatesEnd] = tableOffsets.equal_range(hash);
+        const auto same = std::find_if(candidate, candidatesEnd, [this, &table](const auto & offset){
+            return offset.second + table.size() <= tables.size() && std::equal(std::begin(table), std::end(table), std::begin(tables) + offset.second);
+        });
+        Block block{0, static_cast<std::uint32_t>(words.size()), bits};
+        if (same != candidatesEnd) {// blocks with the same ids share their table
+            block.table = same->second;
+        } else {
+            block.table = static_cast<std::uint32_t>(tables.size());
+            tableOffsets.emplace(hash, block.table);
+            tables.insert(std::end(tables), std::begin(table), std::end(table));
+        }
+        if (bits != 0) {
+            words.resize(words.size() + blockVoxels * bits / 64);
+            for (std::size_t i = 0; i < blockVoxels; ++i) {
+                const std::uint64_t local = std::lower_bound(std::begin(ids), std::end(ids), values[i]) - std::begin(ids);
+                const auto bit = i * bits;
+                words[block.word + bit / 64] |= local << (bit % 64);
+            }
+        }
+        blocks.emplace_back(block);
+    }
+    palette.shrink_to_fit();
+    tables.shrink_to_fit();
+    words.shrink_to_fit();
+}
+
+PaletteCube::PaletteCube(const std::uint64_t value, const Coordinate & shape)
+        : shape{shape}, blockShape{(shape.x + blockEdge - 1) / blockEdge, (shape.y + blockEdge - 1) / blockEdge, (shape.z + blockEdge - 1) / blockEdge}
+        , palette{value}, tables{0}, blocks(static_cast<std::size_t>(blockShape.x) * blockShape.y * blockShape.z, Block{0, 0, 0}) {}
+
+void PaletteCube::decode(std::uint64_t * cube) const {
+    for (int bz = 0; bz < blockShape.z; ++bz)
+    for (int by = 0; by < blockShape.y; ++by)
+    for (int bx = 0; bx < blockShape.x; ++bx) {
+        const auto & block = blocks[(static_cast<std::size_t>(bz) * blockShape.y + by) * blockShape.x + bx];
+        const auto * table = tables.data() + block.table;
+        const auto * blockWords = words.data() + block.word;
+        const std::uint64_t mask = (std::uint64_t{1} << block.bits) - 1;
+        const Coordinate first{bx * blockEdge, by * blockEdge, bz * blockEdge};
+        for (int z = 0; z < std::min(blockEdge, shape.z - first.z); ++z)
+        for (int y = 0; y < std::min(blockEdge, shape.y - first.y); ++y) {
+            auto * row = cube + (static_cast<std::size_t>(first.z + z) * shape.y + first.y + y) * shape.x + first.x;
+            for (int x = 0; x < std::min(blockEdge, shape.x - first.x); ++x) {
+                std::uint64_t local{0};
+                if (block.bits != 0) {
+                    const std::size_t bit = static_cast<std::size_t>((z * blockEdge + y) * blockEdge + x) * block.bits;
+                    local = (blockWords[bit / 64] >> (bit % 64)) & mask;
+                }
+                row[x] = palette[table[local]];
+            }
+        }
+    }
+}
+
+std::vector<std::uint64_t> PaletteCube::plane(const std::size_t axis, const int depth) const {
+    const std::array<int, 3> extent{shape.x, shape.y, shape.z};
+    const auto first = axis == 0 ? 1 : 0;
+    const auto second = axis == 2 ? 1 : 2;
+    std::vector<std::uint64_t> slice;
+    slice.reserve(static_cast<std::size_t>(extent[first]) * extent[second]);
+    std::array<int, 3> voxel;
+    voxel[axis] = depth;
+    for (voxel[second] = 0; voxel[second] < extent[second]; ++voxel[second])
+    for (voxel[first] = 0; voxel[first] < extent[first]; ++voxel[first]) {
+        slice.emplace_back(at(voxel[0], voxel[1], voxel[2]));
+    }
+    return slice;
+}
+
+std::size_t PaletteCube::bytes() const {
+    return sizeof(*this) + palette.capacity() * sizeof(palette[0]) + tables.capacity() * sizeof(tables[0])
+            + words.capacity() * sizeof(words[0]) + blocks.capacity() * sizeof(blocks[0]);
+}
@@ -0,0 +1,70 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Resident form of an unedited segmentation cube.
+ *
+ * Like compressed segmentation, the cube is split into blocks of 8³ voxels that index a small table of their ids
+ * with 0, 1, 2, 4, 8, 16 or 32 bit, so an index never straddles two words.
+ * The tables refer to the palette of distinct ids in the cube. Cubes are immutable, edits expand them into a loader slot.
+ */
+class PaletteCube {
+    static constexpr int blockEdge{8};
+    static constexpr std::size_t blockVoxels{blockEdge * blockEdge * blockEdge};
+    struct Block {
+        std::uint32_t table;// offset into tables
+        std::uint32_t word;// offset into words
+        std::uint8_t bits;
+    };
+    Coordinate shape;
+    Coordinate blockShape;// blocks per axis
+    std::vector<std::uint64_t> palette;
+    std::vector<std::uint32_t> tables;// palette indices of the ids in each block, shared by blocks with the same ids
+    std::vector<std::uint64_t> words;
+    std::vector<Block> blocks;
+public:
+    PaletteCube(const std::uint64_t * cube, const Coordinate & shape);
+    PaletteCube(const std::uint64_t value, const Coordinate & shape);
+
+    std::uint64_t at(const int x, const int y, const int z) const {
+        const auto & block = blocks[(static_cast<std::size_t>(z / blockEdge) * blockShape.y + y / blockEdge) * blockShape.x + x / blockEdge];
+        std::uint64_t local{0};
+        if (block.bits != 0) {
+            const std::size_t bit = (static_cast<std::size_t>(z % blockEdge * blockEdge + y % blockEdge) * blockEdge + x % blockEdge) * block.bits;
+            local = (words[block.word + bit / 64] >> (bit % 64)) & ((std::uint64_t{1} << block.bits) - 1);
+        }
+        return palette[tables[block.table + local]];
+    }
+    void decode(std::uint64_t * cube) const;
+    /// the plane perpendicular to axis at depth, the remaining axes in xyz order with the first one running fastest
+    std::vector<std::uint64_t> plane(const std::size_t axis, const int depth) const;
+    std::size_t bytes() const;
+};
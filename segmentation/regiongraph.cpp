@@ -0,0 +1,375 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#include "regiongraph.h"
+
+#include "dataset.h"
+#include "loader.h"
+#include "palettecube.h"
+#include "segmentation.h"
+#include "stateInfo.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+
+#include <snappy.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace {
+struct Source {// captured in the gui thread for the workers
+    std::size_t layerId;
+    std::size_t magIndex;
+    std::array<int, 3> shape;
+    std::uint64_t background;
+};
+
+struct PairHash {
+    std::size_t operator()(const std::pair<std::uint64_t, std::uint64_t> & pair) const {
+        return std::hash<std::uint64_t>{}(pair.first) ^ (std::hash<std::uint64_t>{}(pair.second) * 0x9e3779b97f4a7c15ull);
+    }
+};
+
+class Accumulator {
+    std::unordered_map<std::pair<std::uint64_t, std::uint64_t>, std::uint64_t, PairHash> areas;
+    std::pair<std::uint64_t, std::uint64_t> last;
+    std::uint64_t * lastArea{nullptr};// neighboring voxel pairs mostly repeat
+    const std::uint64_t background;
+public:
+    explicit Accumulator(const std::uint64_t background) : background{background} {}
+    void add(const std::uint64_t lhs, const std::uint64_t rhs) {
+        if (lhs == rhs || lhs == background || rhs == background) {
+            return;
+        }
+        const auto key = lhs < rhs ? std::make_pair(lhs, rhs) : std::make_pair(rhs, lhs);
+        if (lastArea == nullptr || key != last) {
+            last = key;
+            lastArea = &areas[key];
+        }
+        ++*lastArea;
+    }
+    RegionGraph::Contacts contacts() const {
+        RegionGraph::Contacts contacts;
+        contacts.reserve(areas.size());
+        for (const auto & [pair, area] : areas) {
+            contacts.push_back({pair.first, pair.second, area});
+        }
+        return contacts;
+    }
+};
+
+// the whole cube or the plane perpendicular to axis at depth
+std::vector<std::uint64_t> extract(const std::uint64_t * cube, const std::array<int, 3> & shape, const std::size_t axis, const int depth) {
+    if (axis == RegionGraph::interior) {
+        return {cube, cube + static_cast<std::size_t>(shape[0]) * shape[1] * shape[2]};
+    }
+    std::array<int, 3> first{0, 0, 0}, last = shape;
+    first[axis] = depth;
+    last[axis] = depth + 1;
+    std::vector<std::uint64_t> plane;
+    plane.reserve(static_cast<std::size_t>(shape[0]) * shape[1] * shape[2] / shape[axis]);
+    for (int z = first[2]; z < last[2]; ++z)
+    for (int y = first[1]; y < last[1]; ++y)
+    for (int x = first[0]; x < last[0]; ++x) {
+        plane.emplace_back(cube[(static_cast<std::size_t>(z) * shape[1] + y) * shape[0] + x]);
+    }
+    return plane;
+}
+
+// prefers the loaded cube, modified cubes outside the loaded area are streamed from the snappy cache
+std::vector<std::uint64_t> fetch(const Source & source, const CoordOfCube & cubeCoord, const std::size_t axis, const int depth) {
+    std::shared_ptr<const PaletteCube> packedCube;
+    {
+        QMutexLocker locker(&state->protectCube2Pointer);
+        if (const auto * cube = cubeQuery(state->cube2Pointer, source.layerId, source.magIndex, cubeCoord)) {
+            return extract(static_cast<const std::uint64_t *>(cube), source.shape, axis, depth);
+        }
+        packedCube = paletteQuery(state->cube2Palette, source.layerId, source.magIndex, cubeCoord);
+    }
+    if (packedCube != nullptr) {
+        if (axis != RegionGraph::interior) {
+            return packedCube->plane(axis, depth);
+        }
+        std::vector<std::uint64_t> cube(static_cast<std::size_t>(source.shape[0]) * source.shape[1] * source.shape[2]);
+        packedCube->decode(cube.data());
+        return cube;
+    }
+    auto & worker = *Loader::Controller::singleton().worker;
+    std::string compressed;
+    {
+        QMutexLocker locker(&worker.snappyCacheMutex);
+        if (source.layerId >= worker.snappyCache.size() || source.magIndex >= worker.snappyCache[source.layerId].size()) {
+            return {};
+        }
+        const auto & cubes = worker.snappyCache[source.layerId][source.magIndex];
+        const auto it = cubes.find(cubeCoord);
+        if (it == std::end(cubes)) {
+            return {};
+        }
+        compressed = it->second;
+    }
+    std::vector<std::uint64_t> cube(static_cast<std::size_t>(source.shape[0]) * source.shape[1] * source.shape[2]);
+    if (!snappy::RawUncompress(compressed.data(), compressed.size(), reinterpret_cast<char *>(cube.data()))) {
+        qWarning() << QObject::tr("region graph skipped broken snappy cube (%1, %2, %3)").arg(cubeCoord.x).arg(cubeCoord.y).arg(cubeCoord.z);
+        return {};
+    }
+    return axis == RegionGraph::interior ? cube : extract(cube.data(), source.shape, axis, depth);
+}
+
+RegionGraph::Contacts scanPart(const Source & source, const CoordOfCube & cubeCoord, const std::size_t part) {
+    Accumulator accumulator{source.background};
+    const auto & shape = source.shape;
+    if (part == RegionGraph::interior) {
+        const auto cube = fetch(source, cubeCoord, part, 0);
+        if (cube.empty()) {
+            return {};
+        }
+        const std::size_t row = shape[0];
+        const std::size_t slice = row * shape[1];
+        for (int z = 0; z < shape[2]; ++z)
+        for (int y = 0; y < shape[1]; ++y)
+        for (int x = 0; x < shape[0]; ++x) {
+            const auto i = z * slice + y * row + x;
+            if (x + 1 < shape[0]) {
+                accumulator.add(cube[i], cube[i + 1]);
+            }
+            if (y + 1 < shape[1]) {
+                accumulator.add(cube[i], cube[i + row]);
+            }
+            if (z + 1 < shape[2]) {
+                accumulator.add(cube[i], cube[i + slice]);
+            }
+        }
+    } else {// faces towards the lower neighbor along axis part
+        const CoordOfCube lowerCoord(cubeCoord.x - (part == 0), cubeCoord.y - (part == 1), cubeCoord.z - (part == 2));
+        const auto plane = fetch(source, cubeCoord, part, 0);
+        const auto lowerPlane = plane.empty() ? plane : fetch(source, lowerCoord, part, shape[part] - 1);
+        if (lowerPlane.empty()) {
+            return {};
+        }
+        for (std::size_t i = 0; i < plane.size(); ++i) {
+            accumulator.add(plane[i], lowerPlane[i]);
+        }
+    }
+    return accumulator.contacts();
+}
+}
+
+RegionGraph::RegionGraph() {
+    QObject::connect(&watcher, &QFutureWatcher<std::vector<Part>>::finished, this, &RegionGraph::applyResults);
+}
+
+void RegionGraph::build() {
+    clear();
+    QObject::connect(&Loader::Controller::singleton(), &Loader::Controller::markCubeAsModifiedSignal, this, &RegionGraph::markCubeAsModified, Qt::UniqueConnection);
+    active = true;
+    layerId = Segmentation::singleton().layerId;
+    magIndex = Dataset::datasets[layerId].magIndex;
+    std::unordered_set<CoordOfCube> cubes;
+    {
+        QMutexLocker locker(&state->protectCube2Pointer);
+        if (layerId < state->cube2Pointer.size() && magIndex < state->cube2Pointer[layerId].size()) {
+            for (const auto & pair : state->cube2Pointer[layerId][magIndex]) {
+                cubes.emplace(pair.first);
+            }
+            for (const auto & pair : state->cube2Palette[layerId][magIndex]) {
+                cubes.emplace(pair.first);
+            }
+        }
+    }
+    {
+        auto & worker = *Loader::Controller::singleton().worker;
+        QMutexLocker locker(&worker.snappyCacheMutex);
+        if (layerId < worker.snappyCache.size() && magIndex < worker.snappyCache[layerId].size()) {
+            for (const auto & pair : worker.snappyCache[layerId][magIndex]) {
+                cubes.emplace(pair.first);
+            }
+        }
+    }
+    std::vector<std::pair<CoordOfCube, std::size_t>> work;
+    work.reserve(4 * cubes.size());
+    for (const auto & cubeCoord : cubes) {
+        for (std::size_t part = 0; part < 4; ++part) {
+            work.emplace_back(cubeCoord, part);
+        }
+    }
+    scan(std::move(work));
+}
+
+void RegionGraph::clear() {
+    if (pending) {// discard
+        watcher.waitForFinished();
+        pending = false;
+    }
+    active = false;
+    dirtyCubes.clear();
+    parts.clear();
+    adjacency.clear();
+    emit changed();
+}
+
+void RegionGraph::waitForFinished() {
+    scanDirtyCubes();
+    while (pending) {
+        watcher.waitForFinished();
+        applyResults();
+    }
+}
+
+void RegionGraph::markCubeAsModified(const std::size_t layerId, const CoordOfCube & cubeCoord, const int magnification) {
+    if (!active || layerId != this->layerId || static_cast<std::size_t>(std::log2(magnification)) != magIndex) {
+        return;
+    }
+    if (dirtyCubes.empty() && !pending) {// strokes mark the same cubes repeatedly, collect them until the event loop runs again
+        QTimer::singleShot(0, this, &RegionGraph::scanDirtyCubes);
+    }
+    dirtyCubes.emplace(cubeCoord);
+}
+
+void RegionGraph::scanDirtyCubes() {
+    if (pending || dirtyCubes.empty()) {
+        return;
+    }
+    // a cube owns its interior and the faces towards its lower neighbors, so the upper neighbors rescan one face each
+    std::unordered_map<CoordOfCube, std::array<bool, 4>> dirtyParts;
+    for (const auto & cubeCoord : dirtyCubes) {
+        dirtyParts[cubeCoord].fill(true);
+        dirtyParts[CoordOfCube(cubeCoord.x + 1, cubeCoord.y, cubeCoord.z)][0] = true;
+        dirtyParts[CoordOfCube(cubeCoord.x, cubeCoord.y + 1, cubeCoord.z)][1] = true;
+        dirtyParts[CoordOfCube(cubeCoord.x, cubeCoord.y, cubeCoord.z + 1)][2] = true;
+    }
+    dirtyCubes.clear();
+    std::vector<std::pair<CoordOfCube, std::size_t>> work;
+    for (const auto & [cubeCoord, dirty] : dirtyParts) {
+        for (std::size_t part = 0; part < dirty.size(); ++part) {
+            if (dirty[part]) {
+                work.emplace_back(cubeCoord, part);
+            }
+        }
+    }
+    scan(std::move(work));
+}
+
+void RegionGraph::scan(std::vector<std::pair<CoordOfCube, std::size_t>> work) {
+    const auto & shape = Dataset::datasets[layerId].cubeShape;
+    const Source source{layerId, magIndex, {shape.x, shape.y, shape.z}, Segmentation::singleton().getBackgroundId()};
+    std::vector<Part> results;
+    results.reserve(work.size());
+    for (auto & [cubeCoord, part] : work) {
+        results.push_back({cubeCoord, part, {}});
+    }
+    pending = true;
+    watcher.setFuture(QtConcurrent::run([source, results = std::move(results)]() mutable {
+        QtConcurrent::blockingMap(results, [&source](Part & result){
+            result.contacts = scanPart(source, result.cube, result.part);
+        });
+        return std::move(results);
+    }));
+}
+
+void RegionGraph::applyResults() {
+    if (!pending || !watcher.isFinished()) {
+        return;
+    }
+    pending = false;
+    for (auto & result : watcher.result()) {
+        auto & contacts = parts[result.cube][result.part];
+        apply(contacts, false);
+        contacts = std::move(result.contacts);
+        apply(contacts, true);
+    }
+    emit changed();
+    scanDirtyCubes();
+}
+
+void RegionGraph::apply(const Contacts & contacts, const bool add) {
+    for (const auto & contact : contacts) {
+        for (const auto & [from, to] : {std::make_pair(contact.lhs, contact.rhs), std::make_pair(contact.rhs, contact.lhs)}) {
+            auto & neighbors = adjacency[from];
+            auto & area = neighbors[to];
+            area = add ? area + contact.area : area - contact.area;
+            if (area == 0) {
+                neighbors.erase(to);
+                if (neighbors.empty()) {
+                    adjacency.erase(from);
+                }
+            }
+        }
+    }
+}
+
+bool RegionGraph::busy() const {
+    return pending || !dirtyCubes.empty();
+}
+
+std::size_t RegionGraph::nodeCount() const {
+    return adjacency.size();
+}
+
+std::size_t RegionGraph::edgeCount() const {
+    std::size_t count{0};
+    for (const auto & pair : adjacency) {
+        count += pair.second.size();
+    }
+    return count / 2;
+}
+
+std::uint64_t RegionGraph::contactArea(const std::uint64_t lhs, const std::uint64_t rhs) const {
+    const auto it = adjacency.find(lhs);
+    if (it == std::end(adjacency)) {
+        return 0;
+    }
+    const auto areaIt = it->second.find(rhs);
+    return areaIt != std::end(it->second) ? areaIt->second : 0;
+}
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>> RegionGraph::neighbors(const std::uint64_t id) const {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> neighbors;
+    const auto it = adjacency.find(id);
+    if (it != std::end(adjacency)) {
+        neighbors.assign(std::begin(it->second), std::end(it->second));
+        std::sort(std::begin(neighbors), std::end(neighbors), [](const auto & lhs, const auto & rhs){
+            return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+        });
+    }
+    return neighbors;
+}
+
+RegionGraph::Contacts RegionGraph::contacts() const {
+    Contacts contacts;
+    for (const auto & [id, neighbors] : adjacency) {
+        for (const auto & [neighbor, area] : neighbors) {
+            if (id < neighbor) {
+                contacts.push_back({id, neighbor, area});
+            }
+        }
+    }
+    return contacts;
+}
@@ -0,0 +1,89 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Region adjacency graph of the supervoxels in the segmentation layer.
+ *
+ * Counts the voxel faces two supervoxels share (contact area) in loaded and modified cubes of one magnification.
+ * Each cube contributes its interior and the faces towards its lower neighbours,
+ * so a modified cube only rescans itself and the faces of its upper neighbours in the background.
+ */
+class RegionGraph : public QObject {
+    Q_OBJECT
+public:
+    struct Contact {
+        std::uint64_t lhs;
+        std::uint64_t rhs;
+        std::uint64_t area;
+    };
+    using Contacts = std::vector<Contact>;
+    static constexpr std::size_t interior{3};// part index after the 3 faces
+private:
+    struct Part {
+        CoordOfCube cube;
+        std::size_t part;
+        Contacts contacts;
+    };
+    std::unordered_map<CoordOfCube, std::array<Contacts, 4>> parts;// applied contributions
+    std::unordered_map<std::uint64_t, std::unordered_map<std::uint64_t, std::uint64_t>> adjacency;
+    std::size_t layerId{0};
+    std::size_t magIndex{0};
+    bool active{false};
+    bool pending{false};
+    std::unordered_set<CoordOfCube> dirtyCubes;
+    QFutureWatcher<std::vector<Part>> watcher;
+
+    void apply(const Contacts & contacts, const bool add);
+    void applyResults();
+    void scan(std::vector<std::pair<CoordOfCube, std::size_t>> work);
+    void scanDirtyCubes();
+public:
+    RegionGraph();
+    void build();
+    void clear();
+    void waitForFinished();
+    void markCubeAsModified(const std::size_t layerId, const CoordOfCube & cubeCoord, const int magnification);
+
+    bool busy() const;
+    std::size_t nodeCount() const;
+    std::size_t edgeCount() const;
+    std::uint64_t contactArea(const std::uint64_t lhs, const std::uint64_t rhs) const;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> neighbors(const std::uint64_t id) const;
+    Contacts contacts() const;
+signals:
+    void changed();
+};
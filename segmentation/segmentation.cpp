@@ -29,14 +29,16 @@
 #include "stateInfo.h"
 #include "viewer.h"
 
+#include <QFile>
+#include <QMutexLocker>
 #include <QSignalBlocker>
 #include <QTextStream>
 
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <numeric>
 #include <random>
-#include <sstream>
 #include <utility>
 
 Segmentation::Object::Object(std::vector<std::reference_wrapper<SubObject>> initialVolumes, const Coordinate & location, const uint64_t id, const bool & todo, const bool & immutable)
@@ -60,12 +62,25 @@ bool Segmentation::Object::operator==(const Segmentation::Object & other) const
     return index == other.index;
 }
 
+std::vector<uint64_t> Segmentation::SubObject::oidxs() const {
+    std::vector<uint64_t> indices(objects.size());
+    std::transform(std::begin(objects), std::end(objects), std::begin(indices), [](const uint64_t slot){
+        return objectSlots.index(slot);
+    });
+    return indices;
+}
+
+bool Segmentation::Object::contains(const SubObject & sub) const {
+    return std::any_of(std::begin(sub.objects), std::end(sub.objects), [this](const uint64_t elemSlot){
+        return SubObject::objectSlots.find(elemSlot) == slot;
+    });
+}
+
 void Segmentation::Object::addExistingSubObject(Segmentation::SubObject & sub) {
-    const auto objectPosIt = std::lower_bound(std::begin(sub.objects), std::end(sub.objects), this->index);
-    if (objectPosIt != std::end(sub.objects) && *objectPosIt == this->index) {
+    if (contains(sub)) {
         throw std::runtime_error(tr("object %1 already contains subobject %2").arg(this->id).arg(sub.id).toStdString());
     }
-    sub.objects.emplace(objectPosIt, this->index);//register parent
+    sub.objects.emplace(std::lower_bound(std::begin(sub.objects), std::end(sub.objects), slot), slot);//register parent
     subobjects.emplace_back(sub);//add child
 }
 
@@ -73,9 +88,8 @@ Segmentation::Object & Segmentation::Object::merge(Segmentation::Object & other,
     for (auto & elem : other.subobjects) {//add parent
         auto & parentObjs = elem.get().objects;
         //don’t insert twice
-        auto posIt = std::lower_bound(std::begin(parentObjs), std::end(parentObjs), this->index);
-        if (posIt == std::end(parentObjs) || *posIt != this->index) {
-            parentObjs.emplace(posIt, this->index);
+        if (!contains(elem.get())) {
+            parentObjs.emplace(std::lower_bound(std::begin(parentObjs), std::end(parentObjs), slot), slot);
             elem.get().selectedObjectsCount += this->selected * !capSelection;
         } else if (capSelection) {// if merge doesn’t affect ownership it can still change the selection
             elem.get().selectedObjectsCount = 1;
@@ -90,6 +104,36 @@ Segmentation::Object & Segmentation::Object::merge(Segmentation::Object & other,
     return *this;
 }
 
+Segmentation::Object & Segmentation::Object::absorb(Segmentation::Object & other) {
+    // other gets removed afterwards, linking its slot hands its subobjects over without touching them
+    const auto otherSlot = SubObject::objectSlots.find(other.slot);
+    decltype(subobjects) tmp;
+    tmp.reserve(subobjects.size() + other.subobjects.size());
+    auto lhs = std::begin(subobjects);
+    auto rhs = std::begin(other.subobjects);
+    while (lhs != std::end(subobjects) && rhs != std::end(other.subobjects)) {
+        if (*lhs < *rhs) {
+            tmp.emplace_back(*lhs++);
+        } else if (*rhs < *lhs) {
+            tmp.emplace_back(*rhs++);
+        } else {// shared subobjects would reference the result twice
+            auto & parentObjs = rhs->get().objects;
+            parentObjs.erase(std::find_if(std::begin(parentObjs), std::end(parentObjs), [otherSlot](const uint64_t elemSlot){
+                return SubObject::objectSlots.find(elemSlot) == otherSlot;
+            }));
+            rhs->get().selectedObjectsCount = 1;// if merge doesn’t affect ownership it can still change the selection
+            tmp.emplace_back(*lhs++);
+            ++rhs;
+        }
+    }
+    tmp.insert(std::end(tmp), lhs, std::end(subobjects));
+    tmp.insert(std::end(tmp), rhs, std::end(other.subobjects));
+    std::swap(subobjects, tmp);
+    other.subobjects.clear();
+    slot = SubObject::objectSlots.unite(slot, otherSlot);
+    return *this;
+}
+
 Segmentation & Segmentation::singleton() {
     static Segmentation segmentation;
     return segmentation;
@@ -104,8 +148,10 @@ bool Segmentation::hasSegData() const {
 }
 
 void Segmentation::clear() {
+    downsampler.clear();
     //dispatch to loader thread, original cubes are reloaded automatically
     QTimer::singleShot(0, Loader::Controller::singleton().worker.get(), &Loader::Worker::snappyCacheClear);
+    regionGraph.clear();
     mergelistClear();
 }
 
@@ -153,7 +199,9 @@ void Segmentation::removeObject(Object & object) {
     unselectObject(object);
     for (auto & elem : object.subobjects) {
         auto & subobject = elem.get();
-        subobject.objects.erase(std::remove(std::begin(subobject.objects), std::end(subobject.objects), object.index), std::end(subobject.objects));
+        subobject.objects.erase(std::remove_if(std::begin(subobject.objects), std::end(subobject.objects), [&object](const uint64_t elemSlot){
+            return SubObject::objectSlots.find(elemSlot) == object.slot;
+        }), std::end(subobject.objects));
         if (subobject.objects.empty()) {
             subobjects.erase(subobject.id);
         }
@@ -161,13 +209,8 @@ void Segmentation::removeObject(Object & object) {
     object.subobjects.clear();
     //swap with last, so no intermediate rows need to be deleted
     if (objects.size() > 1 && object.index != objects.back().index) {
-        //replace sorted object index in subobjects
-        for (auto & elem : objects.back().subobjects) {
-            auto & subobject = elem.get();
-            const auto lo = std::rbegin(subobject.objects);
-            const auto hi = std::upper_bound(lo, std::rend(subobject.objects), object.index, std::greater<>{});
-            *std::rotate(lo, lo+1, hi) = object.index;
-        }
+        //subobjects reference the slot, only its index moves
+        SubObject::objectSlots.setIndex(objects.back().slot, object.index);
         //replace object index in selected objects
         selectedObjectIndices.replace(objects.back().index, object.index);
         std::swap(objects.back().index, object.index);
@@ -271,10 +314,10 @@ Segmentation::color_t Segmentation::colorOfSelectedObject(const SubObject & subo
     if (subobject.selectedObjectsCount > 1) {
         return std::make_tuple(std::uint8_t{255}, std::uint8_t{0}, std::uint8_t{0}, alpha);//mark overlapping objects in red
     }
-    const auto objectIndex = *std::find_if(std::begin(subobject.objects), std::end(subobject.objects), [this](const uint64_t index){
-        return objects[index].selected;
+    const auto objectSlot = *std::find_if(std::begin(subobject.objects), std::end(subobject.objects), [this](const uint64_t slot){
+        return objects[SubObject::objectSlots.index(slot)].selected;
     });
-    return colorObjectFromIndex(objectIndex);
+    return colorObjectFromIndex(SubObject::objectSlots.index(objectSlot));
 }
 
 Segmentation::color_t Segmentation::colorObjectFromSubobjectId(const uint64_t subObjectID) const {
@@ -341,9 +384,13 @@ uint64_t Segmentation::largestObjectContainingSubobjectId(const uint64_t subObje
 uint64_t Segmentation::largestObjectContainingSubobject(const Segmentation::SubObject & subobject) const {
     //same comparator for both functions, it seems to work as it is, so i don’t waste my head now to find out why
     //there may have been some reasoning… (at first glance it seems too restrictive for the largest object)
-    auto comparator = std::bind(&Segmentation::objectOrder, this, std::placeholders::_1, std::placeholders::_2);
-    const auto objectIndex = *std::max_element(std::begin(subobject.objects), std::end(subobject.objects), comparator);
-    return objectIndex;
+    if (subobject.objects.size() == 1) {
+        return SubObject::objectSlots.index(subobject.objects.front());
+    }
+    auto comparator = [this](const uint64_t lhs, const uint64_t rhs){
+        return objectOrder(SubObject::objectSlots.index(lhs), SubObject::objectSlots.index(rhs));
+    };
+    return SubObject::objectSlots.index(*std::max_element(std::begin(subobject.objects), std::end(subobject.objects), comparator));
 }
 
 uint64_t Segmentation::tryLargestObjectContainingSubobject(const uint64_t subObjectId) const {
@@ -354,10 +401,22 @@ uint64_t Segmentation::tryLargestObjectContainingSubobject(const uint64_t subObj
     return largestObjectContainingSubobject(it->second);
 }
 
+std::unordered_map<uint64_t, uint64_t> Segmentation::objectIdsOfSubobjects() const {
+    std::unordered_map<uint64_t, uint64_t> objectIds;
+    objectIds.reserve(subobjects.size());
+    for (const auto & [id, subobject] : subobjects) {
+        if (!subobject.objects.empty()) {
+            objectIds.emplace(id, objects[largestObjectContainingSubobject(subobject)].id);
+        }
+    }
+    return objectIds;
+}
+
 uint64_t Segmentation::smallestImmutableObjectContainingSubobject(const Segmentation::SubObject & subobject) const {
-    auto comparitor = std::bind(&Segmentation::objectOrder, this, std::placeholders::_1, std::placeholders::_2);
-    const auto objectIndex = *std::min_element(std::begin(subobject.objects), std::end(subobject.objects), comparitor);
-    return objectIndex;
+    auto comparitor = [this](const uint64_t lhs, const uint64_t rhs){
+        return objectOrder(SubObject::objectSlots.index(lhs), SubObject::objectSlots.index(rhs));
+    };
+    return SubObject::objectSlots.index(*std::min_element(std::begin(subobject.objects), std::end(subobject.objects), comparitor));
 }
 
 decltype(Segmentation::defaultMergeClass) Segmentation::getDefaultMergeClass() const {
@@ -374,7 +433,7 @@ void Segmentation::hoverSubObject(const uint64_t subobject_id) {
         const auto & iter = Segmentation::singleton().subobjects.find(subobject_id);
         std::vector<uint64_t> overlappingObjIndices;
         if (iter != std::end(Segmentation::singleton().subobjects)) {
-            overlappingObjIndices = iter->second.objects;
+            overlappingObjIndices = iter->second.oidxs();
         }
         mouseFocusedObjectId = Segmentation::singleton().tryLargestObjectContainingSubobject(subobject_id);
         emit hoveredSubObjectChanged(hovered_subobject_id = subobject_id, overlappingObjIndices);
@@ -395,7 +454,7 @@ std::vector<std::reference_wrapper<Segmentation::Object>> Segmentation::touchedO
     auto it = subobjects.find(touched_subobject_id);
     std::vector<std::reference_wrapper<Segmentation::Object>> vec;
     if (it != std::end(subobjects)) {
-        for (const auto & index : it->second.objects) {
+        for (const auto & index : it->second.oidxs()) {
             vec.emplace_back(objects[index]);
         }
     }
@@ -410,6 +469,23 @@ bool Segmentation::isSelected(const uint64_t & objectIndex) const {
     return objects[objectIndex].selected;
 }
 
+void Segmentation::volumeUpdate(const boost::optional<CoordOfCube> cubeCoord) {
+    QMutexLocker locker(&volume_dirty_mutex);
+    if (!cubeCoord) {
+        volume_dirty_cubes = boost::none;
+    } else if (volume_dirty_cubes) {
+        volume_dirty_cubes->emplace(cubeCoord.get());
+    }
+    volume_update_required = true;
+}
+
+boost::optional<std::unordered_set<CoordOfCube>> Segmentation::takeVolumeUpdate() {
+    QMutexLocker locker(&volume_dirty_mutex);
+    auto dirtyCubes = std::move(volume_dirty_cubes);
+    volume_dirty_cubes.emplace();
+    return dirtyCubes;
+}
+
 bool Segmentation::isSubObjectIdSelected(const uint64_t & subobjectId) const {
     auto it = subobjects.find(subobjectId);
     return it != std::end(subobjects) ? isSelected(it->second) : false;
@@ -531,7 +607,9 @@ void Segmentation::unmergeObject(Segmentation::Object & object, Segmentation::Ob
             unselectObject(object);
             for (auto & elem : other.subobjects) {
                 auto & parentObjs = elem.get().objects;
-                parentObjs.erase(std::remove(std::begin(parentObjs), std::end(parentObjs), object.index), std::end(parentObjs));//remove parent
+                parentObjs.erase(std::remove_if(std::begin(parentObjs), std::end(parentObjs), [&object](const uint64_t elemSlot){
+                    return SubObject::objectSlots.find(elemSlot) == object.slot;
+                }), std::end(parentObjs));//remove parent
             }
             std::swap(object.subobjects, tmp);
             selectObject(object);
@@ -543,14 +621,14 @@ void Segmentation::unmergeObject(Segmentation::Object & object, Segmentation::Ob
 
 Segmentation::Object & Segmentation::objectFromSubobject(Segmentation::SubObject & subobject, const Coordinate & position) {
     const auto & other = std::find_if(std::begin(subobject.objects), std::end(subobject.objects)
-    , [&](const uint64_t elemId){
-        const auto & elem = objects[elemId];
+    , [&](const uint64_t elemSlot){
+        const auto & elem = objects[SubObject::objectSlots.index(elemSlot)];
         return elem.subobjects.size() == 1 && elem.subobjects.front().get().id == subobject.id;
     });
     if (other == std::end(subobject.objects)) {
         return createObject(std::vector<std::reference_wrapper<SubObject>>{subobject}, position);
     } else {
-        return objects[*other];
+        return objects[SubObject::objectSlots.index(*other)];
     }
 }
 
@@ -577,8 +655,27 @@ std::size_t Segmentation::selectedObjectsCount() const {
 }
 
 void Segmentation::mergelistSave(QIODevice & file) const {
-    QTextStream stream(&file);
-    mergelistSave(stream);
+    if (!file.isOpen() && !file.open(QIODevice::WriteOnly)) {
+        throw std::runtime_error("mergelistSave open failed");
+    }
+    if (file.write(mergelist().format()) == -1) {
+        qDebug() << "mergelistSave fail";
+    }
+}
+
+Mergelist Segmentation::mergelist() const {
+    Mergelist mergelist;
+    mergelist.objects.reserve(objects.size());
+    mergelist.subobjectIds.reserve(std::accumulate(std::begin(objects), std::end(objects), std::size_t{0}, [](const auto sum, const auto & obj){
+        return sum + obj.subobjects.size();
+    }));
+    for (const auto & obj : objects) {
+        mergelist.objects.push_back({obj.id, obj.todo, obj.immutable, mergelist.subobjectIds.size(), obj.subobjects.size(), obj.location, obj.color, obj.category, obj.comment});
+        for (const auto & subObj : obj.subobjects) {
+            mergelist.subobjectIds.emplace_back(subObj.get().id);
+        }
+    }
+    return mergelist;
 }
 
 void Segmentation::mergelistClear() {
@@ -589,6 +686,7 @@ void Segmentation::mergelistClear() {
     objectIdToIndex.clear();
     Object::highestId = 0;
     Object::highestIndex = -1;
+    SubObject::objectSlots.clear();
     SubObject::highestId = 0;
     subobjects.clear();
     backgroundId = 0;
@@ -603,76 +701,56 @@ void Segmentation::mergelistClear() {
 }
 
 void Segmentation::mergelistSave(QTextStream & stream) const {
-    for (const auto & obj : objects) {
-        stream << obj.id << ' ' << obj.todo << ' ' << obj.immutable;
-        for (const auto & subObj : obj.subobjects) {
-            stream << ' ' << subObj.get().id;
-        }
-        stream << '\n';
-        stream << obj.location.x << ' ' << obj.location.y << ' ' << obj.location.z << ' ';
-        if (obj.color) {
-            stream << std::get<0>(obj.color.get()) << ' ' << std::get<1>(obj.color.get()) << ' ' << std::get<2>(obj.color.get()) << '\n';
-        } else {
-            stream << '\n';
-        }
-        stream << obj.category << '\n';
-        stream << obj.comment << '\n';
-    }
+    stream << QString::fromUtf8(mergelist().format());
     if (stream.status() != QTextStream::Ok) {
         qDebug() << "mergelistSave fail";
     }
 }
 
 void Segmentation::mergelistLoad(QIODevice & file) {
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         throw std::runtime_error("mergelistLoad open failed");
     }
-    QTextStream stream(&file);
-    mergelistLoad(stream);
+    auto * qfile = qobject_cast<QFile *>(&file);
+    auto * map = qfile != nullptr && qfile->size() > 0 ? qfile->map(0, qfile->size()) : nullptr;
+    if (map != nullptr) {
+        const auto * begin = reinterpret_cast<const char *>(map);
+        const auto mergelist = Mergelist::parse(begin, begin + qfile->size());
+        qfile->unmap(map);
+        mergelistLoad(mergelist);
+    } else {// e.g. unzipped from an annotation
+        const auto data = file.readAll();
+        mergelistLoad(Mergelist::parse(data.constData(), data.constData() + data.size()));
+    }
 }
 
 void Segmentation::mergelistLoad(QTextStream & stream) {
-    QString line;
+    const auto data = stream.readAll().toUtf8();
+    mergelistLoad(Mergelist::parse(data.constData(), data.constData() + data.size()));
+}
+
+void Segmentation::mergelistLoad(const Mergelist & mergelist) {
     {
         QSignalBlocker blocker{this};
-        std::size_t line_i{0};
         categories.clear();
-        while (!(line = stream.readLine()).isNull()) {
-            std::istringstream lineStream(line.toStdString());
-            std::istringstream coordColorLineStream(stream.readLine().toStdString());
-
-            uint64_t objId;
-            bool todo;
-            bool immutable;
-            Coordinate location;
-            uint r; uint g; uint b;
-            uint64_t initialVolume;
-            QString category;
-            QString comment;
-
-            bool valid0 = (lineStream >> objId) && (lineStream >> todo) && (lineStream >> immutable) && (lineStream >> initialVolume);
-            bool valid1 = (coordColorLineStream >> location.x) && (coordColorLineStream >> location.y) && (coordColorLineStream >> location.z);
-            bool customColorValid = (coordColorLineStream >> r) && (coordColorLineStream >> g) && (coordColorLineStream >> b);
-            bool valid2 = !(category = stream.readLine()).isNull();
-            bool valid3 = !(comment = stream.readLine()).isNull();
-
-            if (valid0 && valid1 && valid2 && valid3) {
-                auto & obj = createObjectFromSubobjectId(initialVolume, location, objId, todo, immutable);
-                uint64_t subObjId;
-                while (lineStream >> subObjId) {
-                    newSubObject(obj, subObjId);
-                }
-                std::sort(std::begin(obj.subobjects), std::end(obj.subobjects));
-                changeCategory(obj, category);
-                if (customColorValid) {
-                    changeColor(obj, std::make_tuple(r, g, b));
-                }
-                obj.comment = comment;
-            } else {
-                clear();
-                throw std::runtime_error("mergelistLoad parsing failed " + std::to_string(valid0) + std::to_string(valid1) + std::to_string(valid2) + std::to_string(valid3) + "@" + std::to_string(line_i));
+        objects.reserve(objects.size() + mergelist.objects.size());
+        SubObject::objectSlots.reserveAdditional(mergelist.objects.size());
+        objectIdToIndex.reserve(objectIdToIndex.size() + mergelist.objects.size());
+        subobjects.reserve(subobjects.size() + mergelist.subobjectIds.size());
+        for (const auto & entry : mergelist.objects) {
+            std::vector<std::reference_wrapper<SubObject>> volumes;
+            volumes.reserve(entry.subobjectCount);
+            for (auto i = entry.firstSubobject; i < entry.firstSubobject + entry.subobjectCount; ++i) {
+                const auto id = mergelist.subobjectIds[i];
+                // most subobjects belong to a single object, don’t reserve for merging
+                volumes.emplace_back(subobjects.emplace(std::piecewise_construct, std::forward_as_tuple(id), std::forward_as_tuple(id, 1)).first->second);
             }
-            line_i += 4 + customColorValid;
+            const auto objectId = objectIdToIndex.find(entry.id) == std::end(objectIdToIndex) ? entry.id : ++Object::highestId;
+            auto & obj = createObject(std::move(volumes), entry.location, objectId, entry.todo, entry.immutable);
+            obj.category = entry.category;
+            categories.insert(entry.category);
+            obj.color = entry.color;
+            obj.comment = entry.comment;
         }
         if (categories.isEmpty()) {
             categories = prefixed_categories;
@@ -752,10 +830,13 @@ void Segmentation::mergeSelectedObjects() {
                 std::swap(firstObj, secondObj);
             }
             flat_deselect(*secondObj);
-            firstObj->merge(*secondObj, true);
-            emit changedRow(firstObj->index);
             if (!secondObj->immutable) {
+                firstObj->absorb(*secondObj);
+                emit changedRow(firstObj->index);
                 removeObject(*secondObj);
+            } else {
+                firstObj->merge(*secondObj, true);
+                emit changedRow(firstObj->index);
             }
         }
         changeCategory(objects[selectedObjectIndices.front()], defaultMergeClass);
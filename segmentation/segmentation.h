@@ -23,11 +23,16 @@
 #pragma once
 
 #include "coordinate.h"
+#include "downsampler.h"
 #include "hash_list.h"
+#include "mergelist.h"
+#include "objectslots.h"
+#include "regiongraph.h"
 #include "segmentationsplit.h"
 
 #include <QColor>
 #include <QDebug>
+#include <QMutex>
 #include <QSet>
 #include <QString>
 #include <QObject>
@@ -40,6 +45,7 @@
 #include <random>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 enum SegmentationColor {
@@ -69,16 +75,21 @@ Q_OBJECT
         friend class SegmentationObjectModel;
         friend class Segmentation;
         static inline uint64_t highestId{0};
-        std::vector<uint64_t> objects;
+        static inline ObjectSlots objectSlots;
+        std::vector<uint64_t> objects;// sorted object slots
         std::size_t selectedObjectsCount = 0;
     public:
-        const auto & oidxs() const {
-            return objects;
+        std::vector<uint64_t> oidxs() const;
+        template<typename Func>
+        void forEachObjectIndex(Func && func) const {// oidxs without allocation
+            for (const auto slot : objects) {
+                func(objectSlots.index(slot));
+            }
         }
         const uint64_t id;
-        explicit SubObject(const uint64_t & id) : id(id) {
+        explicit SubObject(const uint64_t & id, const std::size_t objectCapacity = 10) : id(id) {
             highestId = std::max(id, highestId);
-            objects.reserve(10);//improves merging performance by a factor of 3
+            objects.reserve(objectCapacity);//improves merging performance by a factor of 3
         }
         SubObject(SubObject &&) = delete;
         SubObject(const SubObject &) = delete;
@@ -109,6 +120,7 @@ Q_OBJECT
         std::vector<std::reference_wrapper<SubObject>> subobjects;
         uint64_t id;
         uint64_t index = ++highestIndex;
+        uint64_t slot = SubObject::objectSlots.add(index);// root of the slots referenced by the subobjects
         bool todo;
         bool immutable;
         Coordinate location;
@@ -122,6 +134,8 @@ Q_OBJECT
         bool operator==(const Object & other) const;
         void addExistingSubObject(SubObject & sub);
         Object & merge(Object & other, bool adjustSelection = false);
+        Object & absorb(Object & other);
+        bool contains(const SubObject & sub) const;
     };
 
     std::unordered_map<uint64_t, SubObject> subobjects;
@@ -150,6 +164,8 @@ Q_OBJECT
     void changeColor(Object & obj, const std::tuple<uint8_t, uint8_t, uint8_t> & color);
     void changeComment(Object & obj, const QString & comment);
     void newSubObject(Object & obj, uint64_t subObjID);
+    Mergelist mergelist() const;
+    void mergelistLoad(const Mergelist & mergelist);
 
     void unmergeObject(Object & object, Object & other, const Coordinate & position);
 
@@ -184,6 +200,8 @@ public:
 
     bool enabled{false};
     std::size_t layerId;
+    RegionGraph regionGraph;
+    Downsampler downsampler;
 
     static Segmentation & singleton();
 
@@ -203,7 +221,12 @@ public:
     //volume rendering
     bool volume_render_toggle = false;
     std::atomic_bool volume_update_required{false};
+    QMutex volume_dirty_mutex;
+    boost::optional<std::unordered_set<CoordOfCube>> volume_dirty_cubes;// none → whole volume
+    void volumeUpdate(const boost::optional<CoordOfCube> cubeCoord = boost::none);
+    boost::optional<std::unordered_set<CoordOfCube>> takeVolumeUpdate();
     uint volume_tex_id = 0;
+    uint volume_occupancy_tex_id = 0;
     int volume_tex_len = 128;
     int volume_mouse_move_x = 0;
     int volume_mouse_move_y = 0;
@@ -226,6 +249,7 @@ public:
     uint64_t largestObjectContainingSubobjectId(const uint64_t subObjectId, const Coordinate & location);
     uint64_t largestObjectContainingSubobject(const SubObject & subobject) const;
     uint64_t tryLargestObjectContainingSubobject(const uint64_t subObjectId) const;
+    std::unordered_map<uint64_t, uint64_t> objectIdsOfSubobjects() const;// the mergelist applied to ids
     uint64_t smallestImmutableObjectContainingSubobject(const SubObject & subobject) const;
     decltype(defaultMergeClass) getDefaultMergeClass() const;
     void setDefaultMergeClass(const QString & mergeClass);
@@ -196,7 +196,7 @@ void verticalSplittingPlane(const Coordinate & seed) {
         //add the newly created subobject to all non-splitted objects
         for (auto && id : subObjectsToFill) {
             auto & subobject = Segmentation::singleton().subobjectFromId(id, seed);
-            for (auto && objIndex : subobject.objects) {
+            for (auto && objIndex : subobject.oidxs()) {
                 if (objIndex != splitId) {
                     auto && object = Segmentation::singleton().objects[objIndex];
                     auto & newSubobject = Segmentation::singleton().subobjectFromId(newSubObjId, seed);
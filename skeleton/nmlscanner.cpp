@@ -0,0 +1,455 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#include "skeleton/nmlscanner.h"
+
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <system_error>
+
+namespace {
+struct Unexpected {};// input the scanner does not handle, the caller falls back to QXmlStreamReader
+
+struct Attribute {
+    std::string_view name;
+    std::string_view value;// raw, entities are resolved on demand
+};
+
+struct Tag {
+    std::string_view name;
+    std::vector<Attribute> attributes;
+    const char * begin{nullptr};
+    const char * end{nullptr};// past '>'
+    bool closing{false};
+    bool selfClosing{false};
+};
+
+bool isSpace(const char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+class Cursor {
+    const char * pos;
+    const char * const end;
+
+    void skipSpace() {
+        while (pos != end && isSpace(*pos)) {
+            ++pos;
+        }
+    }
+    bool startsWith(const std::string_view prefix) const {
+        return static_cast<std::size_t>(end - pos) >= prefix.size() && std::equal(std::begin(prefix), std::end(prefix), pos);
+    }
+    void skipPast(const std::string_view terminator) {
+        const auto found = std::string_view(pos, end - pos).find(terminator);
+        if (found == std::string_view::npos) {
+            throw Unexpected{};
+        }
+        pos += found + terminator.size();
+    }
+    std::string_view name() {
+        const auto * begin = pos;
+        while (pos != end && !isSpace(*pos) && *pos != '=' && *pos != '/' && *pos != '>' && *pos != '<') {
+            if (*pos == ':') {// QXmlStreamReader reports local names
+                throw Unexpected{};
+            }
+            ++pos;
+        }
+        if (pos == begin) {
+            throw Unexpected{};
+        }
+        return {begin, static_cast<std::size_t>(pos - begin)};
+    }
+
+public:
+    Cursor(const char * begin, const char * end) : pos{begin}, end{end} {}
+    void seek(const char * position) {
+        pos = position;
+    }
+    bool next(Tag & tag) {
+        while (true) {// text between tags is not of interest
+            const auto * open = static_cast<const char *>(std::memchr(pos, '<', end - pos));
+            if (open == nullptr) {
+                pos = end;
+                return false;
+            }
+            pos = open;
+            if (startsWith("<!--")) {
+                skipPast("-->");
+            } else if (startsWith("<?")) {
+                skipPast("?>");
+            } else if (startsWith("<!")) {// DTDs may declare entities, CDATA does not occur in nml
+                throw Unexpected{};
+            } else {
+                break;
+            }
+        }
+        tag.begin = pos++;
+        tag.closing = pos != end && *pos == '/';
+        if (tag.closing) {
+            ++pos;
+        }
+        tag.name = name();
+        tag.selfClosing = false;
+        tag.attributes.clear();
+        while (true) {
+            skipSpace();
+            if (pos == end) {
+                throw Unexpected{};
+            }
+            if (*pos == '>') {
+                ++pos;
+                break;
+            }
+            if (tag.closing) {
+                throw Unexpected{};
+            }
+            if (*pos == '/') {
+                if (++pos == end || *pos != '>') {
+                    throw Unexpected{};
+                }
+                ++pos;
+                tag.selfClosing = true;
+                break;
+            }
+            Attribute attribute;
+            attribute.name = name();
+            skipSpace();
+            if (pos == end || *pos != '=') {
+                throw Unexpected{};
+            }
+            ++pos;
+            skipSpace();
+            if (pos == end || (*pos != '"' && *pos != '\'')) {
+                throw Unexpected{};
+            }
+            const auto quote = *pos++;
+            const auto * valueEnd = static_cast<const char *>(std::memchr(pos, quote, end - pos));
+            if (valueEnd == nullptr) {
+                throw Unexpected{};
+            }
+            attribute.value = {pos, static_cast<std::size_t>(valueEnd - pos)};
+            pos = valueEnd + 1;
+            if (attribute.value.find('<') != std::string_view::npos || (pos != end && !isSpace(*pos) && *pos != '/' && *pos != '>')) {
+                throw Unexpected{};
+            }
+            for (const auto & other : tag.attributes) {
+                if (other.name == attribute.name) {
+                    throw Unexpected{};
+                }
+            }
+            tag.attributes.emplace_back(attribute);
+        }
+        tag.end = pos;
+        return true;
+    }
+};
+
+bool isXmlChar(const std::uint32_t c) {
+    return c == 0x9 || c == 0xA || c == 0xD || (c >= 0x20 && c <= 0xD7FF) || (c >= 0xE000 && c <= 0xFFFD) || (c >= 0x10000 && c <= 0x10FFFF);
+}
+
+void appendUtf8(QByteArray & out, const std::uint32_t c) {
+    if (c < 0x80) {
+        out += static_cast<char>(c);
+    } else if (c < 0x800) {
+        out += static_cast<char>(0xC0 | (c >> 6));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += static_cast<char>(0xE0 | (c >> 12));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (c >> 18));
+        out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+/** resolves entities and normalizes whitespace like an xml parser does for attribute values */
+QString decode(const std::string_view raw) {
+    const auto special = std::find_if(std::begin(raw), std::end(raw), [](const char c){ return c == '&' || c == '\t' || c == '\n' || c == '\r'; });
+    if (special == std::end(raw)) {
+        return QString::fromUtf8(raw.data(), static_cast<int>(raw.size()));
+    }
+    QByteArray decoded;
+    decoded.reserve(static_cast<int>(raw.size()));
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        const auto c = raw[i];
+        if (c == '\r') {
+            decoded += ' ';
+            if (i + 1 < raw.size() && raw[i + 1] == '\n') {
+                ++i;
+            }
+        } else if (c == '\n' || c == '\t') {
+            decoded += ' ';
+        } else if (c == '&') {
+            const auto semicolon = raw.find(';', i);
+            if (semicolon == std::string_view::npos) {
+                throw Unexpected{};
+            }
+            const auto entity = raw.substr(i + 1, semicolon - i - 1);
+            if (entity == "lt") {
+                decoded += '<';
+            } else if (entity == "gt") {
+                decoded += '>';
+            } else if (entity == "amp") {
+                decoded += '&';
+            } else if (entity == "quot") {
+                decoded += '"';
+            } else if (entity == "apos") {
+                decoded += '\'';
+            } else if (entity.size() > 1 && entity[0] == '#') {
+                const bool hex = entity[1] == 'x';
+                const auto digits = entity.substr(hex ? 2 : 1);
+                std::uint32_t code{0};
+                const auto result = std::from_chars(digits.data(), digits.data() + digits.size(), code, hex ? 16 : 10);
+                if (digits.empty() || result.ec != std::errc{} || result.ptr != digits.data() + digits.size() || !isXmlChar(code)) {
+                    throw Unexpected{};
+                }
+                appendUtf8(decoded, code);
+            } else {
+                throw Unexpected{};
+            }
+            i = semicolon;
+        } else {
+            decoded += c;
+        }
+    }
+    return QString::fromUtf8(decoded);
+}
+
+// plain numbers are converted in place, everything else goes through the same QString conversion QXmlStreamReader users get
+template<typename T>
+bool fromChars(const std::string_view raw, T & value) {
+    const auto result = std::from_chars(raw.data(), raw.data() + raw.size(), value);
+    return result.ec == std::errc{} && result.ptr == raw.data() + raw.size();
+}
+
+std::uint64_t toULongLong(const std::string_view raw) {
+    std::uint64_t value;
+    return fromChars(raw, value) ? value : decode(raw).toULongLong();
+}
+
+int toInt(const std::string_view raw) {
+    int value;
+    return fromChars(raw, value) ? value : decode(raw).toInt();
+}
+
+double toDouble(const std::string_view raw) {
+    std::int64_t value;
+    const bool exact = fromChars(raw, value) && value >= -(std::int64_t{1} << 53) && value <= (std::int64_t{1} << 53) && !(value == 0 && raw.front() == '-');// -0
+    return exact ? static_cast<double>(value) : decode(raw).toDouble();
+}
+
+QString toQString(const std::string_view name) {
+    return QString::fromUtf8(name.data(), static_cast<int>(name.size()));
+}
+
+NmlScanner::Node parseNode(const Tag & tag) {
+    NmlScanner::Node node;
+    for (const auto & attribute : tag.attributes) {
+        const auto & name = attribute.name;
+        const auto & value = attribute.value;
+        if (name == "id") {
+            node.id = toULongLong(value);
+        } else if (name == "radius") {
+            node.radius = toDouble(value);
+        } else if (name == "x") {
+            node.x = toDouble(value);
+        } else if (name == "y") {
+            node.y = toDouble(value);
+        } else if (name == "z") {
+            node.z = toDouble(value);
+        } else if (name == "inVp") {
+            node.inVP = toInt(value);
+        } else if (name == "inMag") {
+            node.inMag = toInt(value);
+        } else if (name == "time") {
+            node.ms = toULongLong(value);
+        } else if (name != "comment") {// comments are read from the comments section
+            node.properties.insert(toQString(name), decode(value));
+        }
+    }
+    return node;
+}
+
+std::pair<std::uint64_t, std::uint64_t> parseEdge(const Tag & tag) {
+    std::pair<std::uint64_t, std::uint64_t> edge{0, 0};
+    for (const auto & attribute : tag.attributes) {
+        if (attribute.name == "source") {
+            edge.first = toULongLong(attribute.value);
+        } else if (attribute.name == "target") {
+            edge.second = toULongLong(attribute.value);
+        }
+    }
+    return edge;
+}
+
+void parseThing(NmlScanner::Thing & thing, const char * begin, const char * end) {
+    Cursor cursor{begin, end};
+    Tag tag;
+    std::vector<std::string_view> open;
+    while (cursor.next(tag)) {
+        if (tag.closing) {
+            if (open.empty() || open.back() != tag.name) {
+                throw Unexpected{};
+            }
+            open.pop_back();
+            continue;
+        }
+        if (tag.name == "thing") {// the outline would not match anymore
+            throw Unexpected{};
+        }
+        if (open.empty()) {
+            if (tag.name != "nodes" && tag.name != "edges") {
+                thing.skippedElements.insert(toQString(tag.name));
+            }
+        } else if (open.size() == 1 && open.front() == "nodes") {
+            if (tag.name == "node") {
+                thing.nodes.emplace_back(parseNode(tag));
+            } else {
+                thing.skippedElements.insert(toQString(tag.name));
+            }
+        } else if (open.size() == 1 && open.front() == "edges") {
+            if (tag.name == "edge") {
+                thing.edges.emplace_back(parseEdge(tag));
+            } else {
+                thing.skippedElements.insert(toQString(tag.name));
+            }
+        }
+        if (!tag.selfClosing) {
+            open.emplace_back(tag.name);
+        }
+    }
+    if (!open.empty()) {
+        throw Unexpected{};
+    }
+}
+
+const char * thingEnd(const char * begin, const char * end) {
+    const std::string_view rest(begin, end - begin);
+    const std::string_view closing{"</thing"};
+    for (auto found = rest.find(closing); found != std::string_view::npos; found = rest.find(closing, found + 1)) {
+        const auto after = found + closing.size();
+        if (after < rest.size() && (rest[after] == '>' || isSpace(rest[after]))) {
+            return begin + found;
+        }
+    }
+    throw Unexpected{};
+}
+
+void checkEncoding(std::string_view data) {
+    if (data.size() >= 2 && (data[0] == '\0' || data[1] == '\0' || static_cast<unsigned char>(data[0]) >= 0xFE)) {// utf-16/32
+        throw Unexpected{};
+    }
+    if (data.substr(0, 5) != "<?xml") {
+        return;
+    }
+    const auto declaration = data.substr(0, data.find("?>"));
+    const auto encoding = declaration.find("encoding");
+    if (encoding == std::string_view::npos) {
+        return;
+    }
+    const auto quote = declaration.find_first_of("\"'", encoding);
+    const auto quoteEnd = quote == std::string_view::npos ? quote : declaration.find(declaration[quote], quote + 1);
+    if (quoteEnd == std::string_view::npos) {
+        throw Unexpected{};
+    }
+    const auto name = declaration.substr(quote + 1, quoteEnd - quote - 1);
+    if (QLatin1String(name.data(), static_cast<int>(name.size())).compare(QLatin1String("utf-8"), Qt::CaseInsensitive) != 0) {
+        throw Unexpected{};
+    }
+}
+}
+
+boost::optional<NmlScanner::Document> NmlScanner::parse(const QByteArray & nml) {
+    try {
+        std::string_view data(nml.constData(), static_cast<std::size_t>(nml.size()));
+        if (data.substr(0, 3) == "\xEF\xBB\xBF") {
+            data.remove_prefix(3);
+        }
+        checkEncoding(data);
+        const auto * begin = data.data();
+        const auto * end = begin + data.size();
+
+        // only the direct children of the root are visited here, thing bodies are skipped to their closing tag
+        Cursor cursor{begin, end};
+        Tag tag;
+        std::vector<std::string_view> open;
+        std::vector<std::pair<const char *, const char *>> bodies;
+        while (cursor.next(tag)) {
+            if (tag.closing) {
+                if (open.empty() || open.back() != tag.name) {
+                    throw Unexpected{};
+                }
+                open.pop_back();
+                continue;
+            }
+            if (open.size() == 1 && tag.name == "thing") {
+                bodies.emplace_back(tag.end, tag.selfClosing ? tag.end : thingEnd(tag.end, end));
+                cursor.seek(bodies.back().second);
+            }
+            if (!tag.selfClosing) {
+                open.emplace_back(tag.name);
+            }
+        }
+        if (!open.empty()) {
+            throw Unexpected{};
+        }
+
+        Document document;
+        document.things.resize(bodies.size());
+        std::vector<std::size_t> lineCounts(bodies.size());
+        std::vector<std::uint8_t> parsed(bodies.size(), false);
+        std::vector<std::size_t> thingIndices(bodies.size());
+        std::iota(std::begin(thingIndices), std::end(thingIndices), 0);
+        QtConcurrent::blockingMap(thingIndices, [&document, &bodies, &lineCounts, &parsed](const std::size_t i){
+            try {
+                parseThing(document.things[i], bodies[i].first, bodies[i].second);
+                lineCounts[i] = std::count(bodies[i].first, bodies[i].second, '\n');
+                parsed[i] = true;
+            } catch (const Unexpected &) {}
+        });
+        if (std::find(std::begin(parsed), std::end(parsed), false) != std::end(parsed)) {
+            return boost::none;
+        }
+
+        const auto * copied = nml.constData();
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            document.outline.append(copied, static_cast<int>(bodies[i].first - copied));
+            document.outline.append(static_cast<int>(lineCounts[i]), '\n');// keeps line numbers of QXmlStreamReader errors meaningful
+            copied = bodies[i].second;
+        }
+        document.outline.append(copied, static_cast<int>(nml.constData() + nml.size() - copied));
+        return document;
+    } catch (const Unexpected &) {
+        return boost::none;
+    }
+}
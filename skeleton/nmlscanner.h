@@ -0,0 +1,66 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+#include <QVariantHash>
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/** @brief Reads the <thing> elements of an nml directly from its bytes.
+ *  Things are parsed in parallel into node and edge tables, the remaining document is
+ *  returned as an outline for QXmlStreamReader with the thing bodies blanked out (line numbers are kept).
+ *  Anything unexpected (other encodings, DTDs, CDATA, namespaces, malformed markup) makes parse fail,
+ *  callers then read the original document with QXmlStreamReader. */
+class NmlScanner {
+public:
+    struct Node {// raw attribute values, scaling is up to the caller
+        boost::optional<std::uint64_t> id;
+        boost::optional<double> radius;
+        boost::optional<double> x;
+        boost::optional<double> y;
+        boost::optional<double> z;
+        boost::optional<int> inVP;
+        int inMag{0};
+        std::uint64_t ms{0};
+        QVariantHash properties;
+    };
+    struct Thing {
+        std::vector<Node> nodes;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> edges;
+        QSet<QString> skippedElements;
+    };
+    struct Document {
+        QByteArray outline;
+        std::vector<Thing> things;// in document order
+    };
+
+    static boost::optional<Document> parse(const QByteArray & nml);
+};
@@ -0,0 +1,212 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#include "skeleton/nmlwriter.h"
+
+#include "skeleton/node.h"
+#include "skeleton/tree.h"
+#include "skeleton/treepager.h"
+
+#include <QtConcurrentMap>
+
+#include <charconv>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+namespace {
+class Formatter {
+    QByteArray & out;
+
+public:
+    explicit Formatter(QByteArray & out) : out{out} {}
+
+    void raw(const std::string_view text) {
+        out.append(text.data(), static_cast<int>(text.size()));
+    }
+    void indent(const int level) {// QXmlStreamWriter auto formatting: newline and 4 spaces per level
+        out.append('\n');
+        out.append(4 * level, ' ');
+    }
+    template<typename T>
+    void number(const T value) {
+        char buffer[24];
+        const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+        out.append(buffer, static_cast<int>(result.ptr - buffer));
+    }
+    void number(const double value) {// like QString::number(double): %g with 6 significant digits
+        char buffer[32];
+        const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value, std::chars_format::general, 6);
+        out.append(buffer, static_cast<int>(result.ptr - buffer));
+    }
+    void escaped(const QString & value) {// same escapes as QXmlStreamWriter::writeAttribute
+        for (const char c : value.toUtf8()) {
+            switch (c) {
+            case '<': raw("&lt;"); break;
+            case '>': raw("&gt;"); break;
+            case '&': raw("&amp;"); break;
+            case '"': raw("&quot;"); break;
+            case '\t': raw("&#9;"); break;
+            case '\n': raw("&#10;"); break;
+            case '\r': raw("&#13;"); break;
+            default: out.append(c);
+            }
+        }
+    }
+    template<typename T>
+    void attribute(const std::string_view name, const T value) {
+        raw(" ");
+        raw(name);
+        raw("=\"");
+        number(value);
+        raw("\"");
+    }
+    void properties(const QVariantHash & properties) {
+        for (auto propertyIt = properties.constBegin(); propertyIt != properties.constEnd(); ++propertyIt) {
+            raw(" ");
+            out.append(propertyIt.key().toUtf8());// QXmlStreamWriter does not escape names either
+            raw("=\"");
+            escaped(propertyIt.value().toString());
+            raw("\"");
+        }
+    }
+};
+
+template<typename Node>
+void formatNode(Formatter & xml, const Node & node, const int coordinateOffset) {// resident nodes and paged nodes share the field names
+    xml.indent(3);
+    xml.raw("<node");
+    xml.attribute("id", node.nodeID);
+    xml.attribute("radius", static_cast<double>(node.radius));
+    xml.attribute("x", node.position.x + coordinateOffset);
+    xml.attribute("y", node.position.y + coordinateOffset);
+    xml.attribute("z", node.position.z + coordinateOffset);
+    xml.attribute("inVp", static_cast<int>(node.createdInVp));
+    xml.attribute("inMag", node.createdInMag);
+    xml.attribute("time", node.timestamp);
+    xml.properties(node.properties);
+    xml.raw("/>");
+}
+
+void formatTree(QByteArray & out, const treeListElement & tree, const TreePager::Page * page, const int coordinateOffset) {
+    Formatter xml{out};
+    xml.indent(1);
+    xml.raw("<thing");
+    xml.attribute("id", tree.treeID);
+    xml.attribute("visible", static_cast<int>(tree.render));
+    if (tree.colorSetManually) {
+        xml.attribute("color.r", tree.color.redF());
+        xml.attribute("color.g", tree.color.greenF());
+        xml.attribute("color.b", tree.color.blueF());
+        xml.attribute("color.a", tree.color.alphaF());
+    } else {
+        xml.raw(R"( color.r="-1." color.g="-1." color.b="-1." color.a="1.")");
+    }
+    xml.properties(tree.properties);
+    xml.raw(">");
+
+    xml.indent(2);
+    if (page != nullptr ? page->nodes.empty() : tree.nodes.empty()) {
+        xml.raw("<nodes/>");
+    } else {
+        xml.raw("<nodes>");
+        if (page != nullptr) {
+            for (const auto & node : page->nodes) {
+                formatNode(xml, node, coordinateOffset);
+            }
+        } else {
+            for (const auto & node : tree.nodes) {
+                formatNode(xml, node, coordinateOffset);
+            }
+        }
+        xml.indent(2);
+        xml.raw("</nodes>");
+    }
+
+    xml.indent(2);
+    bool hasEdges{false};
+    const auto edge = [&xml, &hasEdges](const std::uint64_t source, const std::uint64_t target){
+        if (!hasEdges) {
+            xml.raw("<edges>");
+            hasEdges = true;
+        }
+        xml.indent(3);
+        xml.raw("<edge");
+        xml.attribute("source", source);
+        xml.attribute("target", target);
+        xml.raw("/>");
+    };
+    if (page != nullptr) {// pages keep the forward segments in node order
+        for (const auto & segment : page->segments) {
+            edge(segment.first, segment.second);
+        }
+    } else {
+        for (const auto & node : tree.nodes) {
+            for (const auto & segment : node.segments) {
+                if (segment.forward) {
+                    edge(segment.source.nodeID, segment.target.nodeID);
+                }
+            }
+        }
+    }
+    if (hasEdges) {
+        xml.indent(2);
+        xml.raw("</edges>");
+    } else {
+        xml.raw("<edges/>");
+    }
+
+    xml.indent(1);
+    xml.raw("</thing>");
+}
+}
+
+QByteArray NmlWriter::things(const std::list<treeListElement> & trees, const TreePager & pager, const bool onlySelected, const int coordinateOffset) {
+    std::vector<const treeListElement *> treePtrs;
+    for (const auto & tree : trees) {
+        if (!onlySelected || tree.selected) {
+            treePtrs.emplace_back(&tree);
+        }
+    }
+    std::vector<QByteArray> formatted(treePtrs.size());
+    std::vector<std::size_t> treeIndices(treePtrs.size());
+    std::iota(std::begin(treeIndices), std::end(treeIndices), 0);
+    QtConcurrent::blockingMap(treeIndices, [&formatted, &treePtrs, &pager, coordinateOffset](const std::size_t t){
+        const auto & tree = *treePtrs[t];
+        if (pager.contains(tree.treeID)) {// formatted from the page, the tree stays paged out
+            const auto page = pager.peek(tree.treeID);
+            formatted[t].reserve(static_cast<int>(256 + 160 * page.nodes.size()));
+            formatTree(formatted[t], tree, &page, coordinateOffset);
+        } else {
+            formatted[t].reserve(static_cast<int>(256 + 160 * tree.nodes.size()));
+            formatTree(formatted[t], tree, nullptr, coordinateOffset);
+        }
+    });
+    const auto size = std::accumulate(std::begin(formatted), std::end(formatted), 0, [](const int sum, const QByteArray & part){ return sum + part.size(); });
+    QByteArray joined;
+    joined.reserve(size);
+    for (const auto & part : formatted) {
+        joined += part;
+    }
+    return joined;
+}
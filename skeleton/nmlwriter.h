@@ -0,0 +1,41 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+
+#include <list>
+
+class TreePager;
+class treeListElement;
+
+/** @brief Formats the <thing> elements of an nml without QXmlStreamWriter.
+ *  Trees are formatted in parallel into separate buffers and joined in order. The result is byte-identical
+ *  to what an auto formatting QXmlStreamWriter writes inside <things>, so it can be written to the
+ *  device in between two elements of that writer. */
+class NmlWriter {
+public:
+    /** paged out trees are formatted from their pages without paging them in */
+    static QByteArray things(const std::list<treeListElement> & trees, const TreePager & pager, const bool onlySelected, const int coordinateOffset);
+};
@@ -0,0 +1,185 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+#include "skeleton/nodeindex.h"
+
+#include "skeleton/node.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+CoordOfCube NodeIndex::cellOf(const Coordinate & position) {
+    return position.cube({cellLen, cellLen, cellLen});
+}
+
+template<typename Func>
+void NodeIndex::forEachCell(const CoordOfCube & min, const CoordOfCube & max, Func func) const {
+    const auto boxCells = (max.x - min.x + 1.0) * (max.y - min.y + 1.0) * (max.z - min.z + 1.0);
+    if (boxCells > cells.size()) {// fewer occupied cells than cells in the box
+        for (const auto & [cell, nodes] : cells) {
+            if (min.x <= cell.x && cell.x <= max.x && min.y <= cell.y && cell.y <= max.y && min.z <= cell.z && cell.z <= max.z) {
+                func(nodes);
+            }
+        }
+        return;
+    }
+    for (int z = min.z; z <= max.z; ++z)
+    for (int y = min.y; y <= max.y; ++y)
+    for (int x = min.x; x <= max.x; ++x) {
+        const auto it = cells.find({x, y, z});
+        if (it != std::end(cells)) {
+            func(it->second);
+        }
+    }
+}
+
+void NodeIndex::insert(nodeListElement & node) {
+    const auto cell = cellOf(node.position);
+    cells[cell].emplace_back(&node);
+    updateRadius(node);
+    if (nodeCount++ == 0) {
+        minCell = maxCell = cell;
+    } else {
+        minCell = {std::min(minCell.x, cell.x), std::min(minCell.y, cell.y), std::min(minCell.z, cell.z)};
+        maxCell = {std::max(maxCell.x, cell.x), std::max(maxCell.y, cell.y), std::max(maxCell.z, cell.z)};
+    }
+}
+
+void NodeIndex::remove(nodeListElement & node, const CoordOfCube & cell) {
+    auto cellIt = cells.find(cell);
+    if (cellIt == std::end(cells)) {
+        return;
+    }
+    auto & nodes = cellIt->second;
+    auto nodeIt = std::find(std::begin(nodes), std::end(nodes), &node);
+    if (nodeIt != std::end(nodes)) {
+        *nodeIt = nodes.back();
+        nodes.pop_back();
+        --nodeCount;
+    }
+    if (nodes.empty()) {
+        cells.erase(cellIt);
+    }
+}
+
+void NodeIndex::erase(nodeListElement & node) {
+    remove(node, cellOf(node.position));
+}
+
+void NodeIndex::move(nodeListElement & node, const Coordinate & oldPosition) {
+    if (cellOf(oldPosition) != cellOf(node.position)) {
+        remove(node, cellOf(oldPosition));
+        insert(node);
+    }
+}
+
+void NodeIndex::updateRadius(const nodeListElement & node) {
+    maxRadius = std::max(maxRadius, node.radius);
+}
+
+void NodeIndex::clear() {
+    cells.clear();
+    nodeCount = 0;
+    maxRadius = 0;
+}
+
+std::vector<nodeListElement *> NodeIndex::nearest(const Coordinate & position, const std::size_t k, const std::function<bool(const nodeListElement &)> & filter) const {
+    if (k == 0 || cells.empty()) {
+        return {};
+    }
+    std::priority_queue<std::pair<float, nodeListElement *>> best;// the k nearest so far, farthest on top
+    const auto consider = [&best, &filter, &position, k](const std::vector<nodeListElement *> & nodes){
+        for (auto * node : nodes) {
+            if (filter && !filter(*node)) {
+                continue;
+            }
+            const auto distance = floatCoordinate(position - node->position).length();
+            if (best.size() < k) {
+                best.emplace(distance, node);
+            } else if (distance < best.top().first) {
+                best.pop();
+                best.emplace(distance, node);
+            }
+        }
+    };
+    const auto center = cellOf(position);
+    for (int r = 0;; ++r) {// search shells of cells around the center
+        const auto shellCells = std::pow(2 * r + 1, 3) - (r > 0 ? std::pow(2 * r - 1, 3) : 0);
+        if (shellCells > cells.size()) {// sparse surroundings, visit the remaining occupied cells directly
+            for (const auto & [cell, nodes] : cells) {
+                const auto offset = cell - center;
+                if (std::max({std::abs(offset.x), std::abs(offset.y), std::abs(offset.z)}) >= r) {
+                    consider(nodes);
+                }
+            }
+            break;
+        }
+        for (int z = -r; z <= r; ++z)
+        for (int y = -r; y <= r; ++y)
+        for (int x = -r; x <= r; x += (std::abs(z) == r || std::abs(y) == r) ? 1 : 2 * r) {
+            const auto it = cells.find(center + CoordOfCube{x, y, z});
+            if (it != std::end(cells)) {
+                consider(it->second);
+            }
+        }
+        const auto lower = (center - r).cube2Global({cellLen, cellLen, cellLen});
+        const auto upper = (center + (r + 1)).cube2Global({cellLen, cellLen, cellLen});
+        const auto border = std::min({position.x - lower.x, position.y - lower.y, position.z - lower.z, upper.x - position.x, upper.y - position.y, upper.z - position.z});
+        const bool searchedAll = center.x - r <= minCell.x && center.y - r <= minCell.y && center.z - r <= minCell.z
+                && maxCell.x <= center.x + r && maxCell.y <= center.y + r && maxCell.z <= center.z + r;
+        if (searchedAll || (best.size() == k && best.top().first <= border)) {// unvisited cells are farther away
+            break;
+        }
+    }
+    std::vector<nodeListElement *> result(best.size());
+    for (auto i = result.size(); i-- > 0; best.pop()) {
+        result[i] = best.top().second;
+    }
+    return result;
+}
+
+std::vector<nodeListElement *> NodeIndex::withinRadius(const Coordinate & position, const float radius) const {
+    std::vector<nodeListElement *> result;
+    const auto extent = static_cast<int>(std::ceil(radius));
+    forEachCell(cellOf(position - extent), cellOf(position + extent), [&result, &position, radius](const auto & nodes){
+        for (auto * node : nodes) {
+            if (floatCoordinate(position - node->position).length() <= radius) {
+                result.emplace_back(node);
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<nodeListElement *> NodeIndex::inBox(const Coordinate & min, const Coordinate & max) const {
+    std::vector<nodeListElement *> result;
+    forEachCell(cellOf(min), cellOf(max), [&result, &min, &max](const auto & nodes){
+        for (auto * node : nodes) {
+            const auto & pos = node->position;
+            if (min.x <= pos.x && pos.x <= max.x && min.y <= pos.y && pos.y <= max.y && min.z <= pos.z && pos.z <= max.z) {
+                result.emplace_back(node);
+            }
+        }
+    });
+    return result;
+}
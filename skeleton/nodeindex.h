@@ -0,0 +1,56 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class nodeListElement;
+
+/** @brief Uniform grid over node positions, so proximity queries don’t iterate all trees. */
+class NodeIndex {
+    static constexpr int cellLen{128};
+    std::unordered_map<CoordOfCube, std::vector<nodeListElement *>> cells;
+    std::size_t nodeCount{0};
+    CoordOfCube minCell, maxCell;// bounds of all cells that were occupied since the last clear
+    float maxRadius{0};// largest node radius seen since the last clear
+    static CoordOfCube cellOf(const Coordinate & position);
+    template<typename Func>
+    void forEachCell(const CoordOfCube & min, const CoordOfCube & max, Func func) const;
+    void remove(nodeListElement & node, const CoordOfCube & cell);
+public:
+    void insert(nodeListElement & node);
+    void erase(nodeListElement & node);
+    void move(nodeListElement & node, const Coordinate & oldPosition);
+    void updateRadius(const nodeListElement & node);
+    void clear();
+    std::size_t size() const { return nodeCount; }
+    float radiusBound() const { return maxRadius; }
+
+    std::vector<nodeListElement *> nearest(const Coordinate & position, const std::size_t k = 1, const std::function<bool(const nodeListElement &)> & filter = {}) const;
+    std::vector<nodeListElement *> withinRadius(const Coordinate & position, const float radius) const;
+    std::vector<nodeListElement *> inBox(const Coordinate & min, const Coordinate & max) const;
+};
@@ -0,0 +1,140 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#include "skeleton/skeletonanalytics.h"
+
+#include "skeleton/skeletoncolumns.h"
+
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace {
+constexpr auto unvisited = std::numeric_limits<std::uint32_t>::max();
+
+void analyzeTree(const SkeletonColumns & columns, const floatCoordinate & scale, const SkeletonColumns::Tree & columnTree, SkeletonAnalytics::Tree & tree, SkeletonAnalytics::Nodes & nodes) {
+    const auto first = columnTree.firstNode;
+    const auto end = first + columnTree.nodeCount;
+    const auto inTree = [first, end](const std::uint32_t index){ return index >= first && index < end; };
+    const auto distance = [&columns, &scale](const std::uint32_t lhs, const std::uint32_t rhs){
+        return floatCoordinate{columns.positions[lhs] - columns.positions[rhs]}.componentMul(scale).length();
+    };
+    tree.treeID = columnTree.treeID;
+    tree.nodeCount = columnTree.nodeCount;
+    std::vector<std::uint32_t> childCounts(columnTree.nodeCount);
+    std::vector<std::uint32_t> order;// pre order, parents before their children
+    order.reserve(columnTree.nodeCount);
+    std::vector<std::uint32_t> stack;
+    const auto explore = [&](const std::uint32_t root){
+        ++tree.componentCount;
+        nodes.parents[root] = root;
+        nodes.branchOrders[root] = 0;
+        nodes.pathLengths[root] = 0;
+        stack.emplace_back(root);
+        while (!stack.empty()) {
+            const auto index = stack.back();
+            stack.pop_back();
+            order.emplace_back(index);
+            const auto neighbors = columns.neighbors(index);
+            std::uint32_t degree{0};
+            for (auto it = neighbors.first; it != neighbors.second; ++it) {
+                if (!inTree(*it)) {
+                    continue;
+                }
+                ++degree;
+                if (index < *it) {// each segment once
+                    ++tree.segmentCount;
+                    tree.cableLength += distance(index, *it);
+                }
+                if (nodes.parents[*it] == unvisited) {
+                    nodes.parents[*it] = index;
+                    ++childCounts[index - first];
+                    stack.emplace_back(*it);
+                }
+            }
+            tree.branchPointCount += degree > 2;
+            tree.endPointCount += degree == 1;
+        }
+    };
+    const auto inTreeDegree = [&columns, &inTree](const std::uint32_t index){
+        const auto neighbors = columns.neighbors(index);
+        return std::count_if(neighbors.first, neighbors.second, inTree);
+    };
+    for (auto root = first; root < end; ++root) {// root every component at an end node, so orders and path lengths run from a tip
+        if (nodes.parents[root] == unvisited && inTreeDegree(root) <= 1) {
+            explore(root);
+        }
+    }
+    for (auto root = first; root < end; ++root) {// components without an end node are left, they consist of cycles
+        if (nodes.parents[root] == unvisited) {
+            explore(root);
+        }
+    }
+    tree.cycleCount = tree.segmentCount + tree.componentCount - tree.nodeCount;
+    for (const auto index : order) {// parents are final before their children
+        const auto parent = nodes.parents[index];
+        if (parent != index) {
+            nodes.branchOrders[index] = nodes.branchOrders[parent] + (childCounts[parent - first] > 1);
+            nodes.pathLengths[index] = nodes.pathLengths[parent] + distance(parent, index);
+        }
+        tree.maxBranchOrder = std::max(tree.maxBranchOrder, nodes.branchOrders[index]);
+        tree.maxPathLength = std::max(tree.maxPathLength, nodes.pathLengths[index]);
+    }
+    std::vector<std::uint32_t> maxChildOrders(columnTree.nodeCount, 0), maxChildOrderCounts(columnTree.nodeCount, 0);
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {// children before their parents
+        const auto local = *it - first;
+        const auto strahler = childCounts[local] == 0 ? 1 : maxChildOrders[local] + (maxChildOrderCounts[local] > 1);
+        nodes.strahlerOrders[*it] = strahler;
+        const auto parent = nodes.parents[*it];
+        if (parent == *it) {
+            tree.strahlerOrder = std::max(tree.strahlerOrder, strahler);
+            continue;
+        }
+        auto & parentMax = maxChildOrders[parent - first];
+        if (strahler > parentMax) {
+            parentMax = strahler;
+            maxChildOrderCounts[parent - first] = 1;
+        } else if (strahler == parentMax) {
+            ++maxChildOrderCounts[parent - first];
+        }
+    }
+}
+}
+
+SkeletonAnalytics::Report SkeletonAnalytics::analyze(const SkeletonColumns & columns, const floatCoordinate & scale) {
+    Report report;
+    report.trees.resize(columns.trees.size());
+    report.nodes.parents.assign(columns.nodeCount(), unvisited);
+    report.nodes.branchOrders.resize(columns.nodeCount());
+    report.nodes.strahlerOrders.resize(columns.nodeCount());
+    report.nodes.pathLengths.resize(columns.nodeCount());
+    std::vector<std::size_t> treeIndices(columns.trees.size());
+    std::iota(std::begin(treeIndices), std::end(treeIndices), 0);
+    QtConcurrent::blockingMap(treeIndices, [&columns, &scale, &report](const std::size_t i){// trees own disjoint node ranges
+        analyzeTree(columns, scale, columns.trees[i], report.trees[i], report.nodes);
+    });
+    return report;
+}
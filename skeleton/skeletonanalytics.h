@@ -0,0 +1,62 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <cstdint>
+#include <vector>
+
+class SkeletonColumns;
+
+/** @brief Graph measures of all trees, computed in parallel on the CSR adjacency of a column snapshot.
+ *  Each connected component is rooted at an end node (any node if it has none), segments to other trees are ignored. */
+class SkeletonAnalytics {
+public:
+    struct Tree {
+        std::uint64_t treeID;
+        std::uint32_t nodeCount{0};
+        std::uint32_t segmentCount{0};
+        std::uint32_t componentCount{0};
+        std::uint32_t cycleCount{0};// independent cycles: segments - nodes + components
+        std::uint32_t branchPointCount{0};// degree > 2
+        std::uint32_t endPointCount{0};// degree 1
+        std::uint32_t maxBranchOrder{0};
+        std::uint32_t strahlerOrder{0};// highest Strahler order of its components
+        double cableLength{0};// physical units of the dataset scale
+        double maxPathLength{0};// longest root distance
+    };
+    struct Nodes {// indexed like the node columns
+        std::vector<std::uint32_t> parents;// own index for roots
+        std::vector<std::uint32_t> branchOrders;
+        std::vector<std::uint32_t> strahlerOrders;
+        std::vector<double> pathLengths;// distance to the root along the skeleton
+    };
+    struct Report {
+        std::vector<Tree> trees;
+        Nodes nodes;
+    };
+    static Report analyze(const SkeletonColumns & columns, const floatCoordinate & scale);
+};
@@ -0,0 +1,527 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#include "skeleton/skeletoncolumns.h"
+
+#include "skeleton/node.h"
+#include "skeleton/tree.h"
+#include "skeleton/treepager.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+void SkeletonColumns::resize(const std::size_t nodeCount) {
+    nodeIDs.resize(nodeCount);
+    positions.resize(nodeCount);
+    radii.resize(nodeCount);
+    timestamps.resize(nodeCount);
+    createdInMags.resize(nodeCount);
+    createdInVps.resize(nodeCount);
+    treeIndices.resize(nodeCount);
+    edgeOffsets.assign(nodeCount + 1, 0);
+}
+
+SkeletonColumns SkeletonColumns::fromTrees(const std::list<treeListElement> & trees, const TreePager & pager, const QSet<QString> & numberProperties) {
+    SkeletonColumns columns;
+    std::vector<const treeListElement *> treePtrs;
+    std::size_t nodeCount{0};
+    for (const auto & tree : trees) {
+        const auto * entry = pager.entry(tree.treeID);
+        const auto treeNodeCount = entry != nullptr ? entry->nodeCount : tree.nodes.size();
+        columns.trees.push_back({tree.treeID, static_cast<std::uint32_t>(nodeCount), static_cast<std::uint32_t>(treeNodeCount), tree.color, tree.colorSetManually, tree.render, tree.properties});
+        treePtrs.emplace_back(&tree);
+        nodeCount += treeNodeCount;
+    }
+    columns.resize(nodeCount);
+    QHash<QString, std::vector<double> *> numberColumns;// stable pointers for the concurrent writers
+    for (const auto & name : numberProperties) {
+        columns.numberColumns[name].assign(nodeCount, std::numeric_limits<double>::quiet_NaN());
+    }
+    for (auto it = std::begin(columns.numberColumns); it != std::end(columns.numberColumns); ++it) {
+        numberColumns[it.key()] = &it.value();
+    }
+
+    std::vector<std::size_t> treeIndices(treePtrs.size());
+    std::iota(std::begin(treeIndices), std::end(treeIndices), 0);
+    std::vector<std::unordered_map<const nodeListElement *, std::uint32_t>> localIndices(treePtrs.size());
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> pagedSegments(treePtrs.size());// node indices of the segments of paged out trees
+    std::vector<QHash<QString, std::vector<std::pair<std::uint32_t, QString>>>> localTexts(treePtrs.size());
+    // every tree fills its own range of the node columns
+    QtConcurrent::blockingMap(treeIndices, [&columns, &treePtrs, &pager, &numberColumns, &localIndices, &pagedSegments, &localTexts](const std::size_t t){
+        auto index = columns.trees[t].firstNode;
+        const auto fill = [&columns, &numberColumns, &localTexts, t, &index](const auto & node, const std::size_t degree){
+            columns.nodeIDs[index] = node.nodeID;
+            columns.positions[index] = node.position;
+            columns.radii[index] = node.radius;
+            columns.timestamps[index] = node.timestamp;
+            columns.createdInMags[index] = node.createdInMag;
+            columns.createdInVps[index] = static_cast<std::uint8_t>(node.createdInVp);
+            columns.treeIndices[index] = static_cast<std::uint32_t>(t);
+            columns.edgeOffsets[index + 1] = degree;
+            for (auto it = std::cbegin(node.properties); it != std::cend(node.properties); ++it) {
+                if (auto * column = numberColumns.value(it.key(), nullptr)) {
+                    (*column)[index] = it.value().toDouble();
+                } else {
+                    localTexts[t][it.key()].emplace_back(index, it.value().toString());
+                }
+            }
+            ++index;
+        };
+        const auto & tree = *treePtrs[t];
+        if (pager.contains(tree.treeID)) {// read from the page, the tree stays paged out
+            const auto page = pager.peek(tree.treeID);
+            std::unordered_map<std::uint64_t, std::uint32_t> indexByNodeID;
+            for (std::size_t i = 0; i < page.nodes.size(); ++i) {
+                indexByNodeID.emplace(page.nodes[i].nodeID, static_cast<std::uint32_t>(columns.trees[t].firstNode + i));
+            }
+            std::vector<std::size_t> degrees(page.nodes.size());
+            for (const auto & segment : page.segments) {// paged out trees have no segments to other trees
+                const auto source = indexByNodeID.at(segment.first);
+                const auto target = indexByNodeID.at(segment.second);
+                pagedSegments[t].emplace_back(source, target);
+                ++degrees[source - columns.trees[t].firstNode];
+                ++degrees[target - columns.trees[t].firstNode];
+            }
+            for (std::size_t i = 0; i < page.nodes.size(); ++i) {
+                fill(page.nodes[i], degrees[i]);
+            }
+            return;
+        }
+        auto & local = localIndices[t];
+        local.reserve(tree.nodes.size());
+        for (const auto & residentNode : tree.nodes) {
+            local.emplace(&residentNode, index);
+            fill(residentNode, residentNode.segments.size());
+        }
+    });
+    std::partial_sum(std::begin(columns.edgeOffsets), std::end(columns.edgeOffsets), std::begin(columns.edgeOffsets));
+    columns.sortByNodeID();
+
+    columns.edgeTargets.resize(columns.edgeOffsets.back());
+    columns.edgeForward.resize(columns.edgeOffsets.back());
+    QtConcurrent::blockingMap(treeIndices, [&columns, &treePtrs, &localIndices, &pagedSegments](const std::size_t t){
+        if (!pagedSegments[t].empty()) {
+            std::unordered_map<std::uint32_t, std::uint64_t> edges;// next free edge per node
+            const auto add = [&columns, &edges](const std::uint32_t index, const std::uint32_t neighbor, const bool forward){
+                auto & edge = edges.emplace(index, columns.edgeOffsets[index]).first->second;
+                columns.edgeTargets[edge] = neighbor;
+                columns.edgeForward[edge] = forward;
+                ++edge;
+            };
+            for (const auto & segment : pagedSegments[t]) {
+                add(segment.first, segment.second, true);
+                add(segment.second, segment.first, false);
+            }
+            return;
+        }
+        const auto & local = localIndices[t];
+        auto index = columns.trees[t].firstNode;
+        for (const auto & node : treePtrs[t]->nodes) {
+            auto edge = columns.edgeOffsets[index];
+            for (const auto & segment : node.segments) {
+                const auto & neighbor = segment.forward ? segment.target : segment.source;
+                const auto localIt = local.find(&neighbor);
+                columns.edgeTargets[edge] = localIt != std::end(local) ? localIt->second : columns.indexOf(neighbor.nodeID).get();// segments may connect trees
+                columns.edgeForward[edge] = segment.forward;
+                ++edge;
+            }
+            ++index;
+        }
+    });
+    for (const auto & texts : localTexts) {// trees are in node order, so the sparse columns stay ordered
+        for (auto it = std::cbegin(texts); it != std::cend(texts); ++it) {
+            auto & column = columns.textColumns[it.key()];
+            column.insert(std::end(column), std::begin(it.value()), std::end(it.value()));
+        }
+    }
+    return columns;
+}
+
+void SkeletonColumns::sortByNodeID() {
+    byNodeID.resize(nodeIDs.size());
+    std::iota(std::begin(byNodeID), std::end(byNodeID), 0);
+    std::sort(std::begin(byNodeID), std::end(byNodeID), [this](const auto lhs, const auto rhs){
+        return nodeIDs[lhs] < nodeIDs[rhs];
+    });
+}
+
+std::pair<const std::uint32_t *, const std::uint32_t *> SkeletonColumns::neighbors(const std::uint32_t index) const {
+    return {edgeTargets.data() + edgeOffsets[index], edgeTargets.data() + edgeOffsets[index + 1]};
+}
+
+boost::optional<std::uint32_t> SkeletonColumns::indexOf(const std::uint64_t nodeID) const {
+    const auto it = std::lower_bound(std::begin(byNodeID), std::end(byNodeID), nodeID, [this](const auto index, const auto id){
+        return nodeIDs[index] < id;
+    });
+    if (it != std::end(byNodeID) && nodeIDs[*it] == nodeID) {
+        return *it;
+    }
+    return boost::none;
+}
+
+boost::optional<QString> SkeletonColumns::text(const QString & property, const std::uint32_t index) const {
+    const auto columnIt = textColumns.constFind(property);
+    if (columnIt == std::cend(textColumns)) {
+        return boost::none;
+    }
+    const auto & column = columnIt.value();
+    const auto it = std::lower_bound(std::begin(column), std::end(column), index, [](const auto & entry, const auto value){
+        return entry.first < value;
+    });
+    if (it != std::end(column) && it->first == index) {
+        return it->second;
+    }
+    return boost::none;
+}
+
+std::size_t SkeletonColumns::memoryUsage() const {
+    const auto bytes = [](const auto & vector){
+        return vector.capacity() * sizeof(vector.front());
+    };
+    auto usage = bytes(trees) + bytes(nodeIDs) + bytes(positions) + bytes(radii) + bytes(timestamps) + bytes(createdInMags)
+            + bytes(createdInVps) + bytes(treeIndices) + bytes(edgeOffsets) + bytes(edgeTargets) + bytes(edgeForward) + bytes(byNodeID);
+    for (const auto & column : numberColumns) {
+        usage += bytes(column);
+    }
+    for (const auto & column : textColumns) {
+        usage += bytes(column);
+        for (const auto & entry : column) {
+            usage += static_cast<std::size_t>(entry.second.capacity()) * sizeof(QChar);
+        }
+    }
+    return usage;
+}
+
+namespace {
+// file layout: magic, version, chunk size, tree table, then the columns, each as row count and its compressed chunks.
+// fixed size values are stored in the host’s (little endian) byte order
+const QByteArray columnsMagic{"KNOSSOS skeleton columns"};
+constexpr quint32 columnsVersion{1};
+constexpr std::size_t chunkRows{1 << 16};
+
+std::size_t chunkCount(const std::size_t rows) {
+    return (rows + chunkRows - 1) / chunkRows;
+}
+
+template<typename Serialize>
+void writeChunks(QDataStream & stream, const std::size_t rows, Serialize serialize) {
+    std::vector<std::size_t> chunkIndices(chunkCount(rows));
+    std::iota(std::begin(chunkIndices), std::end(chunkIndices), 0);
+    std::vector<QByteArray> chunks(chunkIndices.size());
+    QtConcurrent::blockingMap(chunkIndices, [&chunks, &serialize, rows](const std::size_t c){
+        chunks[c] = qCompress(serialize(c * chunkRows, std::min(rows, (c + 1) * chunkRows)), 3);
+    });
+    stream << static_cast<quint64>(rows) << static_cast<quint32>(chunks.size());
+    for (const auto & chunk : chunks) {
+        stream << static_cast<quint32>(chunk.size());
+        stream.writeRawData(chunk.constData(), chunk.size());
+    }
+}
+
+template<typename T>
+void writeColumn(QDataStream & stream, const std::vector<T> & column) {
+    writeChunks(stream, column.size(), [&column](const std::size_t begin, const std::size_t end){
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(column.data() + begin), static_cast<int>((end - begin) * sizeof(T)));
+    });
+}
+
+void writeTexts(QDataStream & stream, const std::vector<std::pair<std::uint32_t, QString>> & column) {
+    std::vector<std::uint32_t> indices(column.size());
+    std::transform(std::begin(column), std::end(column), std::begin(indices), [](const auto & entry){ return entry.first; });
+    writeColumn(stream, indices);
+    writeChunks(stream, column.size(), [&column](const std::size_t begin, const std::size_t end){
+        QByteArray chunk;
+        QDataStream chunkStream(&chunk, QIODevice::WriteOnly);
+        chunkStream << static_cast<quint32>(end - begin);
+        for (auto i = begin; i < end; ++i) {
+            chunkStream << column[i].second;
+        }
+        return chunk;
+    });
+}
+
+/** collects the compressed chunks of a mapped file, they are decompressed together afterwards */
+class ChunkReader {
+    QDataStream & stream;
+    const char * const base;
+public:
+    struct Chunk {
+        const char * data;
+        quint32 size;
+        std::size_t firstRow;
+        std::size_t rows;
+        char * destination;// fixed size values
+        std::size_t elementSize;
+        std::vector<std::pair<std::uint32_t, QString>> * texts;// or strings
+    };
+    std::vector<Chunk> chunks;
+
+    ChunkReader(QDataStream & stream, const char * base) : stream{stream}, base{base} {}
+
+    template<typename Add>
+    std::size_t read(Add add) {
+        quint64 rows;
+        quint32 count;
+        stream >> rows >> count;
+        if (stream.status() != QDataStream::Ok || count != chunkCount(rows)) {
+            throw std::runtime_error("skeleton columns: corrupt column header");
+        }
+        add(rows);
+        for (std::size_t c = 0; c < count; ++c) {
+            quint32 size;
+            stream >> size;
+            const auto offset = stream.device()->pos();
+            if (stream.skipRawData(static_cast<int>(size)) != static_cast<int>(size)) {
+                throw std::runtime_error("skeleton columns: truncated chunk");
+            }
+            chunks.push_back({base + offset, size, c * chunkRows, std::min<std::size_t>(chunkRows, rows - c * chunkRows), nullptr, 0, nullptr});
+        }
+        return rows;
+    }
+    template<typename T>
+    void column(std::vector<T> & column) {
+        const auto first = chunks.size();
+        read([&column](const std::size_t rows){ column.resize(rows); });
+        for (auto i = first; i < chunks.size(); ++i) {
+            chunks[i].destination = reinterpret_cast<char *>(column.data() + chunks[i].firstRow);
+            chunks[i].elementSize = sizeof(T);
+        }
+    }
+    void texts(std::vector<std::uint32_t> & indices, std::vector<std::pair<std::uint32_t, QString>> & texts) {
+        column(indices);
+        const auto first = chunks.size();
+        const auto rows = read([&texts](const std::size_t rows){ texts.resize(rows); });
+        if (rows != indices.size()) {
+            throw std::runtime_error("skeleton columns: text column size mismatch");
+        }
+        for (auto i = first; i < chunks.size(); ++i) {
+            chunks[i].texts = &texts;
+        }
+    }
+};
+}
+
+void SkeletonColumns::write(QIODevice & device) const {
+    std::vector<std::int32_t> xs(nodeCount()), ys(nodeCount()), zs(nodeCount());
+    for (std::size_t i = 0; i < nodeCount(); ++i) {
+        std::tie(xs[i], ys[i], zs[i]) = std::make_tuple(positions[i].x, positions[i].y, positions[i].z);
+    }
+    std::vector<std::uint32_t> sources, targets;// forward edges only, the adjacency is rebuilt on read
+    sources.reserve(segmentCount());
+    targets.reserve(segmentCount());
+    for (std::uint32_t i = 0; i < nodeCount(); ++i) {
+        for (auto edge = edgeOffsets[i]; edge < edgeOffsets[i + 1]; ++edge) {
+            if (edgeForward[edge]) {
+                sources.emplace_back(i);
+                targets.emplace_back(edgeTargets[edge]);
+            }
+        }
+    }
+
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.writeRawData(columnsMagic.constData(), columnsMagic.size());
+    stream << columnsVersion << static_cast<quint32>(chunkRows);
+    stream << static_cast<quint32>(trees.size());
+    for (const auto & tree : trees) {
+        stream << static_cast<quint64>(tree.treeID) << tree.firstNode << tree.nodeCount << tree.color << tree.colorSetManually << tree.render << tree.properties;
+    }
+    writeColumn(stream, nodeIDs);
+    writeColumn(stream, xs);
+    writeColumn(stream, ys);
+    writeColumn(stream, zs);
+    writeColumn(stream, radii);
+    writeColumn(stream, timestamps);
+    writeColumn(stream, createdInMags);
+    writeColumn(stream, createdInVps);
+    writeColumn(stream, sources);
+    writeColumn(stream, targets);
+    stream << static_cast<quint32>(numberColumns.size());
+    for (auto it = std::cbegin(numberColumns); it != std::cend(numberColumns); ++it) {
+        stream << it.key();
+        writeColumn(stream, it.value());
+    }
+    stream << static_cast<quint32>(textColumns.size());
+    for (auto it = std::cbegin(textColumns); it != std::cend(textColumns); ++it) {
+        stream << it.key();
+        writeTexts(stream, it.value());
+    }
+    if (stream.status() != QDataStream::Ok) {
+        throw std::runtime_error("skeleton columns: write failed");
+    }
+}
+
+SkeletonColumns SkeletonColumns::read(QIODevice & device) {
+    if (!device.isOpen() && !device.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("skeleton columns: open failed");
+    }
+    auto * file = qobject_cast<QFile *>(&device);
+    auto * map = file != nullptr ? file->map(0, file->size()) : nullptr;
+    const auto data = map != nullptr ? QByteArray::fromRawData(reinterpret_cast<const char *>(map), static_cast<int>(file->size())) : device.readAll();
+    const auto unmap = [file, map](){
+        if (map != nullptr) {
+            file->unmap(map);
+        }
+    };
+    try {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        QDataStream stream(&buffer);
+        stream.setVersion(QDataStream::Qt_5_0);
+        QByteArray magic(columnsMagic.size(), '\0');
+        quint32 version, rows, treeCount;
+        stream.readRawData(magic.data(), magic.size());
+        stream >> version >> rows >> treeCount;
+        if (magic != columnsMagic || version != columnsVersion || rows != chunkRows || stream.status() != QDataStream::Ok) {
+            throw std::runtime_error("skeleton columns: unsupported file");
+        }
+        SkeletonColumns columns;
+        columns.trees.resize(treeCount);
+        for (auto & tree : columns.trees) {
+            quint64 treeID;
+            stream >> treeID >> tree.firstNode >> tree.nodeCount >> tree.color >> tree.colorSetManually >> tree.render >> tree.properties;
+            tree.treeID = treeID;
+        }
+
+        ChunkReader reader(stream, data.constData());
+        std::vector<std::int32_t> xs, ys, zs;
+        std::vector<std::uint32_t> sources, targets;
+        reader.column(columns.nodeIDs);
+        reader.column(xs);
+        reader.column(ys);
+        reader.column(zs);
+        reader.column(columns.radii);
+        reader.column(columns.timestamps);
+        reader.column(columns.createdInMags);
+        reader.column(columns.createdInVps);
+        reader.column(sources);
+        reader.column(targets);
+        quint32 numberCount, textCount;
+        stream >> numberCount;
+        std::vector<std::pair<QString, std::vector<double>>> numbers(numberCount);
+        for (auto & number : numbers) {
+            stream >> number.first;
+            reader.column(number.second);
+        }
+        stream >> textCount;
+        std::vector<std::pair<QString, std::vector<std::pair<std::uint32_t, QString>>>> texts(textCount);
+        std::vector<std::vector<std::uint32_t>> textIndices(textCount);
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            stream >> texts[i].first;
+            reader.texts(textIndices[i], texts[i].second);
+        }
+        if (stream.status() != QDataStream::Ok) {
+            throw std::runtime_error("skeleton columns: truncated file");
+        }
+
+        std::vector<std::uint8_t> failed(reader.chunks.size(), false);
+        std::vector<std::size_t> chunkIndices(reader.chunks.size());
+        std::iota(std::begin(chunkIndices), std::end(chunkIndices), 0);
+        QtConcurrent::blockingMap(chunkIndices, [&reader, &failed](const std::size_t c){
+            const auto & chunk = reader.chunks[c];
+            const auto raw = qUncompress(reinterpret_cast<const uchar *>(chunk.data), static_cast<int>(chunk.size));
+            if (chunk.texts == nullptr) {
+                const auto bytes = chunk.rows * chunk.elementSize;
+                failed[c] = static_cast<std::size_t>(raw.size()) != bytes;
+                if (!failed[c]) {
+                    std::memcpy(chunk.destination, raw.constData(), bytes);
+                }
+                return;
+            }
+            QDataStream chunkStream(raw);
+            quint32 count;
+            chunkStream >> count;
+            failed[c] = count != chunk.rows;
+            for (std::size_t i = 0; !failed[c] && i < count; ++i) {
+                chunkStream >> (*chunk.texts)[chunk.firstRow + i].second;
+            }
+            failed[c] = failed[c] || chunkStream.status() != QDataStream::Ok;
+        });
+        if (std::find(std::begin(failed), std::end(failed), true) != std::end(failed)) {
+            throw std::runtime_error("skeleton columns: corrupt chunk");
+        }
+
+        const auto nodeCount = columns.nodeIDs.size();
+        if (xs.size() != nodeCount || ys.size() != nodeCount || zs.size() != nodeCount || columns.radii.size() != nodeCount || columns.timestamps.size() != nodeCount
+                || columns.createdInMags.size() != nodeCount || columns.createdInVps.size() != nodeCount || sources.size() != targets.size()) {
+            throw std::runtime_error("skeleton columns: column size mismatch");
+        }
+        columns.positions.resize(nodeCount);
+        columns.treeIndices.resize(nodeCount);
+        for (std::size_t i = 0; i < nodeCount; ++i) {
+            columns.positions[i] = {xs[i], ys[i], zs[i]};
+        }
+        for (std::size_t t = 0; t < columns.trees.size(); ++t) {
+            const auto & tree = columns.trees[t];
+            if (static_cast<std::size_t>(tree.firstNode) + tree.nodeCount > nodeCount) {
+                throw std::runtime_error("skeleton columns: tree out of range");
+            }
+            std::fill_n(std::begin(columns.treeIndices) + tree.firstNode, tree.nodeCount, static_cast<std::uint32_t>(t));
+        }
+        columns.edgeOffsets.assign(nodeCount + 1, 0);
+        for (std::size_t e = 0; e < sources.size(); ++e) {
+            if (sources[e] >= nodeCount || targets[e] >= nodeCount) {
+                throw std::runtime_error("skeleton columns: edge out of range");
+            }
+            ++columns.edgeOffsets[sources[e] + 1];
+            ++columns.edgeOffsets[targets[e] + 1];
+        }
+        std::partial_sum(std::begin(columns.edgeOffsets), std::end(columns.edgeOffsets), std::begin(columns.edgeOffsets));
+        columns.edgeTargets.resize(columns.edgeOffsets.back());
+        columns.edgeForward.resize(columns.edgeOffsets.back());
+        auto fill = columns.edgeOffsets;
+        for (std::size_t e = 0; e < sources.size(); ++e) {
+            columns.edgeTargets[fill[sources[e]]] = targets[e];
+            columns.edgeForward[fill[sources[e]]++] = true;
+            columns.edgeTargets[fill[targets[e]]] = sources[e];
+            columns.edgeForward[fill[targets[e]]++] = false;
+        }
+        for (auto & number : numbers) {
+            columns.numberColumns[number.first] = std::move(number.second);
+        }
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            auto & column = texts[i].second;
+            for (std::size_t row = 0; row < column.size(); ++row) {
+                column[row].first = textIndices[i][row];
+            }
+            columns.textColumns[texts[i].first] = std::move(column);
+        }
+        columns.sortByNodeID();
+        unmap();
+        return columns;
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
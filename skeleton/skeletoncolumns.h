@@ -0,0 +1,92 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include "coordinate.h"
+
+#include <QColor>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVariantHash>
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <list>
+#include <utility>
+#include <vector>
+
+class QIODevice;
+class TreePager;
+class treeListElement;
+
+/** @brief Compact snapshot of a skeleton: node attributes in contiguous columns, adjacency in CSR form
+ *  and properties in columnar side tables. The pointer based trees stay the editable model. */
+class SkeletonColumns {
+public:
+    struct Tree {
+        std::uint64_t treeID;
+        std::uint32_t firstNode;// nodes of a tree are contiguous
+        std::uint32_t nodeCount;
+        QColor color;
+        bool colorSetManually;
+        bool render;
+        QVariantHash properties;
+    };
+    std::vector<Tree> trees;
+
+    std::vector<std::uint64_t> nodeIDs;
+    std::vector<Coordinate> positions;
+    std::vector<float> radii;
+    std::vector<std::uint64_t> timestamps;
+    std::vector<std::int32_t> createdInMags;
+    std::vector<std::uint8_t> createdInVps;
+    std::vector<std::uint32_t> treeIndices;
+
+    // both directions of every segment, the neighbors of node i are edgeTargets[edgeOffsets[i], edgeOffsets[i + 1])
+    std::vector<std::uint64_t> edgeOffsets;
+    std::vector<std::uint32_t> edgeTargets;
+    std::vector<std::uint8_t> edgeForward;// node i is the source of the segment
+
+    QHash<QString, std::vector<double>> numberColumns;// NaN where unset
+    QHash<QString, std::vector<std::pair<std::uint32_t, QString>>> textColumns;// sparse, ordered by node index
+
+    /** paged out trees are read from their pages without paging them in */
+    static SkeletonColumns fromTrees(const std::list<treeListElement> & trees, const TreePager & pager, const QSet<QString> & numberProperties);
+    /** binary file of the columns, each one split into independently compressed chunks */
+    void write(QIODevice & device) const;
+    static SkeletonColumns read(QIODevice & device);
+
+    std::size_t nodeCount() const { return nodeIDs.size(); }
+    std::size_t segmentCount() const { return edgeTargets.size() / 2; }
+    std::pair<const std::uint32_t *, const std::uint32_t *> neighbors(const std::uint32_t index) const;
+    boost::optional<std::uint32_t> indexOf(const std::uint64_t nodeID) const;
+    boost::optional<QString> text(const QString & property, const std::uint32_t index) const;
+    std::size_t memoryUsage() const;
+private:
+    std::vector<std::uint32_t> byNodeID;// node indices sorted by node id
+    void resize(const std::size_t nodeCount);
+    void sortByNodeID();
+};
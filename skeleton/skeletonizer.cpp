@@ -27,8 +27,10 @@
 #include "dataset.h"
 #include "functions.h"
 #include "mesh/mesh.h"
+#include "mesh/mesharrays.h"
 #include "segmentation/cubeloader.h"
 #include "segmentation/segmentation.h"
+#include "skeleton/nmlwriter.h"
 #include "skeleton/node.h"
 #include "skeleton/skeleton_dfs.h"
 #include "skeleton/tree.h"
@@ -39,6 +41,7 @@
 #include "widgets/mainwindow.h"
 
 #include <QApplication>
+#include <QBuffer>
 #include <QCryptographicHash>
 #include <QDataStream>
 #include <QElapsedTimer>
@@ -46,6 +49,7 @@
 #include <QSignalBlocker>
 #include <QXmlStreamAttributes>
 
+#include <cmath>
 #include <cstring>
 #include <deque>
 #include <iterator>
@@ -126,6 +130,11 @@ Skeletonizer::Skeletonizer(bool global) {
 
         QObject::connect(this, &Skeletonizer::resetData, this, &Skeletonizer::guiModeLoaded);
         QObject::connect(this, &Skeletonizer::resetData, this, &Skeletonizer::lockingChanged);
+        QObject::connect(this, &Skeletonizer::treeSelectionChangedSignal, [this](){
+            for (auto * tree : skeletonState.selectedTrees) {
+                pageInTree(*tree);
+            }
+        });
     }
 }
 
@@ -232,12 +241,8 @@ void Skeletonizer::propagateComments(nodeListElement & root, const QSet<QString>
     }
 }
 
-void Skeletonizer::saveXmlSkeleton(QIODevice & file, const bool onlySelected, const bool saveTime, const bool saveDatasetPath) {
+void Skeletonizer::saveXmlSkeleton(QIODevice & file, const bool onlySelected, const bool saveTime, const bool saveDatasetPath, const bool saveThings) {
     QXmlStreamWriter xml(&file);
-    saveXmlSkeleton(xml, onlySelected, saveTime, saveDatasetPath);
-}
-
-void Skeletonizer::saveXmlSkeleton(QXmlStreamWriter & xml, const bool onlySelected, const bool saveTime, const bool saveDatasetPath) {
     xml.setAutoFormatting(true);
     xml.writeStartDocument();
 
@@ -354,72 +359,32 @@ void Skeletonizer::saveXmlSkeleton(QXmlStreamWriter & xml, const bool onlySelect
 
     xml.writeEndElement(); // end parameters
 
-    for (auto & currentTree : skeletonState.trees) {
-        if (onlySelected && !currentTree.selected) {
-            continue;
-        }
-        //Every "thing" (tree) has associated nodes and edges.
-        xml.writeStartElement("thing");
-        xml.writeAttribute("id", QString::number(currentTree.treeID));
-        xml.writeAttribute("visible", QString::number(currentTree.render));
-        if (currentTree.colorSetManually) {
-            xml.writeAttribute("color.r", QString::number(currentTree.color.redF()));
-            xml.writeAttribute("color.g", QString::number(currentTree.color.greenF()));
-            xml.writeAttribute("color.b", QString::number(currentTree.color.blueF()));
-            xml.writeAttribute("color.a", QString::number(currentTree.color.alphaF()));
-        } else {
-            xml.writeAttribute("color.r", QString("-1."));
-            xml.writeAttribute("color.g", QString("-1."));
-            xml.writeAttribute("color.b", QString("-1."));
-            xml.writeAttribute("color.a", QString("1."));
-        }
-        for (auto propertyIt = currentTree.properties.constBegin(); propertyIt != currentTree.properties.constEnd(); ++propertyIt) {
-            xml.writeAttribute(propertyIt.key(), propertyIt.value().toString());
-        }
-
-        xml.writeStartElement("nodes");
-        for (const auto & node : currentTree.nodes) {
-            xml.writeStartElement("node");
-            xml.writeAttribute("id", QString::number(node.nodeID));
-            xml.writeAttribute("radius", QString::number(node.radius));
-            xml.writeAttribute("x", QString::number(node.position.x + skeletonState.saveMatlabCoordinates));
-            xml.writeAttribute("y", QString::number(node.position.y + skeletonState.saveMatlabCoordinates));
-            xml.writeAttribute("z", QString::number(node.position.z + skeletonState.saveMatlabCoordinates));
-            xml.writeAttribute("inVp", QString::number(node.createdInVp));
-            xml.writeAttribute("inMag", QString::number(node.createdInMag));
-            xml.writeAttribute("time", QString::number(node.timestamp));
-            for (auto propertyIt = node.properties.constBegin(); propertyIt != node.properties.constEnd(); ++propertyIt) {
-                xml.writeAttribute(propertyIt.key(), propertyIt.value().toString());
-            }
-            xml.writeEndElement(); // end node
-        }
-        xml.writeEndElement(); // end nodes
-
-        xml.writeStartElement("edges");
-        for (const auto & node : currentTree.nodes) {
-            for (const auto & currentSegment : node.segments) {
-                if (currentSegment.forward) {
-                    xml.writeStartElement("edge");
-                    xml.writeAttribute("source", QString::number(currentSegment.source.nodeID));
-                    xml.writeAttribute("target", QString::number(currentSegment.target.nodeID));
-                    xml.writeEndElement();
-                }
-            }
-        }
-        xml.writeEndElement(); // end edges
-
-        xml.writeEndElement(); // end tree
+    // the writer has no pending start tag here, so the formatted things can go straight to the device
+    if (saveThings) {
+        file.write(NmlWriter::things(skeletonState.trees, skeletonState.pager, onlySelected, skeletonState.saveMatlabCoordinates));
     }
 
     xml.writeStartElement("comments");
-    TreeTraverser commentTraverser(skeletonState.trees);
-    for (; !commentTraverser.reachedEnd; ++commentTraverser) {
-        if (!onlySelected || skeletonState.nodesByNodeID[(*commentTraverser).nodeID]->correspondingTree->selected) {
-            if(!(*commentTraverser).getComment().isEmpty()) {
-                xml.writeStartElement("comment");
-                xml.writeAttribute("node", QString::number((*commentTraverser).nodeID));
-                xml.writeAttribute("content", (*commentTraverser).getComment());
-                xml.writeEndElement();
+    const auto writeComment = [&xml](const auto & node){
+        const auto comment = node.properties.value("comment").toString();
+        if (!comment.isEmpty()) {
+            xml.writeStartElement("comment");
+            xml.writeAttribute("node", QString::number(node.nodeID));
+            xml.writeAttribute("content", comment);
+            xml.writeEndElement();
+        }
+    };
+    for (const auto & tree : skeletonState.trees) {
+        if (onlySelected && !tree.selected) {
+            continue;
+        }
+        if (skeletonState.pager.contains(tree.treeID)) {// paged out trees have no branch points, but may have comments
+            for (const auto & node : skeletonState.pager.peek(tree.treeID).nodes) {
+                writeComment(node);
+            }
+        } else {
+            for (const auto & node : tree.nodes) {
+                writeComment(node);
             }
         }
     }
@@ -439,16 +404,150 @@ void Skeletonizer::saveXmlSkeleton(QXmlStreamWriter & xml, const bool onlySelect
     xml.writeEndDocument();
 }
 
-std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> Skeletonizer::loadXmlSkeleton(QIODevice & file, const bool merge, const QString & treeCmtOnMultiLoad) {
-    loadDatasetFromAnnotation(file, false, merge);
+std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> Skeletonizer::loadXmlSkeleton(QIODevice & file, const bool merge, const QString & treeCmtOnMultiLoad, const SkeletonColumns * columns) {
     if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         throw std::runtime_error("loadXmlSkeleton open failed");
     }
-    QXmlStreamReader xml(&file);
-    return loadXmlSkeleton(xml, merge, treeCmtOnMultiLoad);
+    auto nml = file.readAll();
+    file.close();
+    if (auto document = NmlScanner::parse(nml)) {// things are parsed ahead, the stream reader only sees the outline
+        QBuffer outline(&document->outline);
+        loadDatasetFromAnnotation(outline, false, merge);
+        QXmlStreamReader xml(document->outline);
+        return loadXmlSkeleton(xml, merge, treeCmtOnMultiLoad, &document->things, columns);
+    }
+    QBuffer buffer(&nml);
+    loadDatasetFromAnnotation(buffer, false, merge);
+    QXmlStreamReader xml(nml);
+    return loadXmlSkeleton(xml, merge, treeCmtOnMultiLoad, nullptr, columns);
+}
+
+std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> Skeletonizer::loadColumnarSkeleton(QIODevice & file, const bool merge) {
+    const auto columns = SkeletonColumns::read(file);
+    QXmlStreamReader xml(QByteArray("<things/>"));// a bare columns file has no parameters
+    return loadXmlSkeleton(xml, merge, "", nullptr, &columns);
+}
+
+void Skeletonizer::saveColumnarSkeleton(QIODevice & file) {
+    if (!file.isOpen() && !file.open(QIODevice::WriteOnly)) {
+        throw std::runtime_error("saveColumnarSkeleton open failed");
+    }
+    SkeletonColumns::fromTrees(skeletonState.trees, skeletonState.pager, {}).write(file);// all node properties as text, like nml
+}
+
+std::pair<Coordinate, Coordinate> viewBox(const Coordinate & center, const int factor) {// the loaded supercube approximates the view frustum
+    const auto & dataset = Dataset::current();
+    const auto halfExtent = dataset.cubeShape * (dataset.magnification * state->M * factor / 2);
+    return {center - halfExtent, center + halfExtent};
+}
+
+bool Skeletonizer::pageOutTree(treeListElement & tree) {
+    if (tree.nodes.empty() || skeletonState.pager.contains(tree.treeID) || tree.selected || tree.isSynapticCleft || !tree.subobjectCount.empty() || &tree == skeletonState.activeTree) {
+        return false;
+    }
+    for (const auto & node : tree.nodes) {
+        if (node.selected || node.isBranchNode || node.isSynapticNode || &node == skeletonState.activeNode) {
+            return false;
+        }
+        for (const auto & segment : node.segments) {
+            if (segment.source.correspondingTree != segment.target.correspondingTree) {// would dangle
+                return false;
+            }
+        }
+    }
+    skeletonState.pager.store(tree.treeID, TreePager::pageOf(tree));
+    for (auto & node : tree.nodes) {
+        skeletonState.nodesByNodeID.erase(node.nodeID);
+        skeletonState.nodeIndex.erase(node);
+    }
+    tree.nodes.clear();// segments are intra tree and go with their nodes
+    emit treePagedSignal(tree);
+    return true;
+}
+
+void Skeletonizer::pageInTree(treeListElement & tree) {
+    if (!skeletonState.pager.contains(tree.treeID)) {
+        return;
+    }
+    const auto page = skeletonState.pager.take(tree.treeID);
+    {
+        QSignalBlocker blocker{this};
+        for (const auto & node : page.nodes) {
+            addNode(node.nodeID, node.radius, tree.treeID, node.position, node.createdInVp, node.createdInMag, node.timestamp, false, node.properties);
+        }
+        for (const auto & segment : page.segments) {
+            auto * source = findNodeByNodeID(segment.first);
+            auto * target = findNodeByNodeID(segment.second);
+            if (source != nullptr && target != nullptr) {
+                addSegment(*source, *target);
+            }
+        }
+    }
+    emit treePagedSignal(tree);
+}
+
+void Skeletonizer::pageInAll() {
+    for (auto & tree : skeletonState.trees) {
+        pageInTree(tree);
+    }
+    pageOutCell = boost::none;
+}
+
+void Skeletonizer::pageByPosition(const Coordinate & position) {
+    if (!treePaging) {
+        return;
+    }
+    // both directions use the bounding box of the tree, paging out needs a larger box so trees at the border don’t flip
+    const auto view = viewBox(position, 1);
+    std::unordered_set<std::uint64_t> pagedIn;
+    for (const auto treeID : skeletonState.pager.treesIntersecting(view.first, view.second)) {
+        if (auto * tree = findTreeByTreeID(treeID)) {
+            pageInTree(*tree);
+            pagedIn.emplace(treeID);
+        }
+    }
+    // sweep the resident trees only when the position enters another cell of a grid with the view’s half extent
+    const auto halfExtent = (view.second - view.first) / 2;
+    const Coordinate grid{std::max(1, halfExtent.x), std::max(1, halfExtent.y), std::max(1, halfExtent.z)};
+    const auto cell = position / grid;
+    if (pageOutCell && pageOutCell.get() == cell) {
+        return;
+    }
+    pageOutCell = cell;
+    const auto cellMin = cell.componentMul(grid);
+    const auto keepMin = cellMin - grid * 2;// contains the view of every position in the cell
+    const auto keepMax = cellMin + grid * 3;
+    for (auto & tree : skeletonState.trees) {
+        if (tree.nodes.empty() || pagedIn.find(tree.treeID) != std::end(pagedIn)) {
+            continue;
+        }
+        auto min = tree.nodes.front().position;
+        auto max = min;
+        for (const auto & node : tree.nodes) {
+            min = {std::min(min.x, node.position.x), std::min(min.y, node.position.y), std::min(min.z, node.position.z)};
+            max = {std::max(max.x, node.position.x), std::max(max.y, node.position.y), std::max(max.z, node.position.z)};
+        }
+        if (min.x > keepMax.x || max.x < keepMin.x || min.y > keepMax.y || max.y < keepMin.y || min.z > keepMax.z || max.z < keepMin.z) {
+            pageOutTree(tree);
+        }
+    }
+}
+
+nodeListElement * Skeletonizer::pageInNode(std::uint64_t nodeID) {
+    if (const auto treeID = skeletonState.pager.treeOfNode(nodeID)) {
+        if (auto * tree = findTreeByTreeID(treeID.get())) {
+            pageInTree(*tree);
+        }
+    }
+    return findNodeByNodeID(nodeID);
+}
+
+std::size_t Skeletonizer::nodeCount(const treeListElement & tree) const {
+    const auto * entry = skeletonState.pager.entry(tree.treeID);
+    return tree.nodes.size() + (entry != nullptr ? entry->nodeCount : 0);
 }
 
-std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> Skeletonizer::loadXmlSkeleton(QXmlStreamReader & xml, const bool merge, const QString & treeCmtOnMultiLoad) {
+std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> Skeletonizer::loadXmlSkeleton(QXmlStreamReader & xml, const bool merge, const QString & treeCmtOnMultiLoad, const std::vector<NmlScanner::Thing> * parsedThings, const SkeletonColumns * columns) {
     // If "createdin"-node does not exist, skeleton was created in a version before 3.2
     skeletonState.skeletonCreatedInVersion = "pre-3.2";
     skeletonState.skeletonLastSavedInVersion = "pre-3.2";
@@ -470,6 +569,31 @@ std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<tre
     const QSet<QString> knownElements({"offset", "skeletonDisplayMode", "experiment", "dataset", "guiMode", "MovementArea"});
     QSet<QString> skippedElements;
 
+    auto addParsedNode = [this, merge, &nmlScale, &matlabCoordinates, &nodeMap](const NmlScanner::Node & node, const decltype(treeListElement::treeID) treeID){
+        float radius = skeletonState.defaultNodeRadius;
+        Coordinate currentCoordinate;
+        if (node.radius) {
+            radius = (nmlScale ? nmlScale->x / Dataset::current().scales[0].x : 1) * node.radius.get();
+        }
+        if (node.x) {
+            currentCoordinate.x = std::round((nmlScale ? nmlScale->x / Dataset::current().scales[0].x : 1) * node.x.get()) - matlabCoordinates;
+        }
+        if (node.y) {
+            currentCoordinate.y = std::round((nmlScale ? nmlScale->y / Dataset::current().scales[0].y : 1) * node.y.get()) - matlabCoordinates;
+        }
+        if (node.z) {
+            currentCoordinate.z = std::round((nmlScale ? nmlScale->z / Dataset::current().scales[0].z : 1) * node.z.get()) - matlabCoordinates;
+        }
+        const auto inVP = node.inVP ? static_cast<ViewportType>(node.inVP.get()) : VIEWPORT_UNDEFINED;
+        if (merge) {
+            auto & noderef = addNode(boost::none, radius, treeID, currentCoordinate, inVP, node.inMag, node.ms, false, node.properties).get();
+            nodeMap.emplace(std::piecewise_construct, std::forward_as_tuple(node.id.get()), std::forward_as_tuple(noderef));
+        } else {
+            addNode(node.id, radius, treeID, currentCoordinate, inVP, node.inMag, node.ms, false, node.properties);
+        }
+    };
+    std::size_t thingIndex{0};
+
     QElapsedTimer bench;
     bench.start();
     {
@@ -701,49 +825,44 @@ std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<tre
             if (tree.getComment().isEmpty()) {// sets e.g. filename as tree comment when multiple files are loaded
                 setComment(tree, treeCmtOnMultiLoad);
             }
+            if (parsedThings != nullptr) {// the body of this thing is blank in the outline
+                const auto & thing = parsedThings->at(thingIndex++);
+                for (const auto & node : thing.nodes) {
+                    addParsedNode(node, treeID);
+                }
+                edgeVector.insert(std::end(edgeVector), std::begin(thing.edges), std::end(thing.edges));
+                skippedElements.unite(thing.skippedElements);
+            }
 
             while (xml.readNextStartElement()) {
                 if(xml.name() == "nodes") {
                     while(xml.readNextStartElement()) {
                         if(xml.name() == "node") {
-                            boost::optional<decltype(nodeListElement::nodeID)> nodeID;
-                            float radius = skeletonState.defaultNodeRadius;
-                            Coordinate currentCoordinate;
-                            ViewportType inVP = VIEWPORT_UNDEFINED;
-                            int inMag = 0;
-                            uint64_t ms = 0;
-                            QVariantHash properties;
+                            NmlScanner::Node node;
                             for (const auto & attribute : xml.attributes()) {
                                 const auto & name = attribute.name();
                                 const auto & value = attribute.value();
                                 if (name == "id") {
-                                    nodeID = value.toULongLong();
+                                    node.id = value.toULongLong();
                                 } else if (name == "radius") {
-                                    radius = (nmlScale ? nmlScale->x / Dataset::current().scales[0].x : 1) * value.toDouble();
+                                    node.radius = value.toDouble();
                                 } else if (name == "x") {
-                                    currentCoordinate.x = std::round((nmlScale ? nmlScale->x / Dataset::current().scales[0].x : 1) * value.toDouble()) - matlabCoordinates;
+                                    node.x = value.toDouble();
                                 } else if (name == "y") {
-                                    currentCoordinate.y = std::round((nmlScale ? nmlScale->y / Dataset::current().scales[0].y : 1) * value.toDouble()) - matlabCoordinates;
+                                    node.y = value.toDouble();
                                 } else if (name == "z") {
-                                    currentCoordinate.z = std::round((nmlScale ? nmlScale->z / Dataset::current().scales[0].z : 1) * value.toDouble()) - matlabCoordinates;
+                                    node.z = value.toDouble();
                                 } else if (name == "inVp") {
-                                    inVP = static_cast<ViewportType>(value.toInt());
+                                    node.inVP = value.toInt();
                                 } else if (name == "inMag") {
-                                    inMag = {value.toInt()};
+                                    node.inMag = value.toInt();
                                 } else if (name == "time") {
-                                    ms = {value.toULongLong()};
+                                    node.ms = value.toULongLong();
                                 } else if (name != "comment") { // comments are added later in the comments section
-                                    const auto property = name.toString();
-                                    properties.insert(property, value.toString());
+                                    node.properties.insert(name.toString(), value.toString());
                                 }
                             }
-
-                            if (merge) {
-                                auto & noderef = addNode(boost::none, radius, treeID, currentCoordinate, inVP, inMag, ms, false, properties).get();
-                                nodeMap.emplace(std::piecewise_construct, std::forward_as_tuple(nodeID.get()), std::forward_as_tuple(noderef));
-                            } else {
-                                addNode(nodeID, radius, treeID, currentCoordinate, inVP, inMag, ms, false, properties);
-                            }
+                            addParsedNode(node, treeID);
                         } else {
                             skippedElements.insert(xml.name().toString());
                         }
@@ -778,6 +897,99 @@ std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<tre
     if (rootTag != "things") {
         throw std::runtime_error{tr("loadXmlSkeleton: expected root tag <things>, got »%1«").arg(xml.name()).toStdString()};
     }
+    if (columns != nullptr) {// trees of a binary skeleton, the xml still holds parameters, comments and branch points
+        const auto propertiesOf = [columns](const std::uint32_t i){
+            QVariantHash properties;
+            for (auto it = std::cbegin(columns->numberColumns); it != std::cend(columns->numberColumns); ++it) {
+                if (!std::isnan(it.value()[i])) {
+                    properties.insert(it.key(), it.value()[i]);
+                }
+            }
+            for (auto it = std::cbegin(columns->textColumns); it != std::cend(columns->textColumns); ++it) {
+                if (const auto text = columns->text(it.key(), i)) {
+                    properties.insert(it.key(), text.get());
+                }
+            }
+            return properties;
+        };
+        std::unordered_set<std::uint64_t> pinnedNodeIDs(std::cbegin(branchVector), std::cend(branchVector));// nodes that have to be in memory
+        pinnedNodeIDs.emplace(activeNodeID);
+        for (const auto & columnTree : columns->trees) {
+            for (const auto & key : {"preSynapse", "postSynapse"}) {
+                if (columnTree.properties.contains(key)) {
+                    pinnedNodeIDs.emplace(columnTree.properties[key].toULongLong());
+                }
+            }
+        }
+        const auto subobjects = columns->numberColumns.constFind("subobjectId");
+        const auto view = viewBox(loadedPosition ? Coordinate(loadedPosition.get()) : state->viewerState->currentPosition, 1);
+        // trees outside the view go straight to the pager, without ever becoming nodes
+        const auto pageable = [&](const SkeletonColumns::Tree & columnTree){
+            if (!treePaging || merge || columnTree.nodeCount == 0 || columnTree.properties.contains("synapticCleft")) {
+                return false;
+            }
+            const auto end = columnTree.firstNode + columnTree.nodeCount;
+            for (auto i = columnTree.firstNode; i < end; ++i) {
+                const auto & pos = columns->positions[i];
+                const bool visible = pos.x >= view.first.x && pos.x <= view.second.x && pos.y >= view.first.y && pos.y <= view.second.y && pos.z >= view.first.z && pos.z <= view.second.z;
+                if (visible || pinnedNodeIDs.count(columns->nodeIDs[i]) != 0 || columns->text("subobjectId", i)
+                        || (subobjects != std::cend(columns->numberColumns) && !std::isnan(subobjects.value()[i]))) {// hybrid nodes count into the segmentation
+                    return false;
+                }
+                const auto neighbors = columns->neighbors(i);
+                if (std::any_of(neighbors.first, neighbors.second, [&columnTree, end](const auto index){ return index < columnTree.firstNode || index >= end; })) {
+                    return false;// segment to another tree
+                }
+            }
+            return true;
+        };
+        std::vector<bool> pagedTrees(columns->trees.size());
+        for (std::size_t treeIndex = 0; treeIndex < columns->trees.size(); ++treeIndex) {
+            const auto & columnTree = columns->trees[treeIndex];
+            auto & tree = addTree(boost::make_optional(!merge, columnTree.treeID), boost::make_optional(columnTree.colorSetManually, columnTree.color), columnTree.properties);
+            tree.render = columnTree.render;
+            if (merge) {
+                treeMap.emplace(std::piecewise_construct, std::forward_as_tuple(columnTree.treeID), std::forward_as_tuple(tree));
+            }
+            if (tree.getComment().isEmpty()) {
+                setComment(tree, treeCmtOnMultiLoad);
+            }
+            if (pageable(columnTree)) {
+                TreePager::Page page;
+                for (auto i = columnTree.firstNode; i < columnTree.firstNode + columnTree.nodeCount; ++i) {
+                    page.nodes.push_back({columns->nodeIDs[i], columns->radii[i], columns->positions[i], columns->createdInMags[i]
+                                          , static_cast<ViewportType>(columns->createdInVps[i]), columns->timestamps[i], propertiesOf(i)});
+                    for (auto edge = columns->edgeOffsets[i]; edge < columns->edgeOffsets[i + 1]; ++edge) {
+                        if (columns->edgeForward[edge]) {
+                            page.segments.emplace_back(columns->nodeIDs[i], columns->nodeIDs[columns->edgeTargets[edge]]);
+                        }
+                    }
+                }
+                skeletonState.pager.store(tree.treeID, page);
+                pagedTrees[treeIndex] = true;
+                continue;
+            }
+            for (auto i = columnTree.firstNode; i < columnTree.firstNode + columnTree.nodeCount; ++i) {
+                const auto properties = propertiesOf(i);
+                const auto nodeID = columns->nodeIDs[i];
+                auto node = addNode(boost::make_optional(!merge, nodeID), columns->radii[i], tree.treeID, columns->positions[i]
+                                    , static_cast<ViewportType>(columns->createdInVps[i]), columns->createdInMags[i], columns->timestamps[i], false, properties);
+                if (merge && node) {
+                    nodeMap.emplace(std::piecewise_construct, std::forward_as_tuple(nodeID), std::forward_as_tuple(node.get()));
+                }
+            }
+        }
+        for (std::uint32_t i = 0; i < columns->nodeCount(); ++i) {
+            if (pagedTrees[columns->treeIndices[i]]) {
+                continue;
+            }
+            for (auto edge = columns->edgeOffsets[i]; edge < columns->edgeOffsets[i + 1]; ++edge) {
+                if (columns->edgeForward[edge]) {
+                    edgeVector.emplace_back(columns->nodeIDs[i], columns->nodeIDs[columns->edgeTargets[edge]]);
+                }
+            }
+        }
+    }
 
 
     for (const auto & property : numberProperties) {
@@ -851,6 +1063,8 @@ std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<tre
     if (skeletonState.activeNode == nullptr && !skeletonState.trees.empty() && !skeletonState.trees.front().nodes.empty()) {
         setActiveNode(&skeletonState.trees.front().nodes.front());
     }
+    pageOutCell = boost::none;// loaded trees are swept regardless of the last position
+    pageByPosition(state->viewerState->currentPosition);
 
     QMessageBox msgBox{QApplication::activeWindow()};
     auto msg = tr("");
@@ -917,6 +1131,7 @@ bool Skeletonizer::delNode(std::uint64_t nodeID, nodeListElement *nodeToDel) {
     }
 
     skeletonState.nodesByNodeID.erase(nodeToDel->nodeID);
+    skeletonState.nodeIndex.erase(*nodeToDel);
     if (nodeID < skeletonState.nextAvailableNodeID) {
         skeletonState.nextAvailableNodeID = nodeID;
     }
@@ -984,6 +1199,7 @@ bool Skeletonizer::delTree(decltype(treeListElement::treeID) treeID) {
             }
         }
     }
+    skeletonState.pager.drop(treeToDel->treeID);
     {
         QSignalBlocker blocker{this};// bulk operation
         for (auto nodeIt = std::begin(treeToDel->nodes); nodeIt != std::end(treeToDel->nodes); nodeIt = std::begin(treeToDel->nodes)) {
@@ -1020,36 +1236,19 @@ bool Skeletonizer::delTree(decltype(treeListElement::treeID) treeID) {
 }
 
 nodeListElement * Skeletonizer::findNearbyNode(treeListElement * nearbyTree, Coordinate searchPosition) {
-    nodeListElement * nodeWithCurrentlySmallestDistance = nullptr;
-    float smallestDistance = std::numeric_limits<float>::max();//maximum distance
-
-    auto searchTree = [&smallestDistance, &nodeWithCurrentlySmallestDistance, searchPosition](treeListElement & tree){
-        for (auto & currentNode : tree.nodes) {
-            // We make the nearest node the next active node
-            const floatCoordinate distanceVector = searchPosition - currentNode.position;
-            const auto distance = distanceVector.length();
-            //set nearest distance to distance to first node found, then to distance of any nearer node found.
-            if (distance  < smallestDistance) {
-                smallestDistance = distance;
-                nodeWithCurrentlySmallestDistance = &currentNode;
-            }
-        }
-    };
-
     //  If available, search for a node within nearbyTree first.
     if (nearbyTree != nullptr) {
-        searchTree(*nearbyTree);
-    }
-
-    if (nodeWithCurrentlySmallestDistance == nullptr) {
-        // Ok, we didn't find any node in nearbyTree.
-        // Now we take the nearest node, independent of the tree it belongs to.
-        for (auto & currentTree : skeletonState.trees) {
-            searchTree(currentTree);
+        const auto nodes = skeletonState.nodeIndex.nearest(searchPosition, 1, [nearbyTree](const nodeListElement & node){
+            return node.correspondingTree == nearbyTree;
+        });
+        if (!nodes.empty()) {
+            return nodes.front();
         }
     }
-
-    return nodeWithCurrentlySmallestDistance;
+    // Ok, we didn't find any node in nearbyTree.
+    // Now we take the nearest node, independent of the tree it belongs to.
+    const auto nodes = skeletonState.nodeIndex.nearest(searchPosition);
+    return nodes.empty() ? nullptr : nodes.front();
 }
 
 bool Skeletonizer::setActiveTreeByID(decltype(treeListElement::treeID) treeID) {
@@ -1143,7 +1342,7 @@ boost::optional<nodeListElement &> Skeletonizer::addNode(boost::optional<std::ui
         }
     }
 
-    if (nodeID && findNodeByNodeID(nodeID.get())) {
+    if (nodeID && (findNodeByNodeID(nodeID.get()) || skeletonState.pager.containsNode(nodeID.get()))) {
         qDebug() << tr("Node with ID %1 already exists, no node added.").arg(nodeID.get());
         return boost::none;
     }
@@ -1153,8 +1352,12 @@ boost::optional<nodeListElement &> Skeletonizer::addNode(boost::optional<std::ui
         qDebug() << tr("There exists no tree with the provided ID %1!").arg(treeID);
         return boost::none;
     }
+    pageInTree(*tempTree);
 
     if (!nodeID) {
+        while (skeletonState.pager.containsNode(skeletonState.nextAvailableNodeID) || findNodeByNodeID(skeletonState.nextAvailableNodeID)) {// paged nodes keep their ids
+            ++skeletonState.nextAvailableNodeID;
+        }
         nodeID = skeletonState.nextAvailableNodeID;
     }
 
@@ -1169,6 +1372,7 @@ boost::optional<nodeListElement &> Skeletonizer::addNode(boost::optional<std::ui
     updateSubobjectCountFromProperty(tempNode);
 
     skeletonState.nodesByNodeID.emplace(nodeID.get(), &tempNode);
+    skeletonState.nodeIndex.insert(tempNode);
 
     bool isPropertiesChanged = false;
     for (auto & property : properties.keys()) {
@@ -1248,6 +1452,8 @@ bool Skeletonizer::mergeTrees(decltype(treeListElement::treeID) treeID1, decltyp
         qDebug() << "Could not merge trees, provided IDs are not valid!";
         return false;
     }
+    pageInTree(*tree1);
+    pageInTree(*tree2);
 
     for (auto & node : tree2->nodes) {
         node.correspondingTree = tree1;
@@ -1482,6 +1688,7 @@ std::list<segmentListElement>::iterator Skeletonizer::findSegmentBetween(nodeLis
 
 void Skeletonizer::setRadius(nodeListElement & node, const float radius) {
     node.radius = radius;
+    skeletonState.nodeIndex.updateRadius(node);
     updateCircRadius(&node);
     emit nodeChangedSignal(node);
 }
@@ -1489,6 +1696,7 @@ void Skeletonizer::setRadius(nodeListElement & node, const float radius) {
 void Skeletonizer::setPosition(nodeListElement & node, const Coordinate & position) {
     auto oldPos = node.position;
     node.position = position.capped({0, 0, 0}, Dataset::current().boundary);
+    skeletonState.nodeIndex.move(node, oldPos);
     const quint64 newSubobjectId = readVoxel(position);
     Skeletonizer::singleton().movedHybridNode(node, newSubobjectId, oldPos);
     emit nodeChangedSignal(node);
@@ -1731,6 +1939,10 @@ bool Skeletonizer::updateCircRadius(nodeListElement *node) {
     return true;
 }
 
+SkeletonColumns Skeletonizer::columnSnapshot() const {
+    return SkeletonColumns::fromTrees(skeletonState.trees, skeletonState.pager, numberProperties);
+}
+
 float Skeletonizer::radius(const nodeListElement & node) const {
     const auto propertyName = state->viewerState->highlightedNodePropertyByRadius;
     if(!propertyName.isEmpty() && node.properties.contains(propertyName)) {
@@ -1795,6 +2007,7 @@ void Skeletonizer::goToNode(const NodeGenerator::Direction direction) {
 
 void Skeletonizer::moveSelectedNodesToTree(decltype(treeListElement::treeID) treeID) {
     if (auto * newTree = findTreeByTreeID(treeID)) {
+        pageInTree(*newTree);
         for (auto * const node : skeletonState.selectedNodes) {
             newTree->nodes.splice(std::end(newTree->nodes), node->correspondingTree->nodes, node->iterator);
             node->correspondingTree = newTree;
@@ -2011,20 +2224,29 @@ std::tuple<QVector<GLfloat>, QVector<std::uint8_t>, QVector<GLuint>> Skeletonize
     return std::make_tuple(std::move(vertex_components), std::move(colors), std::move(indices));
 }
 
+QVector<GLfloat> Skeletonizer::getMeshNormals(const treeListElement & tree) {
+    QVector<GLfloat> normals(tree.mesh->vertex_count * 3);
+    tree.mesh->normal_buf.bind();
+    if (tree.mesh->normal_buf.size() == static_cast<int>(normals.size() * sizeof(normals[0]))) {
+        tree.mesh->normal_buf.read(0, normals.data(), normals.size() * sizeof(normals[0]));
+    } else {// point clouds have none
+        normals.clear();
+    }
+    tree.mesh->normal_buf.release();
+    return normals;
+}
+
 void Skeletonizer::saveMesh(QIODevice & file, const treeListElement & tree) {
     const auto [vertex_components, colors, indices] = getMesh(tree);
     saveMesh(file, tree, vertex_components, colors, indices);
 }
 
 void Skeletonizer::saveMesh(QIODevice & file, const treeListElement & tree, QVector<GLfloat> vertex_components, QVector<std::uint8_t> colors, QVector<GLuint> indices) {
-    tinyply::PlyFile ply;
-    ply.add_properties_to_element("vertex", {"x", "y", "z"}, vertex_components);
-    if (tree.mesh->useTreeColor == false) {
-        ply.add_properties_to_element("vertex", {"red", "green", "blue", "alpha"}, colors);
-    }
-    ply.add_properties_to_element("face", {"vertex_indices"}, indices, 3, tinyply::PlyProperty::Type::UINT8);
-    if (!ply.write(file, Annotation::singleton().savePlyAsBinary)) {
-        std::runtime_error("mesh save failed for tree " + std::to_string(tree.treeID));
+    MeshArrays mesh{vertex_components, {}, tree.mesh->useTreeColor ? QVector<std::uint8_t>{} : colors, indices};
+    try {
+        mesh.writePly(file, Annotation::singleton().savePlyAsBinary);
+    } catch (const std::runtime_error &) {
+        throw std::runtime_error("mesh save failed for tree " + std::to_string(tree.treeID));
     }
 }
 
@@ -23,8 +23,12 @@
 #pragma once
 
 #include "annotation/annotation.h"
+#include "skeleton/nmlscanner.h"
+#include "skeleton/nodeindex.h"
 #include "skeleton/skeleton_dfs.h"
+#include "skeleton/skeletoncolumns.h"
 #include "skeleton/tree.h"
+#include "skeleton/treepager.h"
 #include "widgets/viewports/viewportbase.h"
 
 #include <QObject>
@@ -140,6 +144,8 @@ struct SkeletonState {
     std::list<Synapse> synapses;
     std::unordered_map<decltype(treeListElement::treeID), treeListElement *> treesByID;
     std::unordered_map<decltype(nodeListElement::nodeID), nodeListElement *> nodesByNodeID;
+    NodeIndex nodeIndex;
+    TreePager pager;// nodes of trees that are paged out
 
     decltype(treeListElement::treeID) nextAvailableTreeID{1};
     decltype(nodeListElement::nodeID) nextAvailableNodeID{1};
@@ -226,6 +232,8 @@ public:
     void notifyChanged(nodeListElement & node);
 
     SkeletonState skeletonState;
+    bool treePaging{false};// keep only trees near the view or in the selection in memory
+    boost::optional<Coordinate> pageOutCell;// view grid cell of the last page out sweep
     Skeletonizer(bool global = false);
     static Skeletonizer & singleton() {
         static Skeletonizer skeletonizer(true);
@@ -282,10 +290,18 @@ public:
 
     void propagateComments(nodeListElement & root, const QSet<QString> & comments, const bool overwrite);
 
-    std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> loadXmlSkeleton(QIODevice &file, const bool merge, const QString & treeCmtOnMultiLoad = "");
-    std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> loadXmlSkeleton(QXmlStreamReader & xml, const bool merge, const QString & treeCmtOnMultiLoad);
-    void saveXmlSkeleton(QIODevice & file, const bool onlySelected = false, const bool saveTime = true, const bool saveDatasetPath = true);
-    void saveXmlSkeleton(QXmlStreamWriter & file, const bool onlySelected = false, const bool saveTime = true, const bool saveDatasetPath = true);
+    std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> loadXmlSkeleton(QIODevice &file, const bool merge, const QString & treeCmtOnMultiLoad = "", const SkeletonColumns * columns = nullptr);
+    std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> loadXmlSkeleton(QXmlStreamReader & xml, const bool merge, const QString & treeCmtOnMultiLoad, const std::vector<NmlScanner::Thing> * parsedThings = nullptr, const SkeletonColumns * columns = nullptr);
+    std::unordered_map<decltype(treeListElement::treeID), std::reference_wrapper<treeListElement>> loadColumnarSkeleton(QIODevice & file, const bool merge);
+    void saveXmlSkeleton(QIODevice & file, const bool onlySelected = false, const bool saveTime = true, const bool saveDatasetPath = true, const bool saveThings = true);
+    void saveColumnarSkeleton(QIODevice & file);
+
+    bool pageOutTree(treeListElement & tree);
+    void pageInTree(treeListElement & tree);
+    void pageInAll();
+    void pageByPosition(const Coordinate & position);
+    nodeListElement * pageInNode(std::uint64_t nodeID);
+    std::size_t nodeCount(const treeListElement & tree) const;
 
     nodeListElement *popBranchNode();
     void pushBranchNode(nodeListElement & branchNode);
@@ -312,11 +328,13 @@ public:
     QSet<nodeListElement *> getPath(std::vector<nodeListElement *> & nodes);
     float radius(const nodeListElement &node) const;
     const QSet<QString> getNumberProperties() const { return numberProperties; }
+    SkeletonColumns columnSnapshot() const;
     const QSet<QString> getTextProperties() const { return textProperties; }
     void convertToNumberProperty(const QString & property);
 
     void loadMesh(QIODevice &, boost::optional<decltype(treeListElement::treeID)> treeID, const QString & filename);
     std::tuple<QVector<GLfloat>, QVector<std::uint8_t>, QVector<GLuint>> getMesh(const treeListElement & tree);
+    QVector<GLfloat> getMeshNormals(const treeListElement & tree);
     void saveMesh(QIODevice & file, const treeListElement & tree);
     void saveMesh(QIODevice & file, const treeListElement & tree, QVector<GLfloat> vertex_components, QVector<std::uint8_t> colors, QVector<GLuint> indices);
     void addMeshToTree(boost::optional<decltype(treeListElement::treeID)> treeID, QVector<float> & verts, QVector<float> & normals, const QVector<unsigned int> & indices, const QVector<std::uint8_t> & colors, int draw_mode = 4/*GL_TRIANGLES*/, bool swap_xy = false);
@@ -339,6 +357,7 @@ signals:
     void treeChangedSignal(const treeListElement & tree);
     void treeRemovedSignal(const std::uint64_t treeID);
     void treesMerged(const std::uint64_t treeID,const std::uint64_t treeID2);
+    void treePagedSignal(const treeListElement & tree);
     void nodeSelectionChangedSignal();
     void treeSelectionChangedSignal();
     void resetData();
@@ -0,0 +1,161 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#include "skeleton/treepager.h"
+
+#include "skeleton/node.h"
+#include "skeleton/tree.h"
+
+#include <QDataStream>
+#include <QIODevice>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+TreePager::Page TreePager::pageOf(const treeListElement & tree) {
+    Page page;
+    page.nodes.reserve(tree.nodes.size());
+    for (const auto & node : tree.nodes) {
+        page.nodes.push_back({node.nodeID, node.radius, node.position, node.createdInMag, node.createdInVp, node.timestamp, node.properties});
+        for (const auto & segment : node.segments) {
+            if (segment.forward) {
+                page.segments.emplace_back(segment.source.nodeID, segment.target.nodeID);
+            }
+        }
+    }
+    return page;
+}
+
+void TreePager::store(const std::uint64_t treeID, const Page & page) {
+    QByteArray raw;
+    QDataStream stream(&raw, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << static_cast<quint64>(page.nodes.size()) << static_cast<quint64>(page.segments.size());
+    Entry entry{{}, page.nodes.size(), {std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()}
+                , {std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min()}};
+    for (const auto & node : page.nodes) {
+        stream << static_cast<quint64>(node.nodeID) << node.radius << node.position.x << node.position.y << node.position.z
+               << node.createdInMag << static_cast<qint32>(node.createdInVp) << static_cast<quint64>(node.timestamp) << node.properties;
+        entry.min = {std::min(entry.min.x, node.position.x), std::min(entry.min.y, node.position.y), std::min(entry.min.z, node.position.z)};
+        entry.max = {std::max(entry.max.x, node.position.x), std::max(entry.max.y, node.position.y), std::max(entry.max.z, node.position.z)};
+        treeByNodeID[node.nodeID] = treeID;
+    }
+    for (const auto & segment : page.segments) {
+        stream << static_cast<quint64>(segment.first) << static_cast<quint64>(segment.second);
+    }
+    entry.data = qCompress(raw, 3);
+    entries[treeID] = std::move(entry);
+}
+
+namespace {
+TreePager::Page decode(const QByteArray & data) {
+    const auto raw = qUncompress(data);
+    QDataStream stream(raw);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint64 nodeCount, segmentCount;
+    stream >> nodeCount >> segmentCount;
+    TreePager::Page page;
+    page.nodes.resize(nodeCount);
+    for (auto & node : page.nodes) {
+        quint64 nodeID, timestamp;
+        qint32 vp;
+        stream >> nodeID >> node.radius >> node.position.x >> node.position.y >> node.position.z >> node.createdInMag >> vp >> timestamp >> node.properties;
+        node.nodeID = nodeID;
+        node.createdInVp = static_cast<ViewportType>(vp);
+        node.timestamp = timestamp;
+    }
+    page.segments.resize(segmentCount);
+    for (auto & segment : page.segments) {
+        quint64 source, target;
+        stream >> source >> target;
+        segment = {source, target};
+    }
+    if (stream.status() != QDataStream::Ok) {
+        throw std::runtime_error("TreePager: corrupt page");
+    }
+    return page;
+}
+}
+
+TreePager::Page TreePager::take(const std::uint64_t treeID) {
+    const auto it = entries.find(treeID);
+    if (it == std::end(entries)) {
+        throw std::runtime_error("TreePager::take: tree is not paged out");
+    }
+    auto page = decode(it->second.data);
+    entries.erase(it);
+    for (const auto & node : page.nodes) {
+        treeByNodeID.erase(node.nodeID);
+    }
+    return page;
+}
+
+TreePager::Page TreePager::peek(const std::uint64_t treeID) const {
+    const auto it = entries.find(treeID);
+    if (it == std::end(entries)) {
+        throw std::runtime_error("TreePager::peek: tree is not paged out");
+    }
+    return decode(it->second.data);
+}
+
+void TreePager::drop(const std::uint64_t treeID) {
+    if (contains(treeID)) {
+        take(treeID);
+    }
+}
+
+void TreePager::clear() {
+    entries.clear();
+    treeByNodeID.clear();
+}
+
+boost::optional<std::uint64_t> TreePager::treeOfNode(const std::uint64_t nodeID) const {
+    const auto it = treeByNodeID.find(nodeID);
+    return boost::make_optional(it != std::end(treeByNodeID), it != std::end(treeByNodeID) ? it->second : 0);
+}
+
+const TreePager::Entry * TreePager::entry(const std::uint64_t treeID) const {
+    const auto it = entries.find(treeID);
+    return it != std::end(entries) ? &it->second : nullptr;
+}
+
+std::vector<std::uint64_t> TreePager::treesIntersecting(const Coordinate & min, const Coordinate & max) const {
+    std::vector<std::uint64_t> treeIDs;
+    for (const auto & pair : entries) {
+        const auto & entry = pair.second;
+        if (entry.nodeCount != 0 && entry.min.x <= max.x && entry.max.x >= min.x && entry.min.y <= max.y && entry.max.y >= min.y
+                && entry.min.z <= max.z && entry.max.z >= min.z) {
+            treeIDs.emplace_back(pair.first);
+        }
+    }
+    return treeIDs;
+}
+
+std::size_t TreePager::memoryUsage() const {
+    std::size_t bytes = treeByNodeID.size() * 2 * sizeof(std::uint64_t);
+    for (const auto & pair : entries) {
+        bytes += pair.second.data.size() + sizeof(Entry);
+    }
+    return bytes;
+}
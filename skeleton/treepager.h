@@ -0,0 +1,83 @@
+/*
+ *  This file is a part of KNOSSOS.
+ *
+ *  (C) Copyright 2007-2018
+ *  Max-Planck-Gesellschaft zur Foerderung der Wissenschaften e.V.
+ *
+ *  KNOSSOS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 of
+ *  the License as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  For further information, visit https://knossos.app
+ *  or contact knossosteam@gmail.com
+ */
+
+
+#pragma once
+
+#include "coordinate.h"
+#include "widgets/viewports/viewportbase.h"
+
+#include <QByteArray>
+#include <QVariantHash>
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class treeListElement;
+
+/** @brief Compressed store for the nodes of trees that are not needed in memory.
+ *  The tree itself (id, color, properties) stays in the skeleton, only its nodes and segments are paged out. */
+class TreePager {
+public:
+    struct Node {
+        std::uint64_t nodeID;
+        float radius;
+        Coordinate position;
+        int createdInMag;
+        ViewportType createdInVp;
+        std::uint64_t timestamp;
+        QVariantHash properties;
+    };
+    struct Page {
+        std::vector<Node> nodes;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> segments;
+    };
+    struct Entry {
+        QByteArray data;// qCompressed page
+        std::size_t nodeCount;
+        Coordinate min, max;// bounding box of the node positions
+    };
+    static Page pageOf(const treeListElement & tree);
+
+    void store(const std::uint64_t treeID, const Page & page);
+    Page take(const std::uint64_t treeID);
+    /** decodes the page but leaves the tree paged out, e.g. for saving */
+    Page peek(const std::uint64_t treeID) const;
+    void drop(const std::uint64_t treeID);
+    void clear();
+
+    bool contains(const std::uint64_t treeID) const { return entries.find(treeID) != std::end(entries); }
+    bool containsNode(const std::uint64_t nodeID) const { return treeByNodeID.find(nodeID) != std::end(treeByNodeID); }
+    boost::optional<std::uint64_t> treeOfNode(const std::uint64_t nodeID) const;
+    const Entry * entry(const std::uint64_t treeID) const;
+    std::vector<std::uint64_t> treesIntersecting(const Coordinate & min, const Coordinate & max) const;
+    std::size_t treeCount() const { return entries.size(); }
+    std::size_t nodeCount() const { return treeByNodeID.size(); }
+    std::size_t memoryUsage() const;
+private:
+    std::unordered_map<std::uint64_t, Entry> entries;
+    std::unordered_map<std::uint64_t, std::uint64_t> treeByNodeID;
+};
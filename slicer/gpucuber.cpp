@@ -24,89 +24,208 @@
 
 #include "segmentation/segmentation.h"
 
-#include <boost/multi_array.hpp>
+#include <QMutexLocker>
+#include <QtConcurrentMap>
 
-gpu_raw_cube::gpu_raw_cube(const Coordinate & gpucubeshape, const bool index) {
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+/**
+ * @brief calls func for every row of the gpucubeshape sized sub array at offset inside a cpu cube
+ * with the source range and the destination index inside the dense gpu cube
+ */
+template<typename T, typename F>
+static void forEachSubArrayRow(const T * data, const Coordinate & cpucubeshape, const Coordinate & gpucubeshape, const Coordinate & offset, F func) {
+    for (int z = 0; z < gpucubeshape.z; ++z)
+    for (int y = 0; y < gpucubeshape.y; ++y) {
+        const auto * row = data + (static_cast<std::size_t>(z + offset.z) * cpucubeshape.y + y + offset.y) * cpucubeshape.x + offset.x;
+        func(row, row + gpucubeshape.x, (static_cast<std::size_t>(z) * gpucubeshape.y + y) * gpucubeshape.x);
+    }
+}
+
+gpu_raw_cube::gpu_raw_cube(const Coordinate & gpucubeshape, const bool index) : shape{gpucubeshape} {
+    setupCube(index ? QOpenGLTexture::R16_UNorm : QOpenGLTexture::R8_UNorm, index ? QOpenGLTexture::Nearest : QOpenGLTexture::Linear);
+}
+
+void gpu_raw_cube::setupCube(const QOpenGLTexture::TextureFormat format, const QOpenGLTexture::Filter filter) {
     cube.setAutoMipMapGenerationEnabled(false);
-    cube.setSize(gpucubeshape.x, gpucubeshape.y, gpucubeshape.z);
+    cube.setSize(shape.x, shape.y, shape.z);
     cube.setMipLevels(1);
-    cube.setMinificationFilter(index ? QOpenGLTexture::Nearest : QOpenGLTexture::Linear);
-    cube.setMagnificationFilter(index ? QOpenGLTexture::Nearest : QOpenGLTexture::Linear);
-    cube.setFormat(index ? QOpenGLTexture::R16_UNorm : QOpenGLTexture::R8_UNorm);
+    cube.setMinificationFilter(filter);
+    cube.setMagnificationFilter(filter);
+    cube.setFormat(format);
     cube.setWrapMode(QOpenGLTexture::ClampToEdge);
     cube.allocateStorage();
 }
 
-std::vector<char> gpu_raw_cube::prepare(boost::multi_array_ref<uint8_t, 3>::const_array_view<3>::type view) {
-    std::vector<char> data;
-    for (const auto & d2 : view)
-    for (const auto & d1 : d2)
-    for (const auto & elem : d1) {
-        data.emplace_back(elem);
-    }
-    return data;
+void gpu_raw_cube::reset() {
+    vertices.clear();
+}
+
+void gpu_raw_cube::prepare(const void * data, const Coordinate & cpucubeshape, const Coordinate & offset, std::vector<std::uint8_t> & staging) {
+    staging.resize(shape.prod());
+    forEachSubArrayRow(reinterpret_cast<const std::uint8_t *>(data), cpucubeshape, shape, offset, [&staging](auto begin, auto end, auto dst){
+        std::copy(begin, end, std::next(std::begin(staging), dst));
+    });
+}
+
+void gpu_raw_cube::upload(const std::vector<std::uint8_t> & staging) {
+    cube.setData(QOpenGLTexture::Red, QOpenGLTexture::UInt8, staging.data());
+}
+
+static std::array<std::uint8_t, 4> lutColor(const std::uint64_t id) {
+    const auto color = Segmentation::singleton().colorObjectFromSubobjectId(id);
+    return {{std::get<0>(color), std::get<1>(color), std::get<2>(color), static_cast<std::uint8_t>(std::get<3>(color) * 255.0 / Segmentation::singleton().alpha)}};// binarize alpha
+}
+
+gpu_lut::gpu_lut() {
+    setupTexture();
 }
 
-void gpu_raw_cube::upload(const std::vector<char> & data) {
-    cube.setData(QOpenGLTexture::Red, QOpenGLTexture::UInt8, data.data());
+void gpu_lut::setupTexture() {
+    texture.setAutoMipMapGenerationEnabled(false);
+    texture.setMipLevels(1);
+    texture.setMinificationFilter(QOpenGLTexture::Nearest);
+    texture.setMagnificationFilter(QOpenGLTexture::Nearest);
+    texture.setWrapMode(QOpenGLTexture::ClampToEdge);
+    texture.setFormat(QOpenGLTexture::RGBA8_UNorm);
 }
 
-void gpu_raw_cube::generate(boost::multi_array_ref<uint8_t, 3>::const_array_view<3>::type view) {
-    upload(prepare(view));
+std::size_t gpu_lut::size() {
+    QMutexLocker locker(&mutex);
+    return index_to_id.size();
 }
 
-gpu_lut_cube::gpu_lut_cube(const Coordinate & gpucubeshape) : gpu_raw_cube(gpucubeshape, true) {
-    lut.setAutoMipMapGenerationEnabled(false);
-    lut.setMipLevels(1);
-    lut.setMinificationFilter(QOpenGLTexture::Nearest);
-    lut.setMagnificationFilter(QOpenGLTexture::Nearest);
-    lut.setFormat(QOpenGLTexture::RGBA8_UNorm);
+void gpu_lut::clear() {
+    QMutexLocker locker(&mutex);
+    id_to_index.clear();
+    index_to_id.clear();
+    colors.clear();
+    dirtyBegin = dirtyEnd = 0;
 }
 
-std::vector<gpu_lut_cube::gpu_index> gpu_lut_cube::prepare(boost::multi_array_ref<uint64_t, 3>::const_array_view<3>::type view) {
-    bool lastValid{false};
-    uint64_t lastElem{0};
-    uint64_t lastIndex{0};
-    std::array<std::uint8_t, 4> lastColor{{}};
+std::size_t gpu_lut::countMissing(const std::vector<std::uint64_t> & sortedIds) {
+    QMutexLocker locker(&mutex);
+    return std::count_if(std::begin(sortedIds), std::end(sortedIds), [this](const std::uint64_t id){
+        return id_to_index.find(id) == std::end(id_to_index);
+    });
+}
 
-    std::vector<gpu_index> data;
-    for (const auto & d2 : view)
-    for (const auto & d1 : d2)
-    for (const auto & elem : d1) {
-        if (lastValid && elem == lastElem) {
-            data.emplace_back(lastIndex);
-        } else {
-            const auto it = id_to_lut_index.find(elem);
-            const auto existing = it != std::end(id_to_lut_index);
-            const auto index = existing ? it->second : (id_to_lut_index[elem] = highest_index++);//increment after assignment
-            data.emplace_back(index);
-            if (!existing) {
-                const auto color = Segmentation::singleton().colorObjectFromSubobjectId(elem);
-                lastColor = {{std::get<0>(color), std::get<1>(color), std::get<2>(color), static_cast<std::uint8_t>(std::get<3>(color) * 255.0 / Segmentation::singleton().alpha)}};// binarize alpha
-                colors.push_back(lastColor);
+/**
+ * @brief returns the compact index of every id, unknown ids are appended to the dictionary
+ *
+ * Called from the worker threads with the (small) palette of a single cube.
+ */
+std::vector<std::uint32_t> gpu_lut::lookup(const std::vector<std::uint64_t> & ids) {
+    std::vector<std::uint32_t> indices;
+    indices.reserve(ids.size());
+    QMutexLocker locker(&mutex);
+    for (const auto id : ids) {
+        const auto [it, inserted] = id_to_index.emplace(id, static_cast<std::uint32_t>(index_to_id.size()));
+        if (inserted) {
+            if (dirtyBegin == dirtyEnd) {
+                dirtyBegin = index_to_id.size();
             }
-            lastElem = elem;
-            lastIndex = index;
-            lastColor = colors[index];
-            lastValid = true;
+            index_to_id.emplace_back(id);
+            dirtyEnd = index_to_id.size();
+            if (colors.size() < index_to_id.size()) {
+                colors.resize(colors.size() + width);
+            }
+            colors[it->second] = lutColor(id);
         }
+        indices.emplace_back(it->second);
+    }
+    return indices;
+}
+
+void gpu_lut::recolor() {
+    QMutexLocker locker(&mutex);
+    for (std::size_t i{0}; i < index_to_id.size(); ++i) {
+        colors[i] = lutColor(index_to_id[i]);
     }
-    const auto lutSize = std::pow(2, std::ceil(std::log2(colors.size())));
-    colors.resize(lutSize);
-    return data;
+    dirtyBegin = 0;
+    dirtyEnd = index_to_id.size();
+    recolorRequired = false;
+}
+
+void gpu_lut::upload() {
+    QMutexLocker locker(&mutex);
+    const int rows = std::max<std::size_t>(1, colors.size() / width);
+    const int height = std::pow(2, std::ceil(std::log2(rows)));
+    if (!texture.isStorageAllocated() || texture.height() < height) {
+        texture.destroy();
+        setupTexture();
+        texture.setSize(width, height);
+        texture.allocateStorage();
+        dirtyBegin = 0;
+        dirtyEnd = index_to_id.size();
+    }
+    if (dirtyBegin < dirtyEnd) {// only patch the rows that changed
+        const int firstRow = dirtyBegin / width;
+        const int lastRow = (dirtyEnd - 1) / width;
+        texture.setData(0, firstRow, 0, width, lastRow - firstRow + 1, 1, QOpenGLTexture::RGBA, QOpenGLTexture::UInt32_RGBA8_Rev, colors.data() + static_cast<std::size_t>(firstRow) * width);
+    }
+    dirtyBegin = dirtyEnd = 0;
+}
+
+gpu_lut_cube::gpu_lut_cube(const Coordinate & gpucubeshape, gpu_lut & lut) : gpu_raw_cube(gpucubeshape, true), lut{lut} {}
+
+std::vector<std::uint64_t> gpu_lut_cube::gatherPalette(const void * data, const Coordinate & cpucubeshape, const Coordinate & gpucubeshape, const Coordinate & offset) {
+    std::vector<std::uint64_t> palette;
+    forEachSubArrayRow(reinterpret_cast<const std::uint64_t *>(data), cpucubeshape, gpucubeshape, offset, [&palette](auto begin, auto end, auto){
+        for (auto it = begin; it != end; ++it) {
+            if (palette.empty() || *it != palette.back()) {// skip runs
+                palette.emplace_back(*it);
+            }
+        }
+    });
+    std::sort(std::begin(palette), std::end(palette));
+    palette.erase(std::unique(std::begin(palette), std::end(palette)), std::end(palette));
+    return palette;
 }
 
-void gpu_lut_cube::upload(const std::vector<gpu_index> & data) {
-    lut.setSize(colors.size());
-    lut.allocateStorage();
+void gpu_lut_cube::prepare(const void * data, const Coordinate & cpucubeshape, const Coordinate & offset, std::vector<std::uint8_t> & staging) {
+    const auto * cubeData = reinterpret_cast<const std::uint64_t *>(data);
+    if (palette.empty()) {// not gathered ahead by the layer
+        palette = gatherPalette(data, cpucubeshape, shape, offset);
+    }
+    paletteIndices = lut.lookup(palette);
+    wide = !paletteIndices.empty() && *std::max_element(std::begin(paletteIndices), std::end(paletteIndices)) > std::numeric_limits<std::uint16_t>::max();
 
-    cube.setData(QOpenGLTexture::Red, QOpenGLTexture::UInt16, data.data());
-    const auto & colors = this->colors;
-    lut.setData(QOpenGLTexture::RGBA, QOpenGLTexture::UInt32_RGBA8_Rev, colors.data());
+    const auto remap = [&](auto * indices){
+        using index_t = std::remove_pointer_t<decltype(indices)>;
+        forEachSubArrayRow(cubeData, cpucubeshape, shape, offset, [this, indices](auto begin, auto end, auto dst){
+            std::uint64_t lastElem{palette.front()};
+            index_t lastIndex = paletteIndices.front();
+            std::transform(begin, end, indices + dst, [&](const std::uint64_t elem){
+                if (elem != lastElem) {
+                    const auto pos = std::lower_bound(std::begin(palette), std::end(palette), elem) - std::begin(palette);
+                    lastElem = elem;
+                    lastIndex = paletteIndices[pos];
+                }
+                return lastIndex;
+            });
+        });
+    };
+    if (wide) {// low 16 bit in R, high 16 bit in G
+        staging.resize(shape.prod() * sizeof(std::uint32_t));
+        remap(reinterpret_cast<std::uint32_t *>(staging.data()));
+    } else {
+        staging.resize(shape.prod() * sizeof(std::uint16_t));
+        remap(reinterpret_cast<std::uint16_t *>(staging.data()));
+    }
+    palette.clear();
 }
 
-void gpu_lut_cube::generate(boost::multi_array_ref<uint64_t, 3>::const_array_view<3>::type view) {
-    upload(prepare(view));
+void gpu_lut_cube::upload(const std::vector<std::uint8_t> & staging) {
+    const auto format = wide ? QOpenGLTexture::RG16_UNorm : QOpenGLTexture::R16_UNorm;
+    if (cube.format() != format) {// recycled cube of the other width
+        cube.destroy();
+        setupCube(format, QOpenGLTexture::Nearest);
+    }
+    cube.setData(wide ? QOpenGLTexture::RG : QOpenGLTexture::Red, QOpenGLTexture::UInt16, staging.data());
 }
 
 TextureLayer::TextureLayer(QOpenGLContext & sharectx) {
@@ -119,41 +238,99 @@ TextureLayer::~TextureLayer() {
     ctx.makeCurrent(&surface);//QOpenGLTexture dtor needs a current ctx
 }
 
-template<typename cube_type, typename elem_type>
-void TextureLayer::createBogusCube(const Coordinate & cpucubeshape, const Coordinate & gpucubeshape) {
-    ctx.makeCurrent(&surface);
-    std::vector<char> data;
-    data.resize(cpucubeshape.z * cpucubeshape.y * cpucubeshape.x * sizeof(elem_type));
-    std::fill(std::begin(data), std::end(data), 0);
-    bogusCube.reset(new cube_type(gpucubeshape));
-    boost::multi_array_ref<elem_type, 3> cube(reinterpret_cast<elem_type*>(data.data()), boost::extents[cpucubeshape.z][cpucubeshape.y][cpucubeshape.x]);
-    using range = boost::multi_array_types::index_range;
-    static_cast<cube_type*>(bogusCube.get())->generate(cube[boost::indices[range(0,gpucubeshape.z)][range(0,gpucubeshape.y)][range(0,gpucubeshape.x)]]);
+std::unique_ptr<gpu_raw_cube> TextureLayer::acquireCube(const Coordinate & gpucubeshape) {
+    if (!recycledCubes.empty()) {
+        auto cube = std::move(recycledCubes.back());
+        recycledCubes.pop_back();
+        cube->reset();
+        return cube;
+    }
+    if (isOverlayData) {
+        return std::make_unique<gpu_lut_cube>(gpucubeshape, lut);
+    }
+    return std::make_unique<gpu_raw_cube>(gpucubeshape);
 }
 
 void TextureLayer::createBogusCube(const Coordinate & cpucubeshape, const Coordinate & gpucubeshape) {
+    ctx.makeCurrent(&surface);
+    recycledCubes.clear();// shape may have changed
+    const std::vector<std::uint64_t> zeros(cpucubeshape.prod());// large enough for all element types
+    std::vector<std::uint8_t> staging;
+    bogusCube = acquireCube(gpucubeshape);
+    bogusCube->prepare(zeros.data(), cpucubeshape, {}, staging);
+    bogusCube->upload(staging);
     if (isOverlayData) {
-        createBogusCube<gpu_lut_cube, std::uint64_t>(cpucubeshape, gpucubeshape);
-    } else {
-        createBogusCube<gpu_raw_cube, std::uint8_t>(cpucubeshape, gpucubeshape);
+        lut.upload();
+    }
+}
+
+void TextureLayer::recycleCube(const CoordOfGPUCube & gpuCoord) {
+    auto it = textures.find(gpuCoord);
+    if (it != std::end(textures)) {
+        recycledCubes.emplace_back(std::move(it->second));
+        textures.erase(it);
     }
 }
 
-template<typename cube_type, typename elem_type>
-void TextureLayer::cubeSubArray(const boost::const_multi_array_ref<elem_type, 3> cube, const Coordinate & gpucubeshape, const CoordOfGPUCube & gpuCoord, const Coordinate & offset) {
+void TextureLayer::prepareCubes(const std::vector<PendingCube> & batch, const Coordinate & cpucubeshape, const Coordinate & gpucubeshape) {
     ctx.makeCurrent(&surface);
-    using range = boost::multi_array_types::index_range;
-    const auto view = cube[boost::indices[range(0+offset.z,gpucubeshape.z+offset.z)][range(0+offset.y,gpucubeshape.y+offset.y)][range(0+offset.x,gpucubeshape.x+offset.x)]];
-    textures[gpuCoord].reset(new cube_type(gpucubeshape));
-    static_cast<cube_type*>(textures[gpuCoord].get())->generate(view);
+    preparedCubes.clear();
+    std::vector<std::size_t> indices(batch.size());
+    std::iota(std::begin(indices), std::end(indices), 0);
+    std::vector<std::vector<std::uint64_t>> palettes(isOverlayData ? batch.size() : 0);
+    if (isOverlayData) {
+        QtConcurrent::blockingMap(indices, [&palettes, &batch, &cpucubeshape, &gpucubeshape](const std::size_t i){
+            palettes[i] = gpu_lut_cube::gatherPalette(batch[i].data, cpucubeshape, gpucubeshape, batch[i].offset);
+        });
+        std::vector<std::uint64_t> batchIds;
+        for (const auto & palette : palettes) {
+            batchIds.insert(std::end(batchIds), std::begin(palette), std::end(palette));
+        }
+        std::sort(std::begin(batchIds), std::end(batchIds));
+        batchIds.erase(std::unique(std::begin(batchIds), std::end(batchIds)), std::end(batchIds));
+        if (lut.size() + lut.countMissing(batchIds) > gpu_lut::capacity) {// start over with a fresh dictionary
+            std::vector<CoordOfGPUCube> uploaded;
+            for (const auto & pair : textures) {
+                uploaded.emplace_back(pair.first);
+            }
+            for (const auto & gpuCoord : uploaded) {
+                recycleCube(gpuCoord);
+            }
+            lut.clear();
+            std::vector<std::uint8_t> staging;// indices of the bogus cube referred to the old dictionary
+            bogusCube->prepare(std::vector<std::uint64_t>(cpucubeshape.prod()).data(), cpucubeshape, {}, staging);
+            bogusCube->upload(staging);
+        }
+    }
+    for (std::size_t i{0}; i < batch.size(); ++i) {
+        preparedCubes.emplace_back(batch[i].gpuCoord, acquireCube(gpucubeshape));
+        if (isOverlayData) {
+            static_cast<gpu_lut_cube &>(*preparedCubes.back().second).setPalette(std::move(palettes[i]));
+        }
+    }
+    stagingBuffers.resize(std::max(stagingBuffers.size(), batch.size()));
+    QtConcurrent::blockingMap(indices, [this, &batch, &cpucubeshape](const std::size_t i){
+        preparedCubes[i].second->prepare(batch[i].data, cpucubeshape, batch[i].offset, stagingBuffers[i]);
+    });
 }
 
-void TextureLayer::cubeSubArray(const void * data, const Coordinate & cpucubeshape, const Coordinate & gpucubeshape, const CoordOfGPUCube & gpuCoord, const Coordinate & offset) {
+void TextureLayer::uploadPreparedCubes() {
+    ctx.makeCurrent(&surface);
+    for (std::size_t i{0}; i < preparedCubes.size(); ++i) {
+        auto & [gpuCoord, cube] = preparedCubes[i];
+        cube->upload(stagingBuffers[i]);
+        textures[gpuCoord] = std::move(cube);
+    }
+    preparedCubes.clear();
     if (isOverlayData) {
-        boost::const_multi_array_ref<std::uint64_t, 3> cube(reinterpret_cast<const std::uint64_t *>(data), boost::extents[cpucubeshape.z][cpucubeshape.y][cpucubeshape.x]);
-        cubeSubArray<gpu_lut_cube>(cube, gpucubeshape, gpuCoord, offset);
-    } else {
-        boost::const_multi_array_ref<std::uint8_t, 3> cube(reinterpret_cast<const std::uint8_t *>(data), boost::extents[cpucubeshape.z][cpucubeshape.y][cpucubeshape.x]);
-        cubeSubArray<gpu_raw_cube>(cube, gpucubeshape, gpuCoord, offset);
+        lut.upload();
+    }
+}
+
+void TextureLayer::updateLut() {
+    if (isOverlayData && lut.recolorRequired) {
+        ctx.makeCurrent(&surface);
+        lut.recolor();
+        lut.upload();
     }
 }
@@ -24,14 +24,15 @@
 
 #include "coordinate.h"
 
+#include <QMutex>
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
 #include <QOpenGLTexture>
 #include <QVector3D>
 
 #include <boost/functional/hash.hpp>
-#include <boost/multi_array/multi_array_ref.hpp>
 
+#include <array>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -48,46 +49,87 @@ struct hash<QVector3D> {
 }
 
 class gpu_raw_cube {
+protected:
+    Coordinate shape;
+    void setupCube(const QOpenGLTexture::TextureFormat format, const QOpenGLTexture::Filter filter);
 public:
     QOpenGLTexture cube{QOpenGLTexture::Target3D};
     std::vector<floatCoordinate> vertices;
     gpu_raw_cube(const Coordinate & gpucubeshape, const bool index = false);
     virtual ~gpu_raw_cube() = default;
-    std::vector<char> prepare(boost::multi_array_ref<std::uint8_t, 3>::const_array_view<3>::type view);
-    void upload(const std::vector<char> & data);
-    void generate(boost::multi_array_ref<std::uint8_t, 3>::const_array_view<3>::type view);
+    virtual void reset();
+    virtual void prepare(const void * data, const Coordinate & cpucubeshape, const Coordinate & offset, std::vector<std::uint8_t> & staging);
+    virtual void upload(const std::vector<std::uint8_t> & staging);
 };
 
-class gpu_lut_cube : public gpu_raw_cube {
+/**
+ * @brief layer wide subobject id → compact index dictionary with one color lut texture shared by all gpu_lut_cubes
+ *
+ * Entries are only ever appended while cubes stream in, so indices stay valid for already uploaded cubes
+ * and recoloring only has to patch the lut texture.
+ */
+class gpu_lut {
+    QMutex mutex;
+    std::unordered_map<std::uint64_t, std::uint32_t> id_to_index;
+    std::vector<std::uint64_t> index_to_id;
+    std::vector<std::array<std::uint8_t, 4>> colors;// padded to full texture rows
+    std::size_t dirtyBegin{0};
+    std::size_t dirtyEnd{0};
+    void setupTexture();
 public:
-    using gpu_index = std::uint16_t;
-private:
-    std::unordered_map<std::uint64_t, gpu_index> id_to_lut_index;
-    gpu_index highest_index = 0;
-    std::vector<std::array<std::uint8_t, 4>> colors;
+    static constexpr int width = 4096;
+    static constexpr std::size_t capacity = 1 << 24;// indices are reconstructed from float channels in the shader
+    QOpenGLTexture texture{QOpenGLTexture::Target2D};
+    bool recolorRequired{false};
+    gpu_lut();
+    std::size_t size();
+    void clear();
+    std::size_t countMissing(const std::vector<std::uint64_t> & sortedIds);
+    std::vector<std::uint32_t> lookup(const std::vector<std::uint64_t> & ids);
+    void recolor();
+    void upload();
+};
+
+class gpu_lut_cube : public gpu_raw_cube {
+    gpu_lut & lut;
+    std::vector<std::uint64_t> palette;// sorted ids of this cube
+    std::vector<std::uint32_t> paletteIndices;
+    bool wide{false};// indices need 32 bit (RG16) instead of 16 bit (R16)
 public:
-    QOpenGLTexture lut{QOpenGLTexture::Target1D};
-    gpu_lut_cube(const Coordinate & gpucubeshape);
-    std::vector<gpu_index> prepare(boost::multi_array_ref<uint64_t, 3>::const_array_view<3>::type view);
-    void upload(const std::vector<gpu_index> & data);
-    void generate(boost::multi_array_ref<std::uint64_t, 3>::const_array_view<3>::type view);
+    gpu_lut_cube(const Coordinate & gpucubeshape, gpu_lut & lut);
+    static std::vector<std::uint64_t> gatherPalette(const void * data, const Coordinate & cpucubeshape, const Coordinate & gpucubeshape, const Coordinate & offset);
+    void setPalette(std::vector<std::uint64_t> && ids) { palette = std::move(ids); }// gathered ahead, skips it in prepare
+    void prepare(const void * data, const Coordinate & cpucubeshape, const Coordinate & offset, std::vector<std::uint8_t> & staging) override;
+    void upload(const std::vector<std::uint8_t> & staging) override;
 };
 
 class TextureLayer {
 public:
+    struct PendingCube {
+        CoordOfGPUCube gpuCoord;
+        Coordinate offset;
+        const void * data;
+    };
     QOffscreenSurface surface;
     QOpenGLContext ctx;//ctx has to live past textures
+    gpu_lut lut;
     std::unordered_map<CoordOfGPUCube, std::unique_ptr<gpu_raw_cube>> textures;
     std::unique_ptr<gpu_raw_cube> bogusCube;
     bool isOverlayData = false;
     std::vector<std::pair<CoordOfGPUCube, Coordinate>> pendingOrthoCubes;
     std::vector<std::pair<CoordOfGPUCube, Coordinate>> pendingArbCubes;
+private:
+    std::vector<std::unique_ptr<gpu_raw_cube>> recycledCubes;
+    std::vector<std::pair<CoordOfGPUCube, std::unique_ptr<gpu_raw_cube>>> preparedCubes;
+    std::vector<std::vector<std::uint8_t>> stagingBuffers;// reused across batches
+    std::unique_ptr<gpu_raw_cube> acquireCube(const Coordinate & gpucubeshape);
+public:
     TextureLayer(QOpenGLContext & sharectx);
     ~TextureLayer();
-    template<typename cube_type, typename elem_type>
-    void createBogusCube(const Coordinate & cpucubeshape, const Coordinate & gpucubeshape);
     void createBogusCube(const Coordinate & cpucubeshape, const Coordinate & gpucubeshape);
-    template<typename cube_type, typename elem_type>
-    void cubeSubArray(const boost::const_multi_array_ref<elem_type, 3> cube, const Coordinate & gpucubeshape, const CoordOfGPUCube & gpuCoord, const Coordinate & offset);
-    void cubeSubArray(const void * data, const Coordinate &  cpucubeshape, const Coordinate & gpucubeshape, const CoordOfGPUCube & gpuCoord, const Coordinate & offset);
+    void recycleCube(const CoordOfGPUCube & gpuCoord);
+    // gathers the sub arrays in parallel, cpu cubes have to stay valid until this returns
+    void prepareCubes(const std::vector<PendingCube> & batch, const Coordinate & cpucubeshape, const Coordinate & gpucubeshape);
+    void uploadPreparedCubes();
+    void updateLut();
 };
@@ -29,9 +29,11 @@
 #include <QString>
 #include <QWaitCondition>
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
+class PaletteCube;
 class stateInfo;
 inline stateInfo * state{nullptr};
 
@@ -47,6 +49,16 @@ inline void * cubeQuery(const coord2bytep_map_t &h, const std::size_t layerId, c
     }
 }
 
+using coord2palette_map_t = std::vector<std::vector<std::unordered_map<CoordOfCube, std::shared_ptr<const PaletteCube>>>>;
+
+inline std::shared_ptr<const PaletteCube> paletteQuery(const coord2palette_map_t &h, const std::size_t layerId, const std::size_t magindex, const CoordOfCube &c) {
+    try {
+        return h.at(layerId).at(magindex).at(c);
+    } catch (const std::out_of_range &) {
+        return nullptr;
+    }
+}
+
 // Bytes for an object ID.
 #define OBJID_BYTES sizeof(uint64_t)
 
@@ -81,6 +93,9 @@ public:
     // Whenever we access a datacube in memory, we do so through
     // this structure.
     coord2bytep_map_t cube2Pointer;
+    // unedited overlay cubes are resident in packed form instead,
+    // shared pointers keep them alive for readers after unlocking
+    coord2palette_map_t cube2Palette;
 
     struct ViewerState * viewerState;
     class MainWindow * mainWindow{nullptr};
@@ -26,6 +26,7 @@
 #include "annotation/file_io.h"
 #include "functions.h"
 #include "loader.h"
+#include "segmentation/palettecube.h"
 #include "segmentation/segmentation.h"
 #include "skeleton/skeletonizer.h"
 #include "stateInfo.h"
@@ -39,6 +40,8 @@
 #include <QElapsedTimer>
 #include <QFutureSynchronizer>
 #include <QMetaObject>
+#include <QMutexLocker>
+#include <QThread>
 #include <QtConcurrentRun>
 #include <QVector3D>
 
@@ -70,47 +73,74 @@ Viewer::Viewer() : evilHack{[this](){ state->viewer = this; return true; }()} {
     QObject::connect(&Segmentation::singleton(), &Segmentation::renderOnlySelectedObjsChanged, this, &Viewer::segmentation_changed);
 
     static auto regVBuff = [](){
-        state->viewerState->AllTreesBuffers.regenVertBuffer = true;
-        state->viewerState->selectedTreesBuffers.regenVertBuffer = true;
+        state->viewerState->skeletonBuffers.regenVertBuffer = true;
+        state->mainWindow->forEachVPDo([](ViewportBase & vp) {
+            vp.update();
+        });
+    };
+    // patch the slots of single nodes, segments and trees, unless everything is regenerated anyway
+    static auto patchVBuff = [](auto func){
+        auto & buffers = state->viewerState->skeletonBuffers;
+        if (buffers.synapseFocus || GLBuffers::darkeningActive()) {
+            buffers.regenVertBuffer = true;
+        } else if (!buffers.regenVertBuffer) {
+            func(buffers);
+        }
         state->mainWindow->forEachVPDo([](ViewportBase & vp) {
             vp.update();
         });
     };
 
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::guiModeLoaded, regVBuff);
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeAddedSignal, regVBuff);
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeChangedSignal, regVBuff);
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeRemovedSignal, regVBuff);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeAddedSignal, [](const nodeListElement & node){
+        patchVBuff([&node](GLBuffers & buffers){ buffers.writeNode(node); });
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeChangedSignal, [](const nodeListElement & node){
+        patchVBuff([&node](GLBuffers & buffers){ buffers.writeNode(node); });
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeRemovedSignal, [](const std::uint64_t nodeID){
+        patchVBuff([nodeID](GLBuffers & buffers){ buffers.removeNode(nodeID); });
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::segmentAdded, [](const quint64 sourceID, const quint64 targetID){
+        patchVBuff([sourceID, targetID](GLBuffers & buffers){
+            const auto * source = Skeletonizer::singleton().findNodeByNodeID(sourceID);
+            const auto * target = Skeletonizer::singleton().findNodeByNodeID(targetID);
+            if (source != nullptr && target != nullptr) {
+                buffers.writeSegment(*source, *target);
+            }
+        });
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::segmentRemoved, [](const quint64 sourceID, const quint64 targetID){
+        patchVBuff([sourceID, targetID](GLBuffers & buffers){ buffers.removeSegment(sourceID, targetID); });
+    });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::propertiesChanged, regVBuff);
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeAddedSignal, regVBuff);
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeChangedSignal, regVBuff);
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeRemovedSignal, regVBuff);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeAddedSignal, [](const treeListElement & tree){
+        patchVBuff([&tree](GLBuffers & buffers){ buffers.writeTree(tree); });
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeChangedSignal, [](const treeListElement & tree){
+        patchVBuff([&tree](GLBuffers & buffers){ buffers.writeTree(tree); });
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeRemovedSignal, [](const std::uint64_t treeID){
+        patchVBuff([treeID](GLBuffers & buffers){ buffers.removeTree(treeID); });
+    });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treesMerged, regVBuff);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treePagedSignal, [](const treeListElement & tree){
+        patchVBuff([&tree](GLBuffers & buffers){
+            buffers.removeTree(tree.treeID);
+            buffers.writeTree(tree);
+        });
+    });
+    QObject::connect(this, &Viewer::coordinateChangedSignal, &Skeletonizer::singleton(), &Skeletonizer::pageByPosition);
 
-    static auto updateSelectionColor = [this](GLBuffers & glBuffers) {
-        if (!glBuffers.regenVertBuffer) {
-            auto & svp = glBuffers.pointVertBuffer;
-            auto setColorAtOffset = [&svp](auto offset, auto color){
-                svp.colors[offset] = {{static_cast<std::uint8_t>(color.red()), static_cast<std::uint8_t>(color.green()), static_cast<std::uint8_t>(color.blue()), static_cast<std::uint8_t>(color.alpha())}};
-                svp.color_buffer.bind();
-                svp.color_buffer.write(static_cast<int>(offset * sizeof(svp.colors[offset])), &svp.colors[offset], sizeof(svp.colors[offset]));
-                svp.color_buffer.release();
-            };
-            if (svp.colorBufferOffset.count(svp.lastSelectedNode)) {// restore old node color
-                setColorAtOffset(svp.colorBufferOffset[svp.lastSelectedNode], getNodeColor(*state->skeletonState->nodesByNodeID[svp.lastSelectedNode]));
-            }
-            svp.lastSelectedNode = state->skeletonState->selectedNodes.front()->nodeID;
-            if (svp.colorBufferOffset.count(svp.lastSelectedNode)) {// colorize new active node
-                setColorAtOffset(svp.colorBufferOffset[svp.lastSelectedNode], QColor{Qt::green});
-            }
-        } else {
-            glBuffers.regenVertBuffer = true;
-        }
-    };
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeSelectionChangedSignal, []() {
         if (state->skeletonState->selectedNodes.size() == 1) {
-            updateSelectionColor(state->viewerState->AllTreesBuffers);
-            updateSelectionColor(state->viewerState->selectedTreesBuffers);
+            patchVBuff([](GLBuffers & buffers){
+                const auto * previous = Skeletonizer::singleton().findNodeByNodeID(buffers.pointVertBuffer.lastSelectedNode);
+                if (previous != nullptr) {// restore old node color
+                    buffers.writeNode(*previous);
+                }
+                buffers.writeNode(*state->skeletonState->selectedNodes.front());// colorize new active node
+            });
         }
     });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeSelectionChangedSignal, regVBuff);
@@ -313,6 +343,35 @@ void Viewer::dcSliceExtract(std::uint8_t * datacube, Coordinate cubePosInAbsPx,
     }
 }
 
+void Viewer::dcFallbackSliceExtract(std::uint8_t * datacube, const Coordinate cubePosInAbsPx, const Dataset & coarse, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId) {
+    const auto & dataset = Dataset::datasets[layerId];
+    const auto cubeShape = dataset.cubeShape;
+    // cubes of the current mag are aligned to the coarse cubes, so the whole tile lies inside one of them
+    const auto inCube = cubePosInAbsPx.insideCube(cubeShape, coarse.scaleFactor);
+    const auto ratio = coarse.scaleFactor / dataset.scaleFactor;
+    const Coordinate step(std::max(1.f, std::round(ratio.x)), std::max(1.f, std::round(ratio.y)), std::max(1.f, std::round(ratio.z)));
+    const Coordinate axisX(vp.viewportType != VIEWPORT_ZY, vp.viewportType == VIEWPORT_ZY, 0);
+    const Coordinate axisY(0, vp.viewportType == VIEWPORT_XY, vp.viewportType != VIEWPORT_XY);
+    const std::size_t texNext = vp.viewportType == VIEWPORT_ZY ? cubeShape.x * 4 : 4;// same texel order as dcSliceExtract
+    const std::ptrdiff_t texNextLine = vp.viewportType == VIEWPORT_ZY ? 4 - 4 * cubeShape.y * cubeShape.x : 0;
+
+    const bool isDatasetAdjustment = state->viewerState->datasetColortableOn || dataset.renderSettings.bias > 0.0 || dataset.renderSettings.rangeDelta < 1.0;
+    for (int yzz = 0; yzz < (vp.viewportType == VIEWPORT_XY ? cubeShape.y : cubeShape.z); ++yzz) {
+        for (int xxy = 0; xxy < (vp.viewportType == VIEWPORT_ZY ? cubeShape.y : cubeShape.x); ++xxy) {
+            const auto voxel = Coordinate(inCube.x, inCube.y, inCube.z) + (axisX * xxy + axisY * yzz) / step;
+            const auto value = datacube[voxel.x + voxel.y * cubeShape.x + voxel.z * cubeShape.x * cubeShape.y];
+            if (isDatasetAdjustment) {
+                std::tie(slice[0], slice[1], slice[2]) = datasetAdjustment(layerId, value);
+            } else {
+                slice[0] = slice[1] = slice[2] = value;
+            }
+            slice[3] = 255;
+            slice += texNext;
+        }
+        slice += texNextLine;
+    }
+}
+
 void Viewer::dcSliceExtract(std::uint8_t * datacube, floatCoordinate *currentPxInDc_float, std::uint8_t * slice, int s, int *t, const floatCoordinate & v2, const std::size_t layerId, float usedSizeInCubePixels) {
     Coordinate currentPxInDc = {roundFloat(currentPxInDc_float->x), roundFloat(currentPxInDc_float->y), roundFloat(currentPxInDc_float->z)};
     const auto cubeShape = Dataset::current().cubeShape;
@@ -362,6 +421,7 @@ void Viewer::dcSliceExtract(std::uint8_t * datacube, floatCoordinate *currentPxI
  * @brief Viewer::ocSliceExtract extracts subObject IDs from datacube
  *      and paints slice at the corresponding position with a color depending on the ID.
  * @param datacube pointer to the datacube for data extraction
+ * @param strides element strides of the datacube along x, y and z, only those within the slice are used
  * @param cubePosInAbsPx smallest coordinates inside the datacube in dataset pixels
  * @param slice pointer to a slice in which to draw the overlay
  *
@@ -374,12 +434,12 @@ void Viewer::dcSliceExtract(std::uint8_t * datacube, floatCoordinate *currentPxI
  * each pixel is tested for its position and is omitted if outside of the area.
  *
  */
-void Viewer::ocSliceExtract(std::uint64_t * datacube, Coordinate cubePosInAbsPx, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId) {
+void Viewer::ocSliceExtract(const std::uint64_t * datacube, const Coordinate & strides, Coordinate cubePosInAbsPx, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId) {
     const auto cubeShape = Dataset::datasets[layerId].cubeShape;
     // we traverse ZY column first because of better locailty of reference
-    const std::size_t voxelIncrement = vp.viewportType == VIEWPORT_ZY ? cubeShape.x : 1;
-    const std::size_t sliceIncrement = vp.viewportType == VIEWPORT_XY ? cubeShape.x : cubeShape.x * cubeShape.y;
-    const std::size_t lineIncrement = vp.viewportType == VIEWPORT_ZY ? 0 : sliceIncrement - cubeShape.x;
+    const std::size_t voxelIncrement = vp.viewportType == VIEWPORT_ZY ? strides.y : strides.x;
+    const std::size_t sliceIncrement = vp.viewportType == VIEWPORT_XY ? strides.y : strides.z;
+    const std::size_t lineIncrement = vp.viewportType == VIEWPORT_ZY ? 0 : sliceIncrement - cubeShape.x * voxelIncrement;
     const std::size_t texNext = vp.viewportType == VIEWPORT_ZY ? cubeShape.x * 4 : 4;// RGBA per pixel
     const std::ptrdiff_t texNextLine = vp.viewportType == VIEWPORT_ZY ? 4 - 4 * cubeShape.y * cubeShape.x : 0;// don’t rely on unsigned overflow
 
@@ -455,10 +515,10 @@ void Viewer::ocSliceExtract(std::uint64_t * datacube, Coordinate cubePosInAbsPx,
                     uint64_t objectId = seg.tryLargestObjectContainingSubobject(subobjectId);
                     if (selected && seg.mouseFocusedObjectId == objectId) {
                         if(isPastFirstRow && isBeforeLastRow && isNotFirstColumn && isNotLastColumn) {
-                            const uint64_t left   = seg.tryLargestObjectContainingSubobject(*reinterpret_cast<uint64_t*>(datacube - voxelIncrement));
-                            const uint64_t right  = seg.tryLargestObjectContainingSubobject(*reinterpret_cast<uint64_t*>(datacube + voxelIncrement));
-                            const uint64_t top    = seg.tryLargestObjectContainingSubobject(*reinterpret_cast<uint64_t*>(datacube - sliceIncrement));
-                            const uint64_t bottom = seg.tryLargestObjectContainingSubobject(*reinterpret_cast<uint64_t*>(datacube + sliceIncrement));
+                            const uint64_t left   = seg.tryLargestObjectContainingSubobject(datacube[-voxelIncrement]);
+                            const uint64_t right  = seg.tryLargestObjectContainingSubobject(datacube[+voxelIncrement]);
+                            const uint64_t top    = seg.tryLargestObjectContainingSubobject(datacube[-sliceIncrement]);
+                            const uint64_t bottom = seg.tryLargestObjectContainingSubobject(datacube[+sliceIncrement]);
                             //enhance alpha of this voxel if any of the surrounding voxels belong to another object
                             if (objectId != left || objectId != right || objectId != top || objectId != bottom) {
                                 slice[3] = std::min(255, slice[3]*4);
@@ -546,18 +606,34 @@ void Viewer::vpGenerateTexture(ViewportOrtho & vp, const std::size_t layerId) {
             int slicePositionWithinCube = vp.n.componentMul(currentPosition_inside_dc.componentMul(Coordinate{1, cubeShape.x, cubeShape.y * cubeShape.x})).length();
             Coordinate offsetCubeGlobal = vp.n.componentMul(vp.n.componentMul(currentPosition_inside_dc));// ensure n is positive by multiplying with itself
 
-            state->protectCube2Pointer.lock();
-            void * const cube = cubeQuery(state->cube2Pointer, layerId, Dataset::datasets[layerId].magIndex, currentDc);
-            state->protectCube2Pointer.unlock();
-
             // Take care of the data textures.
             Coordinate slicePosInAbsPx = Dataset::datasets[layerId].cube2global(currentDc) + Dataset::datasets[layerId].scaleFactor.componentMul(offsetCubeGlobal);
+            const auto magIndex = Dataset::datasets[layerId].magIndex;
+            boost::optional<Dataset> fallback;
+            state->protectCube2Pointer.lock();
+            void * cube = cubeQuery(state->cube2Pointer, layerId, magIndex, currentDc);
+            const auto packedCube = cube == nullptr ? paletteQuery(state->cube2Palette, layerId, magIndex, currentDc) : nullptr;
+            if (cube == nullptr && !Dataset::datasets[layerId].isOverlay()) {// preview a coarser mag until the current one is loaded
+                for (auto mag = magIndex + 1; cube == nullptr && mag <= magIndex + Loader::fallbackMagCount; ++mag) {
+                    fallback = Dataset::datasets[layerId].atMagIndex(mag);
+                    cube = cubeQuery(state->cube2Pointer, layerId, mag, fallback->global2cube(slicePosInAbsPx));
+                }
+            }
+            state->protectCube2Pointer.unlock();
             // This is used to index into the texture. overlayData[index] is the first
             // byte of the datacube slice at position (x_dc, y_dc) in the texture.
-            sync.addFuture(QtConcurrent::run([this, &vp, cube, first, slicePositionWithinCube, slicePosInAbsPx, index, layerId, cubeShape]()  {
-                if (cube != nullptr) {
+            sync.addFuture(QtConcurrent::run([this, &vp, cube, packedCube, fallback, first, slicePositionWithinCube, currentPosition_inside_dc, slicePosInAbsPx, index, layerId, cubeShape]()  {
+                if (packedCube != nullptr) {// only the slice is unpacked, its strides replace the ones of the cube
+                    const std::size_t axis = vp.viewportType == VIEWPORT_ZY ? 0 : vp.viewportType == VIEWPORT_XZ ? 1 : 2;
+                    const auto depth = axis == 0 ? currentPosition_inside_dc.x : axis == 1 ? currentPosition_inside_dc.y : currentPosition_inside_dc.z;
+                    const auto plane = packedCube->plane(axis, depth);
+                    const Coordinate strides = axis == 0 ? Coordinate{0, 1, cubeShape.y} : axis == 1 ? Coordinate{1, 0, cubeShape.x} : Coordinate{1, cubeShape.x, 0};
+                    ocSliceExtract(plane.data(), strides, slicePosInAbsPx, vp.texture.texData[layerId].data() + index, vp, layerId);
+                } else if (cube != nullptr && fallback) {
+                    dcFallbackSliceExtract(reinterpret_cast<std::uint8_t *>(cube), slicePosInAbsPx, fallback.get(), vp.texture.texData[layerId].data() + index, vp, layerId);
+                } else if (cube != nullptr) {
                     if (Dataset::datasets[layerId].isOverlay()) {
-                        ocSliceExtract(reinterpret_cast<std::uint64_t *>(cube) + slicePositionWithinCube, slicePosInAbsPx, vp.texture.texData[layerId].data() + index, vp, layerId);
+                        ocSliceExtract(reinterpret_cast<std::uint64_t *>(cube) + slicePositionWithinCube, {1, cubeShape.x, cubeShape.y * cubeShape.x}, slicePosInAbsPx, vp.texture.texData[layerId].data() + index, vp, layerId);
                     } else {
                         const auto combine = boost::make_optional(!first, Dataset::datasets[layerId].renderSettings.combineSlicesType);
                         dcSliceExtract(reinterpret_cast<std::uint8_t  *>(cube) + slicePositionWithinCube, slicePosInAbsPx, vp.texture.texData[layerId].data() + index, vp, layerId, combine);
@@ -839,7 +915,11 @@ void Viewer::zoomReset() {
 }
 
 bool Viewer::updateDatasetMag(const int mag) {
-    Loader::Controller::singleton().unloadCurrentMagnification(); //unload all the cubes
+    if (mag == 0) {
+        Loader::Controller::singleton().unloadCurrentMagnification(); //unload all the cubes
+    } else {
+        Loader::Controller::singleton().demoteCurrentMagnification();// loaded cubes stay as preview for the new mag
+    }
     if (mag != 0) {// change global mag after unloading
         const bool powerOf2 = mag > 0 && (mag & (mag - 1)) == 0;
         if (!powerOf2 || mag < Dataset::current().lowestAvailableMag || mag > Dataset::current().highestAvailableMag) {
@@ -909,35 +989,51 @@ void Viewer::run() {
     // might cancel the current loading process. When all textures
     // have been processed, we go into an idle state, in which we wait for events.
     if (state->gpuSlicer && gpuRendering) {
+        const auto batchSize = static_cast<std::size_t>(std::max(1, QThread::idealThreadCount()));
         const auto & loadPendingCubes = [&](const Dataset & dset, TextureLayer & layer, auto layerId, std::vector<std::pair<CoordOfGPUCube, Coordinate>> & pendingCubes, QElapsedTimer & timer) {
+            std::vector<TextureLayer::PendingCube> batch;
+            std::unordered_map<CoordOfCube, std::vector<std::uint64_t>> unpackedCubes;// shared by the gpu cubes within
             while (!pendingCubes.empty() && !timer.hasExpired(30)) {
-                const auto pair = pendingCubes.back();
-                pendingCubes.pop_back();
-                if (layer.textures.find(pair.first) == std::end(layer.textures)) {
-                    const auto globalCoord = pair.first.cube2Global(dset.gpuCubeShape, dset.scaleFactor);
-                    const auto cubeCoord = dset.global2cube(globalCoord);
-                    state->protectCube2Pointer.lock();
-                    const auto * ptr = cubeQuery(state->cube2Pointer, layerId, dset.magIndex, cubeCoord);
-                    state->protectCube2Pointer.unlock();
-                    if (ptr != nullptr) {
-                        layer.cubeSubArray(ptr, dset.cubeShape, dset.gpuCubeShape, pair.first, pair.second);
+                batch.clear();
+                QMutexLocker locker(&state->protectCube2Pointer);// cpu cubes must not be recycled while they are gathered
+                while (!pendingCubes.empty() && batch.size() < batchSize) {
+                    const auto pair = pendingCubes.back();
+                    pendingCubes.pop_back();
+                    if (layer.textures.find(pair.first) == std::end(layer.textures)) {
+                        const auto globalCoord = pair.first.cube2Global(dset.gpuCubeShape, dset.scaleFactor);
+                        const auto cubeCoord = dset.global2cube(globalCoord);
+                        const void * ptr = cubeQuery(state->cube2Pointer, layerId, dset.magIndex, cubeCoord);
+                        if (ptr == nullptr) {
+                            if (const auto packedCube = paletteQuery(state->cube2Palette, layerId, dset.magIndex, cubeCoord)) {
+                                auto [it, inserted] = unpackedCubes.try_emplace(cubeCoord);
+                                if (inserted) {
+                                    it->second.resize(dset.cubeShape.prod());
+                                    packedCube->decode(it->second.data());
+                                }
+                                ptr = it->second.data();
+                            }
+                        }
+                        if (ptr != nullptr) {
+                            batch.push_back({pair.first, pair.second, ptr});
+                        }
                     }
                 }
+                layer.prepareCubes(batch, dset.cubeShape, dset.gpuCubeShape);
+                locker.unlock();
+                layer.uploadPreparedCubes();
             }
         };
 
         QElapsedTimer timer;
         timer.start();
-        qDebug() << "loadPendingCubes";
         std::size_t id{};
         for (auto && [dset, textures] : boost::combine(Dataset::datasets, layers)) {
+            textures.updateLut();
             calculateMissingOrthoGPUCubes(dset, textures);
-            qDebug() << textures.pendingOrthoCubes.size() << textures.pendingArbCubes.size() << textures.textures.size();
             loadPendingCubes(dset, textures, id, textures.pendingOrthoCubes, timer);
             loadPendingCubes(dset, textures, id, textures.pendingArbCubes, timer);
             ++id;
         }
-        qDebug() << "loadPendingCubes" << timer.nsecsElapsed()/1e6;
     }
 
     window->forEachOrthoVPDo([](ViewportOrtho & vp) {
@@ -1053,7 +1149,7 @@ void Viewer::userMoveVoxels(const Coordinate & step, UserMoveType userMoveType,
                 }
             }
             for (const auto & pos : obsoleteCubes) {
-                textures.textures.erase(pos);
+                textures.recycleCube(pos);
             }
             calculateMissingOrthoGPUCubes(dset, textures);
         }
@@ -1131,7 +1227,7 @@ void Viewer::reslice_notify_all(const std::size_t layerId, boost::optional<Coord
     window->viewportArb->resliceNecessary[layerId] = true;//arb visibility is not tested
     if (layerId == Segmentation::singleton().layerId) {
         // if anything has changed, update the volume texture data
-        Segmentation::singleton().volume_update_required = true;
+        Segmentation::singleton().volumeUpdate(cubeCoord);
     }
     QMetaObject::invokeMethod(this, &Viewer::run);// multi thread support
 }
@@ -1140,6 +1236,9 @@ void Viewer::segmentation_changed() {
     if (Segmentation::singleton().enabled) {
         reslice_notify(Segmentation::singleton().layerId);
     }
+    for (auto & layer : layers) {// gpu cubes only store compact indices, colors live in the lut
+        layer.lut.recolorRequired = layer.isOverlayData;
+    }
 }
 
 void Viewer::recalcTextureOffsets() {
@@ -38,6 +38,9 @@
 #include <QQuaternion>
 #include <QTimer>
 
+#include <array>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 enum TreeDisplay {
@@ -58,32 +61,71 @@ enum class RotationCenter {
     CurrentPosition
 };
 
+class nodeListElement;
+class treeListElement;
+
 struct GLBuffers {
+    using Color = std::array<std::uint8_t, 4>;
+    using SlotKey = std::pair<std::uint64_t, std::uint64_t>;// node id and 0 or segment source and target id
+
     bool regenVertBuffer{true};
+    bool highlightSelection{true};
+    bool synapseFocus{false};// darkening depends on the whole skeleton
+    static bool darkeningActive();
 
     // vertex buffers that are available for rendering
+    // every tree owns one chunk of slots per buffer, so edits only touch (and upload) single slots
     struct RenderBuffer {
+        struct Chunk {
+            const treeListElement * tree;
+            std::size_t offset;
+            std::size_t capacity;
+            std::size_t size{0};
+        };
+        const std::size_t vertsPerSlot;
+        const bool picking;
         std::vector<floatCoordinate> vertices;
-        std::vector<std::array<std::uint8_t, 4>> colors;
-        std::unordered_map<size_t, unsigned int> colorBufferOffset;
+        std::vector<Color> colors;
+        std::array<std::vector<Color>, 3> pickingColors;// node id bits 0–24, 24–48, 48–64
+        std::vector<SlotKey> slotKeys;
+        std::unordered_map<SlotKey, std::pair<std::uint64_t, std::size_t>, boost::hash<SlotKey>> slots;// tree id and slot
+        std::unordered_map<std::uint64_t, Chunk> chunks;// by tree id
+        std::vector<std::pair<std::size_t, std::size_t>> freeChunks;// offset and capacity
+        std::size_t dirtyBegin{0}, dirtyEnd{0};// slots that changed since the last upload
+        std::size_t gpuVertices{0};
         QOpenGLBuffer vertex_buffer{QOpenGLBuffer::VertexBuffer};
         QOpenGLBuffer color_buffer{QOpenGLBuffer::VertexBuffer};
 
-        size_t lastSelectedNode{0};
-
-        void clear() {
-            vertices.clear();
-            colors.clear();
-            colorBufferOffset.clear();
-        }
-
-        template<typename T, typename U>
-        void emplace_back(T&& coord, U&& color) {
-            vertices.emplace_back(std::forward<T>(coord));
-            colors.emplace_back(std::forward<U>(color));
+        std::uint64_t lastSelectedNode{0};
+
+        RenderBuffer(const std::size_t vertsPerSlot, const bool picking) : vertsPerSlot{vertsPerSlot}, picking{picking} {}
+        void clear();
+        void reserve(const treeListElement & tree, const std::size_t count);
+        std::size_t slot(const treeListElement & tree, const SlotKey & key);
+        void remove(const SlotKey & key);
+        void removeTree(const std::uint64_t treeID);
+        void markDirty(const std::size_t slot);
+        void upload();
+        template<typename Func>
+        void forEachRange(Func func) const {
+            for (const auto & elem : chunks) {
+                if (elem.second.size > 0) {
+                    func(*elem.second.tree, elem.second.offset * vertsPerSlot, elem.second.size * vertsPerSlot);
+                }
+            }
         }
-    } lineVertBuffer, pointVertBuffer;
-    std::vector<std::array<std::uint8_t, 4>> colorPickingBuffer24, colorPickingBuffer48, colorPickingBuffer64;
+    private:
+        std::size_t allocate(const std::size_t capacity);
+        void moveSlot(const std::size_t from, const std::size_t to);
+    } lineVertBuffer{2, false}, pointVertBuffer{1, true};
+
+    void writeTree(const treeListElement & tree);
+    void writeNodeSlot(const nodeListElement & node);
+    void writeNode(const nodeListElement & node);
+    void writeSegment(const nodeListElement & source, const nodeListElement & target);
+    void removeTree(const std::uint64_t treeID);
+    void removeNode(const std::uint64_t nodeID);
+    void removeSegment(const std::uint64_t sourceID, const std::uint64_t targetID);
 };
 
 struct ViewerState {
@@ -172,8 +214,7 @@ struct ViewerState {
     double meshAlphaFactorSlicing{0.5};
     bool MeshPickingEnabled{true};
 
-    GLBuffers AllTreesBuffers;
-    GLBuffers selectedTreesBuffers;
+    GLBuffers skeletonBuffers;
 };
 
 class ViewportBase;
@@ -189,9 +230,10 @@ private:
     void vpGenerateTexture(ViewportArb & vp, const std::size_t layerId);
 
     void dcSliceExtract(std::uint8_t * datacube, Coordinate cubePosInAbsPx, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId, const boost::optional<decltype(Dataset::LayerRenderSettings::combineSlicesType)> combineType);
+    void dcFallbackSliceExtract(std::uint8_t * datacube, const Coordinate cubePosInAbsPx, const Dataset & coarse, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId);
     void dcSliceExtract(std::uint8_t * datacube, floatCoordinate *currentPxInDc_float, std::uint8_t * slice, int s, int *t, const floatCoordinate & v2, const std::size_t layerId, float usedSizeInCubePixels);
 
-    void ocSliceExtract(std::uint64_t * datacube, Coordinate cubePosInAbsPx, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId);
+    void ocSliceExtract(const std::uint64_t * datacube, const Coordinate & strides, Coordinate cubePosInAbsPx, std::uint8_t * slice, ViewportOrtho & vp, const std::size_t layerId);
 
     void calcLeftUpperTexAbsPx();
 
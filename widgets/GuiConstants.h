@@ -53,6 +53,8 @@ const QString VISIBLE = "visible";
 const QString AUTOINC_FILENAME = "autoinc_filename";
 const QString AUTO_SAVING = "auto_saving";
 const QString PLY_SAVE_AS_BIN = "ply_save_as_bin";
+const QString MESH_SAVE_COMPRESSED = "mesh_save_compressed";
+const QString SKELETON_SAVE_AS_COLUMNS = "skeleton_save_as_columns";
 const QString SAVE_ANNOTATION_TIME = "save_annotation_time";
 const QString SAVE_DATASET_PATH = "save_dataset_path";
 const QString SAVING_INTERVAL = "saving_interval";
@@ -81,6 +83,7 @@ const QString SHOW_SKELETON_3DVP = "show_skeleton_3dvp";
 const QString SHOW_SKELETON_ORTHOVPS = "show_skeleton_orthovps";
 const QString TREE_LUT_FILE = "tree_lut_file";
 const QString TREE_LUT_FILE_USED = "tree_lut_file_used";
+const QString TREE_PAGING = "tree_paging";
 const QString TREE_VISIBILITY_3DVP = "tree_visibility_3dvp";
 const QString TREE_VISIBILITY_ORTHOVPS = "tree_visibility_orthovps";
 
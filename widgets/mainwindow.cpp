@@ -30,6 +30,7 @@
 #include "loader.h"
 #include "mainwindow.h"
 #include "network.h"
+#include "regionexport.h"
 #include "scriptengine/scripting.h"
 #include "segmentation/cubeloader.h"
 #include "skeleton/swc.h"
@@ -57,6 +58,7 @@
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QGridLayout>
+#include <QInputDialog>
 #include <QKeySequence>
 #include <QLabel>
 #include <QLayout>
@@ -624,6 +626,7 @@ void MainWindow::createMenus() {
     });
     fileMenu.addSeparator();
     fileMenu.addAction(tr("Export to nml..."), this, &MainWindow::exportToNml);
+    fileMenu.addAction(tr("Export Movement Area …"), this, &MainWindow::exportMovementArea);
     fileMenu.addSeparator();
     addApplicationShortcut(fileMenu, QIcon(":/resources/icons/menubar/quit.png"), tr("Quit"), this, &MainWindow::close, QKeySequence::Quit);
 
@@ -1113,6 +1116,46 @@ void MainWindow::exportToNml() {
     }
 }
 
+void MainWindow::exportMovementArea() {
+    const QStringList formats{tr("KNOSSOS cubes"), tr("KNOSSOS cubes, mergelist applied"), tr("Zarr arrays"), tr("Zarr arrays, mergelist applied")};
+    bool ok{false};
+    const auto format = formats.indexOf(QInputDialog::getItem(this, tr("Export Movement Area"), tr("Visible layers at the current mag as"), formats, 0, false, &ok));
+    if (!ok) {
+        return;
+    }
+    const auto directory = state->viewer->suspend([this]{
+        return QFileDialog::getExistingDirectory(this, tr("Export Movement Area to"), QDir::homePath());
+    });
+    if (directory.isEmpty()) {
+        return;
+    }
+    RegionExport job;
+    for (std::size_t layerId{0}; layerId < Dataset::datasets.size(); ++layerId) {
+        if (Dataset::datasets[layerId].renderSettings.visible) {
+            job.layers.emplace_back(layerId);
+        }
+    }
+    job.magIndex = Dataset::current().magIndex;
+    const auto & scaleFactor = Dataset::current().scaleFactor;
+    const auto inMag = [&scaleFactor](const Coordinate & pos){
+        return Coordinate(pos.x / scaleFactor.x, pos.y / scaleFactor.y, pos.z / scaleFactor.z);
+    };
+    job.first = inMag(Annotation::singleton().movementAreaMin);
+    job.last = inMag(Annotation::singleton().movementAreaMax);
+    job.directory = directory;
+    job.format = format < 2 ? RegionExport::Format::KnossosCubes : RegionExport::Format::Zarr;
+    job.applyMergelist = format % 2 == 1;
+    try {
+        exportRegion(job);
+    } catch (const std::exception & e) {
+        QMessageBox box{this};
+        box.setIcon(QMessageBox::Warning);
+        box.setText(tr("Exporting the movement area failed"));
+        box.setInformativeText(e.what());
+        box.exec();
+    }
+}
+
 void MainWindow::setWorkMode(AnnotationMode workMode) {
     if (workModes.find(workMode) == std::end(workModes)) {
         workMode = AnnotationMode::Mode_Tracing;
@@ -270,6 +270,7 @@ public slots:
     void saveAsSlot(const bool onlySelectedTrees = false, const bool saveTime = true, const bool saveDatasetPath = true);
     void save(QString filename = Annotation::singleton().annotationFilename, const bool silent = false, const bool allocIncrement = true, const bool onlySelectedTrees = false, const bool saveTime = true, const bool saveDatasetPath = true);
     void exportToNml();
+    void exportMovementArea();
     void updateCommentShortcut(const int index, const QString & comment);
 
     /* edit skeleton menu*/
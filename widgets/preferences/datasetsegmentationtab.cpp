@@ -171,12 +171,12 @@ DatasetAndSegmentationTab::DatasetAndSegmentationTab(QWidget *parent) : QWidget(
     QObject::connect(&volumeOpaquenessSlider, &QSlider::valueChanged, [this](int value){
         volumeOpaquenessSpinBox.setValue(value);
         Segmentation::singleton().volume_opacity = value;
-        Segmentation::singleton().volume_update_required = true;
+        Segmentation::singleton().volumeUpdate();
     });
     QObject::connect(&volumeOpaquenessSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this](int value){
         volumeOpaquenessSlider.setValue(value);
         Segmentation::singleton().volume_opacity = value;
-        Segmentation::singleton().volume_update_required = true;
+        Segmentation::singleton().volumeUpdate();
     });
 
     QObject::connect(state->mainWindow, &MainWindow::overlayOpacityChanged, [this](){
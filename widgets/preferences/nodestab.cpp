@@ -131,23 +131,20 @@ NodesTab::NodesTab(QWidget *parent) : QWidget(parent) {
     QObject::connect(&overrideNodeRadiusSpin, static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), [](const double value ) {
         state->viewerState->overrideNodeRadiusVal = value;
 
-        state->viewerState->AllTreesBuffers.regenVertBuffer = true;
-        state->viewerState->selectedTreesBuffers.regenVertBuffer = true;
+        state->viewerState->skeletonBuffers.regenVertBuffer = true;
     });
     QObject::connect(&nodeCommentsCheck, &QCheckBox::clicked, [](const bool checked) { ViewportOrtho::showNodeComments = checked; });
     QObject::connect(&overrideNodeRadiusCheck, &QCheckBox::clicked, [this](const bool on) {
         state->viewerState->overrideNodeRadiusBool = on;
 
-        state->viewerState->AllTreesBuffers.regenVertBuffer = true;
-        state->viewerState->selectedTreesBuffers.regenVertBuffer = true;
+        state->viewerState->skeletonBuffers.regenVertBuffer = true;
 
         overrideNodeRadiusSpin.setEnabled(on);
     });
     QObject::connect(&edgeNodeRatioSpin, static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), [](const double value) {
         state->viewerState->segRadiusToNodeRadius = value;
 
-        state->viewerState->AllTreesBuffers.regenVertBuffer = true;
-        state->viewerState->selectedTreesBuffers.regenVertBuffer = true;
+        state->viewerState->skeletonBuffers.regenVertBuffer = true;
     });
     // properties
     static auto propertyConversionCheck = [](auto index, auto property, auto & combo){
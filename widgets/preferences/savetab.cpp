@@ -57,11 +57,20 @@ SaveTab::SaveTab(QWidget * parent) : QWidget(parent) {
 
     plySaveButtonGroup.addButton(&plySaveAsBinRadio, true);
     plySaveButtonGroup.addButton(&plySaveAsTxtRadio, false);
+    plySaveButtonGroup.addButton(&plySaveCompressedRadio, 2);
     plyLayout.addWidget(&plySaveAsBinRadio);
     plyLayout.addWidget(&plySaveAsTxtRadio);
+    plyLayout.addWidget(&plySaveCompressedRadio);
     plyLayout.setAlignment(Qt::AlignLeft);
     plyGroupBox.setLayout(&plyLayout);
 
+    skeletonSaveButtonGroup.addButton(&skeletonSaveAsXmlRadio, false);
+    skeletonSaveButtonGroup.addButton(&skeletonSaveAsColumnsRadio, true);
+    skeletonLayout.addWidget(&skeletonSaveAsXmlRadio);
+    skeletonLayout.addWidget(&skeletonSaveAsColumnsRadio);
+    skeletonLayout.setAlignment(Qt::AlignLeft);
+    skeletonGroupBox.setLayout(&skeletonLayout);
+
     customSaveLayout.addWidget(&saveTimeButton);
     customSaveLayout.addWidget(&saveDatasetPathButton);
     customSaveLayout.addWidget(&customSaveButton);
@@ -71,6 +80,7 @@ SaveTab::SaveTab(QWidget * parent) : QWidget(parent) {
     mainLayout.addWidget(&generalGroup);
     mainLayout.addWidget(&autosaveGroup);
     mainLayout.addWidget(&plyGroupBox);
+    mainLayout.addWidget(&skeletonGroupBox);
     mainLayout.addWidget(&customSaveGroup);
     mainLayout.addStretch();
     setLayout(&mainLayout);
@@ -93,6 +103,10 @@ SaveTab::SaveTab(QWidget * parent) : QWidget(parent) {
     });
     QObject::connect(&plySaveButtonGroup, &QButtonGroup::idClicked, [](auto id) {
         Annotation::singleton().savePlyAsBinary = static_cast<bool>(id);
+        Annotation::singleton().saveMeshesCompressed = id == 2;
+    });
+    QObject::connect(&skeletonSaveButtonGroup, &QButtonGroup::idClicked, [](auto id) {
+        Annotation::singleton().saveSkeletonAsColumns = static_cast<bool>(id);
     });
     QObject::connect(&customSaveButton, &QPushButton::clicked, [this](const bool) {
         state->viewer->window->saveAsSlot(false, saveTimeButton.isChecked(), saveDatasetPathButton.isChecked());
@@ -112,15 +126,21 @@ void SaveTab::loadSettings(const QSettings & settings) {
     autosaveIntervalSpinBox.setValue(settings.value(SAVING_INTERVAL, 5).toInt());
     autosaveGroup.setChecked(settings.value(AUTO_SAVING, true).toBool());
 
-    const auto buttonId = static_cast<int>(settings.value(PLY_SAVE_AS_BIN, true).toBool());
+    const auto buttonId = settings.value(MESH_SAVE_COMPRESSED, false).toBool() ? 2 : static_cast<int>(settings.value(PLY_SAVE_AS_BIN, true).toBool());
     plySaveButtonGroup.button(buttonId)->setChecked(true);
     plySaveButtonGroup.idClicked(buttonId);
+
+    const auto skeletonButtonId = static_cast<int>(settings.value(SKELETON_SAVE_AS_COLUMNS, false).toBool());
+    skeletonSaveButtonGroup.button(skeletonButtonId)->setChecked(true);
+    skeletonSaveButtonGroup.idClicked(skeletonButtonId);
 }
 
 void SaveTab::saveSettings(QSettings & settings) {
     settings.setValue(AUTOINC_FILENAME, autoincrementFileNameButton.isChecked());
     settings.setValue(AUTO_SAVING, autosaveGroup.isChecked());
-    settings.setValue(PLY_SAVE_AS_BIN, plySaveAsBinRadio.isChecked());
+    settings.setValue(PLY_SAVE_AS_BIN, !plySaveAsTxtRadio.isChecked());
+    settings.setValue(MESH_SAVE_COMPRESSED, plySaveCompressedRadio.isChecked());
+    settings.setValue(SKELETON_SAVE_AS_COLUMNS, skeletonSaveAsColumnsRadio.isChecked());
     settings.setValue(SAVE_ANNOTATION_TIME, saveTimeButton.isChecked());
     settings.setValue(SAVE_DATASET_PATH, saveDatasetPathButton.isChecked());
     settings.setValue(SAVING_INTERVAL, autosaveIntervalSpinBox.value());
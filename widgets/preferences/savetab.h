@@ -54,6 +54,12 @@ class SaveTab : public QWidget {
     QButtonGroup plySaveButtonGroup;
     QRadioButton plySaveAsBinRadio{tr("binary files")};
     QRadioButton plySaveAsTxtRadio{tr("text files")};
+    QRadioButton plySaveCompressedRadio{tr("compressed (*.kmesh, for many large meshes)")};
+    QGroupBox skeletonGroupBox{tr("Save skeleton as…")};
+    QHBoxLayout skeletonLayout;
+    QButtonGroup skeletonSaveButtonGroup;
+    QRadioButton skeletonSaveAsXmlRadio{tr("xml (annotation.xml)")};
+    QRadioButton skeletonSaveAsColumnsRadio{tr("binary columns (skeleton.kcs, for very large skeletons)")};
     QGroupBox customSaveGroup{"Custom Save"};
     QHBoxLayout customSaveLayout;
     QCheckBox saveTimeButton{"Include annotation time"};
@@ -23,6 +23,7 @@
 #include "treestab.h"
 
 #include "gui_wrapper.h"
+#include "skeleton/skeletonizer.h"
 #include "stateInfo.h"
 #include "viewer.h"
 #include "widgets/GuiConstants.h"
@@ -69,6 +70,8 @@ TreesTab::TreesTab(QWidget *parent) : QWidget(parent) {
     vpOrthoGroup.setLayout(&vpOrthoLayout);
     visibilityLayout.addWidget(&vpOrthoGroup);
     visibilityLayout.addWidget(&vp3dGroup);
+    treePagingCheck.setToolTip(tr("Nodes of trees that are neither selected nor near the current position are compressed and loaded again on demand."));
+    visibilityLayout.addWidget(&treePagingCheck);
     visibilityLayout.setAlignment(Qt::AlignTop);
     visibilityGroup.setLayout(&visibilityLayout);
 
@@ -79,13 +82,19 @@ TreesTab::TreesTab(QWidget *parent) : QWidget(parent) {
     // trees render options
     QObject::connect(&highlightActiveTreeCheck, &QCheckBox::clicked, [](const bool on) {
         state->viewerState->highlightActiveTree = on;
-        state->viewerState->AllTreesBuffers.regenVertBuffer = true;
-        state->viewerState->selectedTreesBuffers.regenVertBuffer = true;
+        state->viewerState->skeletonBuffers.regenVertBuffer = true;
     });
     QObject::connect(&highlightIntersectionsCheck, &QCheckBox::clicked, [](const bool checked) {
         state->viewerState->showIntersections = checked;
-        state->viewerState->AllTreesBuffers.regenVertBuffer = true;
-        state->viewerState->selectedTreesBuffers.regenVertBuffer = true;
+        state->viewerState->skeletonBuffers.regenVertBuffer = true;
+    });
+    QObject::connect(&treePagingCheck, &QCheckBox::clicked, [](const bool checked) {
+        Skeletonizer::singleton().treePaging = checked;
+        if (checked) {
+            Skeletonizer::singleton().pageByPosition(state->viewerState->currentPosition);
+        } else {
+            Skeletonizer::singleton().pageInAll();
+        }
     });
     QObject::connect(&lightEffectsCheck, &QCheckBox::clicked, [](const bool on) { state->viewerState->lightOnOff = on; });
     QObject::connect(&msaaSpin, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), [](const int samples){
@@ -187,6 +196,7 @@ void TreesTab::saveSettings(QSettings & settings) const {
     settings.setValue(SHOW_SKELETON_ORTHOVPS, vpOrthoGroup.isChecked());
     settings.setValue(TREE_LUT_FILE, lutFilePath);
     settings.setValue(TREE_LUT_FILE_USED, ownTreeColorsCheck.isChecked());
+    settings.setValue(TREE_PAGING, treePagingCheck.isChecked());
     settings.setValue(TREE_VISIBILITY_3DVP, vp3dButtonGroup.checkedId());
     settings.setValue(TREE_VISIBILITY_ORTHOVPS, vpOrthoButtonGroup.checkedId());
 }
@@ -222,4 +232,6 @@ void TreesTab::loadSettings(const QSettings & settings) {
     vp3dGroup.clicked(vp3dGroup.isChecked());
     vpOrthoGroup.setChecked(settings.value(SHOW_SKELETON_ORTHOVPS, true).toBool());
     vpOrthoGroup.clicked(vpOrthoGroup.isChecked());
+    treePagingCheck.setChecked(settings.value(TREE_PAGING, false).toBool());
+    treePagingCheck.clicked(treePagingCheck.isChecked());
 }
@@ -92,6 +92,7 @@ class TreesTab : public QWidget
     QButtonGroup vpOrthoButtonGroup;
     QRadioButton vpOrthoAllTreesRadio{tr("Show all trees")};
     QRadioButton vpOrthoSelectedTreesRadio{tr("Show only selected trees")};
+    QCheckBox treePagingCheck{tr("Keep only trees near the view in memory")};
 
     void loadTreeLUTButtonClicked(QString path = "");
     void saveSettings(QSettings & settings) const;
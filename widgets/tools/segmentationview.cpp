@@ -39,8 +39,12 @@
 #include <QPushButton>
 #include <QSplitter>
 #include <QString>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 
+#include <algorithm>
 #include <chrono>
+#include <numeric>
 
 CategoryDelegate::CategoryDelegate(CategoryModel & categoryModel) {
     box.setModel(&categoryModel);
@@ -179,29 +183,261 @@ Qt::ItemFlags SegmentationObjectModel::flags(const QModelIndex & index) const {
     return flags;
 }
 
-void SegmentationObjectModel::recreate() {
-    beginResetModel();
-    endResetModel();
+static int compare(const ObjectListModel::SortKey & lhs, const ObjectListModel::SortKey & rhs) {
+    if (const auto * number = std::get_if<quint64>(&lhs)) {
+        const auto other = std::get<quint64>(rhs);
+        return (*number > other) - (*number < other);
+    }
+    return std::get<QCollatorSortKey>(lhs).compare(std::get<QCollatorSortKey>(rhs));
 }
 
-void SegmentationObjectModel::appendRowBegin() {
-    beginInsertRows(QModelIndex(), rowCount(), rowCount());
+ObjectListModel::ObjectListModel() {
+    collator.setNumericMode(true);
+    QObject::connect(&watcher, &QFutureWatcher<Result>::finished, this, [this](){
+        auto result = watcher.result();
+        if (result.generation == latestRun) {// superseded runs are dropped
+            publish(std::move(result));
+        }
+    });
 }
 
-void SegmentationObjectModel::popRowBegin() {
-    beginRemoveRows(QModelIndex(), rowCount()-1, rowCount()-1);
+int ObjectListModel::rowCount(const QModelIndex &) const {
+    return rows.size();
 }
 
-void SegmentationObjectModel::appendRow() {
+QVariant ObjectListModel::data(const QModelIndex & index, int role) const {
+    if (index.isValid() && static_cast<std::size_t>(index.row()) < rows.size() && rows[index.row()] < Segmentation::singleton().objects.size()) {
+        return objectGet(Segmentation::singleton().objects[rows[index.row()]], index, role);
+    }
+    return QVariant();//return invalid QVariant
+}
+
+bool ObjectListModel::setData(const QModelIndex & index, const QVariant & value, int role) {
+    if (index.isValid() && static_cast<std::size_t>(index.row()) < rows.size() && rows[index.row()] < Segmentation::singleton().objects.size()) {
+        return objectSet(Segmentation::singleton().objects[rows[index.row()]], index, value, role);
+    }
+    return true;
+}
+
+ObjectListModel::Entry ObjectListModel::entry(const Segmentation::Object & obj) const {
+    quint64 number{obj.id};
+    if (sortColumn == 2) {
+        number = obj.immutable;
+    } else if (sortColumn == 5) {
+        number = obj.subobjects.size();
+    } else if (sortColumn == 6) {// natural order of the id list starts with the first id
+        number = obj.subobjects.empty() ? 0 : obj.subobjects.front().get().id;
+    }
+    return {number, obj.category, obj.comment};
+}
+
+ObjectListModel::SortKey ObjectListModel::sortKey(const Entry & entry, const int column, const QCollator & collator) {
+    if (column == 3) {
+        return collator.sortKey(entry.category);
+    } else if (column == 4) {
+        return collator.sortKey(entry.comment);
+    }
+    return entry.number;
+}
+
+bool ObjectListModel::accepts(const Entry & entry, const Filter & filter, const QRegularExpression & commentRegex) {
+    return entry.category.contains(filter.category) && (filter.regex ? commentRegex.match(entry.comment).hasMatch() : entry.comment.contains(filter.comment));
+}
+
+ObjectListModel::Result ObjectListModel::compute(const std::vector<Entry> & entries, const Filter & filter, const int column, const Qt::SortOrder order, const std::uint64_t generation) {
+    Result result{generation, {}, std::vector<SortKey>(column < 0 ? 0 : entries.size())};
+    std::vector<char> accepted(entries.size());
+    const std::size_t blockSize{16384};
+    std::vector<std::size_t> blocks((entries.size() + blockSize - 1) / blockSize);
+    std::iota(std::begin(blocks), std::end(blocks), 0);
+    QtConcurrent::blockingMap(blocks, [&](const std::size_t block){
+        QCollator collator;// per thread
+        collator.setNumericMode(true);
+        const QRegularExpression commentRegex(filter.regex ? filter.comment : QString{});
+        for (auto i = block * blockSize; i < std::min(entries.size(), (block + 1) * blockSize); ++i) {
+            accepted[i] = accepts(entries[i], filter, commentRegex);
+            if (column >= 0) {
+                result.keys[i] = sortKey(entries[i], column, collator);
+            }
+        }
+    });
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (accepted[i]) {
+            result.rows.emplace_back(i);
+        }
+    }
+    if (column >= 0) {
+        std::sort(std::begin(result.rows), std::end(result.rows), [&keys = result.keys, order](const auto lhs, const auto rhs){
+            const auto comparison = compare(keys[lhs], keys[rhs]);
+            return comparison != 0 ? (order == Qt::AscendingOrder ? comparison < 0 : comparison > 0) : lhs < rhs;
+        });
+    }
+    return result;
+}
+
+bool ObjectListModel::lessThan(const std::uint64_t lhs, const std::uint64_t rhs) const {
+    const auto comparison = sortColumn < 0 ? 0 : compare(keys[lhs], keys[rhs]);
+    return comparison != 0 ? (sortOrder == Qt::AscendingOrder ? comparison < 0 : comparison > 0) : lhs < rhs;
+}
+
+int ObjectListModel::insertPosition(const std::uint64_t objectIndex) const {
+    return std::distance(std::begin(rows), std::upper_bound(std::begin(rows), std::end(rows), objectIndex, [this](const auto lhs, const auto rhs){
+        return lessThan(lhs, rhs);
+    }));
+}
+
+void ObjectListModel::updatePositions(const std::size_t first, const std::size_t last) {
+    for (auto row = first; row < last; ++row) {
+        positions[rows[row]] = row;
+    }
+}
+
+void ObjectListModel::insertObjectRow(const std::uint64_t objectIndex) {
+    const auto row = insertPosition(objectIndex);
+    beginInsertRows(QModelIndex(), row, row);
+    rows.emplace(std::next(std::begin(rows), row), objectIndex);
+    updatePositions(row, rows.size());
     endInsertRows();
 }
 
-void SegmentationObjectModel::popRow() {
+void ObjectListModel::removeObjectRow(const int row) {
+    beginRemoveRows(QModelIndex(), row, row);
+    positions[rows[row]] = -1;
+    rows.erase(std::next(std::begin(rows), row));
+    updatePositions(row, rows.size());
     endRemoveRows();
 }
 
-void SegmentationObjectModel::changeRow(int idx) {
-    emit dataChanged(index(idx, 0), index(idx, columnCount()-1));
+bool ObjectListModel::synced() const {// false while the rows of a reset are computed
+    return positions.size() == Segmentation::singleton().objects.size();
+}
+
+void ObjectListModel::start() {
+    const auto & objects = Segmentation::singleton().objects;
+    std::vector<Entry> entries;
+    entries.reserve(objects.size());
+    for (const auto & obj : objects) {
+        entries.emplace_back(entry(obj));
+    }
+    latestRun = ++generation;
+    if (entries.size() < backgroundThreshold) {
+        publish(compute(entries, filter, sortColumn, sortOrder, latestRun));
+    } else {
+        watcher.setFuture(QtConcurrent::run([entries = std::move(entries), filter = filter, column = sortColumn, order = sortOrder, run = latestRun](){
+            return compute(entries, filter, column, order, run);
+        }));
+    }
+}
+
+void ObjectListModel::publish(Result && result) {
+    if (result.generation != generation) {// objects changed meanwhile
+        start();
+        return;
+    }
+    beginResetModel();
+    rows = std::move(result.rows);
+    keys = std::move(result.keys);
+    positions.assign(Segmentation::singleton().objects.size(), -1);
+    updatePositions(0, rows.size());
+    endResetModel();
+}
+
+void ObjectListModel::sort(int column, Qt::SortOrder order) {
+    if (column != sortColumn || order != sortOrder) {
+        sortColumn = column;
+        sortOrder = order;
+        start();
+    }
+}
+
+void ObjectListModel::setFilter(const Filter & filter) {
+    this->filter = filter;
+    commentRegex.setPattern(filter.regex ? filter.comment : QString{});
+    start();
+}
+
+void ObjectListModel::recreate() {
+    if (Segmentation::singleton().objects.size() >= backgroundThreshold) {// the rows may refer to replaced objects until the new ones are published
+        beginResetModel();
+        rows.clear();
+        positions.clear();
+        keys.clear();
+        endResetModel();
+    }
+    start();
+}
+
+void ObjectListModel::appendObject() {
+    ++generation;
+    const auto & objects = Segmentation::singleton().objects;
+    if (positions.size() + 1 != objects.size()) {
+        return;
+    }
+    const auto entry = this->entry(objects.back());
+    positions.emplace_back(-1);
+    if (sortColumn >= 0) {
+        keys.emplace_back(sortKey(entry, sortColumn, collator));
+    }
+    if (accepts(entry, filter, commentRegex)) {
+        insertObjectRow(objects.back().index);
+    }
+}
+
+void ObjectListModel::changeObject(const std::uint64_t objectIndex) {
+    ++generation;
+    if (!synced()) {
+        return;
+    }
+    const auto entry = this->entry(Segmentation::singleton().objects[objectIndex]);
+    if (sortColumn >= 0) {
+        keys[objectIndex] = sortKey(entry, sortColumn, collator);
+    }
+    const auto row = positions[objectIndex];
+    const auto accepted = accepts(entry, filter, commentRegex);
+    if (row < 0) {
+        if (accepted) {
+            insertObjectRow(objectIndex);
+        }
+    } else if (!accepted) {
+        removeObjectRow(row);
+    } else if ((row > 0 && lessThan(objectIndex, rows[row - 1])) || (row + 1 < static_cast<int>(rows.size()) && lessThan(rows[row + 1], objectIndex))) {
+        rows.erase(std::next(std::begin(rows), row));
+        const auto target = insertPosition(objectIndex);
+        rows.emplace(std::next(std::begin(rows), row), objectIndex);
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), target > row ? target + 1 : target);
+        rows.erase(std::next(std::begin(rows), row));
+        rows.emplace(std::next(std::begin(rows), target), objectIndex);
+        updatePositions(std::min(row, target), std::max(row, target) + 1);
+        endMoveRows();
+        emit dataChanged(index(target, 0), index(target, columnCount() - 1));
+    } else {
+        emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    }
+}
+
+void ObjectListModel::removeLastObject() {
+    ++generation;
+    if (!synced() || positions.empty()) {
+        return;
+    }
+    if (positions.back() >= 0) {
+        removeObjectRow(positions.back());
+    }
+    positions.pop_back();
+    if (sortColumn >= 0) {
+        keys.pop_back();
+    }
+}
+
+std::uint64_t ObjectListModel::objectIndex(const int row) const {
+    return rows[row];
+}
+
+QModelIndex ObjectListModel::indexOfObject(const std::uint64_t objectIndex, const int column) const {
+    if (objectIndex < positions.size() && positions[objectIndex] >= 0) {
+        return index(positions[objectIndex], column);
+    }
+    return {};
 }
 
 void CategoryModel::recreate() {
@@ -287,12 +523,7 @@ SegmentationView::SegmentationView(QWidget * const parent) : QWidget(parent), ca
     setupTable(touchedObjsTable, touchedObjectModel);
     touchedLayoutWidget.hide();
 
-    //proxy model chaining, so we can filter twice
-    objectProxyModelCategory.setSourceModel(&objectModel);
-    objectProxyModelComment.setSourceModel(&objectProxyModelCategory);
-    objectProxyModelCategory.setFilterKeyColumn(3);
-    objectProxyModelComment.setFilterKeyColumn(4);
-    setupTable(objectsTable, objectProxyModelComment);
+    setupTable(objectsTable, objectModel);
     objectsTable.setSortingEnabled(true);
     objectsTable.sortByColumn(objSortSectionIndex = 1, Qt::SortOrder::AscendingOrder);
 
@@ -341,15 +572,13 @@ SegmentationView::SegmentationView(QWidget * const parent) : QWidget(parent), ca
     objectsTable.setColumnWidth(0, 50);
     touchedObjsTable.setColumnWidth(0, 50);
 
-    QObject::connect(&Segmentation::singleton(), &Segmentation::beforeAppendRow, &objectModel, &SegmentationObjectModel::appendRowBegin);
     QObject::connect(&Segmentation::singleton(), &Segmentation::beforeRemoveRow, [this](){
         objectSelectionProtection = true;
-        objectModel.popRowBegin();
         if (Segmentation::singleton().objects.back().selected) {
             const auto index = Segmentation::singleton().objects.back().index;
-            const auto & proxyIndex = objectProxyModelComment.mapFromSource(objectProxyModelCategory.mapFromSource(objectModel.index(index, 0)));
-            objectsTable.selectionModel()->select(proxyIndex, QItemSelectionModel::Deselect | QItemSelectionModel::Rows);
+            objectsTable.selectionModel()->select(objectModel.indexOfObject(index), QItemSelectionModel::Deselect | QItemSelectionModel::Rows);
         }
+        objectModel.removeLastObject();
         objectSelectionProtection = false;
         touchedObjectModel.recreate();
         updateTouchedObjSelection();
@@ -357,11 +586,10 @@ SegmentationView::SegmentationView(QWidget * const parent) : QWidget(parent), ca
     });
     QObject::connect(&Segmentation::singleton(), &Segmentation::appendedRow, [this](){
         objectSelectionProtection = true;
-        objectModel.appendRow();
+        objectModel.appendObject();
         if (Segmentation::singleton().objects.back().selected) {
             const auto index = Segmentation::singleton().objects.back().index;
-            const auto & proxyIndex = objectProxyModelComment.mapFromSource(objectProxyModelCategory.mapFromSource(objectModel.index(index, 0)));
-            objectsTable.selectionModel()->setCurrentIndex(proxyIndex, QItemSelectionModel::Select | QItemSelectionModel::Rows);
+            objectsTable.selectionModel()->setCurrentIndex(objectModel.indexOfObject(index), QItemSelectionModel::Select | QItemSelectionModel::Rows);
         }
         objectSelectionProtection = false;
         touchedObjectModel.recreate();
@@ -369,19 +597,18 @@ SegmentationView::SegmentationView(QWidget * const parent) : QWidget(parent), ca
         updateLabels();
     });
     QObject::connect(&Segmentation::singleton(), &Segmentation::removedRow, [this](){
-        objectModel.popRow();
         touchedObjectModel.recreate();
         updateTouchedObjSelection();
         updateLabels();
     });
     QObject::connect(&Segmentation::singleton(), &Segmentation::changedRow, [this](int index){
-        objectModel.changeRow(index);
+        objectModel.changeObject(index);
         touchedObjectModel.recreate();
         updateLabels();//maybe subobject count changed
     });
     QObject::connect(&Segmentation::singleton(), &Segmentation::changedRowSelection, [this](int index){
         if (scope s{objectSelectionProtection}) {
-            const auto & proxyIndex = objectProxyModelComment.mapFromSource(objectProxyModelCategory.mapFromSource(objectModel.index(index, 0)));
+            const auto & proxyIndex = objectModel.indexOfObject(index);
             //selection lookup is way cheaper than reselection (sadly)
             const bool alreadySelected = objectsTable.selectionModel()->isSelected(proxyIndex);
             if (Segmentation::singleton().objects[index].selected && !alreadySelected) {
@@ -393,6 +620,7 @@ SegmentationView::SegmentationView(QWidget * const parent) : QWidget(parent), ca
             updateTouchedObjSelection();
         }
     });
+    QObject::connect(&objectModel, &ObjectListModel::modelReset, this, &SegmentationView::updateSelection);// rows may be published later
     QObject::connect(&Segmentation::singleton(), &Segmentation::resetData, [this](){
         touchedObjectModel.recreate();
         objectModel.recreate();
@@ -429,8 +657,7 @@ SegmentationView::SegmentationView(QWidget * const parent) : QWidget(parent), ca
         if (index.column() == 0) {
             colorDialog.setCurrentColor(table.model()->data(index, Qt::BackgroundRole).value<QColor>());
             if (state->viewer->suspend([this]{ return colorDialog.exec(); }) == QColorDialog::Accepted) {
-                const auto & proxyIndex = objectProxyModelCategory.mapToSource(objectProxyModelComment.mapToSource(index));
-                auto & obj = (&table == &objectsTable) ? Segmentation::singleton().objects[proxyIndex.row()] : touchedObjectModel.objectCache[index.row()].get();
+                auto & obj = (&table == &objectsTable) ? Segmentation::singleton().objects[objectModel.objectIndex(index.row())] : touchedObjectModel.objectCache[index.row()].get();
                 auto color = colorDialog.currentColor();
                 Segmentation::singleton().changeColor(obj, std::make_tuple(color.red(), color.green(), color.blue()));
             }
@@ -596,7 +823,7 @@ void SegmentationView::touchedObjSelectionChanged(const QItemSelection & selecte
 void SegmentationView::selectionChanged(const QItemSelection & selected, const QItemSelection & deselected) {
     if (scope s{objectSelectionProtection}) {
         commitSelection(selected, deselected, [this](const int & i){
-            return objectProxyModelCategory.mapToSource(objectProxyModelComment.mapToSource(objectProxyModelComment.index(i, 1))).row();
+            return objectModel.objectIndex(i);
         });
         updateTouchedObjSelection();
     }
@@ -612,8 +839,8 @@ void SegmentationView::updateTouchedObjSelection() {
 }
 
 void SegmentationView::updateSelection() {
-    const auto & proxySelection = deltaBlockSelection(objectProxyModelComment, [&](const auto rowIndex){
-        return Segmentation::singleton().objects[objectProxyModelCategory.mapToSource(objectProxyModelComment.mapToSource(objectProxyModelComment.index(rowIndex, 0))).row()];
+    const auto & proxySelection = deltaBlockSelection(objectModel, [&](const auto rowIndex){
+        return Segmentation::singleton().objects[objectModel.objectIndex(rowIndex)];
     });
 
     objectSelectionProtection = true;//using block signals prevents update of the tableview
@@ -626,13 +853,7 @@ void SegmentationView::updateSelection() {
 }
 
 void SegmentationView::filter() {
-    objectProxyModelCategory.setFilterFixedString(categoryFilter.currentText());
-    if (regExCheckbox.isChecked()) {
-        objectProxyModelComment.setFilterRegExp(commentFilter.text());
-    } else {
-        objectProxyModelComment.setFilterFixedString(commentFilter.text());
-    }
-    updateSelection();
+    objectModel.setFilter({categoryFilter.currentText(), commentFilter.text(), regExCheckbox.isChecked()});// selection is restored on reset
     updateTouchedObjSelection();
 }
 
@@ -641,8 +862,8 @@ void SegmentationView::updateLabels() {
     subobjectCountLabel.setText(QString("Subobjects: %1").arg(Segmentation::singleton().subobjects.size()));
 }
 
-uint64_t SegmentationView::indexFromRow(const SegmentationObjectModel &, const QModelIndex index) const {
-    return objectProxyModelCategory.mapSelectionToSource(objectProxyModelComment.mapSelectionToSource({index, index})).indexes().front().row();
+uint64_t SegmentationView::indexFromRow(const ObjectListModel & model, const QModelIndex index) const {
+    return model.objectIndex(index.row());
 }
 uint64_t SegmentationView::indexFromRow(const TouchedObjectModel & model, const QModelIndex index) const {
     return model.objectCache[index.row()].get().index;
@@ -654,7 +875,6 @@ void SegmentationView::userCreateObject() {
         category = Segmentation::singleton().objects[Segmentation::singleton().selectedObjectIndices.front()].category;
     }
     Segmentation::singleton().createAndSelectObject(state->viewerState->currentPosition, category);
-    filter();
 }
 
 QString SegmentationView::getCategory(const int idx) const {
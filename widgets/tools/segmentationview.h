@@ -33,27 +33,22 @@
 #include <QColorDialog>
 #include <QComboBox>
 #include <QDoubleSpinBox>
+#include <QFutureWatcher>
 #include <QGridLayout>
 #include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
-#include <QSortFilterProxyModel>
+#include <QRegularExpression>
 #include <QStyledItemDelegate>
 #include <QTreeView>
 #include <QVBoxLayout>
 #include <QWidget>
 #include <QMenu>
 
+#include <cstdint>
 #include <functional>
-
-class NaturalSortProxyModel : public QSortFilterProxyModel {
-public:
-    bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const {
-        QCollator sorter;
-        sorter.setNumericMode(true);
-        return sorter.compare(sourceModel()->data(source_left).toString(), sourceModel()->data(source_right).toString()) < 0;
-    }
-};
+#include <variant>
+#include <vector>
 
 class CategoryDelegate : public QStyledItemDelegate {
     mutable PreventDeferredDelete<QComboBox> box;
@@ -77,12 +72,73 @@ public:
     bool objectSet(Segmentation::Object & obj, const QModelIndex & index, const QVariant & value, int role);
     virtual bool setData(const QModelIndex & index, const QVariant & value, int role = Qt::EditRole) override;
     virtual Qt::ItemFlags flags(const QModelIndex & index) const override;
+};
+
+/**
+ * @brief Filtered and sorted rows of all objects.
+ *
+ * Rows map to object indices and sort keys are precomputed per object.
+ * Filtering and sorting run in a background thread which publishes the rows,
+ * single objects are inserted, moved and removed in place.
+ */
+class ObjectListModel : public SegmentationObjectModel {
+    Q_OBJECT
+public:
+    struct Filter {
+        QString category;
+        QString comment;
+        bool regex{false};
+    };
+    using SortKey = std::variant<quint64, QCollatorSortKey>;
+private:
+    struct Entry {// what filter and sort key are computed from
+        quint64 number;
+        QString category;
+        QString comment;
+    };
+    struct Result {
+        std::uint64_t generation{0};
+        std::vector<std::uint64_t> rows;
+        std::vector<SortKey> keys;
+    };
+    static constexpr std::size_t backgroundThreshold{50000};// objects
+    std::vector<std::uint64_t> rows;// object indices
+    std::vector<int> positions;// row of each object, -1 if filtered
+    std::vector<SortKey> keys;// of each object, empty if unsorted
+    Filter filter;
+    QRegularExpression commentRegex;
+    QCollator collator;
+    int sortColumn{-1};
+    Qt::SortOrder sortOrder{Qt::AscendingOrder};
+    std::uint64_t generation{0};// incremented by every change
+    std::uint64_t latestRun{0};
+    QFutureWatcher<Result> watcher;
+
+    Entry entry(const Segmentation::Object & obj) const;
+    static SortKey sortKey(const Entry & entry, const int column, const QCollator & collator);
+    static bool accepts(const Entry & entry, const Filter & filter, const QRegularExpression & commentRegex);
+    static Result compute(const std::vector<Entry> & entries, const Filter & filter, const int column, const Qt::SortOrder order, const std::uint64_t generation);
+    bool lessThan(const std::uint64_t lhs, const std::uint64_t rhs) const;
+    int insertPosition(const std::uint64_t objectIndex) const;
+    void insertObjectRow(const std::uint64_t objectIndex);
+    void removeObjectRow(const int row);
+    void updatePositions(const std::size_t first, const std::size_t last);
+    bool synced() const;
+    void start();
+    void publish(Result && result);
+public:
+    ObjectListModel();
+    virtual int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+    virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+    virtual bool setData(const QModelIndex & index, const QVariant & value, int role = Qt::EditRole) override;
+    virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    void setFilter(const Filter & filter);
     void recreate();
-    void appendRowBegin();
-    void popRowBegin();
-    void appendRow();
-    void popRow();
-    void changeRow(int idx);
+    void appendObject();
+    void changeObject(const std::uint64_t objectIndex);
+    void removeLastObject();
+    std::uint64_t objectIndex(const int row) const;
+    QModelIndex indexOfObject(const std::uint64_t objectIndex, const int column = 0) const;
 };
 
 class TouchedObjectModel : public SegmentationObjectModel {
@@ -124,9 +180,7 @@ Q_OBJECT
     QLineEdit commentFilter;
     QCheckBox regExCheckbox{"Regex"};
 
-    SegmentationObjectModel objectModel;
-    NaturalSortProxyModel objectProxyModelCategory;
-    NaturalSortProxyModel objectProxyModelComment;
+    ObjectListModel objectModel;
     TouchedObjectModel touchedObjectModel;
 
     CategoryDelegate categoryDelegate;
@@ -158,7 +212,7 @@ public:
     void updateTouchedObjSelection();
     void updateLabels();
     void updateBrushEditRange(const double minSize, const double maxSize);
-    uint64_t indexFromRow(const SegmentationObjectModel & model, const QModelIndex index) const;
+    uint64_t indexFromRow(const ObjectListModel & model, const QModelIndex index) const;
     uint64_t indexFromRow(const TouchedObjectModel & model, const QModelIndex index) const;
     void userCreateObject();
     QString getCategory(const int idx) const;
@@ -74,6 +74,55 @@ int AbstractSkeletonModel<ConcreteModel>::rowCount(const QModelIndex &) const {
     return static_cast<ConcreteModel const * const>(this)->cache.size();
 }
 
+std::uint64_t elemId(const treeListElement & tree) {
+    return tree.treeID;
+}
+
+std::uint64_t elemId(const nodeListElement & node) {
+    return node.nodeID;
+}
+
+template<typename ConcreteModel>
+template<typename Elem>
+void AbstractSkeletonModel<ConcreteModel>::appendRow(Elem & elem) {
+    auto & model = static_cast<ConcreteModel &>(*this);
+    const int row = model.cache.size();
+    beginInsertRows(QModelIndex(), row, row);
+    model.cache.emplace_back(elem);
+    model.rows[elemId(elem)] = row;
+    endInsertRows();
+}
+
+template<typename ConcreteModel>
+void AbstractSkeletonModel<ConcreteModel>::removeRowsOf(const std::vector<std::uint64_t> & ids) {// ids only, the elements may be gone already
+    auto & model = static_cast<ConcreteModel &>(*this);
+    std::vector<int> rows;
+    for (const auto id : ids) {
+        const auto it = model.rows.find(id);
+        if (it != std::end(model.rows)) {
+            rows.emplace_back(it->second);
+            model.rows.erase(it);
+        }
+    }
+    if (rows.empty()) {
+        return;
+    }
+    std::sort(std::begin(rows), std::end(rows), std::greater<>{});
+    for (std::size_t i = 0; i < rows.size();) {// remove consecutive rows as one range, back to front
+        const auto last = rows[i];
+        auto first = last;
+        for (++i; i < rows.size() && rows[i] == first - 1; ++i) {
+            first = rows[i];
+        }
+        beginRemoveRows(QModelIndex(), first, last);
+        model.cache.erase(std::next(std::begin(model.cache), first), std::next(std::begin(model.cache), last + 1));
+        endRemoveRows();
+    }
+    for (auto row = static_cast<std::size_t>(rows.back()); row < model.cache.size(); ++row) {
+        model.rows[elemId(model.cache[row].get())] = row;
+    }
+}
+
 template class AbstractSkeletonModel<TreeModel>;//please clang, should actually be implicitly instantiated in here anyway
 
 QString propertyStringWithoutComment(const QVariantHash & properties) {
@@ -99,7 +148,7 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const {
     } else if (role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::UserRole) {
         switch (index.column()) {
         case 0: return static_cast<quint64>(tree.treeID);
-        case 3: return static_cast<quint64>(tree.nodes.size());
+        case 3: return static_cast<quint64>(Skeletonizer::singleton().nodeCount(tree));// includes paged out nodes
         case 4: return tree.getComment();
         case 5:
             auto treeProperties = propertyStringWithoutComment(tree.properties);
@@ -198,51 +247,73 @@ bool TreeModel::dropMimeData(const QMimeData *, Qt::DropAction, int, int, const
     return false;
 }
 
+bool TreeModel::matches(const treeListElement & tree) const {
+    return (mode == SynapseDisplayModes::Hide && tree.isSynapticCleft == false)
+            || (mode == SynapseDisplayModes::Show)
+            || (mode == SynapseDisplayModes::ShowOnly && tree.isSynapticCleft);
+}
+
 void TreeModel::recreate() {
     beginResetModel();
     cache.clear();
     for (auto && tree : state->skeletonState->trees) {
-        if ((mode == SynapseDisplayModes::Hide && tree.isSynapticCleft == false)
-                || (mode == SynapseDisplayModes::Show)
-                || (mode == SynapseDisplayModes::ShowOnly && tree.isSynapticCleft)) {
+        if (matches(tree)) {
             cache.emplace_back(tree);
         }
     }
+    rows.clear();
+    for (std::size_t i = 0; i < cache.size(); ++i) {
+        rows.emplace(cache[i].get().treeID, i);
+    }
     endResetModel();
 }
 
+bool NodeModel::matches(const nodeListElement & node, const bool matchAll) const {// show node if for all criteria: either criterion not demanded or fulfilled
+    if (mode.testFlag(FilterMode::All)) {
+        return true;
+    }
+    const auto oneMatched = (mode.testFlag(FilterMode::Selected) && node.selected)
+            || (mode.testFlag(FilterMode::InSelectedTree) && node.correspondingTree->selected)
+            || (mode.testFlag(FilterMode::Branch) && node.isBranchNode)
+            || (mode.testFlag(FilterMode::Comment) && node.getComment().isEmpty() == false)
+            || (mode.testFlag(FilterMode::Synapse) && node.isSynapticNode);
+    const auto allMatched = (!mode.testFlag(FilterMode::Selected) || node.selected)
+            && (!mode.testFlag(FilterMode::InSelectedTree) || node.correspondingTree->selected)
+            && (!mode.testFlag(FilterMode::Branch) || node.isBranchNode)
+            && (!mode.testFlag(FilterMode::Comment) || node.getComment().isEmpty() == false)
+            && (!mode.testFlag(FilterMode::Synapse) || node.isSynapticNode);
+    return (!matchAll && oneMatched) || (matchAll && allMatched);
+}
+
 void NodeModel::recreate(const bool matchAll = true) {
     beginResetModel();
     cache.clear();
     for (auto && tree : state->skeletonState->trees)
     for (auto && node : tree.nodes) {
-        cache.emplace_back(node);
+        if (matches(node, matchAll)) {
+            cache.emplace_back(node);
+        } else if (matchAll && mode.testFlag(FilterMode::Selected) && node.selected) {
+            selectionFromModel = true;
+            Skeletonizer::singleton().toggleSelection(QSet{&node});
+            selectionFromModel = false;
+        }
+    }
+    rows.clear();
+    rows.reserve(cache.size());
+    for (std::size_t i = 0; i < cache.size(); ++i) {
+        rows.emplace(cache[i].get().nodeID, i);
     }
+    endResetModel();
+}
 
-    if(mode.testFlag(FilterMode::All) == false) {
-        decltype(cache) hits;
-        for (auto && node : cache) {// show node if for all criteria: either criterion not demanded or fulfilled
-            const auto oneMatched = (mode.testFlag(FilterMode::Selected) && node.get().selected)
-                    || (mode.testFlag(FilterMode::InSelectedTree) && node.get().correspondingTree->selected)
-                    || (mode.testFlag(FilterMode::Branch) && node.get().isBranchNode)
-                    || (mode.testFlag(FilterMode::Comment) && node.get().getComment().isEmpty() == false)
-                    || (mode.testFlag(FilterMode::Synapse) && node.get().isSynapticNode);
-            const auto allMatched = (!mode.testFlag(FilterMode::Selected) || node.get().selected)
-                    && (!mode.testFlag(FilterMode::InSelectedTree) || node.get().correspondingTree->selected)
-                    && (!mode.testFlag(FilterMode::Branch) || node.get().isBranchNode)
-                    && (!mode.testFlag(FilterMode::Comment) || node.get().getComment().isEmpty() == false)
-                    && (!mode.testFlag(FilterMode::Synapse) || node.get().isSynapticNode);
-            if ((!matchAll && oneMatched) || (matchAll && allMatched)) {
-                hits.emplace_back(node);
-            } else if (matchAll && mode.testFlag(FilterMode::Selected) && node.get().selected) {
-                selectionFromModel = true;
-                Skeletonizer::singleton().toggleSelection(QSet{&node.get()});
-                selectionFromModel = false;
-            }
+void NodeModel::removeStaleRows() {// nodes of deleted or paged out trees are gone without a signal each
+    std::vector<std::uint64_t> staleIds;
+    for (const auto & pair : rows) {
+        if (state->skeletonState->nodesByNodeID.find(pair.first) == std::end(state->skeletonState->nodesByNodeID)) {
+            staleIds.emplace_back(pair.first);
         }
-        cache = hits;
     }
-    endResetModel();
+    removeRowsOf(staleIds);
 }
 
 void NodeView::mousePressEvent(QMouseEvent * event) {
@@ -450,20 +521,26 @@ SkeletonView::SkeletonView(QWidget * const parent) : QWidget{parent}
     connect(&Skeletonizer::singleton(), &Skeletonizer::lockedToNode, [this](const std::uint64_t nodeID) { lockedNodeLabel.setText(tr("Locked to node %1").arg(nodeID)); });
     connect(&Skeletonizer::singleton(), &Skeletonizer::unlockedNode, [this]() { lockedNodeLabel.setText(tr("Locked to nothing at the moment")); });
 
-    static auto updateTreeSelection = [this](){
-        updateSelection(treeView, treeModel, treeSortAndCommentFilterProxy);
+    static auto updateTreeCount = [this](){
         const auto all = state->skeletonState->trees.size();
         const auto shown = static_cast<std::size_t>(treeView.model()->rowCount());
         const auto selected = state->skeletonState->selectedTrees.size();
         treeCountLabel.setText(tr("%1 trees").arg(all) + (all != shown ? tr(", %2 shown").arg(shown) : "") + (selected != 0 ? tr(", %3 selected").arg(selected) : ""));
     };
-    static auto updateNodeSelection = [this](){
-        updateSelection(nodeView, nodeModel, nodeSortAndCommentFilterProxy);
+    static auto updateTreeSelection = [this](){
+        updateSelection(treeView, treeModel, treeSortAndCommentFilterProxy);
+        updateTreeCount();
+    };
+    static auto updateNodeCount = [this](){
         const auto all = state->skeletonState->nodesByNodeID.size();
         const auto shown = static_cast<std::size_t>(nodeView.model()->rowCount());
         const auto selected = state->skeletonState->selectedNodes.size();
         nodeCountLabel.setText(tr("%1 nodes").arg(all) + (all != shown ? tr(", %2 shown").arg(shown) : "") + (selected != 0 ? tr(", %3 selected").arg(selected) : ""));
     };
+    static auto updateNodeSelection = [this](){
+        updateSelection(nodeView, nodeModel, nodeSortAndCommentFilterProxy);
+        updateNodeCount();
+    };
     static auto treeRecreate = [&, this](){
         treeModel.recreate();
         updateTreeSelection();
@@ -504,17 +581,46 @@ SkeletonView::SkeletonView(QWidget * const parent) : QWidget{parent}
     });
 
     const auto treeIndex = [this](const auto & tree){
-        const auto it = std::find_if(std::cbegin(treeModel.cache), std::cend(treeModel.cache), [&tree](const auto & elem){
-            return elem.get().treeID == tree.treeID;
-        });
-        return static_cast<int>(std::distance(std::cbegin(treeModel.cache), it));
+        const auto it = treeModel.rows.find(tree.treeID);
+        return it != std::end(treeModel.rows) ? it->second : static_cast<int>(treeModel.cache.size());
+    };
+    // nodes in the current filter mode, shown nodes are appended as rows instead of recreating the model
+    static auto appendNodeRows = [this](const treeListElement & tree){
+        const auto matchAll = nodeFilterModeCombo.currentIndex() == 0;
+        for (const auto & node : tree.nodes) {
+            if (nodeModel.matches(node, matchAll)) {
+                nodeModel.appendRow(*Skeletonizer::singleton().findNodeByNodeID(node.nodeID));
+            }
+        }
+        updateNodeCount();
     };
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeAddedSignal, allRecreate);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeAddedSignal, [this](const auto & tree){
+        if (treeModel.matches(tree)) {
+            treeModel.appendRow(*Skeletonizer::singleton().findTreeByTreeID(tree.treeID));
+        }
+        updateTreeCount();
+        appendNodeRows(tree);
+    });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeChangedSignal, [this, treeIndex](const auto & tree){
         const auto index = treeIndex(tree);
         treeModel.dataChanged(treeModel.index(index, 0), treeModel.index(index, treeModel.columnCount() - 1));
     });
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeRemovedSignal, allRecreate);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeRemovedSignal, [this](const std::uint64_t treeID){
+        treeModel.removeRowsOf({treeID});
+        updateTreeCount();
+        nodeModel.removeStaleRows();// its nodes were deleted silently
+        updateNodeCount();
+    });
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treePagedSignal, [this, treeIndex](const auto & tree){
+        const auto index = treeIndex(tree);
+        treeModel.dataChanged(treeModel.index(index, 0), treeModel.index(index, treeModel.columnCount() - 1));
+        if (tree.nodes.empty()) {
+            nodeModel.removeStaleRows();// the node cache must not point to paged out nodes
+            updateNodeCount();
+        } else {
+            appendNodeRows(tree);
+        }
+    });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treesMerged, treeRecreate);
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::treeSelectionChangedSignal, [this](){
         if (!treeModel.selectionFromModel) {
@@ -540,17 +646,23 @@ SkeletonView::SkeletonView(QWidget * const parent) : QWidget{parent}
     });
 
     const auto nodeIndex = [this](const auto & node){
-        const auto it = std::find_if(std::cbegin(nodeModel.cache), std::cend(nodeModel.cache), [&node](const auto & elem){
-            return elem.get().nodeID == node.nodeID;
-        });
-        return static_cast<int>(std::distance(std::cbegin(nodeModel.cache), it));
+        const auto it = nodeModel.rows.find(node.nodeID);
+        return it != std::end(nodeModel.rows) ? it->second : static_cast<int>(nodeModel.cache.size());
     };
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeAddedSignal, nodeRecreate);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeAddedSignal, [this](const auto & node){
+        if (nodeModel.matches(node, nodeFilterModeCombo.currentIndex() == 0)) {
+            nodeModel.appendRow(*Skeletonizer::singleton().findNodeByNodeID(node.nodeID));
+        }
+        updateNodeCount();
+    });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeChangedSignal, [this, nodeIndex](const auto & node){
         const auto index = nodeIndex(node);
         nodeModel.dataChanged(nodeModel.index(index, 0), nodeModel.index(index, nodeModel.columnCount() - 1));
     });
-    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeRemovedSignal, nodeRecreate);
+    QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::nodeRemovedSignal, [this](const std::uint64_t nodeID){
+        nodeModel.removeRowsOf({nodeID});
+        updateNodeCount();
+    });
     QObject::connect(&Skeletonizer::singleton(), &Skeletonizer::jumpedToNodeSignal, [this, nodeIndex](const auto & node){
         const auto modelIndex = nodeSortAndCommentFilterProxy.mapFromSource(nodeModel.index(nodeIndex(node), 0));
         if (modelIndex.isValid()) {
@@ -692,7 +804,8 @@ SkeletonView::SkeletonView(QWidget * const parent) : QWidget{parent}
     });
 
     QObject::connect(treeContextMenu.addAction("&Jump to first node"), &QAction::triggered, [](){
-        const auto * tree = state->skeletonState->selectedTrees.front();
+        auto * tree = state->skeletonState->selectedTrees.front();
+        Skeletonizer::singleton().pageInTree(*tree);
         if (!tree->nodes.empty()) {
             Skeletonizer::singleton().jumpToNode(tree->nodes.front());
         }
@@ -976,6 +1089,7 @@ void SkeletonView::jumpToNextNode(const bool forward) const {
 
 void SkeletonView::jumpToNextTree(const bool forward) const {
     jumoTo(treeView, treeModel, treeSortAndCommentFilterProxy, forward, [](auto && elem){
+        Skeletonizer::singleton().pageInTree(elem);
         if (elem.nodes.size() > 0) {
             Skeletonizer::singleton().setActive(elem.nodes.front());
             Skeletonizer::singleton().jumpToNode(elem.nodes.front());
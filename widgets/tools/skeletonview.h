@@ -42,7 +42,10 @@
 #include <QTreeView>
 #include <QVBoxLayout>
 
+#include <cstdint>
 #include <functional>
+#include <unordered_map>
+#include <vector>
 
 template<typename ConcreteModel>
 class AbstractSkeletonModel : public QAbstractListModel {
@@ -53,6 +56,9 @@ public:
     virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     virtual Qt::ItemFlags flags(const QModelIndex & index) const override;
     virtual int rowCount(const QModelIndex & = QModelIndex{}) const override;
+    template<typename Elem>
+    void appendRow(Elem & elem);
+    void removeRowsOf(const std::vector<std::uint64_t> & ids);
 };
 
 class TreeModel : public AbstractSkeletonModel<TreeModel> {
@@ -62,6 +68,7 @@ class TreeModel : public AbstractSkeletonModel<TreeModel> {
     const std::vector<Qt::ItemFlags> flagModifier = {Qt::ItemIsDropEnabled, {}, Qt::ItemIsUserCheckable, {}, Qt::ItemIsEditable, {}};
 public:
     std::vector<std::reference_wrapper<class treeListElement>> cache;
+    std::unordered_map<std::uint64_t, int> rows;// tree id → row of cache
     enum SynapseDisplayModes {
         Hide     = 0,
         Show     = 1,
@@ -71,6 +78,7 @@ public:
     virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
     virtual bool setData(const QModelIndex & index, const QVariant & value, int role = Qt::EditRole) override;
     virtual bool dropMimeData(const QMimeData * data, Qt::DropAction action, int row, int column, const QModelIndex & parent) override;
+    bool matches(const treeListElement & tree) const;
     void recreate();
 signals:
     void moveNodes(const QModelIndex &);
@@ -82,6 +90,7 @@ class NodeModel : public AbstractSkeletonModel<NodeModel> {
     const std::vector<Qt::ItemFlags> flagModifier = {Qt::ItemIsDragEnabled, Qt::ItemIsEditable, Qt::ItemIsEditable, Qt::ItemIsEditable, Qt::ItemIsEditable, Qt::ItemIsEditable, {}};
 public:
     std::vector<std::reference_wrapper<class nodeListElement>> cache;
+    std::unordered_map<std::uint64_t, int> rows;// node id → row of cache
     enum FilterMode {
         All = 0,
         InSelectedTree = 1 << 1,
@@ -93,7 +102,9 @@ public:
     QFlags<FilterMode> mode = FilterMode::InSelectedTree;
     virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
     virtual bool setData(const QModelIndex & index, const QVariant & value, int role = Qt::EditRole) override;
+    bool matches(const nodeListElement & node, const bool matchAll) const;
     void recreate(const bool matchAll);
+    void removeStaleRows();
 };
 
 class NodeView : public QTreeView {
@@ -21,6 +21,7 @@
  */
 
 #include "annotation/annotation.h"
+#include "commentsetting.h"
 #include "coordinate.h"
 #include "dataset.h"
 #include "functions.h"
@@ -39,11 +40,13 @@
 #include "viewer.h"
 
 #include <QMatrix4x4>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLFramebufferObject>
 #include <QOpenGLPaintDevice>
 #include <QOpenGLTimeMonitor>
 #include <QPainter>
 #include <QQuaternion>
+#include <QVector2D>
 #include <QVector3D>
 
 #ifdef Q_OS_MAC
@@ -55,8 +58,13 @@
 #include <boost/math/constants/constants.hpp>
 #include <boost/range/combine.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
 
 enum GLNames {
     None,
@@ -80,6 +88,10 @@ auto lineSize(const float nanometerPerPixel) {
     return std::max(smallestVisibleNodeSize(), state->viewerState->segRadiusToNodeRadius * uniformPointDiameter(nanometerPerPixel));
 }
 
+auto arrayFromQColor(const QColor & color) {
+    return GLBuffers::Color{{static_cast<std::uint8_t>(color.red()), static_cast<std::uint8_t>(color.green()), static_cast<std::uint8_t>(color.blue()), static_cast<std::uint8_t>(color.alpha())}};
+}
+
 QColor getPickingColor(const nodeListElement & node, const RenderOptions::SelectionPass &selectionPass) {
     QColor color;
 
@@ -107,6 +119,11 @@ void ViewportBase::renderCylinder(const Coordinate & base, float baseRadius, con
     topRadius *= Dataset::current().scales[0].x;
 
     if (!options.useLinesAndPoints(std::max(baseRadius, topRadius) * screenPxXPerDataPx, smallestVisibleNodeSize())) {
+        if (collectInstances) {
+            const auto lod = std::max(baseRadius, topRadius) > 100.f ? 2 : std::max(baseRadius, topRadius) > 15.f ? 1 : 0;
+            cylinderLods[lod].instances.push_back({{{isoBase.x, isoBase.y, isoBase.z, baseRadius}}, {{isoTop.x, isoTop.y, isoTop.z, topRadius}}, arrayFromQColor(color)});
+            return;
+        }
         glColor4d(color.redF(), color.greenF(), color.blueF(), color.alphaF());
 
         glPushMatrix();
@@ -145,6 +162,11 @@ void ViewportBase::renderSphere(const Coordinate & pos, float radius, const QCol
     radius *= Dataset::current().scales[0].x;
 
     if (!options.useLinesAndPoints(radius * screenPxXPerDataPx, smallestVisibleNodeSize())) {
+        if (collectInstances) {
+            const auto lod = radius * screenPxXPerDataPx > 20. ? 2 : radius * screenPxXPerDataPx > 5. ? 1 : 0;
+            sphereLods[lod].instances.push_back({{{isoPos.x, isoPos.y, isoPos.z, radius}}, {}, arrayFromQColor(color)});
+            return;
+        }
         glColor4d(color.redF(), color.greenF(), color.blueF(), color.alphaF());
         glPushMatrix();
         glTranslatef(isoPos.x, isoPos.y, isoPos.z);
@@ -166,6 +188,58 @@ void ViewportBase::renderSphere(const Coordinate & pos, float radius, const QCol
     }
 }
 
+void ViewportBase::renderInstances(QOpenGLShaderProgram & shader, std::array<InstancedMesh, 3> & lods) {
+    GLfloat modelview_mat[4][4];
+    glGetFloatv(GL_MODELVIEW_MATRIX, &modelview_mat[0][0]);
+    GLfloat projection_mat[4][4];
+    glGetFloatv(GL_PROJECTION_MATRIX, &projection_mat[0][0]);
+    auto & gl = *context()->extraFunctions();
+
+    shader.bind();
+    shader.setUniformValue("modelview_matrix", modelview_mat);
+    shader.setUniformValue("projection_matrix", projection_mat);
+    shader.setUniformValue("lighting", static_cast<GLint>(state->viewerState->lightOnOff));// like the glu path
+    const int vertexLocation = shader.attributeLocation("vertex");
+    // per instance attributes, instance_top is unused for spheres
+    std::vector<std::tuple<int, GLenum, int>> instanceAttributes;
+    for (const auto & attribute : {std::make_tuple("instance_base", GL_FLOAT, offsetof(InstancedMesh::Instance, base))
+                                 , std::make_tuple("instance_top", GL_FLOAT, offsetof(InstancedMesh::Instance, top))
+                                 , std::make_tuple("color", GL_UNSIGNED_BYTE, offsetof(InstancedMesh::Instance, color))}) {
+        const int location = shader.attributeLocation(std::get<0>(attribute));
+        if (location != -1) {
+            instanceAttributes.emplace_back(location, std::get<1>(attribute), static_cast<int>(std::get<2>(attribute)));
+        }
+    }
+    for (auto & mesh : lods) {
+        if (mesh.instances.empty()) {
+            continue;
+        }
+        mesh.vertexBuffer.bind();
+        shader.enableAttributeArray(vertexLocation);
+        shader.setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 3);
+        mesh.vertexBuffer.release();
+
+        mesh.instanceBuffer.bind();
+        mesh.instanceBuffer.allocate(mesh.instances.data(), static_cast<int>(mesh.instances.size() * sizeof(mesh.instances.front())));
+        for (const auto & [location, type, offset] : instanceAttributes) {
+            shader.enableAttributeArray(location);
+            shader.setAttributeBuffer(location, type, offset, 4, sizeof(InstancedMesh::Instance));
+            gl.glVertexAttribDivisor(static_cast<GLuint>(location), 1);
+        }
+        mesh.instanceBuffer.release();
+
+        gl.glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.vertexCount, static_cast<GLsizei>(mesh.instances.size()));
+
+        for (const auto & attribute : instanceAttributes) {
+            gl.glVertexAttribDivisor(static_cast<GLuint>(std::get<0>(attribute)), 0);
+            shader.disableAttributeArray(std::get<0>(attribute));
+        }
+        shader.disableAttributeArray(vertexLocation);
+        mesh.instances.clear();
+    }
+    shader.release();
+}
+
 void ViewportBase::renderSegment(const segmentListElement & segment, const QColor & color, const RenderOptions & options) {
     renderCylinder(segment.source.position, Skeletonizer::singleton().radius(segment.source) * state->viewerState->segRadiusToNodeRadius,
         segment.target.position, Skeletonizer::singleton().radius(segment.target) * state->viewerState->segRadiusToNodeRadius, color, options);
@@ -601,30 +675,19 @@ void ViewportOrtho::renderViewportFast(const Dataset & dset, TextureLayer & laye
         if (layer.isOverlayData) {
             overlay_data_shader.setUniformValue("indexTexture", 0);
             overlay_data_shader.setUniformValue("textureLUT", 1);
-            overlay_data_shader.setUniformValue("factor", static_cast<float>(std::numeric_limits<gpu_lut_cube::gpu_index>::max()));
+            overlay_data_shader.setUniformValue("factor", static_cast<float>(std::numeric_limits<std::uint16_t>::max()));
+            overlay_data_shader.setUniformValue("lutSize", QVector2D(layer.lut.texture.width(), layer.lut.texture.height()));
+            layer.lut.texture.bind(1);
         } else {
             raw_data_shader.setUniformValue("texture", 0);
         }
         auto render = [&](auto & cube, const QMatrix4x4 modelMatrix = {}){
-            if (layer.isOverlayData) {
-                auto & punned = static_cast<gpu_lut_cube&>(cube);
-                punned.cube.bind(0);
-                punned.lut.bind(1);
-                overlay_data_shader.setUniformValue("lutSize", static_cast<float>(punned.lut.width() * punned.lut.height() * punned.lut.depth()));
-            } else {
-                cube.cube.bind(0);
-            }
+            cube.cube.bind(0);
             shader.setUniformValue("model_matrix", modelMatrix);
 
             glDrawArrays(GL_TRIANGLE_FAN, 0, static_cast<int>(triangleVertices.size()));
 
-            if (layer.isOverlayData) {
-                auto & punned = static_cast<gpu_lut_cube&>(cube);
-                punned.lut.release(1, QOpenGLTexture::ResetTextureUnit);
-                punned.cube.release(0, QOpenGLTexture::ResetTextureUnit);
-            } else {
-                cube.cube.release(0, QOpenGLTexture::ResetTextureUnit);
-            }
+            cube.cube.release(0, QOpenGLTexture::ResetTextureUnit);
         };
         if (!arb) {
             const float halfsc = fov.componentMul(v1).length() * 0.5f / gpuCubeShape.x;
@@ -671,6 +734,9 @@ void ViewportOrtho::renderViewportFast(const Dataset & dset, TextureLayer & laye
                 }
             }
         }
+        if (layer.isOverlayData) {
+            layer.lut.texture.release(1, QOpenGLTexture::ResetTextureUnit);
+        }
         shader.disableAttributeArray(vertexLocation);
         shader.disableAttributeArray(texLocation);
         shader.release();
@@ -932,49 +998,85 @@ void Viewport3D::renderVolumeVP() {
         float scaley = 1.0f / (datascale.y / biggestScale);
         float scalez = 1.0f / (datascale.z / biggestScale);
 
-        glMatrixMode(GL_TEXTURE);
-        glLoadIdentity();
-
+        QMatrix4x4 texMatrix;
         // dataset translation adjustment
-        glTranslatef((static_cast<float>(state->viewerState->currentPosition.x % cubeLen.x) / cubeLen.x - 0.5f) / state->M,
-                     (static_cast<float>(state->viewerState->currentPosition.y % cubeLen.y) / cubeLen.y - 0.5f) / state->M,
-                     (static_cast<float>(state->viewerState->currentPosition.z % cubeLen.z) / cubeLen.z - 0.5f) / state->M);
-
-        glTranslatef(0.5f, 0.5f, 0.5f);
-        glScalef(volumeClippingAdjust, volumeClippingAdjust, volumeClippingAdjust); // scale to remove cube corner clipping
-        glScalef(scalex, scaley, scalez); // dataset scaling adjustment
-        glMultMatrixf(volRotMatrix.data()); // volume viewport rotation
-        glScalef(1.0f/zoom, 1.0f/zoom, 1.0f/zoom*2.0f); // volume viewport zoom
-        glTranslatef(-0.5f, -0.5f, -0.5f);
-        glTranslatef(transx, transy, 0.0f); // volume viewport translation
+        texMatrix.translate((static_cast<float>(state->viewerState->currentPosition.x % cubeLen.x) / cubeLen.x - 0.5f) / state->M,
+                            (static_cast<float>(state->viewerState->currentPosition.y % cubeLen.y) / cubeLen.y - 0.5f) / state->M,
+                            (static_cast<float>(state->viewerState->currentPosition.z % cubeLen.z) / cubeLen.z - 0.5f) / state->M);
+
+        texMatrix.translate(0.5f, 0.5f, 0.5f);
+        texMatrix.scale(volumeClippingAdjust, volumeClippingAdjust, volumeClippingAdjust); // scale to remove cube corner clipping
+        texMatrix.scale(scalex, scaley, scalez); // dataset scaling adjustment
+        texMatrix *= volRotMatrix; // volume viewport rotation
+        texMatrix.scale(1.0f/zoom, 1.0f/zoom, 1.0f/zoom*2.0f); // volume viewport zoom
+        texMatrix.translate(-0.5f, -0.5f, -0.5f);
+        texMatrix.translate(transx, transy, 0.0f); // volume viewport translation
+
+        const bool zwei = Dataset::datasets[seg.layerId].boundary.z == 1;
+        const int sliceCount = zwei ? 1 : texLen * volumeClippingAdjust * maxScaleRatio;
+        float volume_opacity = seg.volume_opacity / 255.0f;
+        if (volumeRaycastShader.isLinked()) {
+            // one ray per pixel front to back through the same sample positions the slice stack used
+            glDisable(GL_DEPTH_TEST);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_3D, seg.volume_occupancy_tex_id);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_3D, volTexId);
+
+            volumeRaycastShader.bind();
+            volumeRaycastShader.setUniformValue("volume", 0);
+            volumeRaycastShader.setUniformValue("occupancy", 1);
+            volumeRaycastShader.setUniformValue("texMatrix", texMatrix);
+            volumeRaycastShader.setUniformValue("opacity", volume_opacity);
+            volumeRaycastShader.setUniformValue("steps", sliceCount);
+            volumeRaycastShader.setUniformValue("rFront", zwei ? 0.5f : (sliceCount - 1.0f) / sliceCount);
+            volumeRaycastShader.setUniformValue("rStep", 1.0f / sliceCount);
+            volumeRaycastShader.setUniformValue("bricks", static_cast<float>((texLen + volumeBrickLen - 1) / volumeBrickLen));
+
+            screenVertexBuf.bind();
+            int vertexLocation = volumeRaycastShader.attributeLocation("vertex");
+            volumeRaycastShader.enableAttributeArray(vertexLocation);
+            volumeRaycastShader.setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 3);
+            screenVertexBuf.release();
 
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
+            glDrawArrays(GL_QUADS, 0, 4);
 
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_TEXTURE_3D);
+            volumeRaycastShader.disableAttributeArray(vertexLocation);
+            volumeRaycastShader.release();
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_3D, 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_3D, 0);
+        } else {// fixed function slice stacking
+            glMatrixMode(GL_TEXTURE);
+            glLoadMatrixf(texMatrix.constData());
+            glMatrixMode(GL_MODELVIEW);
+            glLoadIdentity();
+
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_TEXTURE_3D);
+
+            glBindTexture(GL_TEXTURE_3D, volTexId);
+            for(int i = 0; i < sliceCount; ++i) {
+                float depth = zwei ? 0.5 : i/static_cast<float>(sliceCount);
+                glColor4f(depth, depth, depth, volume_opacity);
+                glBegin(GL_QUADS);
+                    glTexCoord3f(0.0f, 1.0f, depth);
+                    glVertex3f(-1.0f, -1.0f,  1.0f-depth*2.0f);
+                    glTexCoord3f(1.0f, 1.0f, depth);
+                    glVertex3f( 1.0f, -1.0f,  1.0f-depth*2.0f);
+                    glTexCoord3f(1.0f, 0.0f, depth);
+                    glVertex3f( 1.0f,  1.0f,  1.0f-depth*2.0f);
+                    glTexCoord3f(0.0f, 0.0f, depth);
+                    glVertex3f(-1.0f,  1.0f,  1.0f-depth*2.0f);
+                glEnd();
+            }
 
-        glBindTexture(GL_TEXTURE_3D, volTexId);
-        float volume_opacity = seg.volume_opacity / 255.0f;
-        for(int i = 0; i < (Dataset::datasets[seg.layerId].boundary.z == 1 ? 1 : texLen * volumeClippingAdjust * maxScaleRatio); ++i) {
-            float depth = Dataset::datasets[seg.layerId].boundary.z == 1 ? 0.5 : i/(texLen * volumeClippingAdjust * maxScaleRatio);
-            glColor4f(depth, depth, depth, volume_opacity);
-            glBegin(GL_QUADS);
-                glTexCoord3f(0.0f, 1.0f, depth);
-                glVertex3f(-1.0f, -1.0f,  1.0f-depth*2.0f);
-                glTexCoord3f(1.0f, 1.0f, depth);
-                glVertex3f( 1.0f, -1.0f,  1.0f-depth*2.0f);
-                glTexCoord3f(1.0f, 0.0f, depth);
-                glVertex3f( 1.0f,  1.0f,  1.0f-depth*2.0f);
-                glTexCoord3f(0.0f, 0.0f, depth);
-                glVertex3f(-1.0f,  1.0f,  1.0f-depth*2.0f);
-            glEnd();
+            glMatrixMode(GL_TEXTURE);
+            glLoadIdentity();
+            glMatrixMode(GL_MODELVIEW);
         }
 
-        glMatrixMode(GL_TEXTURE);
-        glLoadIdentity();
-        glMatrixMode(GL_MODELVIEW);
-
         // Reset previously changed OGL parameters
         glDisable(GL_TEXTURE_3D);
         glEnable(GL_TEXTURE_2D);
@@ -1770,7 +1872,82 @@ boost::optional<nodeListElement &> ViewportBase::pickNode(int x, int y, int widt
     return boost::none;
 }
 
+std::pair<bool, bool> darkenOrHideTree(const treeListElement & currentTree, const ViewportType vpType);
+
+boost::optional<hash_list<nodeListElement *>> ViewportBase::pickNodesFromIndex(int centerX, int centerY, int width, int height) {
+    const bool radiusUnbounded = !state->viewerState->highlightedNodePropertyByRadius.isEmpty() || CommentSetting::useCommentNodeRadius;
+    if (!pickingMatrixValid || radiusUnbounded || this->width() == 0 || this->height() == 0) {
+        return boost::none;
+    }
+    bool invertible;
+    const auto inverse = pickingMatrix.inverted(&invertible);
+    if (!invertible) {
+        return boost::none;
+    }
+    const auto scale = Dataset::current().scales[0];
+    const auto toNdc = [this](const float x, const float y){
+        return QPointF{2.0 * x / this->width() - 1.0, 1.0 - 2.0 * y / this->height()};
+    };
+    const auto rectMin = toNdc(centerX - width / 2, centerY + height / 2);
+    const auto rectMax = toNdc(centerX - width / 2 + width, centerY - height / 2);
+    // data space bounds of the picking volume (rectangle × depth range)
+    floatCoordinate min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    floatCoordinate max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const auto x : {rectMin.x(), rectMax.x()})
+    for (const auto y : {rectMin.y(), rectMax.y()})
+    for (const auto z : {-1.0, 1.0}) {
+        const auto iso = inverse.map(QVector3D(x, y, z));
+        const floatCoordinate pos{iso.x() / scale.x, iso.y() / scale.y, iso.z() / scale.z};
+        min = {std::min(min.x, pos.x), std::min(min.y, pos.y), std::min(min.z, pos.z)};
+        max = {std::max(max.x, pos.x), std::max(max.y, pos.y), std::max(max.z, pos.z)};
+    }
+    const auto & index = state->skeletonState->nodeIndex;
+    const auto radiusBound = std::max(state->viewerState->overrideNodeRadiusBool ? state->viewerState->overrideNodeRadiusVal : 0.f, index.radiusBound());
+    const auto pad = std::ceil(radiusBound * scale.x / std::min({scale.x, scale.y, scale.z})) + 1;
+    const auto candidates = index.inBox(Coordinate(std::floor(min.x - pad), std::floor(min.y - pad), std::floor(min.z - pad))
+                                      , Coordinate(std::ceil(max.x + pad), std::ceil(max.y + pad), std::ceil(max.z + pad)));
+
+    // orthographic projections: one length per axis for every position
+    const auto pxPerIso = QVector3D(pickingMatrix(0, 0), pickingMatrix(0, 1), pickingMatrix(0, 2)).length() * 0.5f * this->width();
+    const auto ndcZPerIso = QVector3D(pickingMatrix(2, 0), pickingMatrix(2, 1), pickingMatrix(2, 2)).length();
+    std::unordered_map<const treeListElement *, bool> hiddenTrees;
+    std::vector<std::tuple<float, float, nodeListElement *>> hits;// screen distance, depth, node
+    for (auto * node : candidates) {
+        auto hiddenIt = hiddenTrees.find(node->correspondingTree);
+        if (hiddenIt == std::end(hiddenTrees)) {
+            hiddenIt = hiddenTrees.emplace(node->correspondingTree, darkenOrHideTree(*node->correspondingTree, viewportType).second).first;
+        }
+        if (hiddenIt->second) {
+            continue;
+        }
+        const auto isoRadius = Skeletonizer::singleton().radius(*node) * scale.x;
+        const auto ndc = pickingMatrix.map(QVector3D(scale.componentMul(node->position)));
+        if (std::abs(ndc.z()) > 1 + isoRadius * ndcZPerIso) {// depth cutoff
+            continue;
+        }
+        const auto screenX = (ndc.x() + 1) * 0.5f * this->width();
+        const auto screenY = (1 - ndc.y()) * 0.5f * this->height();
+        const auto radiusPx = std::max(0.5f, isoRadius * pxPerIso);
+        // distance from the projected center to the picking rectangle
+        const auto dx = std::max({0.f, centerX - width / 2 - screenX, screenX - (centerX - width / 2 + width)});
+        const auto dy = std::max({0.f, centerY - height / 2 - screenY, screenY - (centerY - height / 2 + height)});
+        if (std::hypot(dx, dy) <= radiusPx) {
+            const auto distance = std::max(0.f, std::hypot(screenX - centerX, screenY - centerY) - radiusPx);
+            hits.emplace_back(distance, ndc.z(), node);
+        }
+    }
+    std::sort(std::begin(hits), std::end(hits));// nearest to the center first, front to back
+    hash_list<nodeListElement *> foundNodes;
+    for (const auto & hit : hits) {
+        foundNodes.emplace_back(std::get<2>(hit));
+    }
+    return foundNodes;
+}
+
 hash_list<nodeListElement *> ViewportBase::pickNodes(int centerX, int centerY, int width, int height) {
+    if (auto nodes = pickNodesFromIndex(centerX, centerY, width, height)) {
+        return nodes.get();
+    }
     makeCurrent();
     glPushAttrib(GL_VIEWPORT_BIT);
     glViewport(0, 0, this->width(), this->height());
@@ -1812,7 +1989,7 @@ hash_list<nodeListElement *> ViewportBase::pickNodes(int centerX, int centerY, i
     return foundNodes;
 }
 
-std::pair<bool, bool> darkenOrHideTree(treeListElement & currentTree, const ViewportType vpType) {
+std::pair<bool, bool> darkenOrHideTree(const treeListElement & currentTree, const ViewportType vpType) {
     const auto * activeTree = state->skeletonState->activeTree;
     const auto * activeNode = state->skeletonState->activeNode;
     const auto * activeSynapse = (activeNode && activeNode->isSynapticNode) ? activeNode->correspondingSynapse :
@@ -1853,89 +2030,237 @@ void synapseLoop(Func func, const ViewportType vpType){
     }
 }
 
-void generateSkeletonGeometry(GLBuffers & glBuffers, const RenderOptions &options, const ViewportType viewportType) {
-    glBuffers.regenVertBuffer = false;
-    glBuffers.lineVertBuffer.clear();
-    glBuffers.pointVertBuffer.clear();
-    glBuffers.colorPickingBuffer24.clear();
-    glBuffers.colorPickingBuffer48.clear();
-    glBuffers.colorPickingBuffer64.clear();
-
-    auto arrayFromQColor = [](QColor color){
-        return decltype(glBuffers.lineVertBuffer.colors)::value_type{{static_cast<std::uint8_t>(color.red()), static_cast<std::uint8_t>(color.green()), static_cast<std::uint8_t>(color.blue()), static_cast<std::uint8_t>(color.alpha())}};
-    };
+void GLBuffers::RenderBuffer::clear() {
+    vertices.clear();
+    colors.clear();
+    for (auto & buffer : pickingColors) {
+        buffer.clear();
+    }
+    slotKeys.clear();
+    slots.clear();
+    chunks.clear();
+    freeChunks.clear();
+    dirtyBegin = dirtyEnd = 0;
+}
 
-    auto addSegment = [arrayFromQColor, &glBuffers](const segmentListElement & segment, const QColor & color) {
-        const auto isoBase = Dataset::current().scales[0].componentMul(segment.source.position);
-        const auto isoTop = Dataset::current().scales[0].componentMul(segment.target.position);
+std::size_t GLBuffers::RenderBuffer::allocate(const std::size_t capacity) {
+    const auto freeIt = std::find_if(std::begin(freeChunks), std::end(freeChunks), [capacity](const auto & chunk){
+        return chunk.second >= capacity;
+    });
+    if (freeIt != std::end(freeChunks)) {// first fit, the remainder stays free
+        const auto offset = freeIt->first;
+        if (freeIt->second > capacity) {
+            *freeIt = {offset + capacity, freeIt->second - capacity};
+        } else {
+            freeChunks.erase(freeIt);
+        }
+        return offset;
+    }
+    const auto offset = slotKeys.size();
+    slotKeys.resize(offset + capacity);
+    vertices.resize(slotKeys.size() * vertsPerSlot);
+    colors.resize(slotKeys.size() * vertsPerSlot);
+    if (picking) {
+        for (auto & buffer : pickingColors) {
+            buffer.resize(slotKeys.size());
+        }
+    }
+    return offset;
+}
 
-        glBuffers.lineVertBuffer.emplace_back(isoBase, arrayFromQColor(color));
-        glBuffers.lineVertBuffer.emplace_back(isoTop, arrayFromQColor(color));
-    };
+void GLBuffers::RenderBuffer::moveSlot(const std::size_t from, const std::size_t to) {
+    std::copy_n(std::next(std::begin(vertices), from * vertsPerSlot), vertsPerSlot, std::next(std::begin(vertices), to * vertsPerSlot));
+    std::copy_n(std::next(std::begin(colors), from * vertsPerSlot), vertsPerSlot, std::next(std::begin(colors), to * vertsPerSlot));
+    if (picking) {
+        for (auto & buffer : pickingColors) {
+            buffer[to] = buffer[from];
+        }
+    }
+    slotKeys[to] = slotKeys[from];
+    slots[slotKeys[to]].second = to;
+    markDirty(to);
+}
 
-    auto addNode = [arrayFromQColor, options, &glBuffers](const nodeListElement & node) {
-        auto color = state->viewer->getNodeColor(node);
+void GLBuffers::RenderBuffer::reserve(const treeListElement & tree, const std::size_t count) {
+    if (chunks.count(tree.treeID) == 0) {
+        const auto capacity = std::max<std::size_t>(16, count + count / 4);
+        chunks.emplace(tree.treeID, Chunk{&tree, allocate(capacity), capacity});
+    }
+}
 
-        if (node.selected && options.highlightSelection) {// highlight selected nodes
-            auto selectedNodeColor = QColor(Qt::green);
-//            selectedNodeColor.setAlphaF(0.5f);// results in half-transparent nodes in low mode
-            color = selectedNodeColor;
-            glBuffers.pointVertBuffer.lastSelectedNode = node.nodeID;
+std::size_t GLBuffers::RenderBuffer::slot(const treeListElement & tree, const SlotKey & key) {
+    const auto slotIt = slots.find(key);
+    if (slotIt != std::end(slots)) {
+        if (slotIt->second.first == tree.treeID) {
+            return slotIt->second.second;
         }
+        remove(key);// changed its tree
+    }
+    reserve(tree, 0);
+    auto & chunk = chunks.at(tree.treeID);
+    if (chunk.size == chunk.capacity) {// relocate into a chunk twice as big
+        const auto capacity = 2 * chunk.capacity;
+        const auto offset = allocate(capacity);
+        for (std::size_t i = 0; i < chunk.size; ++i) {
+            moveSlot(chunk.offset + i, offset + i);
+        }
+        freeChunks.emplace_back(chunk.offset, chunk.capacity);
+        chunk.offset = offset;
+        chunk.capacity = capacity;
+    }
+    const auto slot = chunk.offset + chunk.size++;
+    slotKeys[slot] = key;
+    slots[key] = {tree.treeID, slot};
+    return slot;
+}
+
+void GLBuffers::RenderBuffer::remove(const SlotKey & key) {
+    const auto slotIt = slots.find(key);
+    if (slotIt == std::end(slots)) {
+        return;
+    }
+    const auto [treeID, slot] = slotIt->second;
+    slots.erase(slotIt);
+    auto chunkIt = chunks.find(treeID);
+    auto & chunk = chunkIt->second;
+    const auto last = chunk.offset + chunk.size - 1;
+    if (slot != last) {// keep the chunk dense
+        moveSlot(last, slot);
+    }
+    if (--chunk.size == 0) {
+        freeChunks.emplace_back(chunk.offset, chunk.capacity);
+        chunks.erase(chunkIt);
+    }
+}
 
-        const auto isoPos = Dataset::current().scales[0].componentMul(node.position);
+void GLBuffers::RenderBuffer::removeTree(const std::uint64_t treeID) {
+    const auto chunkIt = chunks.find(treeID);
+    if (chunkIt == std::end(chunks)) {
+        return;
+    }
+    const auto & chunk = chunkIt->second;
+    for (std::size_t slot = chunk.offset; slot < chunk.offset + chunk.size; ++slot) {
+        slots.erase(slotKeys[slot]);
+    }
+    freeChunks.emplace_back(chunk.offset, chunk.capacity);
+    chunks.erase(chunkIt);
+}
 
-        glBuffers.colorPickingBuffer24.emplace_back(arrayFromQColor(getPickingColor(node, RenderOptions::SelectionPass::NodeID0_24Bits)));
-        glBuffers.colorPickingBuffer48.emplace_back(arrayFromQColor(getPickingColor(node, RenderOptions::SelectionPass::NodeID24_48Bits)));
-        glBuffers.colorPickingBuffer64.emplace_back(arrayFromQColor(getPickingColor(node, RenderOptions::SelectionPass::NodeID48_64Bits)));
-        glBuffers.pointVertBuffer.emplace_back(isoPos, arrayFromQColor(color));
-        glBuffers.pointVertBuffer.colorBufferOffset[node.nodeID] = static_cast<unsigned int>(glBuffers.pointVertBuffer.vertices.size()-1);
-    };
+void GLBuffers::RenderBuffer::markDirty(const std::size_t slot) {
+    if (dirtyBegin == dirtyEnd) {
+        dirtyBegin = slot;
+        dirtyEnd = slot + 1;
+    } else {
+        dirtyBegin = std::min(dirtyBegin, slot);
+        dirtyEnd = std::max(dirtyEnd, slot + 1);
+    }
+}
 
-    for (auto & currentTree : Skeletonizer::singleton().skeletonState.trees) {
-        // focus on synapses, darken rest of skeleton
-        bool darken, hide;
-        std::tie(darken, hide) = darkenOrHideTree(currentTree, viewportType);
-        if (hide) {
-            continue;
+void GLBuffers::RenderBuffer::upload() {
+    const auto write = [](auto & buf, const auto & data, const std::size_t begin, const std::size_t end){
+        buf.bind();
+        buf.write(static_cast<int>(begin * sizeof(data.front())), data.data() + begin, static_cast<int>((end - begin) * sizeof(data.front())));
+        buf.release();
+    };
+    if (gpuVertices < vertices.size() || !vertex_buffer.isCreated()) {// grow with the vector to amortize reallocations
+        gpuVertices = vertices.capacity();
+        for (auto * buf : {&vertex_buffer, &color_buffer}) {
+            buf->destroy();
+            buf->create();
+            buf->bind();
+            buf->allocate(static_cast<int>(gpuVertices * (buf == &vertex_buffer ? sizeof(vertices.front()) : sizeof(colors.front()))));
+            buf->release();
         }
-        for (auto nodeIt = std::begin(currentTree.nodes); nodeIt != std::end(currentTree.nodes); ++nodeIt) {
-            //This sets the current color for the segment rendering
-            QColor currentColor = currentTree.color;
-            if (state->viewerState->highlightActiveTree && currentTree.treeID == state->skeletonState->activeTree->treeID) {
-                currentColor = Qt::red;
-            }
-            if (darken) {
-                currentColor.setAlpha(Synapse::darkenedAlpha);
-            }
+        dirtyBegin = 0;
+        dirtyEnd = slotKeys.size();
+    }
+    if (dirtyBegin < dirtyEnd) {
+        write(vertex_buffer, vertices, dirtyBegin * vertsPerSlot, dirtyEnd * vertsPerSlot);
+        write(color_buffer, colors, dirtyBegin * vertsPerSlot, dirtyEnd * vertsPerSlot);
+        dirtyBegin = dirtyEnd = 0;
+    }
+}
 
-            for (const auto & currentSegment : nodeIt->segments) {
-                if (currentSegment.forward) {
-                    continue;
-                }
-                addSegment(currentSegment, currentColor);
-            }
+bool GLBuffers::darkeningActive() {
+    const auto * activeTree = state->skeletonState->activeTree;
+    const auto * activeNode = state->skeletonState->activeNode;
+    return state->skeletonState->synapseState != Synapse::State::PreSynapse || (activeNode && activeNode->isSynapticNode) || (activeTree && activeTree->isSynapticCleft);
+}
 
-            addNode(*nodeIt);
+void GLBuffers::writeTree(const treeListElement & tree) {
+    pointVertBuffer.reserve(tree, tree.nodes.size());
+    lineVertBuffer.reserve(tree, tree.nodes.size());
+    for (const auto & node : tree.nodes) {
+        writeNodeSlot(node);
+        for (const auto & segment : node.segments) {
+            if (!segment.forward) {
+                writeSegment(segment.source, segment.target);
+            }
         }
     }
+}
+
+void GLBuffers::writeNodeSlot(const nodeListElement & node) {
+    auto color = state->viewer->getNodeColor(node);
+    if (node.selected && highlightSelection) {// highlight selected nodes
+        color = QColor(Qt::green);// opaque, alpha results in half-transparent nodes in low mode
+        pointVertBuffer.lastSelectedNode = node.nodeID;
+    }
+    const auto slot = pointVertBuffer.slot(*node.correspondingTree, {node.nodeID, 0});
+    pointVertBuffer.vertices[slot] = Dataset::current().scales[0].componentMul(node.position);
+    pointVertBuffer.colors[slot] = arrayFromQColor(color);
+    pointVertBuffer.pickingColors[0][slot] = arrayFromQColor(getPickingColor(node, RenderOptions::SelectionPass::NodeID0_24Bits));
+    pointVertBuffer.pickingColors[1][slot] = arrayFromQColor(getPickingColor(node, RenderOptions::SelectionPass::NodeID24_48Bits));
+    pointVertBuffer.pickingColors[2][slot] = arrayFromQColor(getPickingColor(node, RenderOptions::SelectionPass::NodeID48_64Bits));
+    pointVertBuffer.markDirty(slot);
+}
 
-    synapseLoop([&addSegment](const auto &, const auto & virtualSegment, const auto & color){
-        addSegment(virtualSegment, color);
-    }, viewportType);
+void GLBuffers::writeNode(const nodeListElement & node) {
+    writeNodeSlot(node);
+    // segments end at the moved node
+    for (const auto & segment : node.segments) {
+        writeSegment(segment.source, segment.target);
+    }
+}
 
-    const auto uploadVertexData = [](auto & buf, const auto & vertices){
-        buf.destroy();
-        buf.create();
-        buf.bind();
-        buf.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(vertices.front())));
-        buf.release();
-    };
-    uploadVertexData(glBuffers.pointVertBuffer.color_buffer, glBuffers.pointVertBuffer.colors);
-    uploadVertexData(glBuffers.pointVertBuffer.vertex_buffer, glBuffers.pointVertBuffer.vertices);
+void GLBuffers::writeSegment(const nodeListElement & source, const nodeListElement & target) {
+    const auto & tree = *target.correspondingTree;
+    QColor color = tree.color;
+    if (state->viewerState->highlightActiveTree && &tree == state->skeletonState->activeTree) {
+        color = Qt::red;
+    }
+    if (darkenOrHideTree(tree, VIEWPORT_SKELETON).first) {// focus on synapses, darken rest of skeleton
+        color.setAlpha(Synapse::darkenedAlpha);
+    }
+    const auto slot = lineVertBuffer.slot(tree, {source.nodeID, target.nodeID});
+    lineVertBuffer.vertices[2 * slot] = Dataset::current().scales[0].componentMul(source.position);
+    lineVertBuffer.vertices[2 * slot + 1] = Dataset::current().scales[0].componentMul(target.position);
+    lineVertBuffer.colors[2 * slot] = lineVertBuffer.colors[2 * slot + 1] = arrayFromQColor(color);
+    lineVertBuffer.markDirty(slot);
+}
+
+void GLBuffers::removeTree(const std::uint64_t treeID) {
+    pointVertBuffer.removeTree(treeID);
+    lineVertBuffer.removeTree(treeID);
+}
+
+void GLBuffers::removeNode(const std::uint64_t nodeID) {
+    pointVertBuffer.remove({nodeID, 0});
+}
+
+void GLBuffers::removeSegment(const std::uint64_t sourceID, const std::uint64_t targetID) {
+    lineVertBuffer.remove({sourceID, targetID});
+}
 
-    uploadVertexData(glBuffers.lineVertBuffer.color_buffer, glBuffers.lineVertBuffer.colors);
-    uploadVertexData(glBuffers.lineVertBuffer.vertex_buffer, glBuffers.lineVertBuffer.vertices);
+void generateSkeletonGeometry(GLBuffers & glBuffers, const RenderOptions &options) {
+    glBuffers.regenVertBuffer = false;
+    glBuffers.highlightSelection = options.highlightSelection;
+    glBuffers.synapseFocus = GLBuffers::darkeningActive();
+    glBuffers.lineVertBuffer.clear();
+    glBuffers.pointVertBuffer.clear();
+    for (const auto & tree : Skeletonizer::singleton().skeletonState.trees) {
+        glBuffers.writeTree(tree);
+    }
 }
 
 /*
@@ -1978,12 +2303,34 @@ void ViewportBase::renderSkeleton(const RenderOptions &options) {
     //if(viewportType == VIEWPORT_SKELETON) glEnable(GL_CULL_FACE);
 
     glPushMatrix();
-    const auto displayFlag = (viewportType == VIEWPORT_SKELETON) ? state->viewerState->skeletonDisplayVP3D : state->viewerState->skeletonDisplayVPOrtho;
-    auto & glBuffers = displayFlag.testFlag(TreeDisplay::OnlySelected) ? state->viewerState->selectedTreesBuffers : state->viewerState->AllTreesBuffers;
+    if (!options.nodePicking) {// remember the transformation for picking on the cpu
+        QMatrix4x4 modelview, projection;
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview.data());
+        glGetFloatv(GL_PROJECTION_MATRIX, projection.data());
+        pickingMatrix = projection * modelview;
+        pickingMatrixValid = true;
+    }
+    auto & glBuffers = state->viewerState->skeletonBuffers;
     if(glBuffers.regenVertBuffer) {
-        generateSkeletonGeometry(glBuffers, options, viewportType);
+        generateSkeletonGeometry(glBuffers, options);
     }
+    glBuffers.lineVertBuffer.upload();
+    glBuffers.pointVertBuffer.upload();
+    // hidden trees are skipped per viewport instead of being left out of the buffers
+    const auto visibleRanges = [this](const GLBuffers::RenderBuffer & buffer){
+        std::vector<GLint> firsts;
+        std::vector<GLsizei> counts;
+        buffer.forEachRange([this, &firsts, &counts](const treeListElement & tree, const std::size_t first, const std::size_t count){
+            if (!darkenOrHideTree(tree, viewportType).second) {
+                firsts.emplace_back(static_cast<GLint>(first));
+                counts.emplace_back(static_cast<GLsizei>(count));
+            }
+        });
+        return std::make_pair(firsts, counts);
+    };
     if(!state->viewerState->onlyLinesAndPoints) {
+        // queue spheres and cylinders to draw them instanced at once
+        collectInstances = instancingSupported && !options.nodePicking;
         for (auto & currentTree : Skeletonizer::singleton().skeletonState.trees) {
             // focus on synapses, darken rest of skeleton
             bool darken, hide;
@@ -2095,6 +2442,11 @@ void ViewportBase::renderSkeleton(const RenderOptions &options) {
                     , Skeletonizer::singleton().radius(*synapse.getPostSynapse()) * state->viewerState->segRadiusToNodeRadius, color, options);
             }, viewportType);
         }
+        if (collectInstances) {
+            collectInstances = false;
+            renderInstances(instancedCylinderShader, cylinderLods);
+            renderInstances(instancedSphereShader, sphereLods);
+        }
     }
 
     // lighting isn’t really applicable to lines and points
@@ -2122,7 +2474,20 @@ void ViewportBase::renderSkeleton(const RenderOptions &options) {
         glColorPointer(4, GL_UNSIGNED_BYTE, 0, nullptr);
         glBuffers.lineVertBuffer.color_buffer.release();
 
-        glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(glBuffers.lineVertBuffer.vertices.size()));
+        const auto lineRanges = visibleRanges(glBuffers.lineVertBuffer);
+        glMultiDrawArrays(GL_LINES, lineRanges.first.data(), lineRanges.second.data(), static_cast<GLsizei>(lineRanges.first.size()));
+
+        /* synapses are few and depend on the selection, so they’re collected every frame */
+        std::vector<floatCoordinate> synapseVertices;
+        std::vector<GLBuffers::Color> synapseColors;
+        synapseLoop([&synapseVertices, &synapseColors](const auto &, const auto & virtualSegment, const auto & color){
+            synapseVertices.emplace_back(Dataset::current().scales[0].componentMul(virtualSegment.source.position));
+            synapseVertices.emplace_back(Dataset::current().scales[0].componentMul(virtualSegment.target.position));
+            synapseColors.insert(std::end(synapseColors), 2, arrayFromQColor(color));
+        }, viewportType);
+        glVertexPointer(3, GL_FLOAT, 0, synapseVertices.data());
+        glColorPointer(4, GL_UNSIGNED_BYTE, 0, synapseColors.data());
+        glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(synapseVertices.size()));
 
         glDisableClientState(GL_COLOR_ARRAY);
         glDisableClientState(GL_VERTEX_ARRAY);
@@ -2141,11 +2506,11 @@ void ViewportBase::renderSkeleton(const RenderOptions &options) {
 
     if(options.nodePicking) {
         if(options.selectionPass == RenderOptions::SelectionPass::NodeID0_24Bits) {
-            glColorPointer(4, GL_UNSIGNED_BYTE, 0, glBuffers.colorPickingBuffer24.data());
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, glBuffers.pointVertBuffer.pickingColors[0].data());
         } else if(options.selectionPass == RenderOptions::SelectionPass::NodeID24_48Bits) {
-            glColorPointer(4, GL_UNSIGNED_BYTE, 0, glBuffers.colorPickingBuffer48.data());
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, glBuffers.pointVertBuffer.pickingColors[1].data());
         } else if(options.selectionPass == RenderOptions::SelectionPass::NodeID48_64Bits) {
-            glColorPointer(4, GL_UNSIGNED_BYTE, 0, glBuffers.colorPickingBuffer64.data());
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, glBuffers.pointVertBuffer.pickingColors[2].data());
         }
     } else {
         glBuffers.pointVertBuffer.color_buffer.bind();
@@ -2153,7 +2518,8 @@ void ViewportBase::renderSkeleton(const RenderOptions &options) {
         glBuffers.pointVertBuffer.color_buffer.release();
     }
 
-    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(glBuffers.pointVertBuffer.vertices.size()));
+    const auto pointRanges = visibleRanges(glBuffers.pointVertBuffer);
+    glMultiDrawArrays(GL_POINTS, pointRanges.first.data(), pointRanges.second.data(), static_cast<GLsizei>(pointRanges.first.size()));
 
     glDisableClientState(GL_COLOR_ARRAY);
     glDisableClientState(GL_VERTEX_ARRAY);
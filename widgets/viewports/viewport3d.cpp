@@ -24,14 +24,20 @@
 
 #include "dataset.h"
 #include "profiler.h"
+#include "segmentation/palettecube.h"
 #include "segmentation/segmentation.h"
 #include "skeleton/skeletonizer.h"
 #include "stateInfo.h"
 #include "viewer.h"
 
 #include <QMetaObject>
+#include <QMutexLocker>
+#include <QtConcurrent>
 
+#include <array>
+#include <numeric>
 #include <tuple>
+#include <unordered_map>
 
 Viewport3D::Viewport3D(QWidget *parent, ViewportType viewportType) : ViewportBase(parent, viewportType) {
     wiggleButton.setCheckable(true);
@@ -112,14 +118,17 @@ Viewport3D::~Viewport3D() {
     makeCurrent();
     if (Segmentation::singleton().volume_tex_id != 0) {
         glDeleteTextures(1, &Segmentation::singleton().volume_tex_id);
+        glDeleteTextures(1, &Segmentation::singleton().volume_occupancy_tex_id);
     }
     Segmentation::singleton().volume_tex_id = 0;
+    Segmentation::singleton().volume_occupancy_tex_id = 0;
 }
 
 void Viewport3D::paintGL() {
     glClear(GL_DEPTH_BUFFER_BIT);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    pickingMatrixValid = false;// set again if the skeleton is rendered
     renderViewport();
     renderViewportFrontFace();
 }
@@ -156,146 +165,187 @@ void Viewport3D::updateVolumeTexture() {
         glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
         glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA, texLen, texLen, texLen, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        volumeColors.clear();// force full regeneration for the new texture
+
+        const int bricks = (texLen + volumeBrickLen - 1) / volumeBrickLen;
+        glGenTextures(1, &seg.volume_occupancy_tex_id);
+        glBindTexture(GL_TEXTURE_3D, seg.volume_occupancy_tex_id);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_LUMINANCE, bricks, bricks, bricks, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
     }
 
     static Profiler tex_gen_profiler;
-    static Profiler dcfetch_profiler;
     static Profiler colorfetch_profiler;
     static Profiler occlusion_profiler;
     static Profiler tex_transfer_profiler;
 
     tex_gen_profiler.start(); // ----------------------------------------------------------- profiling
-    const auto currentPosDc = Dataset::datasets[seg.layerId].global2cube(state->viewerState->currentPosition);
-    const bool zwei = Dataset::datasets[seg.layerId].boundary.z == 1;
-    const auto cubeLen = Dataset::datasets[seg.layerId].cubeShape;
-    int M = state->M;
-    int M_radius = (M - 1) / 2;
-    GLubyte* colcube = new GLubyte[4*texLen*texLen*(zwei ? 1 : texLen)];
-    std::tuple<uint64_t, Segmentation::color_t> lastIdColor;
-
-    state->protectCube2Pointer.lock();
-
-    dcfetch_profiler.start(); // ----------------------------------------------------------- profiling
-    uint64_t** rawcubes = new uint64_t*[M*M*(zwei ? 1 : M)];
-    for(int z = 0; z < (zwei ? 1 : M); ++z)
-    for(int y = 0; y < M; ++y)
-    for(int x = 0; x < M; ++x) {
-        auto cubeIndex = z*M*M + y*M + x;
-        const CoordOfCube cubeCoordRelative{x - M_radius, y - M_radius, z - M_radius};
-        rawcubes[cubeIndex] = reinterpret_cast<uint64_t*>(cubeQuery(state->cube2Pointer
-            , Segmentation::singleton().layerId, Dataset::datasets[seg.layerId].magIndex, currentPosDc + cubeCoordRelative));
+    const auto & dataset = Dataset::datasets[seg.layerId];
+    const auto currentPosDc = dataset.global2cube(state->viewerState->currentPosition);
+    const bool zwei = dataset.boundary.z == 1;
+    const auto cubeLen = dataset.cubeShape;
+    const int M = state->M;
+    const int M_radius = (M - 1) / 2;
+    const int texDepth = zwei ? 1 : texLen;
+    const std::size_t texBytes = 4 * texLen * texLen * texLen;
+
+    const auto dirtyCubes = seg.takeVolumeUpdate();
+    const bool everything = !dirtyCubes || volumeColors.size() != texBytes || volumeCenterCube != currentPosDc || volumeMagIndex != dataset.magIndex;
+    volumeColors.resize(texBytes);
+    volumeTexData.resize(texBytes);
+    volumeCenterCube = currentPosDc;
+    volumeMagIndex = dataset.magIndex;
+
+    // texel → (cube, voxel) per axis, the volume samples every M-th voxel of the supercube
+    const auto axisLookup = [texLen, M](const int cubeLen){
+        std::vector<std::pair<int, int>> lookup;
+        for (int i = 0; i < texLen; ++i) {
+            lookup.emplace_back(i * M / cubeLen, i * M % cubeLen);
+        }
+        return lookup;
+    };
+    const auto lookupX = axisLookup(cubeLen.x), lookupY = axisLookup(cubeLen.y), lookupZ = axisLookup(cubeLen.z);
+
+    std::vector<bool> dirtySlab(texDepth, everything);
+    if (!everything) {
+        for (const auto & cubeCoord : dirtyCubes.get()) {
+            const auto relative = cubeCoord - currentPosDc + M_radius;
+            if (relative.x < 0 || relative.y < 0 || relative.z < 0 || relative.x >= M || relative.y >= M || relative.z >= M) {
+                continue;
+            }
+            for (int z = 0; z < texDepth; ++z) {
+                dirtySlab[z] = dirtySlab[z] || zwei || lookupZ[z].first == relative.z;
+            }
+        }
+    }
+    std::vector<int> colorSlabs, shadeSlabs;// occlusion reads the neighbouring slabs
+    for (int z = 0; z < texDepth; ++z) {
+        if (dirtySlab[z]) {
+            colorSlabs.emplace_back(z);
+        }
+        if (dirtySlab[z] || (z > 0 && dirtySlab[z - 1]) || (z + 1 < texDepth && dirtySlab[z + 1])) {
+            shadeSlabs.emplace_back(z);
+        }
+    }
+    if (colorSlabs.empty()) {
+        tex_gen_profiler.end(); // ----------------------------------------------------------- profiling
+        return;
     }
-    dcfetch_profiler.end(); // ----------------------------------------------------------- profiling
 
     colorfetch_profiler.start(); // ----------------------------------------------------------- profiling
-
-    for(int z = 0; z < (zwei ? 1 : texLen); ++z)
-    for(int y = 0; y < texLen; ++y)
-    for(int x = 0; x < texLen; ++x) {
-        Coordinate DcCoord{(x * M)/cubeLen.x, (y * M)/cubeLen.y, (z * M)/cubeLen.z};
-        auto cubeIndex = DcCoord.z*M*M + DcCoord.y*M + DcCoord.x;
-        auto& rawcube = rawcubes[cubeIndex];
-
-        if(rawcube != nullptr) {
-            auto indexInDc  = ((z * M)%cubeLen.z)*cubeLen.y*cubeLen.x + ((y * M)%cubeLen.y)*cubeLen.x + (x * M)%cubeLen.x;
-            auto indexInTex = z*texLen*texLen + y*texLen + x;
-            auto subobjectId = rawcube[indexInDc];
-            if(subobjectId == std::get<0>(lastIdColor)) {
-                auto idColor = std::get<1>(lastIdColor);
-                colcube[4*indexInTex+0] = std::get<0>(idColor);
-                colcube[4*indexInTex+1] = std::get<1>(idColor);
-                colcube[4*indexInTex+2] = std::get<2>(idColor);
-                colcube[4*indexInTex+3] = std::get<3>(idColor);
-            } else if (seg.isSubObjectIdSelected(subobjectId)) {
-                auto idColor = seg.colorObjectFromSubobjectId(subobjectId);
-                std::get<3>(idColor) = 255; // ignore color alpha
-                colcube[4*indexInTex+0] = std::get<0>(idColor);
-                colcube[4*indexInTex+1] = std::get<1>(idColor);
-                colcube[4*indexInTex+2] = std::get<2>(idColor);
-                colcube[4*indexInTex+3] = std::get<3>(idColor);
-                lastIdColor = std::make_tuple(subobjectId, idColor);
-            } else {
-                colcube[4*indexInTex+0] = 0;
-                colcube[4*indexInTex+1] = 0;
-                colcube[4*indexInTex+2] = 0;
-                colcube[4*indexInTex+3] = 0;
-            }
-        } else {
-            auto indexInTex = z*texLen*texLen + y*texLen + x;
-            colcube[4*indexInTex+0] = 0;
-            colcube[4*indexInTex+1] = 0;
-            colcube[4*indexInTex+2] = 0;
-            colcube[4*indexInTex+3] = 0;
+    {
+        QMutexLocker locker(&state->protectCube2Pointer);
+        std::vector<const std::uint64_t *> rawcubes(M * M * (zwei ? 1 : M));
+        std::vector<std::shared_ptr<const PaletteCube>> packedCubes(rawcubes.size());
+        for(int z = 0; z < (zwei ? 1 : M); ++z)
+        for(int y = 0; y < M; ++y)
+        for(int x = 0; x < M; ++x) {
+            const CoordOfCube cubeCoordRelative{x - M_radius, y - M_radius, z - M_radius};
+            rawcubes[z*M*M + y*M + x] = reinterpret_cast<const std::uint64_t *>(cubeQuery(state->cube2Pointer, seg.layerId, dataset.magIndex, currentPosDc + cubeCoordRelative));
+            packedCubes[z*M*M + y*M + x] = paletteQuery(state->cube2Palette, seg.layerId, dataset.magIndex, currentPosDc + cubeCoordRelative);
         }
+        QtConcurrent::blockingMap(colorSlabs, [&](const int z){
+            std::unordered_map<std::uint64_t, Segmentation::color_t> colorCache;// few ids per slab
+            auto * texel = volumeColors.data() + 4 * z * texLen * texLen;
+            const auto [cubeZ, voxelZ] = lookupZ[z];
+            for(int y = 0; y < texLen; ++y) {
+                const auto [cubeY, voxelY] = lookupY[y];
+                for(int x = 0; x < texLen; ++x, texel += 4) {
+                    const auto [cubeX, voxelX] = lookupX[x];
+                    const bool inside = cubeX < M && cubeY < M && cubeZ < M;
+                    const auto * rawcube = inside ? rawcubes[cubeZ*M*M + cubeY*M + cubeX] : nullptr;
+                    const auto * packedCube = inside ? packedCubes[cubeZ*M*M + cubeY*M + cubeX].get() : nullptr;
+                    Segmentation::color_t idColor{};
+                    if (rawcube != nullptr || packedCube != nullptr) {
+                        const auto subobjectId = rawcube != nullptr ? rawcube[voxelZ*cubeLen.y*cubeLen.x + voxelY*cubeLen.x + voxelX] : packedCube->at(voxelX, voxelY, voxelZ);
+                        auto it = colorCache.find(subobjectId);
+                        if (it == std::end(colorCache)) {
+                            Segmentation::color_t color{};
+                            if (seg.isSubObjectIdSelected(subobjectId)) {
+                                color = seg.colorObjectFromSubobjectId(subobjectId);
+                                std::get<3>(color) = 255; // ignore color alpha
+                            }
+                            it = colorCache.emplace(subobjectId, color).first;
+                        }
+                        idColor = it->second;
+                    }
+                    std::tie(texel[0], texel[1], texel[2], texel[3]) = idColor;
+                }
+            }
+        });
     }
-
-    delete[] rawcubes;
-
-    state->protectCube2Pointer.unlock();
-
     colorfetch_profiler.end(); // ----------------------------------------------------------- profiling
 
     occlusion_profiler.start(); // ----------------------------------------------------------- profiling
-    for(int z = 1; z < (zwei ? 1 : texLen - 1); ++z)
-    for(int y = 1; y < texLen - 1; ++y)
-    for(int x = 1; x < texLen - 1; ++x) {
-        auto indexInTex = (z)*texLen*texLen + (y)*texLen + x;
-        if(colcube[4*indexInTex+3] != 0) {
-            for(int xi = -1; xi <= 1; ++xi) {
-                auto othrIndexInTex = (z)*texLen*texLen + (y)*texLen + x+xi;
-                if((xi != 0) && colcube[4*othrIndexInTex+3] != 0) {
-                    colcube[4*indexInTex+0] *= 0.95f;
-                    colcube[4*indexInTex+1] *= 0.95f;
-                    colcube[4*indexInTex+2] *= 0.95f;
-                }
+    // darken by 0.95 for each of the 6 direct neighbours that is filled as well
+    static const auto occlusion = [](){
+        std::array<std::array<std::uint8_t, 256>, 7> lut;
+        for (std::size_t neighbours = 0; neighbours < lut.size(); ++neighbours) {
+            for (std::size_t value = 0; value < lut[neighbours].size(); ++value) {
+                lut[neighbours][value] = value * std::pow(0.95f, neighbours);
             }
         }
-    }
-
-    for(int z = 1; z < (zwei ? 1 : texLen - 1); ++z)
-    for(int y = 1; y < texLen - 1; ++y)
-    for(int x = 1; x < texLen - 1; ++x) {
-        auto indexInTex = (z)*texLen*texLen + (y)*texLen + x;
-        if(colcube[4*indexInTex+3] != 0) {
-            for(int yi = -1; yi <= 1; ++yi) {
-                auto othrIndexInTex = (z)*texLen*texLen + (y+yi)*texLen + x;
-                if((yi != 0) && colcube[4*othrIndexInTex+3] != 0) {
-                    colcube[4*indexInTex+0] *= 0.95f;
-                    colcube[4*indexInTex+1] *= 0.95f;
-                    colcube[4*indexInTex+2] *= 0.95f;
+        return lut;
+    }();
+    QtConcurrent::blockingMap(shadeSlabs, [&](const int z){
+        const std::size_t slabBytes = 4 * texLen * texLen;
+        std::copy_n(volumeColors.data() + z * slabBytes, slabBytes, volumeTexData.data() + z * slabBytes);
+        if (zwei || z == 0 || z == texLen - 1) {
+            return;
+        }
+        for(int y = 1; y < texLen - 1; ++y)
+        for(int x = 1; x < texLen - 1; ++x) {
+            const std::size_t indexInTex = z*texLen*texLen + y*texLen + x;
+            if (volumeColors[4*indexInTex+3] != 0) {
+                int neighbours{0};
+                for (const std::size_t offset : {std::size_t{1}, static_cast<std::size_t>(texLen), static_cast<std::size_t>(texLen * texLen)}) {
+                    neighbours += (volumeColors[4*(indexInTex-offset)+3] != 0) + (volumeColors[4*(indexInTex+offset)+3] != 0);
+                }
+                for (int channel = 0; channel < 3; ++channel) {
+                    volumeTexData[4*indexInTex+channel] = occlusion[neighbours][volumeColors[4*indexInTex+channel]];
                 }
             }
         }
-    }
+    });
+    occlusion_profiler.end(); // ----------------------------------------------------------- profiling
 
-    for(int z = 1; z < (zwei ? 1 : texLen - 1); ++z)
-    for(int y = 1; y < texLen - 1; ++y)
-    for(int x = 1; x < texLen - 1; ++x) {
-        auto indexInTex = (z)*texLen*texLen + (y)*texLen + x;
-        if(colcube[4*indexInTex+3] != 0) {
-            for(int zi = -1; zi <= 1; ++zi) {
-                auto othrIndexInTex = (z+zi)*texLen*texLen + (y)*texLen + x;
-                if((zi != 0) && colcube[4*othrIndexInTex+3] != 0) {
-                    colcube[4*indexInTex+0] *= 0.95f;
-                    colcube[4*indexInTex+1] *= 0.95f;
-                    colcube[4*indexInTex+2] *= 0.95f;
-                }
+    const int zBegin = everything ? 0 : shadeSlabs.front(), zEnd = everything ? texLen : shadeSlabs.back() + 1;// whole texture also clears unused slabs of 2D datasets
+    // one byte per brick whether anything is filled, so the raycaster can skip empty space
+    const int bricks = (texLen + volumeBrickLen - 1) / volumeBrickLen;
+    volumeOccupancy.resize(bricks * bricks * bricks);
+    const int brickBegin = zBegin / volumeBrickLen, brickEnd = (zEnd - 1) / volumeBrickLen + 1;
+    std::vector<int> brickSlabs(brickEnd - brickBegin);
+    std::iota(std::begin(brickSlabs), std::end(brickSlabs), brickBegin);
+    QtConcurrent::blockingMap(brickSlabs, [&](const int brickZ){
+        auto * occupancy = volumeOccupancy.data() + brickZ * bricks * bricks;
+        std::fill(occupancy, occupancy + bricks * bricks, 0);
+        for(int z = brickZ * volumeBrickLen; z < std::min(texDepth, (brickZ + 1) * volumeBrickLen); ++z)
+        for(int y = 0; y < texLen; ++y)
+        for(int x = 0; x < texLen; ++x) {
+            if (volumeColors[4*(z*texLen*texLen + y*texLen + x)+3] != 0) {
+                occupancy[(y / volumeBrickLen) * bricks + x / volumeBrickLen] = 255;
             }
         }
-    }
-    occlusion_profiler.end(); // ----------------------------------------------------------- profiling
+    });
 
     tex_transfer_profiler.start(); // ----------------------------------------------------------- profiling
     glBindTexture(GL_TEXTURE_3D, seg.volume_tex_id);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA, texLen, texLen, texLen, 0, GL_RGBA, GL_UNSIGNED_BYTE, colcube);
-    delete[] colcube;
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, zBegin, texLen, texLen, zEnd - zBegin, GL_RGBA, GL_UNSIGNED_BYTE, volumeTexData.data() + 4 * zBegin * texLen * texLen);
+    glBindTexture(GL_TEXTURE_3D, seg.volume_occupancy_tex_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, brickBegin, bricks, bricks, brickEnd - brickBegin, GL_LUMINANCE, GL_UNSIGNED_BYTE, volumeOccupancy.data() + brickBegin * bricks * bricks);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
     tex_transfer_profiler.end(); // ----------------------------------------------------------- profiling
 
     tex_gen_profiler.end(); // ----------------------------------------------------------- profiling
 
     // --------------------- display some profiling information ------------------------
     // qDebug() << "tex gen avg time: " << tex_gen_profiler.average_time()*1000 << "ms";
-    // qDebug() << "    dc fetch    : " << dcfetch_profiler.average_time()*1000 << "ms";
     // qDebug() << "    color fetch : " << colorfetch_profiler.average_time()*1000 << "ms";
     // qDebug() << "    occlusion   : " << occlusion_profiler.average_time()*1000 << "ms";
     // qDebug() << "    tex transfer: " << tex_transfer_profiler.average_time()*1000 << "ms";
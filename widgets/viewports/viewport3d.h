@@ -28,6 +28,8 @@
 #include <QThread>
 #include <QTimer>
 
+#include <vector>
+
 class Viewport3D : public ViewportBase {
     Q_OBJECT
     QThread timerThread;
@@ -41,6 +43,12 @@ class Viewport3D : public ViewportBase {
     bool wiggleDirection{true};
     int wiggle{0};
     QTimer wiggletimer, rotationTimer;
+    std::vector<std::uint8_t> volumeColors;// segmentation volume before occlusion, kept for partial updates
+    std::vector<std::uint8_t> volumeTexData;
+    static constexpr int volumeBrickLen{8};
+    std::vector<std::uint8_t> volumeOccupancy;// per brick, for empty space skipping
+    CoordOfCube volumeCenterCube;
+    std::size_t volumeMagIndex{0};
     void renderVolumeVP();
     void renderSkeletonVP(const RenderOptions & options = RenderOptions());
     virtual void renderViewport(const RenderOptions &options = RenderOptions()) override;
@@ -34,6 +34,13 @@
 #include <QMenu>
 #include <QMessageBox>
 
+#include <boost/math/constants/constants.hpp>
+
+#include <array>
+#include <cmath>
+#include <utility>
+#include <vector>
+
 // init here to avoid massive recompile
 #ifndef NDEBUG
 bool ViewportBase::oglDebug = true;
@@ -242,6 +249,35 @@ void ViewportBase::resizeEvent(QResizeEvent *event) {
 }
 
 
+// two triangles per quad of a parametrized surface
+static const std::array<std::pair<int, int>, 6> quadCorners{{{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}}};
+
+static std::vector<floatCoordinate> unitSphere(const int slices) {
+    const auto pi = boost::math::constants::pi<float>();
+    std::vector<floatCoordinate> vertices;
+    for (int stack = 0; stack < slices; ++stack)
+    for (int slice = 0; slice < slices; ++slice) {
+        for (const auto & corner : quadCorners) {
+            const auto theta = pi * (stack + corner.first) / slices;
+            const auto phi = 2 * pi * (slice + corner.second) / slices;
+            vertices.emplace_back(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+        }
+    }
+    return vertices;
+}
+
+static std::vector<floatCoordinate> unitCylinder(const int edges) {
+    const auto pi = boost::math::constants::pi<float>();
+    std::vector<floatCoordinate> vertices;
+    for (int edge = 0; edge < edges; ++edge) {
+        for (const auto & corner : quadCorners) {
+            const auto angle = 2 * pi * (edge + corner.first) / edges;
+            vertices.emplace_back(std::cos(angle), std::sin(angle), corner.second);
+        }
+    }
+    return vertices;
+}
+
 void ViewportBase::initializeGL() {
     static bool printed = false;
     const auto glversion  = reinterpret_cast<const char*>(::glGetString(GL_VERSION));
@@ -298,6 +334,9 @@ void ViewportBase::initializeGL() {
     createShader(raw_data_shader, {"3DTexture.vert"}, {"3DTexture.frag"});
     createShader(overlay_data_shader, {"3DTexture.vert"}, {"3DTextureLUT.frag"});
     createShader(shaderTextureQuad, {"texturequad.vert"}, {"texturequad.frag"});
+    createShader(volumeRaycastShader, {"texturequad.vert"}, {"texturequad volumeraycast.frag"});
+    createShader(instancedSphereShader, {"instancedsphere.vert"}, {"functions/diffuse.frag", "color instanced.frag"});
+    createShader(instancedCylinderShader, {"instancedcylinder.vert"}, {"functions/diffuse.frag", "color instanced.frag"});
     for (auto * shader : shaders) {
         if (!shader->log().isEmpty() && viewportType == VIEWPORT_SKELETON) {
             qDebug().noquote() << shader->log();
@@ -313,6 +352,26 @@ void ViewportBase::initializeGL() {
     screenVertexBuf.bind();
     screenVertexBuf.allocate(vertices.data(), vertices.size() * sizeof(vertices.front()));
     screenVertexBuf.release();
+
+    const auto * ctx = context();
+    instancingSupported = instancedSphereShader.isLinked() && instancedCylinderShader.isLinked()
+            && (ctx->format().version() >= qMakePair(3, 3) || (ctx->hasExtension("GL_ARB_instanced_arrays") && ctx->hasExtension("GL_ARB_draw_instanced")));
+    const auto uploadUnitMesh = [](InstancedMesh & mesh, const std::vector<floatCoordinate> & vertices){
+        if (!mesh.vertexBuffer.isCreated()) {
+            mesh.vertexBuffer.create();
+            mesh.instanceBuffer.create();
+        }
+        mesh.vertexBuffer.bind();
+        mesh.vertexBuffer.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(vertices.front())));
+        mesh.vertexBuffer.release();
+        mesh.vertexCount = static_cast<int>(vertices.size());
+    };
+    // same detail levels as the gluSphere and gluCylinder fallbacks
+    const std::array<int, 3> sphereSlices{{5, 8, 14}}, cylinderEdges{{3, 6, 10}};
+    for (std::size_t lod = 0; lod < sphereLods.size(); ++lod) {
+        uploadUnitMesh(sphereLods[lod], unitSphere(sphereSlices[lod]));
+        uploadUnitMesh(cylinderLods[lod], unitCylinder(cylinderEdges[lod]));
+    }
 }
 
 void ViewportBase::resizeGL(int width, int height) {
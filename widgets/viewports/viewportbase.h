@@ -28,6 +28,7 @@
 
 #include <QAction>
 #include <QDialog>
+#include <QMatrix4x4>
 #include <QMenu>
 #include <QOpenGLBuffer>
 #include <QOpenGLDebugLogger>
@@ -43,6 +44,7 @@
 
 #include <boost/optional.hpp>
 
+#include <array>
 #include <vector>
 
 enum ViewportType {VIEWPORT_XY, VIEWPORT_XZ, VIEWPORT_ZY, VIEWPORT_ARBITRARY, VIEWPORT_SKELETON, VIEWPORT_UNDEFINED};
@@ -144,6 +146,22 @@ protected:
     QAction *zoomEndSeparator;
     QOpenGLTexture emptyMask{QOpenGLTexture::Target2D};
     QOpenGLBuffer screenVertexBuf{QOpenGLBuffer::VertexBuffer};
+
+    struct InstancedMesh {// unit mesh drawn once per collected instance
+        struct Instance {
+            std::array<float, 4> base;// sphere center or cylinder base and its radius
+            std::array<float, 4> top;// cylinder top and its radius
+            std::array<std::uint8_t, 4> color;
+        };
+        QOpenGLBuffer vertexBuffer{QOpenGLBuffer::VertexBuffer};
+        QOpenGLBuffer instanceBuffer{QOpenGLBuffer::VertexBuffer};
+        int vertexCount{0};
+        std::vector<Instance> instances;
+    };
+    bool instancingSupported{false};
+    bool collectInstances{false};// renderSphere and renderCylinder only queue instances
+    std::array<InstancedMesh, 3> sphereLods, cylinderLods;// low to high detail
+    void renderInstances(QOpenGLShaderProgram & shader, std::array<InstancedMesh, 3> & lods);
 private:
     QOpenGLDebugLogger oglLogger;
     QWidget *dockParent;
@@ -171,6 +189,9 @@ protected:
     QOpenGLShaderProgram meshSlicingWithMaskShader;
     QOpenGLShaderProgram meshSlicingIdShader;
     QOpenGLShaderProgram shaderTextureQuad;
+    QOpenGLShaderProgram volumeRaycastShader;
+    QOpenGLShaderProgram instancedSphereShader;
+    QOpenGLShaderProgram instancedCylinderShader;
 
     QOpenGLShaderProgram raw_data_shader;
     QOpenGLShaderProgram overlay_data_shader;
@@ -195,6 +216,9 @@ protected:
     virtual void renderNode(const nodeListElement & node, const RenderOptions & options = RenderOptions());
     bool updateFrustumClippingPlanes();
     virtual void renderViewportFrontFace();
+    QMatrix4x4 pickingMatrix;// projection * modelview of the last rendered skeleton
+    bool pickingMatrixValid{false};
+    boost::optional<hash_list<nodeListElement *>> pickNodesFromIndex(int centerX, int centerY, int width, int height);
     hash_list<nodeListElement *> pickNodes(int centerX, int centerY, int width, int height);
     boost::optional<nodeListElement &> pickNode(int x, int y, int width);
     void handleLinkToggle(const QMouseEvent & event);
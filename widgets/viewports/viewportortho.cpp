@@ -75,6 +75,7 @@ void ViewportOrtho::paintGL() {
     glClearColor(0, 0, 0, 0);
     glEnable(GL_BLEND);
     glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    pickingMatrixValid = false;// set again if the skeleton is rendered
     if (state->gpuSlicer && state->viewer->gpuRendering) {
         renderViewportFast();
     } else {